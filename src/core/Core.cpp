@@ -1,14 +1,19 @@
 #include "Core.h"
 
 #include <algorithm>
+#include <chrono>
+#include <cmath>
 #include <cstddef>
+#include <future>
 #include <iomanip>
 #include <iostream>
 #include <sstream>
 #include <stdexcept>
+#include <thread>
 #include <utility>
 
 #include <glad/gl.h>
+#include <glm/gtc/matrix_transform.hpp>
 #include <imgui.h>
 #include <imgui_impl_glfw.h>
 #include <imgui_impl_opengl3.h>
@@ -16,10 +21,24 @@
 #include "PluginDescriptor.h"
 #include "PluginRegister.h"
 #include "RenderPlugin.h"
+#include "util/Benchmark.h"
 #include "util/FileUtil.h"
+#include "util/FileWatcher.h"
+#include "util/FrameReadback.h"
+#include "util/FrameStream.h"
 #include "util/GLFWUtil.h"
 #include "util/GLUtil.h"
 #include "util/ImageUtil.h"
+#include "util/Log.h"
+#include "util/PngStreamWriter.h"
+#include "util/Profiler.h"
+#include "util/ProgramBinaryCache.h"
+#include "util/QualityController.h"
+#include "util/RenderTarget.h"
+#include "util/ResourceArchive.h"
+#include "util/ResourceCache.h"
+#include "util/ShaderProgram.h"
+#include "util/ThreadPool.h"
 
 using namespace OGL4Core2::Core;
 
@@ -29,12 +48,30 @@ static constexpr int openGLVersionMajor = 4;
 static constexpr int openGLVersionMinor = 5;
 static constexpr char imguiGlslVersion[] = "#version 450";
 static constexpr char title[] = "OGL4Core2";
+static constexpr std::size_t numScreenshotBuffers = 3;
+// Capture streams drop frames instead of stalling the render loop, if more frames are in flight.
+static constexpr std::size_t numCaptureBuffers = 3;
+static constexpr std::size_t captureQueueFrames = 8;
+// Adaptive render scales are rounded up to multiples of 1 / renderScaleSteps, so the render size and thereby the plugin
+// buffers only change in coarse steps.
+static constexpr float renderScaleSteps = 20.0f;
+// Lowest render scale and minimum render scale, for the command line and the GUI.
+static constexpr float lowestRenderScale = 0.1f;
+// In on-demand mode, ImGui needs a few frames after an input event to settle, e.g. for hover highlights and layout.
+static constexpr int onDemandSettleFrames = 3;
+// Maximum blocking time while waiting for events in on-demand mode, the shader file watcher is polled in between.
+static constexpr double onDemandWaitTimeout = 0.25;
 
 Core::Core(Config cfg)
     : cfg_(std::move(cfg)),
       window_(nullptr),
+      projectionTileMatrix_(1.0f),
+      posterPending_(cfg_.posterWidth > 0 && cfg_.posterHeight > 0),
+      pluginQuality_(1.0f),
       running_(false),
       frameNumber_(0),
+      imguiMemory_("ImGui font atlas", MemoryCategory::ImGui, MemoryLocation::Gpu, 0, "Core"),
+      frameStartAllocations_(AllocationCounter::get()),
       currentPlugin_(nullptr),
       currentPluginIdx_(-1),
       pluginSelectionIdx_(0),
@@ -43,22 +80,27 @@ Core::Core(Config cfg)
       framebufferWidth_(-1),
       framebufferHeight_(-1),
       contentScale_(-1.0f),
+      renderWidth_(-1),
+      renderHeight_(-1),
+      renderScale_(std::clamp(cfg_.renderScale, lowestRenderScale, 1.0f)),
+      minRenderScale_(std::clamp(cfg_.minRenderScale, lowestRenderScale, 1.0f)),
+      adaptiveRenderScale_(1.0f),
       mouseX_(0.0),
       mouseY_(0.0),
-      cameraControlMode_(AbstractCamera::MouseControlMode::None) {
-    Core::initGLFW();
-
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, openGLVersionMajor);
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, openGLVersionMinor);
-    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GLFW_TRUE);
-    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
-    glfwWindowHint(GLFW_OPENGL_DEBUG_CONTEXT, GLFW_TRUE);
-    glfwWindowHint(GLFW_SCALE_TO_MONITOR, GLFW_TRUE);
-
-    window_ = glfwCreateWindow(initWindowSizeWidth, initWindowSizeHeight, title, nullptr, nullptr);
-    if (!window_) {
-        Core::terminateGLFW();
-        throw std::runtime_error("GLFW window creation failed!");
+      inputEventTime_(0.0),
+      cameraControlMode_(AbstractCamera::MouseControlMode::None),
+      synchronousPluginLoad_(false),
+      onDemand_(cfg_.onDemandRendering && !cfg_.headless && !cfg_.benchmark && cfg_.screenshotFrames.empty() &&
+                cfg_.captureStream.empty()),
+      redrawRequested_(true),
+      redrawFrames_(0) {
+    Log::setVerbose(cfg_.verbose);
+    Core::initGLFW(cfg_.headless);
+
+    if (cfg_.headless) {
+        createHeadlessWindow();
+    } else {
+        createWindow();
     }
 
     glfwMakeContextCurrent(window_);
@@ -82,17 +124,38 @@ Core::Core(Config cfg)
     // ignore notifications
     glDebugMessageControl(GL_DONT_CARE, GL_DONT_CARE, GL_DEBUG_SEVERITY_NOTIFICATION, 0, nullptr, GL_FALSE);
 
-    // The initial size above is only a hint for the window manager, but no guarantied window size. Further the window
-    // size can be adjusted by DPI scaling on some systems. This initial resize will not be caught by the callback
-    // events. Therefore, here do an initial size query.
-    glfwGetWindowSize(window_, &windowWidth_, &windowHeight_);
-    glfwGetFramebufferSize(window_, &framebufferWidth_, &framebufferHeight_);
+    // Shader hot reloading compiles on driver threads, without stalling the frame.
+    ShaderProgram::initParallelCompile(glfwGetProcAddress);
+
+    if (cfg_.headless) {
+        // There is no window system framebuffer, plugins render into an offscreen target of fixed size instead.
+        windowWidth_ = framebufferWidth_ = cfg_.headlessWidth;
+        windowHeight_ = framebufferHeight_ = cfg_.headlessHeight;
+        offscreenTarget_ = std::make_unique<RenderTarget>(framebufferWidth_, framebufferHeight_);
+        if (!cfg_.autoQuit) {
+            std::cout << "Headless mode without auto quit, rendering continues until the process is terminated."
+                      << std::endl;
+        }
+    } else {
+        // The initial window size is only a hint for the window manager, but no guarantied window size. Further the
+        // window size can be adjusted by DPI scaling on some systems. This initial resize will not be caught by the
+        // callback events. Therefore, here do an initial size query.
+        glfwGetWindowSize(window_, &windowWidth_, &windowHeight_);
+        glfwGetFramebufferSize(window_, &framebufferWidth_, &framebufferHeight_);
+        if (onDemand_ && framebufferWidth_ > 0 && framebufferHeight_ > 0) {
+            offscreenTarget_ = std::make_unique<RenderTarget>(framebufferWidth_, framebufferHeight_);
+        }
+    }
 
     glfwSetWindowUserPointer(window_, this);
 
     glfwSetWindowRefreshCallback(window_, [](GLFWwindow* window) {
-        static_cast<Core*>(glfwGetWindowUserPointer(window))->draw();
-        glfwSwapBuffers(window);
+        auto* core = static_cast<Core*>(glfwGetWindowUserPointer(window));
+        if (!core->onDemand_) {
+            core->draw();
+        }
+        // In on-demand mode the last frame is still valid, it is only presented again.
+        core->present();
     });
 
     // Map callbacks to core class methods
@@ -102,20 +165,37 @@ Core::Core(Config cfg)
     glfwSetFramebufferSizeCallback(window_, [](GLFWwindow* window, int width, int height) {
         static_cast<Core*>(glfwGetWindowUserPointer(window))->framebufferSizeEvent(width, height);
     });
+    // Input is queued and dispatched once per frame in dispatchInputEvents().
     glfwSetKeyCallback(window_, [](GLFWwindow* window, int key, int scancode, int action, int mods) {
-        static_cast<Core*>(glfwGetWindowUserPointer(window))->keyEvent(key, scancode, action, mods);
+        InputEvent event{InputEvent::Type::Key, glfwGetTime()};
+        event.code = key;
+        event.scancode = scancode;
+        event.action = action;
+        event.mods = mods;
+        static_cast<Core*>(glfwGetWindowUserPointer(window))->inputQueue_.push(event);
     });
     glfwSetCharCallback(window_, [](GLFWwindow* window, unsigned int codepoint) {
-        static_cast<Core*>(glfwGetWindowUserPointer(window))->charEvent(codepoint);
+        InputEvent event{InputEvent::Type::Char, glfwGetTime()};
+        event.codepoint = codepoint;
+        static_cast<Core*>(glfwGetWindowUserPointer(window))->inputQueue_.push(event);
     });
     glfwSetMouseButtonCallback(window_, [](GLFWwindow* window, int button, int action, int mods) {
-        static_cast<Core*>(glfwGetWindowUserPointer(window))->mouseButtonEvent(button, action, mods);
+        InputEvent event{InputEvent::Type::MouseButton, glfwGetTime()};
+        event.code = button;
+        event.action = action;
+        event.mods = mods;
+        static_cast<Core*>(glfwGetWindowUserPointer(window))->inputQueue_.push(event);
     });
     glfwSetCursorPosCallback(window_, [](GLFWwindow* window, double xpos, double ypos) {
-        static_cast<Core*>(glfwGetWindowUserPointer(window))->mouseMoveEvent(xpos, ypos);
+        auto* core = static_cast<Core*>(glfwGetWindowUserPointer(window));
+        const bool coalesce = core->currentPlugin_ == nullptr || !core->currentPlugin_->isRawMouseInput();
+        core->inputQueue_.pushMouseMove(glfwGetTime(), xpos, ypos, coalesce);
     });
     glfwSetScrollCallback(window_, [](GLFWwindow* window, double xoffset, double yoffset) {
-        static_cast<Core*>(glfwGetWindowUserPointer(window))->mouseScrollEvent(xoffset, yoffset);
+        InputEvent event{InputEvent::Type::MouseScroll, glfwGetTime()};
+        event.x = xoffset;
+        event.y = yoffset;
+        static_cast<Core*>(glfwGetWindowUserPointer(window))->inputQueue_.push(event);
     });
 
     // Setup Dear ImGui
@@ -147,16 +227,68 @@ Core::Core(Config cfg)
     // Plugins will be initialized on the fly in render method. No need to duplicate initialization here.
 
     // Find default plugin by name
+    bool defaultPluginFound = false;
     if (!cfg_.defaultPluginName.empty()) {
         const auto& plugins = PluginRegister::getAll();
         for (std::size_t i = 0; i < plugins.size(); i++) {
             if (cfg_.defaultPluginName == plugins[i]->name()) {
                 pluginSelectionIdx_ = static_cast<int>(i);
+                defaultPluginFound = true;
                 break;
             }
         }
     }
 
+    if (cfg_.benchmark) {
+        // Silently benchmarking another plugin would produce misleading numbers.
+        if (!defaultPluginFound) {
+            throw std::runtime_error("Benchmark plugin \"" + cfg_.defaultPluginName + "\" not found!");
+        }
+        benchmark_ = std::make_unique<Benchmark>(Benchmark::Config{
+            cfg_.defaultPluginName, cfg_.benchmarkWarmupFrames, cfg_.benchmarkFrames, cfg_.benchmarkFilename});
+        // Frame times must not be bound to the display refresh rate.
+        glfwSwapInterval(0);
+    }
+
+    ResourceCache::setCapacity(cfg_.resourceCacheSizeMiB * 1024 * 1024);
+
+    if (cfg_.programBinaryCache) {
+        const auto cacheDir = cfg_.programBinaryCacheDir.empty() ? FileUtil::getUserCachePath() / "programs"
+                                                                 : std::filesystem::path(cfg_.programBinaryCacheDir);
+        ProgramBinaryCache::init(cacheDir);
+    }
+
+    // Non-interactive runs wait for the plugin loading, so frame numbers of screenshots and benchmarks always refer to
+    // frames of the loaded plugin.
+    synchronousPluginLoad_ = cfg_.headless || cfg_.benchmark || !cfg_.screenshotFrames.empty() || posterPending_;
+
+    // PNG encoding of screenshots is slow, it is done on worker threads fed by an asynchronous readback.
+    // The render thread takes part in parallelFor() and task graphs, leaving one hardware thread to it.
+    workerPool_ = std::make_unique<ThreadPool>(cfg_.workerThreads > 0
+                                                   ? cfg_.workerThreads
+                                                   : std::max(2u, std::thread::hardware_concurrency()) - 1);
+    screenshotReadback_ = std::make_unique<FrameReadback>(*workerPool_, numScreenshotBuffers);
+    if (!cfg_.captureStream.empty()) {
+        captureStream_ = std::make_unique<FrameStream>(cfg_.captureStream,
+            FrameStream::parseFormat(cfg_.captureFormat), cfg_.captureFps, captureQueueFrames);
+        captureReadback_ = std::make_unique<FrameReadback>(*workerPool_, numCaptureBuffers);
+    }
+
+    profiler_ = std::make_unique<Profiler>(cfg_.profileTraceFilename);
+    profiler_->setEnabled(!cfg_.profileTraceFilename.empty());
+
+    // Benchmarks measure the plugin at full quality.
+    qualityController_ =
+        std::make_unique<QualityController>(cfg_.benchmark ? 0.0 : cfg_.targetFrameTime, cfg_.minQuality);
+
+    if (cfg_.screenshotFormat != "png" && cfg_.screenshotFormat != "png-fast" && cfg_.screenshotFormat != "png-raw" &&
+        cfg_.screenshotFormat != "qoi") {
+        throw std::runtime_error("Unknown screenshot format \"" + cfg_.screenshotFormat + "\"!");
+    }
+    if (cfg_.posterWidth < 0 || cfg_.posterHeight < 0 || cfg_.posterTileSize < 1) {
+        throw std::runtime_error("Invalid poster size!");
+    }
+
     // Sort and filter screenshot frame list
     if (!cfg_.screenshotFrames.empty()) {
         std::sort(cfg_.screenshotFrames.begin(), cfg_.screenshotFrames.end());
@@ -172,6 +304,18 @@ Core::~Core() {
     // Delete active plugin here, before destroying the OpenGL context.
     camera_.reset();
     currentPlugin_ = nullptr;
+    cancelPluginLoading();
+    renderThreadTasks_.clear();
+    // Waits for pending screenshots.
+    screenshotReadback_.reset();
+    captureReadback_.reset();
+    captureStream_.reset();
+    posterTarget_.reset();
+    workerPool_.reset();
+    profiler_.reset();
+    qualityController_.reset();
+    scaledTarget_.reset();
+    offscreenTarget_.reset();
 
     ImGui_ImplOpenGL3_Shutdown();
     ImGui_ImplGlfw_Shutdown();
@@ -187,6 +331,25 @@ void Core::run() {
     }
     running_ = true;
     while (!glfwWindowShouldClose(window_)) {
+        if (onDemand_ && !needsRedraw()) {
+            // Nothing has changed, block until the next event. File changes do not wake up the event loop, therefore
+            // the shader watcher is polled after a timeout.
+            glfwWaitEventsTimeout(onDemandWaitTimeout);
+            dispatchInputEvents();
+            runRenderThreadTasks();
+            updateShaderPrograms();
+            continue;
+        }
+        redrawRequested_ = false;
+        redrawFrames_ = std::max(0, redrawFrames_ - 1);
+        // Heap allocations of a full frame, including the tasks run on the render thread.
+        const auto allocations = AllocationCounter::get();
+        frameAllocations_.allocations = allocations.allocations - frameStartAllocations_.allocations;
+        frameAllocations_.bytes = allocations.bytes - frameStartAllocations_.bytes;
+        frameStartAllocations_ = allocations;
+
+        runRenderThreadTasks();
+
         frameNumber_++;
 
         if (fps_.tick()) {
@@ -194,12 +357,46 @@ void Core::run() {
             glfwSetWindowTitle(window_, windowTitle.c_str());
         }
 
+        if (benchmark_ != nullptr && benchmark_->isRunning()) {
+            auto camera = camera_.lock();
+            if (camera) {
+                benchmark_->updateCamera(*camera);
+            }
+        }
+
+        profiler_->beginFrame(frameNumber_);
         draw();
+        profiler_->endFrame();
 
         screenshot();
-
-        glfwSwapBuffers(window_);
+        captureFrame();
+        present();
+        frameArena_.reset();
+
+        if (benchmark_ != nullptr && benchmark_->isRunning()) {
+            // Measure the full frame including all GPU work.
+            glFinish();
+            if (benchmark_->frameFinished()) {
+                benchmark_->writeReport(framebufferWidth_, framebufferHeight_);
+                std::cout << "Benchmark results written to " << cfg_.benchmarkFilename << std::endl;
+                glfwSetWindowShouldClose(window_, GLFW_TRUE);
+            }
+        }
         glfwPollEvents();
+        dispatchInputEvents();
+    }
+    screenshotReadback_->finish();
+    if (captureReadback_ != nullptr) {
+        captureReadback_->finish();
+        const auto stats = captureStream_->getStats();
+        std::cerr << "Capture stream: " << stats.written << " frames written, "
+                  << stats.droppedReadback + stats.droppedQueue << " dropped (readback busy " << stats.droppedReadback
+                  << ", writer busy " << stats.droppedQueue << "), " << stats.scaled << " scaled to the stream size"
+                  << std::endl;
+    }
+    if (!cfg_.profileTraceFilename.empty()) {
+        profiler_->exportChromeTrace(cfg_.profileTraceFilename);
+        std::cout << "Profiler trace written to " << cfg_.profileTraceFilename << std::endl;
     }
     running_ = false;
 }
@@ -211,6 +408,65 @@ std::filesystem::path Core::getPluginResourcesPath() const {
     return currentPluginResourcesPath_;
 }
 
+std::shared_ptr<const ResourceArchive> Core::getPluginResourceArchive() const {
+    return currentPluginArchive_;
+}
+
+GLuint Core::getDefaultFramebuffer() const {
+    if (posterTarget_ != nullptr) {
+        return posterTarget_->fbo();
+    }
+    return scaledTarget_ != nullptr ? scaledTarget_->fbo() : getOutputFramebuffer();
+}
+
+GLuint Core::getOutputFramebuffer() const {
+    return offscreenTarget_ != nullptr ? offscreenTarget_->fbo() : 0;
+}
+
+const glm::mat4& Core::getProjectionTileMatrix() const {
+    return projectionTileMatrix_;
+}
+
+bool Core::isRenderingPoster() const {
+    return posterTarget_ != nullptr;
+}
+
+Profiler& Core::getProfiler() const {
+    return *profiler_;
+}
+
+ThreadPool& Core::getThreadPool() const {
+    return *workerPool_;
+}
+
+FrameArena& Core::getFrameArena() const {
+    return frameArena_;
+}
+
+void Core::runOnRenderThread(std::function<void()> task) const {
+    {
+        std::lock_guard<std::mutex> lock(renderThreadMutex_);
+        renderThreadTasks_.push_back(std::move(task));
+    }
+    requestRedraw();
+}
+
+void Core::runRenderThreadTasks() {
+    {
+        std::lock_guard<std::mutex> lock(renderThreadMutex_);
+        std::swap(runningRenderThreadTasks_, renderThreadTasks_);
+    }
+    // Tasks may queue new tasks, these run in the next frame.
+    for (auto& task : runningRenderThreadTasks_) {
+        try {
+            task();
+        } catch (const std::exception& ex) {
+            std::cerr << "Render thread task failed: " << ex.what() << std::endl;
+        }
+    }
+    runningRenderThreadTasks_.clear();
+}
+
 bool Core::isKeyPressed(Key key) const {
     return glfwGetKey(window_, static_cast<int>(key)) == GLFW_PRESS;
 }
@@ -222,12 +478,26 @@ bool Core::isMouseButtonPressed(MouseButton button) const {
 void Core::getMousePos(double& xpos, double& ypos) const {
     glfwGetCursorPos(window_, &xpos, &ypos);
     scaleWindowPosToFramebufferPos(xpos, ypos);
+    scaleFramebufferPosToRenderPos(xpos, ypos);
+}
+
+double Core::getInputEventTime() const {
+    return inputEventTime_;
 }
 
 void Core::setWindowSize(int width, int height) const {
     glfwSetWindowSize(window_, width, height);
 }
 
+void Core::requestRedraw() const {
+    if (!onDemand_) {
+        return;
+    }
+    redrawRequested_ = true;
+    // Wakes up the event loop, if it is waiting.
+    glfwPostEmptyEvent();
+}
+
 void Core::registerCamera(const std::shared_ptr<AbstractCamera>& camera) const {
     camera_ = camera;
 }
@@ -275,6 +545,10 @@ void Core::draw() {
     ImGui_ImplGlfw_NewFrame();
     ImGui::NewFrame();
 
+    // The backend uploads the font atlas as RGBA8 texture.
+    const ImGuiIO& io = ImGui::GetIO();
+    imguiMemory_.resize(MemoryTracker::textureBytes(GL_RGBA8, io.Fonts->TexWidth, io.Fonts->TexHeight));
+
     ImGui::SetNextWindowPos(ImVec2(10.0, 10.0), ImGuiCond_Once);
     ImGui::SetNextWindowSize(ImVec2(300.0, 600.0), ImGuiCond_Once);
 
@@ -283,11 +557,80 @@ void Core::draw() {
     if (ImGui::CollapsingHeader("Plugins", ImGuiTreeNodeFlags_DefaultOpen)) {
         ImGui::Combo("Plugin", &pluginSelectionIdx_, pluginNamesImGui_.data());
     }
+    if (ImGui::CollapsingHeader("Profiler")) {
+        profiler_->drawGUI();
+        const auto arenaStats = frameArena_.getStats();
+        ImGui::Text("Allocations/frame: %llu (%.1f KiB)",
+            static_cast<unsigned long long>(frameAllocations_.allocations),
+            static_cast<double>(frameAllocations_.bytes) / 1024.0);
+        ImGui::Text("Frame arena: %.1f KiB used, %.1f KiB peak", static_cast<double>(arenaStats.used) / 1024.0,
+            static_cast<double>(arenaStats.peak) / 1024.0);
+    }
+    if (ImGui::CollapsingHeader("Resource Cache")) {
+        const auto stats = ResourceCache::getStats();
+        ImGui::Text("Entries: %zu", stats.entries);
+        ImGui::Text("Memory: %.1f / %.1f MiB", static_cast<double>(stats.bytes) / (1024.0 * 1024.0),
+            static_cast<double>(stats.capacity) / (1024.0 * 1024.0));
+        ImGui::Text("Hits: %zu, Misses: %zu, Evictions: %zu", stats.hits, stats.misses, stats.evictions);
+        if (ImGui::Button("Clear")) {
+            ResourceCache::clear();
+        }
+        if (ProgramBinaryCache::isEnabled()) {
+            const auto programStats = ProgramBinaryCache::getStats();
+            ImGui::Text("Program binaries: %zu hits, %zu misses", programStats.hits, programStats.misses);
+        }
+    }
+    if (ImGui::CollapsingHeader("Memory")) {
+        MemoryTracker::drawGUI();
+    }
+    if (captureStream_ != nullptr && ImGui::CollapsingHeader("Capture")) {
+        const auto stats = captureStream_->getStats();
+        ImGui::Text("Written: %llu frames", static_cast<unsigned long long>(stats.written));
+        ImGui::Text("Dropped: %llu readback, %llu writer", static_cast<unsigned long long>(stats.droppedReadback),
+            static_cast<unsigned long long>(stats.droppedQueue));
+        ImGui::Text("Scaled to the stream size: %llu frames", static_cast<unsigned long long>(stats.scaled));
+    }
+    if (ImGui::CollapsingHeader("Poster")) {
+        int posterSize[2] = {cfg_.posterWidth, cfg_.posterHeight};
+        if (ImGui::InputInt2("Size", posterSize)) {
+            cfg_.posterWidth = std::max(0, posterSize[0]);
+            cfg_.posterHeight = std::max(0, posterSize[1]);
+        }
+        if (ImGui::InputInt("Tile size", &cfg_.posterTileSize, 256, 1024)) {
+            cfg_.posterTileSize = std::max(1, cfg_.posterTileSize);
+        }
+        if (ImGui::Button("Render poster") && currentPlugin_ != nullptr && cfg_.posterWidth > 0 &&
+            cfg_.posterHeight > 0) {
+            posterPending_ = true;
+        }
+    }
+    if (ImGui::CollapsingHeader("Adaptive Quality")) {
+        float targetFrameTime = static_cast<float>(qualityController_->getTargetFrameTime());
+        if (ImGui::InputFloat("Target (ms)", &targetFrameTime, 1.0f, 5.0f, "%.1f")) {
+            qualityController_->setTargetFrameTime(std::max(0.0f, targetFrameTime));
+        }
+        float minQuality = qualityController_->getMinQuality();
+        if (ImGui::SliderFloat("Min quality", &minQuality, QualityController::lowestQuality, 1.0f)) {
+            qualityController_->setMinQuality(minQuality);
+        }
+        ImGui::SliderFloat("Render scale", &renderScale_, lowestRenderScale, 1.0f);
+        ImGui::SliderFloat("Min render scale", &minRenderScale_, lowestRenderScale, 1.0f);
+        ImGui::Text("Quality: %.2f%s", qualityController_->getQuality(),
+            qualityController_->isInteracting() ? " (interacting)" : "");
+        ImGui::Text("Render size: %d x %d", renderWidth_, renderHeight_);
+        ImGui::Text("Full quality render time: %.2f ms", qualityController_->getFullQualityFrameTime());
+    }
     if (currentPluginIdx_ != pluginSelectionIdx_) {
         currentPluginIdx_ = pluginSelectionIdx_;
         // Need to delete plugin first, so destructor of old plugin runs before constructor of new plugin.
         // Otherwise, this could mess up OpenGL states.
         currentPlugin_ = nullptr;
+        cancelPluginLoading();
+        {
+            // Queued tasks may refer to the deleted plugins.
+            std::lock_guard<std::mutex> lock(renderThreadMutex_);
+            renderThreadTasks_.clear();
+        }
 
         // Init new plugin
         const auto& plugin = PluginRegister::get(currentPluginIdx_);
@@ -302,42 +645,389 @@ void Core::draw() {
             currentPluginResourcesPath_.clear();
         }
 
-        currentPlugin_ = plugin->create(*this);
-        // Plugin needs to know window size.
-        currentPlugin_->resize(framebufferWidth_, framebufferHeight_);
+        currentPluginArchive_.reset();
+        if (cfg_.resourceArchives) {
+            try {
+                const auto archivePath = FileUtil::findPluginResourceArchive(plugin->path());
+                if (!archivePath.empty()) {
+                    currentPluginArchive_ = std::make_shared<const ResourceArchive>(archivePath);
+                }
+            } catch (const std::exception& ex) {
+                std::cerr << "Cannot open resource archive, using resource files: " << ex.what() << std::endl;
+            }
+        }
+
+        // Shader programs of the plugin are rebuilt, when their files in the shaders resource dir are changed. Archives
+        // are immutable, there is nothing to watch.
+        shaderWatcher_.reset();
+        if (currentPluginArchive_ == nullptr && !currentPluginResourcesPath_.empty() &&
+            std::filesystem::is_directory(currentPluginResourcesPath_ / "shaders")) {
+            try {
+                shaderWatcher_ = std::make_unique<FileWatcher>(currentPluginResourcesPath_ / "shaders");
+            } catch (const std::exception& ex) {
+                std::cerr << "Shader hot reloading disabled: " << ex.what() << std::endl;
+            }
+        }
+
+        // The constructor runs here on the render thread, the slow CPU part of the loading runs on a worker thread.
+        // Meanwhile, a loading screen is shown.
+        loadingStart_ = std::chrono::steady_clock::now();
+        loadingPluginName_ = plugin->name();
+        MemoryTracker::setDefaultOwner(loadingPluginName_);
+        loadingPlugin_ = plugin->create(*this);
+        auto task = std::make_shared<std::packaged_task<void()>>([p = loadingPlugin_.get()]() { p->prepare(); });
+        loadingFuture_ = task->get_future();
+        workerPool_->submit([task]() { (*task)(); });
+        if (synchronousPluginLoad_) {
+            loadingFuture_.wait();
+        }
     }
 
+    if (loadingPlugin_ != nullptr) {
+        if (loadingFuture_.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+            finishPluginLoading();
+        } else {
+            drawLoadingScreen();
+        }
+    }
+
+    glBindFramebuffer(GL_FRAMEBUFFER, getOutputFramebuffer());
+    glViewport(0, 0, framebufferWidth_, framebufferHeight_);
     glClear(GL_COLOR_BUFFER_BIT);
 
     if (currentPlugin_ != nullptr) {
-        currentPlugin_->render();
+        updateShaderPrograms();
+
+        // The quality is lowered by the resolution first, the fragment cost falls quadratically with the render scale.
+        // The plugin gets the remaining factor, once the scale is at its lower bound.
+        qualityController_->update();
+        const float quality = qualityController_->getQuality();
+        adaptiveRenderScale_ = 1.0f;
+        if (minRenderScale_ < 1.0f) {
+            adaptiveRenderScale_ =
+                std::ceil(std::clamp(std::sqrt(quality), minRenderScale_, 1.0f) * renderScaleSteps) / renderScaleSteps;
+        }
+        updateRenderSize();
+        const float pluginQuality = std::min(1.0f, quality / (adaptiveRenderScale_ * adaptiveRenderScale_));
+        if (pluginQuality != pluginQuality_) {
+            pluginQuality_ = pluginQuality;
+            currentPlugin_->setQuality(pluginQuality_);
+        }
+
+        if (scaledTarget_ != nullptr) {
+            scaledTarget_->bind();
+            glViewport(0, 0, renderWidth_, renderHeight_);
+            glClear(GL_COLOR_BUFFER_BIT);
+        }
+
+        {
+            ProfileScope scope(*profiler_, "Plugin");
+            qualityController_->beginMeasure();
+            currentPlugin_->render();
+            qualityController_->endMeasure();
+        }
+
+        if (scaledTarget_ != nullptr) {
+            ProfileScope scope(*profiler_, "Upscale");
+            glDisable(GL_SCISSOR_TEST);
+            glBindFramebuffer(GL_READ_FRAMEBUFFER, scaledTarget_->fbo());
+            glBindFramebuffer(GL_DRAW_FRAMEBUFFER, getOutputFramebuffer());
+            glBlitFramebuffer(0, 0, renderWidth_, renderHeight_, 0, 0, framebufferWidth_, framebufferHeight_,
+                GL_COLOR_BUFFER_BIT, GL_LINEAR);
+        }
+
+        if (posterPending_ && frameNumber_ >= cfg_.posterFrame) {
+            posterPending_ = false;
+            ProfileScope scope(*profiler_, "Poster");
+            renderPoster();
+            if (cfg_.autoQuit && cfg_.screenshotFrames.empty()) {
+                glfwSetWindowShouldClose(window_, GLFW_TRUE);
+            }
+        }
     }
 
     ImGui::End();
     ImGui::Render();
-    ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+    if (!cfg_.hideGui) {
+        ProfileScope scope(*profiler_, "ImGui");
+        // Plugins may leave their own FBO bound.
+        glBindFramebuffer(GL_FRAMEBUFFER, getOutputFramebuffer());
+        ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+    }
+}
+
+void Core::updateShaderPrograms() {
+    if (currentPlugin_ == nullptr) {
+        return;
+    }
+    const auto changedFiles =
+        shaderWatcher_ != nullptr ? shaderWatcher_->poll() : std::vector<std::filesystem::path>();
+    if (currentPlugin_->updateShaderPrograms(changedFiles)) {
+        // Draw with the rebuilt programs, respectively keep polling until the rebuild has finished.
+        redrawFrames_ = std::max(redrawFrames_, 1);
+    }
+}
+
+bool Core::needsRedraw() const {
+    // Reduced quality frames are followed by a full quality frame, once the interaction has ended.
+    return redrawRequested_ || redrawFrames_ > 0 || loadingPlugin_ != nullptr ||
+           currentPluginIdx_ != pluginSelectionIdx_ || qualityController_->isInteracting() || pluginQuality_ < 1.0f ||
+           adaptiveRenderScale_ < 1.0f;
+}
+
+void Core::present() {
+    // There is no surface to present in headless mode.
+    if (cfg_.headless) {
+        return;
+    }
+    if (onDemand_ && offscreenTarget_ != nullptr) {
+        glDisable(GL_SCISSOR_TEST);
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, offscreenTarget_->fbo());
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+        glBlitFramebuffer(0, 0, offscreenTarget_->width(), offscreenTarget_->height(), 0, 0, framebufferWidth_,
+            framebufferHeight_, GL_COLOR_BUFFER_BIT, GL_LINEAR);
+    }
+    glfwSwapBuffers(window_);
+}
+
+void Core::finishPluginLoading() {
+    auto plugin = std::move(loadingPlugin_);
+    // Rethrows exceptions from prepare().
+    loadingFuture_.get();
+
+    plugin->finalize();
+    // Plugin needs to know window size.
+    updateRenderSize();
+    plugin->resize(renderWidth_, renderHeight_);
+    // Plugins start with full quality. The render time estimate of the previous plugin does not apply.
+    pluginQuality_ = 1.0f;
+    qualityController_->reset();
+    currentPlugin_ = std::move(plugin);
+
+    if (benchmark_ != nullptr) {
+        // Include uploads still queued on the GPU in the load time.
+        glFinish();
+        const auto loadTime = std::chrono::steady_clock::now() - loadingStart_;
+        benchmark_->start(std::chrono::duration<double, std::milli>(loadTime).count());
+        if (camera_.expired()) {
+            std::cerr << "Benchmark: plugin has no registered camera, the camera path is not applied." << std::endl;
+        }
+    }
+}
+
+void Core::cancelPluginLoading() {
+    if (loadingPlugin_ == nullptr) {
+        return;
+    }
+    // The worker must not access the plugin anymore, before it is deleted here on the render thread.
+    loadingFuture_.wait();
+    loadingFuture_ = std::future<void>();
+    loadingPlugin_ = nullptr;
+}
+
+void Core::drawLoadingScreen() const {
+    const auto& io = ImGui::GetIO();
+    const float elapsed = std::chrono::duration<float>(std::chrono::steady_clock::now() - loadingStart_).count();
+    const std::string status = loadingPlugin_->getLoadingStatus();
+
+    ImGui::SetNextWindowPos(ImVec2(io.DisplaySize.x * 0.5f, io.DisplaySize.y * 0.5f), ImGuiCond_Always,
+        ImVec2(0.5f, 0.5f));
+    ImGui::SetNextWindowSize(ImVec2(400.0f * contentScale_, 0.0f), ImGuiCond_Always);
+    ImGui::Begin("Loading", nullptr,
+        ImGuiWindowFlags_NoDecoration | ImGuiWindowFlags_NoMove | ImGuiWindowFlags_NoSavedSettings |
+            ImGuiWindowFlags_NoInputs);
+    ImGui::Text("Loading %s (%.1f s)", loadingPluginName_.c_str(), elapsed);
+    ImGui::ProgressBar(loadingPlugin_->getLoadingProgress(), ImVec2(-1.0f, 0.0f));
+    if (!status.empty()) {
+        ImGui::TextUnformatted(status.c_str());
+    }
+    ImGui::End();
 }
 
 void Core::screenshot() {
+    screenshotReadback_->poll();
+
     if (cfg_.screenshotFrames.empty() || cfg_.screenshotFrames.front() != frameNumber_) {
         return;
     }
 
     cfg_.screenshotFrames.erase(cfg_.screenshotFrames.begin());
 
-    std::vector<unsigned char> image(framebufferWidth_ * framebufferHeight_ * 4);
-    glReadBuffer(GL_BACK);
-    glReadPixels(0, 0, framebufferWidth_, framebufferHeight_, GL_RGBA, GL_UNSIGNED_BYTE, image.data());
-
     std::string filename = cfg_.screenshotFilename.empty() ? "screenshot" : cfg_.screenshotFilename;
     std::stringstream ss;
     ss << std::setw(5) << std::setfill('0') << frameNumber_;
+    filename += "." + ss.str() + (cfg_.screenshotFormat == "qoi" ? ".qoi" : ".png");
+
+    // Flipping and encoding is done by the consumer on a worker thread. If all readback buffers are in flight, this
+    // blocks until one is available, so no requested screenshot is lost. QOI strips are encoded in parallel.
+    const GLenum readBuffer = offscreenTarget_ != nullptr ? GL_COLOR_ATTACHMENT0 : GL_BACK;
+    screenshotReadback_->captureBlocking(getOutputFramebuffer(), readBuffer, framebufferWidth_, framebufferHeight_,
+        [filename, format = cfg_.screenshotFormat, pool = workerPool_.get()](std::vector<unsigned char>&& image,
+            int width, int height) {
+            if (format == "qoi") {
+                ImageUtil::saveQoiImage(filename, image, width, height, pool);
+            } else {
+                const auto compression = format == "png-fast"  ? ImageUtil::PngCompression::Fast
+                                         : format == "png-raw" ? ImageUtil::PngCompression::None
+                                                               : ImageUtil::PngCompression::Default;
+                ImageUtil::savePngImage(filename, std::move(image), width, height, compression);
+            }
+        });
+
+    if (cfg_.autoQuit && cfg_.screenshotFrames.empty() && !posterPending_) {
+        glfwSetWindowShouldClose(window_, GLFW_TRUE);
+    }
+}
+
+void Core::captureFrame() {
+    if (captureReadback_ == nullptr) {
+        return;
+    }
+    captureReadback_->poll();
+    if (framebufferWidth_ <= 0 || framebufferHeight_ <= 0) {
+        // Minimized window.
+        return;
+    }
+
+    const uint64_t sequence = captureStream_->beginFrame(framebufferWidth_, framebufferHeight_);
+    // Unlike screenshots, the capture never waits for a readback buffer. Conversion happens on a worker thread,
+    // writing on the writer thread of the stream.
+    const GLenum readBuffer = offscreenTarget_ != nullptr ? GL_COLOR_ATTACHMENT0 : GL_BACK;
+    const bool captured = captureReadback_->capture(getOutputFramebuffer(), readBuffer, framebufferWidth_,
+        framebufferHeight_, [stream = captureStream_.get(), sequence](std::vector<unsigned char>&& image, int width,
+                                int height) {
+            stream->submitFrame(sequence, image, width, height);
+        });
+    if (!captured) {
+        captureStream_->skipFrame(sequence);
+    }
+}
+
+void Core::renderPoster() {
+    const int width = cfg_.posterWidth;
+    const int height = cfg_.posterHeight;
+    GLint maxViewportDims[2] = {0, 0};
+    GLint maxTextureSize = 0;
+    glGetIntegerv(GL_MAX_VIEWPORT_DIMS, maxViewportDims);
+    glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxTextureSize);
+    const int maxTileSize = std::max(1, std::min({cfg_.posterTileSize, maxViewportDims[0], maxViewportDims[1],
+                                            static_cast<int>(maxTextureSize)}));
+
+    // The poster is split into n x n tiles, so each tile has the aspect ratio of the poster and plugins keep their
+    // projection, only the tile matrix is applied. The tiled image is up to n - 1 pixels larger per axis due to
+    // rounding, it is cropped centered.
+    const int tiles = std::max((width + maxTileSize - 1) / maxTileSize, (height + maxTileSize - 1) / maxTileSize);
+    const int tileWidth = (width + tiles - 1) / tiles;
+    const int tileHeight = (height + tiles - 1) / tiles;
+    const int cropX = (tiles * tileWidth - width) / 2;
+    const int cropY = (tiles * tileHeight - height) / 2;
+
+    std::string filename = cfg_.screenshotFilename.empty() ? "poster" : cfg_.screenshotFilename + ".poster";
+    std::stringstream ss;
+    ss << std::setw(5) << std::setfill('0') << frameNumber_;
     filename += "." + ss.str() + ".png";
 
-    ImageUtil::savePngImage(filename, std::move(image), framebufferWidth_, framebufferHeight_);
+    const float quality = pluginQuality_;
+    if (quality != 1.0f) {
+        currentPlugin_->setQuality(1.0f);
+    }
+    currentPlugin_->resize(tileWidth, tileHeight);
+    posterTarget_ = std::make_unique<RenderTarget>(tileWidth, tileHeight);
+
+    try {
+        PngStreamWriter writer(filename, width, height);
+        // One row of tiles at a time. Tiles are read directly into their columns of the strip, which holds the rows
+        // bottom-up as returned by OpenGL.
+        std::vector<unsigned char> strip;
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        glPixelStorei(GL_PACK_ALIGNMENT, 1);
+        glPixelStorei(GL_PACK_ROW_LENGTH, width);
+        for (int j = 0; j < tiles; j++) {
+            const int y0 = std::max(0, j * tileHeight - cropY);
+            const int y1 = std::min(height, (j + 1) * tileHeight - cropY);
+            if (y1 <= y0) {
+                continue;
+            }
+            const int rows = y1 - y0;
+            strip.resize(static_cast<std::size_t>(width) * static_cast<std::size_t>(rows) * 4);
+            for (int i = 0; i < tiles; i++) {
+                const int x0 = std::max(0, i * tileWidth - cropX);
+                const int x1 = std::min(width, (i + 1) * tileWidth - cropX);
+                if (x1 <= x0) {
+                    continue;
+                }
+                // Map the tile range in NDC of the full view, with row j counted from the top, to [-1, 1].
+                const float n = static_cast<float>(tiles);
+                const float centerX = -1.0f + (2.0f * static_cast<float>(i) + 1.0f) / n;
+                const float centerY = 1.0f - (2.0f * static_cast<float>(j) + 1.0f) / n;
+                projectionTileMatrix_ = glm::translate(glm::scale(glm::mat4(1.0f), glm::vec3(n, n, 1.0f)),
+                    glm::vec3(-centerX, -centerY, 0.0f));
+
+                posterTarget_->bind();
+                glViewport(0, 0, tileWidth, tileHeight);
+                glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+                currentPlugin_->render();
+
+                const int tileTop = y0 + cropY - j * tileHeight;
+                glBindFramebuffer(GL_READ_FRAMEBUFFER, posterTarget_->fbo());
+                glReadBuffer(GL_COLOR_ATTACHMENT0);
+                glReadPixels(x0 + cropX - i * tileWidth, tileHeight - tileTop - rows, x1 - x0, rows, GL_RGBA,
+                    GL_UNSIGNED_BYTE, strip.data() + static_cast<std::size_t>(x0) * 4);
+            }
+            const auto stride = static_cast<std::ptrdiff_t>(width) * 4;
+            writer.writeRows(strip.data() + (rows - 1) * stride, rows, -stride);
+        }
+        writer.finish();
+        std::cout << "Poster written to " << filename << " (" << width << " x " << height << ", " << tiles << " x "
+                  << tiles << " tiles)" << std::endl;
+    } catch (const std::exception& ex) {
+        std::cerr << "Poster failed: " << ex.what() << std::endl;
+    }
 
-    if (cfg_.autoQuit && cfg_.screenshotFrames.empty()) {
-        glfwSetWindowShouldClose(window_, GLFW_TRUE);
+    glPixelStorei(GL_PACK_ROW_LENGTH, 0);
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    projectionTileMatrix_ = glm::mat4(1.0f);
+    posterTarget_.reset();
+    currentPlugin_->resize(renderWidth_, renderHeight_);
+    if (quality != 1.0f) {
+        currentPlugin_->setQuality(quality);
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, getOutputFramebuffer());
+    glViewport(0, 0, framebufferWidth_, framebufferHeight_);
+}
+
+void Core::dispatchInputEvents() {
+    inputQueue_.take(inputEvents_);
+    if (!inputEvents_.empty()) {
+        redrawFrames_ = onDemandSettleFrames;
+    }
+    for (const auto& event : inputEvents_) {
+        inputEventTime_ = event.time;
+        // Hovering and typing text do not change the rendering, key presses, clicks, drags and scrolling might.
+        const bool drag = event.type == InputEvent::Type::MouseMove && GLFWUtil::anyMouseButtonPressed(window_);
+        const bool interaction = (event.type == InputEvent::Type::Key && event.action != GLFW_RELEASE) ||
+                                 event.type == InputEvent::Type::MouseButton ||
+                                 event.type == InputEvent::Type::MouseScroll || drag;
+        if (interaction) {
+            qualityController_->interact();
+        }
+        switch (event.type) {
+            case InputEvent::Type::Key:
+                keyEvent(event.code, event.scancode, event.action, event.mods);
+                break;
+            case InputEvent::Type::Char:
+                charEvent(event.codepoint);
+                break;
+            case InputEvent::Type::MouseButton:
+                mouseButtonEvent(event.code, event.action, event.mods);
+                break;
+            case InputEvent::Type::MouseMove:
+                mouseMoveEvent(event.x, event.y);
+                break;
+            case InputEvent::Type::MouseScroll:
+                mouseScrollEvent(event.x, event.y);
+                break;
+        }
     }
 }
 
@@ -350,8 +1040,42 @@ void Core::framebufferSizeEvent(int width, int height) {
     // Save size for init of new plugin.
     framebufferWidth_ = width;
     framebufferHeight_ = height;
-    if (currentPlugin_ != nullptr) {
-        currentPlugin_->resize(width, height);
+    if (onDemand_ && width > 0 && height > 0) {
+        if (offscreenTarget_ == nullptr) {
+            offscreenTarget_ = std::make_unique<RenderTarget>(width, height);
+        } else {
+            offscreenTarget_->resize(width, height);
+        }
+    }
+    updateRenderSize();
+    redrawFrames_ = std::max(redrawFrames_, 1);
+}
+
+void Core::updateRenderSize() {
+    int width = framebufferWidth_;
+    int height = framebufferHeight_;
+    const float scale = renderScale_ * adaptiveRenderScale_;
+    if (scale < 1.0f && width > 0 && height > 0) {
+        width = std::max(1, static_cast<int>(std::lround(static_cast<float>(width) * scale)));
+        height = std::max(1, static_cast<int>(std::lround(static_cast<float>(height) * scale)));
+    }
+
+    if (width != framebufferWidth_ || height != framebufferHeight_) {
+        if (scaledTarget_ == nullptr) {
+            scaledTarget_ = std::make_unique<RenderTarget>(width, height);
+        } else {
+            scaledTarget_->resize(width, height);
+        }
+    } else {
+        scaledTarget_.reset();
+    }
+
+    if (width != renderWidth_ || height != renderHeight_) {
+        renderWidth_ = width;
+        renderHeight_ = height;
+        if (currentPlugin_ != nullptr) {
+            currentPlugin_->resize(width, height);
+        }
     }
 }
 
@@ -397,6 +1121,7 @@ void Core::mouseMoveEvent(double xpos, double ypos) {
         // with glfwGetKey will miss the state when the modifier key was pressed before the window gets the focus. The
         // reason for this is, that glfwGetKey only returns a cached state, while the modifiers parameter contains the
         // live status.
+        // Coalesced moves pass the accumulated motion since the last dispatched position in one call.
         if (cameraControlMode_ != AbstractCamera::MouseControlMode::None) {
             auto camera = camera_.lock();
             if (camera) {
@@ -408,7 +1133,10 @@ void Core::mouseMoveEvent(double xpos, double ypos) {
             }
         }
 
-        currentPlugin_->mouseMove(xpos, ypos);
+        double renderX = xpos;
+        double renderY = ypos;
+        scaleFramebufferPosToRenderPos(renderX, renderY);
+        currentPlugin_->mouseMove(renderX, renderY);
     }
     mouseX_ = xpos;
     mouseY_ = ypos;
@@ -428,11 +1156,13 @@ void Core::mouseScrollEvent(double xoffset, double yoffset) {
 
 int Core::glfwReferenceCounter_ = 0;
 
-void Core::initGLFW() {
+void Core::initGLFW(bool headless) {
     if (Core::glfwReferenceCounter_ <= 0) {
         glfwSetErrorCallback([](int error_code, const char* description) {
             std::cerr << "GLFW Error (" << error_code << "): " << description << std::endl;
         });
+        // The null platform does not need any display connection. The context is created with EGL or OSMesa.
+        glfwInitHint(GLFW_PLATFORM, headless ? GLFW_PLATFORM_NULL : GLFW_ANY_PLATFORM);
         if (!glfwInit()) {
             throw std::runtime_error("GLFW init failed!");
         }
@@ -448,7 +1178,69 @@ void Core::terminateGLFW() {
     }
 }
 
+void Core::createWindow() {
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, openGLVersionMajor);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, openGLVersionMinor);
+    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GLFW_TRUE);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    glfwWindowHint(GLFW_OPENGL_DEBUG_CONTEXT, GLFW_TRUE);
+    glfwWindowHint(GLFW_SCALE_TO_MONITOR, GLFW_TRUE);
+
+    window_ = glfwCreateWindow(initWindowSizeWidth, initWindowSizeHeight, title, nullptr, nullptr);
+    if (!window_) {
+        Core::terminateGLFW();
+        throw std::runtime_error("GLFW window creation failed!");
+    }
+}
+
+void Core::createHeadlessWindow() {
+    if (cfg_.headlessWidth <= 0 || cfg_.headlessHeight <= 0) {
+        Core::terminateGLFW();
+        throw std::runtime_error("Invalid headless framebuffer size!");
+    }
+
+    std::vector<std::pair<int, std::string>> contextApis;
+    if (cfg_.headlessContextApi.empty() || cfg_.headlessContextApi == "egl") {
+        contextApis.emplace_back(GLFW_EGL_CONTEXT_API, "EGL");
+    }
+    if (cfg_.headlessContextApi.empty() || cfg_.headlessContextApi == "osmesa") {
+        contextApis.emplace_back(GLFW_OSMESA_CONTEXT_API, "OSMesa");
+    }
+    if (contextApis.empty()) {
+        Core::terminateGLFW();
+        throw std::runtime_error("Unknown headless context API \"" + cfg_.headlessContextApi + "\"!");
+    }
+
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, openGLVersionMajor);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, openGLVersionMinor);
+    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GLFW_TRUE);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    glfwWindowHint(GLFW_OPENGL_DEBUG_CONTEXT, GLFW_TRUE);
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+
+    // The window is never shown, it only carries the context. Rendering goes to the offscreen render target.
+    for (const auto& [api, name] : contextApis) {
+        glfwWindowHint(GLFW_CONTEXT_CREATION_API, api);
+        window_ = glfwCreateWindow(cfg_.headlessWidth, cfg_.headlessHeight, title, nullptr, nullptr);
+        if (window_) {
+            std::cout << "Headless " << name << " context, framebuffer size " << cfg_.headlessWidth << "x"
+                      << cfg_.headlessHeight << "." << std::endl;
+            return;
+        }
+        std::cerr << "Cannot create headless " << name << " context." << std::endl;
+    }
+    Core::terminateGLFW();
+    throw std::runtime_error("GLFW headless context creation failed!");
+}
+
 void Core::scaleWindowPosToFramebufferPos(double& xpos, double& ypos) const {
     xpos *= static_cast<double>(framebufferWidth_) / static_cast<double>(windowWidth_);
     ypos *= static_cast<double>(framebufferHeight_) / static_cast<double>(windowHeight_);
 }
+
+void Core::scaleFramebufferPosToRenderPos(double& xpos, double& ypos) const {
+    if (renderWidth_ != framebufferWidth_ || renderHeight_ != framebufferHeight_) {
+        xpos *= static_cast<double>(renderWidth_) / static_cast<double>(framebufferWidth_);
+        ypos *= static_cast<double>(renderHeight_) / static_cast<double>(framebufferHeight_);
+    }
+}
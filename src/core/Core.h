@@ -1,9 +1,15 @@
 #pragma once
 
+#include <atomic>
+#include <chrono>
+#include <cstddef>
 #include <cstdint>
 #include <exception>
 #include <filesystem>
+#include <functional>
+#include <future>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <vector>
 
@@ -11,13 +17,28 @@
 #include <glad/gl.h>
 #include <GLFW/glfw3.h>
 // clang-format on
+#include <glm/ext/matrix_float4x4.hpp>
 
 #include "Input.h"
 #include "camera/AbstractCamera.h"
+#include "util/AllocationCounter.h"
 #include "util/FpsCounter.h"
+#include "util/FrameArena.h"
+#include "util/InputQueue.h"
+#include "util/MemoryTracker.h"
+#include "util/ResourceCache.h"
 
 namespace OGL4Core2::Core {
+    class Benchmark;
+    class FileWatcher;
+    class FrameReadback;
+    class FrameStream;
+    class Profiler;
+    class QualityController;
     class RenderPlugin;
+    class ResourceArchive;
+    class RenderTarget;
+    class ThreadPool;
 
     class Core {
     public:
@@ -25,7 +46,56 @@ namespace OGL4Core2::Core {
             std::string defaultPluginName;
             std::vector<uint32_t> screenshotFrames;
             std::string screenshotFilename;
+            // "png" (smallest files), "png-fast", "png-raw" (uncompressed) or "qoi" (fastest, for long sequences).
+            std::string screenshotFormat = "png";
+            // If set, every frame is written to this file or pipe ("-" for stdout), as "raw" RGBA or "y4m" video.
+            std::string captureStream;
+            std::string captureFormat = "y4m";
+            int captureFps = 60;
+            // If set, a poster of this size is rendered in tiles at the given frame and streamed into a PNG file, the
+            // size is not limited by the framebuffer. The tile size is clamped to the OpenGL limits.
+            int posterWidth = 0;
+            int posterHeight = 0;
+            uint32_t posterFrame = 1;
+            int posterTileSize = 2048;
             bool autoQuit = false;
+            bool hideGui = false;
+            // Headless mode renders into an offscreen framebuffer of the given size, using an EGL (surfaceless) or
+            // OSMesa context without any window system. An empty context API name tries EGL first, then OSMesa.
+            bool headless = false;
+            int headlessWidth = 1280;
+            int headlessHeight = 800;
+            std::string headlessContextApi;
+            // If set, the profiler is enabled from the first frame and a Chrome trace is written here on exit.
+            std::string profileTraceFilename;
+            // Benchmark mode drives the registered camera along a scripted path with vsync off and writes frame time
+            // statistics to the output file. The default plugin is the benchmarked plugin.
+            bool benchmark = false;
+            uint32_t benchmarkWarmupFrames = 100;
+            uint32_t benchmarkFrames = 500;
+            std::string benchmarkFilename = "benchmark.json";
+            // Memory bound of the process-wide resource cache in MiB.
+            std::size_t resourceCacheSizeMiB = ResourceCache::defaultCapacityMiB;
+            // Linked shader programs are cached on disk to speed up plugin loading. An empty directory uses the
+            // "programs" directory within the user cache dir.
+            bool programBinaryCache = true;
+            std::string programBinaryCacheDir;
+            // Installed builds read plugin resources from the packed archive, if there is one.
+            bool resourceArchives = true;
+            // While interacting, the plugin quality is lowered to hold this render time in ms, 0 disables it.
+            double targetFrameTime = 16.6;
+            float minQuality = 0.25f;
+            // Plugins render at this fraction of the framebuffer size per axis, the result is upscaled bilinearly.
+            float renderScale = 1.0f;
+            // Lower bound of the render scale applied by the adaptive quality, 1 keeps the resolution fixed.
+            float minRenderScale = 0.5f;
+            // Draw frames only when input, the GUI or the plugin changed something, otherwise block waiting for events.
+            // Ignored for headless runs, benchmarks, screenshots and capture streams.
+            bool onDemandRendering = false;
+            // Number of worker threads, 0 uses one less than the number of hardware threads.
+            std::size_t workerThreads = 0;
+            // Print informational messages, e.g. shader reloads and volume read timings.
+            bool verbose = false;
         };
 
         explicit Core(Config cfg);
@@ -35,19 +105,98 @@ namespace OGL4Core2::Core {
 
         [[nodiscard]] std::filesystem::path getPluginResourcesPath() const;
 
+        /**
+         * Resource archive of the current plugin, nullptr if resources are read from loose files.
+         */
+        [[nodiscard]] std::shared_ptr<const ResourceArchive> getPluginResourceArchive() const;
+
+        /**
+         * Framebuffer the plugins should render into. This is 0 when rendering into a window at full resolution,
+         * otherwise the handle of the offscreen or scaled render target. Plugins must bind this instead of 0 after
+         * rendering to their own FBOs. Its size is the one passed to RenderPlugin::resize().
+         */
+        [[nodiscard]] GLuint getDefaultFramebuffer() const;
+
+        /**
+         * Plugins multiply their projection matrix with this matrix from the left, i.e. projection =
+         * getProjectionTileMatrix() * glm::perspective(...). While a poster is rendered, it maps the part of the view
+         * covered by the current tile to the full tile, making the projection off-axis. It is the identity otherwise.
+         */
+        [[nodiscard]] const glm::mat4& getProjectionTileMatrix() const;
+
+        /**
+         * True while poster tiles are rendered. Plugins skip their GUI and screen space overlays then, these would be
+         * repeated in every tile.
+         */
+        [[nodiscard]] bool isRenderingPoster() const;
+
+        /**
+         * Frame profiler. Plugins can add their own scopes with ProfileScope, they are nested within the plugin render
+         * scope of the core.
+         */
+        [[nodiscard]] Profiler& getProfiler() const;
+
+        /**
+         * Work-stealing thread pool shared by the core and all plugins, for background tasks, parallelFor() and task
+         * graphs. Tasks must not use OpenGL, see runOnRenderThread().
+         */
+        [[nodiscard]] ThreadPool& getThreadPool() const;
+
+        /**
+         * Queue a task to run on the render thread at the beginning of the next frame, e.g. to upload the results of
+         * a worker task. Can be called from any thread. Pending tasks are dropped when the plugin is switched.
+         */
+        void runOnRenderThread(std::function<void()> task) const;
+
+        /**
+         * Linear allocator for transient data of the current frame, reset after each frame. Render thread only, e.g.
+         * FrameVector<float> data(ArenaAllocator<float>(core.getFrameArena())). Nothing allocated from it must be kept
+         * beyond the frame.
+         */
+        [[nodiscard]] FrameArena& getFrameArena() const;
+
         [[nodiscard]] bool isKeyPressed(Key key) const;
         [[nodiscard]] bool isMouseButtonPressed(MouseButton button) const;
         void getMousePos(double& xpos, double& ypos) const;
 
+        /**
+         * Time in seconds (glfwGetTime()) at which the input event currently passed to the plugin was received. Input
+         * is dispatched once per frame, use this instead of the current time for time based input handling.
+         */
+        [[nodiscard]] double getInputEventTime() const;
+
         void setWindowSize(int width, int height) const;
 
+        /**
+         * Request a new frame in on-demand rendering mode, has no effect otherwise. Input events cause redraws already,
+         * plugins call this if their state changes otherwise, e.g. when an asynchronous load has finished or for an
+         * animation. Can be called from any thread.
+         */
+        void requestRedraw() const;
+
         void registerCamera(const std::shared_ptr<AbstractCamera>& camera) const;
         void removeCamera() const;
 
     private:
         void validateImGuiScale();
         void draw();
+        void finishPluginLoading();
+        void cancelPluginLoading();
+        void drawLoadingScreen() const;
         void screenshot();
+        void captureFrame();
+        void renderPoster();
+        void dispatchInputEvents();
+        void runRenderThreadTasks();
+        void updateShaderPrograms();
+        [[nodiscard]] bool needsRedraw() const;
+        void present();
+        void updateRenderSize();
+
+        /**
+         * Window or offscreen framebuffer, the plugin output is upscaled into it and the GUI is drawn on top.
+         */
+        [[nodiscard]] GLuint getOutputFramebuffer() const;
 
         void windowSizeEvent(int width, int height);
         void framebufferSizeEvent(int width, int height);
@@ -58,18 +207,49 @@ namespace OGL4Core2::Core {
         void mouseScrollEvent(double xoffset, double yoffset);
 
         void scaleWindowPosToFramebufferPos(double& xpos, double& ypos) const;
+        void scaleFramebufferPosToRenderPos(double& xpos, double& ypos) const;
+
+        void createWindow();
+        void createHeadlessWindow();
 
         Config cfg_;
 
         GLFWwindow* window_;
+        std::unique_ptr<RenderTarget> offscreenTarget_;
+        std::unique_ptr<RenderTarget> scaledTarget_;
+        std::unique_ptr<ThreadPool> workerPool_;
+        mutable std::mutex renderThreadMutex_;
+        mutable std::vector<std::function<void()>> renderThreadTasks_;
+        std::vector<std::function<void()>> runningRenderThreadTasks_;
+        std::unique_ptr<FrameReadback> screenshotReadback_;
+        std::unique_ptr<FrameReadback> captureReadback_;
+        std::unique_ptr<FrameStream> captureStream_;
+        std::unique_ptr<RenderTarget> posterTarget_;
+        glm::mat4 projectionTileMatrix_;
+        bool posterPending_;
+        std::unique_ptr<Profiler> profiler_;
+        std::unique_ptr<Benchmark> benchmark_;
+        std::unique_ptr<QualityController> qualityController_;
+        float pluginQuality_;
         bool running_;
 
         uint64_t frameNumber_;
 
         FpsCounter fps_;
+        TrackedMemory imguiMemory_;
+
+        mutable FrameArena frameArena_;
+        AllocationCounter::Counts frameStartAllocations_;
+        AllocationCounter::Counts frameAllocations_;
 
         std::shared_ptr<RenderPlugin> currentPlugin_;
+        std::shared_ptr<RenderPlugin> loadingPlugin_;
+        std::future<void> loadingFuture_;
+        std::string loadingPluginName_;
+        std::chrono::steady_clock::time_point loadingStart_;
         std::filesystem::path currentPluginResourcesPath_;
+        std::shared_ptr<const ResourceArchive> currentPluginArchive_;
+        std::unique_ptr<FileWatcher> shaderWatcher_;
         std::exception currentPluginResourcesPathException_;
         int currentPluginIdx_;
         int pluginSelectionIdx_;
@@ -85,13 +265,34 @@ namespace OGL4Core2::Core {
         int framebufferWidth_;
         int framebufferHeight_;
         float contentScale_;
+
+        // Plugins render at a reduced resolution into scaledTarget_, if the render size differs from the framebuffer
+        // size. Mouse positions passed to the plugin are mapped to the render size as well.
+        int renderWidth_;
+        int renderHeight_;
+        float renderScale_;
+        float minRenderScale_;
+        float adaptiveRenderScale_;
         double mouseX_;
         double mouseY_;
 
+        // Input events are queued by the GLFW callbacks and dispatched to the plugin once per frame.
+        InputQueue inputQueue_;
+        std::vector<InputEvent> inputEvents_;
+        double inputEventTime_;
+
         AbstractCamera::MouseControlMode cameraControlMode_;
         mutable std::weak_ptr<AbstractCamera> camera_;
 
-        static void initGLFW();
+        bool synchronousPluginLoad_;
+
+        // In on-demand mode, frames are drawn into offscreenTarget_ also in windowed mode, so the last frame can be
+        // presented again on window refreshes without drawing it.
+        bool onDemand_;
+        mutable std::atomic<bool> redrawRequested_;
+        int redrawFrames_;
+
+        static void initGLFW(bool headless);
         static void terminateGLFW();
 
         static int glfwReferenceCounter_;
@@ -1,20 +1,23 @@
 #include "RenderPlugin.h"
 
 #include <algorithm>
-#include <fstream>
 #include <regex>
-#include <sstream>
 #include <stdexcept>
 #include <utility>
 
 #include <glad/gl.h>
 
 #include "Core.h"
-#include "util/ImageUtil.h"
+#include "util/MemoryTracker.h"
+#include "util/ResourceCache.h"
 
 using namespace OGL4Core2::Core;
 
-RenderPlugin::RenderPlugin(const Core& c) : core_(c) {}
+RenderPlugin::RenderPlugin(const Core& c) : core_(c), loadingProgress_(0.0f), rawMouseInput_(false) {}
+
+void RenderPlugin::prepare() {}
+
+void RenderPlugin::finalize() {}
 
 void RenderPlugin::resize([[maybe_unused]] int width, [[maybe_unused]] int height) {}
 
@@ -29,18 +32,65 @@ void RenderPlugin::mouseMove([[maybe_unused]] double xpos, [[maybe_unused]] doub
 
 void RenderPlugin::mouseScroll([[maybe_unused]] double xoffset, [[maybe_unused]] double yoffset) {}
 
-std::filesystem::path RenderPlugin::getResourcePath(const std::string& name) const {
-    auto basePath = core_.getPluginResourcesPath();
+void RenderPlugin::setQuality([[maybe_unused]] float quality) {}
+
+bool RenderPlugin::isRawMouseInput() const {
+    return rawMouseInput_;
+}
+
+void RenderPlugin::setRawMouseInput(bool raw) {
+    rawMouseInput_ = raw;
+}
+
+Profiler& RenderPlugin::getProfiler() const {
+    return core_.getProfiler();
+}
+
+ThreadPool& RenderPlugin::getThreadPool() const {
+    return core_.getThreadPool();
+}
+
+void RenderPlugin::runOnRenderThread(std::function<void()> task) const {
+    core_.runOnRenderThread(std::move(task));
+}
+
+FrameArena& RenderPlugin::getFrameArena() const {
+    return core_.getFrameArena();
+}
+
+const glm::mat4& RenderPlugin::getProjectionTileMatrix() const {
+    return core_.getProjectionTileMatrix();
+}
+
+bool RenderPlugin::isRenderingPoster() const {
+    return core_.isRenderingPoster();
+}
 
+std::string RenderPlugin::cleanResourceName(const std::string& name) {
     // Replace '\' with '/' in case Windows style path separation is used instead of generic format '/'.
     std::string nameClean = name;
     std::replace(nameClean.begin(), nameClean.end(), '\\', '/');
+    return nameClean;
+}
 
-    return basePath / std::filesystem::path(nameClean).make_preferred();
+std::shared_ptr<const ResourceArchive> RenderPlugin::findInArchive(const std::string& nameClean) const {
+    auto archive = core_.getPluginResourceArchive();
+    if (archive != nullptr && archive->contains(nameClean)) {
+        return archive;
+    }
+    return nullptr;
+}
+
+std::filesystem::path RenderPlugin::getResourcePath(const std::string& name) const {
+    auto basePath = core_.getPluginResourcesPath();
+    return basePath / std::filesystem::path(cleanResourceName(name)).make_preferred();
 }
 
 std::filesystem::path RenderPlugin::getResourceFilePath(const std::string& name) const {
     std::filesystem::path path = getResourcePath(name);
+    if (findInArchive(cleanResourceName(name)) != nullptr) {
+        return path;
+    }
     if (!std::filesystem::is_regular_file(path)) {
         throw std::runtime_error("Invalid resource file name: \"" + name + "\"! Path \"" + path.string() +
                                  "\" does not exists or is not a file.");
@@ -50,6 +100,10 @@ std::filesystem::path RenderPlugin::getResourceFilePath(const std::string& name)
 
 std::filesystem::path RenderPlugin::getResourceDirPath(const std::string& name) const {
     auto path = getResourcePath(name);
+    auto archive = core_.getPluginResourceArchive();
+    if (archive != nullptr && archive->containsDir(cleanResourceName(name))) {
+        return path;
+    }
     if (!std::filesystem::is_directory(path)) {
         throw std::runtime_error("Invalid resource dir name: \"" + name + "\"! Path \"" + path.string() +
                                  "\" does not exist or is not a directory.");
@@ -58,23 +112,45 @@ std::filesystem::path RenderPlugin::getResourceDirPath(const std::string& name)
 }
 
 std::string RenderPlugin::getStringResource(const std::string& name) const {
-    std::filesystem::path path = getResourceFilePath(name);
-    std::ifstream file(path);
-    if (!file.is_open()) {
-        throw std::runtime_error("Cannot read resource file \"" + path.string() + "\"!");
+    const auto nameClean = cleanResourceName(name);
+    if (auto archive = findInArchive(nameClean)) {
+        return std::string(archive->get(nameClean).str());
     }
-    std::stringstream buffer;
-    buffer << file.rdbuf();
-    return buffer.str();
+    return *ResourceCache::getText(getResourceFilePath(name));
+}
+
+ResourceView RenderPlugin::getResourceData(const std::string& name) const {
+    const auto nameClean = cleanResourceName(name);
+    if (auto archive = findInArchive(nameClean)) {
+        return archive->get(nameClean);
+    }
+    auto data = ResourceCache::getBinary(getResourceFilePath(name));
+    return {data, data->data(), data->size()};
+}
+
+std::shared_ptr<const ResourceCache::Image> RenderPlugin::getPngImage(const std::string& name) const {
+    const auto nameClean = cleanResourceName(name);
+    if (auto archive = findInArchive(nameClean)) {
+        return ResourceCache::getPng(*archive, nameClean);
+    }
+    return ResourceCache::getPng(getResourceFilePath(name));
 }
 
 std::vector<unsigned char> RenderPlugin::getPngResource(const std::string& name, int& width, int& height) const {
-    return ImageUtil::loadPngImage(getResourceFilePath(name), width, height);
+    auto image = getPngImage(name);
+    width = image->width;
+    height = image->height;
+    return image->data;
 }
 
 std::shared_ptr<glowl::Texture2D> RenderPlugin::getTextureResource(const std::string& name) const {
-    int width, height;
-    std::vector<unsigned char> image = getPngResource(name, width, height);
+    // Upload directly from the cached image, without copying it.
+    auto image = getPngImage(name);
+    return createTexture(name, image->data, image->width, image->height);
+}
+
+std::shared_ptr<glowl::Texture2D> RenderPlugin::createTexture(const std::string& name,
+    const std::vector<unsigned char>& image, int width, int height) {
     glowl::TextureLayout layout(GL_RGBA8, width, height, 1, GL_RGBA, GL_UNSIGNED_BYTE, 1,
         {
             {GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE},
@@ -83,7 +159,18 @@ std::shared_ptr<glowl::Texture2D> RenderPlugin::getTextureResource(const std::st
             {GL_TEXTURE_MAG_FILTER, GL_LINEAR},
         },
         {});
-    return std::make_shared<glowl::Texture2D>(name, layout, image.data());
+    // The texture shares its control block with the memory record, so the record lives exactly as long as the texture.
+    struct TrackedTexture {
+        glowl::Texture2D texture;
+        TrackedMemory memory;
+        TrackedTexture(const std::string& name, const glowl::TextureLayout& layout, const unsigned char* data,
+            std::size_t bytes)
+            : texture(name, layout, data),
+              memory(name, MemoryCategory::Texture, MemoryLocation::Gpu, bytes) {}
+    };
+    auto tracked = std::make_shared<TrackedTexture>(name, layout, image.data(),
+        MemoryTracker::textureBytes(GL_RGBA8, width, height));
+    return std::shared_ptr<glowl::Texture2D>(tracked, &tracked->texture);
 }
 
 std::vector<std::filesystem::path> RenderPlugin::getResourceDirFilePaths(const std::string& name,
@@ -91,6 +178,16 @@ std::vector<std::filesystem::path> RenderPlugin::getResourceDirFilePaths(const s
     std::filesystem::path dir = getResourceDirPath(name);
     std::vector<std::filesystem::path> files;
     std::regex filterRegex(filter);
+    auto archive = core_.getPluginResourceArchive();
+    if (archive != nullptr && archive->containsDir(cleanResourceName(name))) {
+        // Archive listings are already sorted.
+        for (const auto& file : archive->list(cleanResourceName(name))) {
+            if (filter.empty() || std::regex_match(file, filterRegex)) {
+                files.push_back(dir / file);
+            }
+        }
+        return files;
+    }
     for (const auto& entry : std::filesystem::directory_iterator(dir)) {
         std::filesystem::directory_entry a;
         if (!std::filesystem::is_regular_file(entry)) {
@@ -104,3 +201,73 @@ std::vector<std::filesystem::path> RenderPlugin::getResourceDirFilePaths(const s
     std::sort(files.begin(), files.end());
     return files;
 }
+
+std::shared_ptr<ShaderProgram> RenderPlugin::createShaderProgram(const ShaderResourceList& shaders) {
+    ShaderProgram::ShaderFileList files;
+    std::string label;
+    for (const auto& [type, name] : shaders) {
+        files.push_back({type, getResourceFilePath(name)});
+        label += (label.empty() ? "" : ", ") + name;
+    }
+    // Sources are read from the archive, if there is one. The loader keeps the archive alive with the program.
+    ShaderProgram::SourceLoader loader;
+    if (auto archive = core_.getPluginResourceArchive()) {
+        loader = [archive, basePath = core_.getPluginResourcesPath()](const std::filesystem::path& path) {
+            const auto name = path.lexically_relative(basePath).generic_string();
+            if (archive->contains(name)) {
+                return std::make_shared<const std::string>(archive->get(name).str());
+            }
+            return ResourceCache::getText(path);
+        };
+    }
+    auto program = std::make_shared<ShaderProgram>(std::move(files), label, std::move(loader));
+
+    shaderPrograms_.erase(std::remove_if(shaderPrograms_.begin(), shaderPrograms_.end(),
+                              [](const auto& p) { return p.expired(); }),
+        shaderPrograms_.end());
+    shaderPrograms_.push_back(program);
+    return program;
+}
+
+bool RenderPlugin::updateShaderPrograms(const std::vector<std::filesystem::path>& changedFiles) {
+    bool rebuilding = false;
+    for (const auto& weakProgram : shaderPrograms_) {
+        auto program = weakProgram.lock();
+        if (program == nullptr) {
+            continue;
+        }
+        for (const auto& file : changedFiles) {
+            if (program->dependsOn(file)) {
+                program->reload();
+                break;
+            }
+        }
+        rebuilding = rebuilding || program->isReloading();
+        program->update();
+    }
+    return rebuilding;
+}
+
+void RenderPlugin::reloadShaderPrograms() {
+    for (const auto& weakProgram : shaderPrograms_) {
+        if (auto program = weakProgram.lock()) {
+            program->reload();
+        }
+    }
+}
+
+float RenderPlugin::getLoadingProgress() const {
+    std::lock_guard<std::mutex> lock(loadingMutex_);
+    return loadingProgress_;
+}
+
+std::string RenderPlugin::getLoadingStatus() const {
+    std::lock_guard<std::mutex> lock(loadingMutex_);
+    return loadingStatus_;
+}
+
+void RenderPlugin::setLoadingProgress(float progress, const std::string& status) {
+    std::lock_guard<std::mutex> lock(loadingMutex_);
+    loadingProgress_ = std::clamp(progress, 0.0f, 1.0f);
+    loadingStatus_ = status;
+}
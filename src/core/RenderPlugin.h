@@ -1,22 +1,47 @@
 #pragma once
 
 #include <filesystem>
+#include <functional>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <utility>
 #include <vector>
 
+#include <glm/ext/matrix_float4x4.hpp>
 #include <glowl/Texture2D.hpp>
 
 #include "Input.h"
+#include "util/FrameArena.h"
+#include "util/ResourceArchive.h"
+#include "util/ResourceCache.h"
+#include "util/ShaderProgram.h"
+#include "util/ThreadPool.h"
 
 namespace OGL4Core2::Core {
     class Core;
+    class Profiler;
 
     class RenderPlugin {
     public:
+        using ShaderResourceList = std::vector<std::pair<ShaderProgram::ShaderType, std::string>>;
+
         explicit RenderPlugin(const Core& c);
         virtual ~RenderPlugin() = default;
 
+        /**
+         * Called on a worker thread after construction, while the core shows a loading screen. Slow CPU work, like
+         * reading and parsing files, should be done here instead of in the constructor. OpenGL must not be used, the
+         * resource helpers are allowed, except for getTextureResource().
+         */
+        virtual void prepare();
+
+        /**
+         * Called on the render thread after prepare() has finished, to upload the prepared data to the GPU. This
+         * should be short, the UI is blocked meanwhile.
+         */
+        virtual void finalize();
+
         virtual void render() = 0;
 
         virtual void resize(int width, int height);
@@ -26,16 +51,122 @@ namespace OGL4Core2::Core {
         virtual void mouseMove(double xpos, double ypos);
         virtual void mouseScroll(double xoffset, double yoffset);
 
+        /**
+         * Quality level in (0, 1] for the following frames, set by the adaptive quality controller of the core. While
+         * the user interacts, the level is lowered to hold the target frame time, once idle it returns to 1. Plugins
+         * map it to their own knobs, e.g. the ray marching step size. Only called on changes, the initial level is 1.
+         */
+        virtual void setQuality(float quality);
+
+        /**
+         * If false (default), all mouse moves between two frames are coalesced into a single mouseMove() call with the
+         * last position. Otherwise, every cursor event is passed on, see setRawMouseInput().
+         */
+        [[nodiscard]] bool isRawMouseInput() const;
+
         [[nodiscard]] std::filesystem::path getResourcePath(const std::string& name) const;
         [[nodiscard]] std::filesystem::path getResourceFilePath(const std::string& name) const;
         [[nodiscard]] std::filesystem::path getResourceDirPath(const std::string& name) const;
         [[nodiscard]] std::string getStringResource(const std::string& name) const;
+
+        /**
+         * Raw resource data. Points directly into the memory mapped resource archive, if there is one, otherwise the
+         * file is read into memory.
+         */
+        [[nodiscard]] ResourceView getResourceData(const std::string& name) const;
         [[nodiscard]] std::vector<unsigned char> getPngResource(const std::string& name, int& width, int& height) const;
         [[nodiscard]] std::shared_ptr<glowl::Texture2D> getTextureResource(const std::string& name) const;
         [[nodiscard]] std::vector<std::filesystem::path> getResourceDirFilePaths(const std::string& name,
             const std::string& filter = std::string()) const;
 
+        /**
+         * Build a shader program from shader resource files. The program is rebuilt automatically, when one of its
+         * files is changed on disk. Throws if the program cannot be built.
+         */
+        [[nodiscard]] std::shared_ptr<ShaderProgram> createShaderProgram(const ShaderResourceList& shaders);
+
+        /**
+         * Called by the core once per frame on the render thread. Starts rebuilding the shader programs using one of
+         * the changed files and swaps in rebuilt programs, once they are linked. Returns true if any program was
+         * rebuilding, i.e. a new frame is needed to show the result.
+         */
+        bool updateShaderPrograms(const std::vector<std::filesystem::path>& changedFiles);
+
+        /**
+         * Loading progress in [0, 1] and status message, reported by the plugin from prepare().
+         */
+        [[nodiscard]] float getLoadingProgress() const;
+        [[nodiscard]] std::string getLoadingStatus() const;
+
     protected:
+        [[nodiscard]] Profiler& getProfiler() const;
+
+        /**
+         * Thread pool of the core, see Core::getThreadPool(). Tasks submitted by the plugin must be finished before
+         * its destructor returns.
+         */
+        [[nodiscard]] ThreadPool& getThreadPool() const;
+
+        /**
+         * Run a task on the render thread at the beginning of the next frame, see Core::runOnRenderThread().
+         */
+        void runOnRenderThread(std::function<void()> task) const;
+
+        /**
+         * Per-frame linear allocator of the core, see Core::getFrameArena().
+         */
+        [[nodiscard]] FrameArena& getFrameArena() const;
+
+        /**
+         * Off-axis tile matrix for poster rendering, to be multiplied from the left to the projection matrix, see
+         * Core::getProjectionTileMatrix().
+         */
+        [[nodiscard]] const glm::mat4& getProjectionTileMatrix() const;
+
+        /**
+         * True while poster tiles are rendered, see Core::isRenderingPoster().
+         */
+        [[nodiscard]] bool isRenderingPoster() const;
+
+        /**
+         * Create an RGBA8 texture from image data, e.g. loaded with getPngResource() within prepare(). The texture is
+         * recorded in the MemoryTracker for its lifetime.
+         */
+        [[nodiscard]] static std::shared_ptr<glowl::Texture2D> createTexture(const std::string& name,
+            const std::vector<unsigned char>& image, int width, int height);
+
+        void setLoadingProgress(float progress, const std::string& status = std::string());
+
+        /**
+         * Request every cursor event, e.g. for freehand drawing. Input is still dispatched once per frame, the time of
+         * each event is available with Core::getInputEventTime().
+         */
+        void setRawMouseInput(bool raw);
+
+        /**
+         * Rebuild all shader programs created with createShaderProgram(), e.g. on a key press.
+         */
+        void reloadShaderPrograms();
+
         const Core& core_;
+
+    private:
+        /**
+         * Resource name with '/' as separator, as used within resource archives.
+         */
+        [[nodiscard]] static std::string cleanResourceName(const std::string& name);
+
+        /**
+         * Archive of the current plugin, nullptr if there is no archive or it does not contain the name.
+         */
+        [[nodiscard]] std::shared_ptr<const ResourceArchive> findInArchive(const std::string& nameClean) const;
+        [[nodiscard]] std::shared_ptr<const ResourceCache::Image> getPngImage(const std::string& name) const;
+
+        mutable std::mutex loadingMutex_;
+        float loadingProgress_;
+        std::string loadingStatus_;
+        bool rawMouseInput_;
+
+        std::vector<std::weak_ptr<ShaderProgram>> shaderPrograms_;
     };
 } // namespace OGL4Core2::Core
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace OGL4Core2::Core {
+    /**
+     * Process wide heap allocation counters. The global operator new/delete are replaced to count every allocation
+     * made through them (on all threads, including third-party C++ libraries). Allocations via malloc are not counted.
+     */
+    class AllocationCounter {
+    public:
+        struct Counts {
+            uint64_t allocations = 0;
+            uint64_t bytes = 0;
+        };
+
+        /**
+         * Total counts since program start. Take the difference of two calls to measure a section, other threads
+         * are included in the difference.
+         */
+        [[nodiscard]] static Counts get();
+    };
+} // namespace OGL4Core2::Core
@@ -0,0 +1,183 @@
+#include "Benchmark.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <numeric>
+#include <stdexcept>
+#include <utility>
+
+#ifdef _WIN32
+// clang-format off
+#include <windows.h>
+#include <psapi.h>
+// clang-format on
+#else
+#include <sys/resource.h>
+#endif
+
+#include <glad/gl.h>
+
+#include "../camera/AbstractCamera.h"
+#include "MemoryTracker.h"
+
+using namespace OGL4Core2::Core;
+
+namespace {
+    constexpr double pi = 3.14159265358979323846;
+    // Radius of the trackball used by the orbit camera, a horizontal drag of x = r * sin(phi / 2) through the center
+    // rotates by phi.
+    constexpr double trackballRadius = 0.8;
+    // The dolly control moves by 4 units per normalized mouse unit.
+    constexpr double dollyPerMouseUnit = 4.0;
+    constexpr double dollyAmplitude = 1.5;
+
+    double percentile(const std::vector<double>& sorted, double p) {
+        if (sorted.empty()) {
+            return 0.0;
+        }
+        // Nearest rank
+        const auto rank = static_cast<std::size_t>(std::ceil(p / 100.0 * static_cast<double>(sorted.size())));
+        return sorted[std::clamp<std::size_t>(rank, 1, sorted.size()) - 1];
+    }
+
+    std::string escapeJson(const std::string& str) {
+        std::string result;
+        for (const char c : str) {
+            if (c == '"' || c == '\\') {
+                result += '\\';
+            }
+            result += c;
+        }
+        return result;
+    }
+} // namespace
+
+Benchmark::Benchmark(Config cfg) : cfg_(std::move(cfg)), running_(false), frame_(0), loadTimeMs_(0.0) {
+    if (cfg_.measuredFrames == 0) {
+        throw std::runtime_error("Benchmark requires at least one measured frame!");
+    }
+    frameTimes_.reserve(cfg_.measuredFrames);
+}
+
+void Benchmark::start(double loadTimeMs) {
+    loadTimeMs_ = loadTimeMs;
+    frame_ = 0;
+    frameTimes_.clear();
+    running_ = true;
+    lastFrameEnd_ = std::chrono::steady_clock::now();
+}
+
+void Benchmark::updateCamera(AbstractCamera& camera) const {
+    if (!running_) {
+        return;
+    }
+    const bool warmup = frame_ < cfg_.warmupFrames;
+    const uint32_t phaseLength = warmup ? cfg_.warmupFrames : cfg_.measuredFrames;
+    const uint32_t phaseFrame = warmup ? frame_ : frame_ - cfg_.warmupFrames;
+
+    // Both parts of the path end at the start pose, so warm-up and measurement see the same views.
+    const double t0 = static_cast<double>(phaseFrame) / static_cast<double>(phaseLength);
+    const double t1 = static_cast<double>(phaseFrame + 1) / static_cast<double>(phaseLength);
+
+    const double phi = 2.0 * pi / static_cast<double>(phaseLength);
+    const double dx = trackballRadius * std::sin(0.5 * phi);
+    camera.mouseMoveControl(AbstractCamera::MouseControlMode::Left, -dx, 0.0, dx, 0.0);
+
+    const double dolly = dollyAmplitude * (std::sin(2.0 * pi * t0) - std::sin(2.0 * pi * t1));
+    camera.mouseMoveControl(AbstractCamera::MouseControlMode::Right, 0.0, 0.0, 0.0, -dolly / dollyPerMouseUnit);
+}
+
+bool Benchmark::frameFinished() {
+    if (!running_) {
+        return false;
+    }
+    const auto now = std::chrono::steady_clock::now();
+    if (frame_ >= cfg_.warmupFrames) {
+        frameTimes_.push_back(std::chrono::duration<double, std::milli>(now - lastFrameEnd_).count());
+    }
+    lastFrameEnd_ = now;
+    frame_++;
+    if (frame_ >= cfg_.warmupFrames + cfg_.measuredFrames) {
+        running_ = false;
+        return true;
+    }
+    return false;
+}
+
+void Benchmark::writeReport(int width, int height) const {
+    std::vector<double> sorted = frameTimes_;
+    std::sort(sorted.begin(), sorted.end());
+    const double mean =
+        sorted.empty() ? 0.0 : std::accumulate(sorted.begin(), sorted.end(), 0.0) / static_cast<double>(sorted.size());
+
+    const auto* renderer = reinterpret_cast<const char*>(glGetString(GL_RENDERER));
+    const auto* version = reinterpret_cast<const char*>(glGetString(GL_VERSION));
+
+    std::ofstream file(cfg_.outputFilename);
+    if (!file.is_open()) {
+        throw std::runtime_error("Cannot write benchmark file \"" + cfg_.outputFilename.string() + "\"!");
+    }
+    file << "{\n";
+    file << "  \"plugin\": \"" << escapeJson(cfg_.pluginName) << "\",\n";
+    file << "  \"renderer\": \"" << escapeJson(renderer != nullptr ? renderer : "") << "\",\n";
+    file << "  \"glVersion\": \"" << escapeJson(version != nullptr ? version : "") << "\",\n";
+    file << "  \"width\": " << width << ",\n";
+    file << "  \"height\": " << height << ",\n";
+    file << "  \"warmupFrames\": " << cfg_.warmupFrames << ",\n";
+    file << "  \"measuredFrames\": " << frameTimes_.size() << ",\n";
+    file << "  \"loadTimeMs\": " << loadTimeMs_ << ",\n";
+    file << "  \"peakMemoryBytes\": " << peakMemoryUsage() << ",\n";
+    // Tracked memory at the end of the run, of all owners and of the benchmarked plugin only.
+    const auto memory = MemoryTracker::getTotals();
+    const auto pluginMemory = MemoryTracker::getTotals(cfg_.pluginName);
+    const auto writeMemory = [&file](const char* name, const auto& bytes, bool last) {
+        file << "    \"" << name << "\": {";
+        for (std::size_t i = 0; i < numMemoryCategories; i++) {
+            file << (i > 0 ? ", " : "") << "\"" << MemoryTracker::categoryName(static_cast<MemoryCategory>(i))
+                 << "\": " << bytes[i];
+        }
+        file << (last ? "}\n" : "},\n");
+    };
+    file << "  \"trackedMemoryBytes\": {\n";
+    writeMemory("cpu", memory.cpu, false);
+    writeMemory("gpu", memory.gpu, false);
+    writeMemory("pluginCpu", pluginMemory.cpu, false);
+    writeMemory("pluginGpu", pluginMemory.gpu, true);
+    file << "  },\n";
+    file << "  \"frameTimeMs\": {\n";
+    file << "    \"mean\": " << mean << ",\n";
+    file << "    \"min\": " << (sorted.empty() ? 0.0 : sorted.front()) << ",\n";
+    file << "    \"p50\": " << percentile(sorted, 50.0) << ",\n";
+    file << "    \"p90\": " << percentile(sorted, 90.0) << ",\n";
+    file << "    \"p99\": " << percentile(sorted, 99.0) << ",\n";
+    file << "    \"max\": " << (sorted.empty() ? 0.0 : sorted.back()) << "\n";
+    file << "  },\n";
+    file << "  \"frameTimesMs\": [";
+    for (std::size_t i = 0; i < frameTimes_.size(); i++) {
+        file << (i > 0 ? ", " : "") << frameTimes_[i];
+    }
+    file << "]\n";
+    file << "}\n";
+}
+
+std::size_t Benchmark::peakMemoryUsage() {
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+        return counters.PeakWorkingSetSize;
+    }
+    return 0;
+#else
+    struct rusage usage {};
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return 0;
+    }
+#ifdef __APPLE__
+    return static_cast<std::size_t>(usage.ru_maxrss);
+#else
+    // Linux reports kilobytes.
+    return static_cast<std::size_t>(usage.ru_maxrss) * 1024;
+#endif
+#endif
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+namespace OGL4Core2::Core {
+    class AbstractCamera;
+
+    /**
+     * Deterministic benchmark run. The camera follows a scripted path, a full orbit combined with a dolly sweep, which
+     * is driven through the regular camera mouse controls, so every camera implementation can be used. The path is
+     * completed once during the warm-up frames and once during the measured frames. Frame times are taken after a
+     * glFinish() at the end of each frame, so they include the GPU work.
+     */
+    class Benchmark {
+    public:
+        struct Config {
+            std::string pluginName;
+            uint32_t warmupFrames = 100;
+            uint32_t measuredFrames = 500;
+            std::filesystem::path outputFilename;
+        };
+
+        explicit Benchmark(Config cfg);
+        ~Benchmark() = default;
+
+        Benchmark(const Benchmark&) = delete;
+        Benchmark(Benchmark&&) = delete;
+        Benchmark& operator=(const Benchmark&) = delete;
+        Benchmark& operator=(Benchmark&&) = delete;
+
+        /**
+         * Start the benchmark after the plugin is loaded.
+         */
+        void start(double loadTimeMs);
+
+        [[nodiscard]] inline bool isRunning() const {
+            return running_;
+        }
+
+        /**
+         * Move the camera to the path position of the upcoming frame.
+         */
+        void updateCamera(AbstractCamera& camera) const;
+
+        /**
+         * Record the end of a frame. Returns true, when all measured frames are done.
+         */
+        bool frameFinished();
+
+        /**
+         * Write the report as JSON to the configured output file.
+         */
+        void writeReport(int width, int height) const;
+
+        /**
+         * Peak resident memory of the process in bytes, 0 if not available.
+         */
+        [[nodiscard]] static std::size_t peakMemoryUsage();
+
+    private:
+        Config cfg_;
+        bool running_;
+        uint32_t frame_;
+        double loadTimeMs_;
+        std::chrono::steady_clock::time_point lastFrameEnd_;
+        std::vector<double> frameTimes_;
+    };
+} // namespace OGL4Core2::Core
@@ -0,0 +1,395 @@
+#include "BrickedVolume.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#include "MappedFile.h"
+#include "ReadOnlyFile.h"
+#include "ThreadPool.h"
+#include "VolumePyramid.h"
+
+using namespace OGL4Core2::Core;
+
+static constexpr char volumeMagic[8] = {'O', 'G', 'L', 'B', 'V', 'O', 'L', '\0'};
+static constexpr uint32_t volumeVersion = 1;
+static constexpr uint64_t pageSize = 4096;
+static constexpr uint32_t maxBrickSize = 256;
+static constexpr uint32_t maxLevels = 32;
+// Downsampled levels are written through a temporary file in slabs of about this size.
+static constexpr std::size_t levelSlabBytes = 64 * 1024 * 1024;
+
+// All platforms we build for are little endian, the header is written and read as it is.
+struct BrickedVolume::Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t brickSize;
+    uint32_t resolution[3];
+    float sliceThickness[3];
+    uint64_t brickStride;
+    uint64_t dataOffset;
+    uint64_t histogram[histogramBins];
+    uint32_t levels;
+    uint32_t reserved;
+    uint64_t levelFirstBrick[maxLevels];
+    // Offset of the (min, max) table of all bricks.
+    uint64_t minMaxOffset;
+};
+
+namespace {
+    uint64_t alignUp(uint64_t value, uint64_t alignment) {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+
+    std::array<uint32_t, 3> bricksPerAxis(const std::array<uint32_t, 3>& resolution, uint32_t brickSize) {
+        return {(resolution[0] + brickSize - 1) / brickSize, (resolution[1] + brickSize - 1) / brickSize,
+            (resolution[2] + brickSize - 1) / brickSize};
+    }
+
+    /**
+     * Levels down to the first one which fits into a single brick.
+     */
+    uint32_t brickLevels(const std::array<uint32_t, 3>& resolution, uint32_t brickSize) {
+        const uint32_t levels = std::min(VolumePyramid::numLevels(resolution), maxLevels);
+        for (uint32_t l = 0; l < levels; l++) {
+            const auto res = VolumePyramid::levelResolution(resolution, l);
+            if (res[0] <= brickSize && res[1] <= brickSize && res[2] <= brickSize) {
+                return l + 1;
+            }
+        }
+        return levels;
+    }
+
+    /**
+     * Write the bricks of one level, layer by layer. The bricks of a layer are gathered in parallel. The range of
+     * each brick including its border is appended to minMax.
+     */
+    void writeBricks(std::ofstream& out, const MappedFile& src, const std::array<uint32_t, 3>& resolution,
+        uint32_t brickSize, uint32_t border, uint64_t brickStride, ThreadPool& pool, uint64_t* histogram,
+        std::vector<uint8_t>& minMax, const std::function<void(std::size_t)>& layerDone) {
+        const std::size_t rowSize = resolution[0];
+        const std::size_t sliceSize = rowSize * resolution[1];
+        const uint32_t stored = brickSize + 2 * border;
+        const auto bricks = bricksPerAxis(resolution, brickSize);
+        const std::size_t layerBricks = static_cast<std::size_t>(bricks[0]) * bricks[1];
+        std::vector<unsigned char> layer(layerBricks * brickStride);
+        std::vector<uint8_t> layerMinMax(2 * layerBricks);
+        std::mutex histogramMutex;
+        // Layers are read front to back.
+        src.prefetch(0, sliceSize * std::min<std::size_t>(resolution[2], 2 * brickSize));
+        for (uint32_t bz = 0; bz < bricks[2]; bz++) {
+            // Voxels of the next layer are loaded by the OS, while this layer is gathered.
+            const std::size_t nextZ = static_cast<std::size_t>(bz + 1) * brickSize;
+            if (nextZ < resolution[2]) {
+                src.prefetch(nextZ * sliceSize, sliceSize * std::min<std::size_t>(brickSize, resolution[2] - nextZ));
+            }
+            pool.parallelFor(0, layerBricks, [&](std::size_t begin, std::size_t end) {
+                std::array<uint64_t, BrickedVolume::histogramBins> localHistogram{};
+                for (std::size_t b = begin; b < end; b++) {
+                    const auto bx = static_cast<uint32_t>(b % bricks[0]);
+                    const auto by = static_cast<uint32_t>(b / bricks[0]);
+                    unsigned char* dst = layer.data() + b * brickStride;
+                    for (uint32_t sz = 0; sz < stored; sz++) {
+                        const int64_t vz = static_cast<int64_t>(bz) * brickSize + sz - border;
+                        const auto z = static_cast<std::size_t>(std::clamp<int64_t>(vz, 0, resolution[2] - 1));
+                        for (uint32_t sy = 0; sy < stored; sy++) {
+                            const int64_t vy = static_cast<int64_t>(by) * brickSize + sy - border;
+                            const auto y = static_cast<std::size_t>(std::clamp<int64_t>(vy, 0, resolution[1] - 1));
+                            const unsigned char* row = src.data() + z * sliceSize + y * rowSize;
+                            const bool payloadRow = sz >= border && sz < stored - border && sy >= border &&
+                                                    sy < stored - border && vz < resolution[2] && vy < resolution[1];
+                            for (uint32_t sx = 0; sx < stored; sx++) {
+                                const int64_t vx = static_cast<int64_t>(bx) * brickSize + sx - border;
+                                const unsigned char value =
+                                    row[static_cast<std::size_t>(std::clamp<int64_t>(vx, 0, resolution[0] - 1))];
+                                *dst++ = value;
+                                // Each voxel is counted once, by the brick it belongs to.
+                                if (payloadRow && sx >= border && sx < stored - border && vx < resolution[0]) {
+                                    localHistogram[value]++;
+                                }
+                            }
+                        }
+                    }
+                    const auto [lo, hi] = std::minmax_element(layer.data() + b * brickStride, dst);
+                    layerMinMax[2 * b] = *lo;
+                    layerMinMax[2 * b + 1] = *hi;
+                    std::fill(dst, layer.data() + (b + 1) * brickStride, 0);
+                }
+                if (histogram != nullptr) {
+                    std::lock_guard<std::mutex> lock(histogramMutex);
+                    for (std::size_t i = 0; i < BrickedVolume::histogramBins; i++) {
+                        histogram[i] += localHistogram[i];
+                    }
+                }
+            });
+            out.write(reinterpret_cast<const char*>(layer.data()), static_cast<std::streamsize>(layer.size()));
+            if (!out) {
+                return;
+            }
+            minMax.insert(minMax.end(), layerMinMax.begin(), layerMinMax.end());
+            layerDone(layerBricks);
+        }
+    }
+
+    /**
+     * Write the next level of src into a raw file, in slabs of slices.
+     */
+    void writeLevel(const MappedFile& src, const std::array<uint32_t, 3>& resolution,
+        const std::filesystem::path& filename, VolumePyramid::Filter filter, ThreadPool& pool) {
+        const auto res = VolumePyramid::levelResolution(resolution, 1);
+        const std::size_t sliceSize = static_cast<std::size_t>(res[0]) * res[1];
+        const auto slabSlices = static_cast<uint32_t>(std::max<std::size_t>(1, levelSlabBytes / sliceSize));
+        std::vector<uint8_t> slab(sliceSize * std::min(slabSlices, res[2]));
+        std::ofstream out(filename, std::ios::binary | std::ios::trunc);
+        for (uint32_t z = 0; z < res[2] && out; z += slabSlices) {
+            const uint32_t zEnd = std::min(z + slabSlices, res[2]);
+            VolumePyramid::downsample(src.data(), resolution, slab.data(), z, zEnd, filter, pool);
+            out.write(reinterpret_cast<const char*>(slab.data()), static_cast<std::streamsize>((zEnd - z) * sliceSize));
+        }
+        out.close();
+        if (!out) {
+            throw std::runtime_error("Cannot write \"" + filename.string() + "\"!");
+        }
+    }
+} // namespace
+
+BrickedVolume::BrickedVolume(const std::filesystem::path& filename, std::size_t cacheCapacity)
+    : filename_(filename),
+      file_(std::make_unique<ReadOnlyFile>(filename)),
+      resolution_{},
+      sliceThickness_{},
+      histogram_{},
+      brickSize_(0),
+      brickStride_(0),
+      dataOffset_(0),
+      numBricks_(0),
+      cacheMemory_("Brick cache", MemoryCategory::Volume, MemoryLocation::Cpu) {
+    Header header{};
+    if (file_->size() < sizeof(Header)) {
+        throw std::runtime_error("Invalid bricked volume \"" + filename.string() + "\"!");
+    }
+    file_->readAt(reinterpret_cast<unsigned char*>(&header), 0, sizeof(Header));
+    if (std::memcmp(header.magic, volumeMagic, sizeof(volumeMagic)) != 0 || header.version != volumeVersion ||
+        header.brickSize == 0 || header.brickSize > maxBrickSize) {
+        throw std::runtime_error("Invalid bricked volume \"" + filename.string() + "\"!");
+    }
+    brickSize_ = header.brickSize;
+    brickStride_ = static_cast<std::size_t>(header.brickStride);
+    dataOffset_ = static_cast<std::size_t>(header.dataOffset);
+    for (int i = 0; i < 3; i++) {
+        if (header.resolution[i] == 0) {
+            throw std::runtime_error("Invalid bricked volume \"" + filename.string() + "\"!");
+        }
+        resolution_[i] = header.resolution[i];
+        sliceThickness_[i] = header.sliceThickness[i];
+    }
+    std::copy(std::begin(header.histogram), std::end(header.histogram), histogram_.begin());
+
+    // The bricks of all levels are stored one after another.
+    const uint32_t levels = header.levels;
+    if (levels == 0 || levels > brickLevels(resolution_, brickSize_)) {
+        throw std::runtime_error("Invalid bricked volume \"" + filename.string() + "\"!");
+    }
+    for (uint32_t l = 0; l < levels; l++) {
+        levelResolution_.push_back(VolumePyramid::levelResolution(resolution_, l));
+        levelBrickCount_.push_back(bricksPerAxis(levelResolution_.back(), brickSize_));
+        levelFirstBrick_.push_back(numBricks_);
+        if (header.levelFirstBrick[l] != numBricks_) {
+            throw std::runtime_error("Invalid bricked volume \"" + filename.string() + "\"!");
+        }
+        const auto& count = levelBrickCount_.back();
+        numBricks_ += static_cast<std::size_t>(count[0]) * count[1] * count[2];
+    }
+
+    const std::size_t storedSize = getStoredBrickSize();
+    if (brickStride_ < storedSize * storedSize * storedSize ||
+        file_->size() < dataOffset_ + numBricks_ * brickStride_) {
+        throw std::runtime_error("Bricked volume \"" + filename.string() + "\" is truncated!");
+    }
+
+    // The bricks of each level are the cells of its min/max grid.
+    std::vector<uint8_t> minMax(2 * numBricks_);
+    if (file_->size() < header.minMaxOffset + minMax.size()) {
+        throw std::runtime_error("Bricked volume \"" + filename.string() + "\" is truncated!");
+    }
+    file_->readAt(minMax.data(), static_cast<std::size_t>(header.minMaxOffset), minMax.size());
+    for (uint32_t l = 0; l < levels; l++) {
+        const auto first = minMax.begin() + static_cast<std::ptrdiff_t>(2 * levelFirstBrick_[l]);
+        const std::size_t end = l + 1 < levels ? levelFirstBrick_[l + 1] : numBricks_;
+        minMaxGrids_.emplace_back(levelBrickCount_[l], brickSize_,
+            std::vector<uint8_t>(first, minMax.begin() + static_cast<std::ptrdiff_t>(2 * end)));
+    }
+    cacheStats_.capacity = cacheCapacity;
+}
+
+BrickedVolume::~BrickedVolume() = default;
+
+void BrickedVolume::convert(const std::filesystem::path& rawFile, const std::array<uint32_t, 3>& resolution,
+    const std::array<float, 3>& sliceThickness, const std::filesystem::path& filename, uint32_t brickSize,
+    VolumePyramid::Filter filter, ThreadPool& pool, const std::function<void(float)>& progress) {
+    if (brickSize == 0 || brickSize > maxBrickSize || resolution[0] == 0 || resolution[1] == 0 || resolution[2] == 0) {
+        throw std::runtime_error("Invalid bricked volume parameters!");
+    }
+    auto src = std::make_unique<MappedFile>(rawFile);
+    if (src->size() < static_cast<std::size_t>(resolution[0]) * resolution[1] * resolution[2]) {
+        throw std::runtime_error("Raw file \"" + rawFile.string() + "\" is too short!");
+    }
+
+    const uint32_t stored = brickSize + 2 * border;
+    const uint64_t brickStride = alignUp(static_cast<uint64_t>(stored) * stored * stored, pageSize);
+    const uint32_t levels = brickLevels(resolution, brickSize);
+
+    Header header{};
+    std::memcpy(header.magic, volumeMagic, sizeof(volumeMagic));
+    header.version = volumeVersion;
+    header.brickSize = brickSize;
+    for (int i = 0; i < 3; i++) {
+        header.resolution[i] = resolution[i];
+        header.sliceThickness[i] = sliceThickness[i];
+    }
+    header.brickStride = brickStride;
+    header.dataOffset = alignUp(sizeof(Header), pageSize);
+    header.levels = levels;
+    std::size_t totalBricks = 0;
+    for (uint32_t l = 0; l < levels; l++) {
+        header.levelFirstBrick[l] = totalBricks;
+        const auto count = bricksPerAxis(VolumePyramid::levelResolution(resolution, l), brickSize);
+        totalBricks += static_cast<std::size_t>(count[0]) * count[1] * count[2];
+    }
+
+    // Write to a temporary file first, an aborted conversion must not leave a truncated volume.
+    auto tmpPath = filename;
+    tmpPath += ".tmp";
+    auto levelPath = filename;
+    levelPath += ".level.tmp";
+    std::error_code ec;
+    const auto removeLevelFiles = [&]() {
+        for (int i = 0; i < 2; i++) {
+            auto path = levelPath;
+            std::filesystem::remove(path += std::to_string(i), ec);
+        }
+    };
+    try {
+        std::ofstream out(tmpPath, std::ios::binary | std::ios::trunc);
+        if (!out.is_open()) {
+            throw std::runtime_error("Cannot write bricked volume \"" + filename.string() + "\"!");
+        }
+        // The header is written again at the end, with the histogram.
+        std::vector<char> headerPage(header.dataOffset, 0);
+        out.write(headerPage.data(), static_cast<std::streamsize>(headerPage.size()));
+
+        std::vector<uint8_t> minMax;
+        minMax.reserve(2 * totalBricks);
+        std::size_t bricksDone = 0;
+        const auto layerDone = [&](std::size_t bricks) {
+            bricksDone += bricks;
+            if (progress) {
+                progress(static_cast<float>(bricksDone) / static_cast<float>(totalBricks));
+            }
+        };
+        // Each level is downsampled from the previous one into a file, which is mapped as source of the next.
+        for (uint32_t l = 0; l < levels && out; l++) {
+            const auto res = VolumePyramid::levelResolution(resolution, l);
+            writeBricks(out, *src, res, brickSize, border, brickStride, pool, l == 0 ? header.histogram : nullptr,
+                minMax, layerDone);
+            if (l + 1 < levels && out) {
+                auto nextPath = levelPath;
+                nextPath += std::to_string(l % 2);
+                writeLevel(*src, res, nextPath, filter, pool);
+                src = std::make_unique<MappedFile>(nextPath);
+            }
+        }
+        header.minMaxOffset = header.dataOffset + totalBricks * brickStride;
+        out.write(reinterpret_cast<const char*>(minMax.data()), static_cast<std::streamsize>(minMax.size()));
+        out.seekp(0);
+        out.write(reinterpret_cast<const char*>(&header), sizeof(Header));
+        out.close();
+        src.reset();
+        removeLevelFiles();
+        if (!out) {
+            throw std::runtime_error("Cannot write bricked volume \"" + filename.string() + "\"!");
+        }
+    } catch (...) {
+        src.reset();
+        std::filesystem::remove(tmpPath, ec);
+        removeLevelFiles();
+        throw;
+    }
+
+    std::filesystem::rename(tmpPath, filename, ec);
+    if (ec) {
+        std::filesystem::remove(tmpPath, ec);
+        throw std::runtime_error("Cannot write bricked volume \"" + filename.string() + "\"!");
+    }
+}
+
+BrickedVolume::Brick BrickedVolume::getBrick(std::size_t index) {
+    if (index >= numBricks_) {
+        throw std::runtime_error("Invalid brick index!");
+    }
+    {
+        std::lock_guard<std::mutex> lock(cacheMutex_);
+        auto it = cache_.find(index);
+        if (it != cache_.end()) {
+            lru_.splice(lru_.begin(), lru_, it->second.lruPos);
+            cacheStats_.hits++;
+            return it->second.brick;
+        }
+        cacheStats_.misses++;
+    }
+
+    // Read without holding the lock, concurrent misses of the same brick may read it twice.
+    const std::size_t stored = getStoredBrickSize();
+    auto data = std::make_shared<std::vector<uint8_t>>(stored * stored * stored);
+    file_->readAt(data->data(), dataOffset_ + index * brickStride_, data->size());
+
+    std::lock_guard<std::mutex> lock(cacheMutex_);
+    auto it = cache_.find(index);
+    if (it != cache_.end()) {
+        return it->second.brick;
+    }
+    lru_.push_front(index);
+    cache_.emplace(index, CacheEntry{data, lru_.begin()});
+    cacheStats_.bytes += data->size();
+    evict();
+    return data;
+}
+
+std::vector<BrickedVolume::Brick> BrickedVolume::getBricks(const std::vector<std::size_t>& indices, ThreadPool& pool) {
+    std::vector<Brick> result(indices.size());
+    pool.parallelFor(0, indices.size(), [&](std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; i++) {
+            result[i] = getBrick(indices[i]);
+        }
+    });
+    return result;
+}
+
+void BrickedVolume::setCacheCapacity(std::size_t bytes) {
+    std::lock_guard<std::mutex> lock(cacheMutex_);
+    cacheStats_.capacity = bytes;
+    evict();
+}
+
+BrickedVolume::CacheStats BrickedVolume::getCacheStats() const {
+    std::lock_guard<std::mutex> lock(cacheMutex_);
+    CacheStats stats = cacheStats_;
+    stats.bricks = cache_.size();
+    return stats;
+}
+
+void BrickedVolume::evict() {
+    // The most recently used brick is kept, even if it exceeds the capacity on its own.
+    while (cacheStats_.bytes > cacheStats_.capacity && lru_.size() > 1) {
+        const std::size_t index = lru_.back();
+        lru_.pop_back();
+        auto it = cache_.find(index);
+        cacheStats_.bytes -= it->second.brick->size();
+        cache_.erase(it);
+        cacheStats_.evictions++;
+    }
+    cacheMemory_.resize(cacheStats_.bytes);
+}
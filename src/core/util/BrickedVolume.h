@@ -0,0 +1,181 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "MemoryTracker.h"
+#include "MinMaxGrid.h"
+#include "VolumePyramid.h"
+
+namespace OGL4Core2::Core {
+    class ReadOnlyFile;
+    class ThreadPool;
+
+    /**
+     * Out-of-core volume of 8 bit voxels, split into bricks of brickSize^3 voxels. Each brick is stored with a border
+     * of one voxel copied from its neighbors (clamped at the volume boundary), so a brick can be placed anywhere in a
+     * texture atlas and still be filtered trilinearly. Opening a file only reads the header, bricks are read on demand
+     * into an LRU cache with a fixed memory bound.
+     *
+     * Besides the full resolution, the file holds downsampled levels (see VolumePyramid) down to a level which fits
+     * into a single brick. The bricks of all levels share one index space, level by level. The value range of each
+     * brick is stored as well, the bricks of each level form a MinMaxGrid which is available without reading any
+     * brick.
+     *
+     * File layout (little endian): header including a 256 bin histogram, brick data starting at a page aligned offset.
+     * Bricks are stored level by level in x-fastest order, each padded to a multiple of the page size, followed by the
+     * (min, max) table of all bricks.
+     */
+    class BrickedVolume {
+    public:
+        using Brick = std::shared_ptr<const std::vector<uint8_t>>;
+
+        static constexpr uint32_t border = 1;
+        static constexpr std::size_t histogramBins = 256;
+
+        struct CacheStats {
+            std::size_t bricks = 0;
+            std::size_t bytes = 0;
+            std::size_t capacity = 0;
+            std::size_t hits = 0;
+            std::size_t misses = 0;
+            std::size_t evictions = 0;
+        };
+
+        /**
+         * Open a bricked volume file, throws if it is not valid.
+         */
+        BrickedVolume(const std::filesystem::path& filename, std::size_t cacheCapacity);
+        ~BrickedVolume();
+
+        BrickedVolume(const BrickedVolume&) = delete;
+        BrickedVolume(BrickedVolume&&) = delete;
+        BrickedVolume& operator=(const BrickedVolume&) = delete;
+        BrickedVolume& operator=(BrickedVolume&&) = delete;
+
+        /**
+         * Convert a raw file of 8 bit voxels, x fastest, into a bricked volume file. The raw file is mapped and the
+         * bricks of one layer are gathered in parallel, so memory use is bounded by one layer of bricks. Downsampled
+         * levels are computed with the given filter through temporary files next to the output. The progress
+         * callback is optional and called with values in [0, 1].
+         */
+        static void convert(const std::filesystem::path& rawFile, const std::array<uint32_t, 3>& resolution,
+            const std::array<float, 3>& sliceThickness, const std::filesystem::path& filename, uint32_t brickSize,
+            VolumePyramid::Filter filter, ThreadPool& pool, const std::function<void(float)>& progress = nullptr);
+
+        [[nodiscard]] inline const std::array<uint32_t, 3>& getResolution() const {
+            return resolution_;
+        }
+
+        [[nodiscard]] inline const std::array<float, 3>& getSliceThickness() const {
+            return sliceThickness_;
+        }
+
+        /**
+         * Voxels per brick and axis, without the border.
+         */
+        [[nodiscard]] inline uint32_t getBrickSize() const {
+            return brickSize_;
+        }
+
+        /**
+         * Voxels per brick and axis as stored, including the border on both sides.
+         */
+        [[nodiscard]] inline uint32_t getStoredBrickSize() const {
+            return brickSize_ + 2 * border;
+        }
+
+        [[nodiscard]] inline uint32_t getNumLevels() const {
+            return static_cast<uint32_t>(levelResolution_.size());
+        }
+
+        [[nodiscard]] inline const std::array<uint32_t, 3>& getLevelResolution(uint32_t level) const {
+            return levelResolution_[level];
+        }
+
+        [[nodiscard]] inline const std::array<uint32_t, 3>& getBrickCount(uint32_t level = 0) const {
+            return levelBrickCount_[level];
+        }
+
+        /**
+         * Index of the first brick of a level.
+         */
+        [[nodiscard]] inline std::size_t getLevelFirstBrick(uint32_t level) const {
+            return levelFirstBrick_[level];
+        }
+
+        /**
+         * Number of bricks of all levels.
+         */
+        [[nodiscard]] inline std::size_t getNumBricks() const {
+            return numBricks_;
+        }
+
+        [[nodiscard]] inline const std::array<uint64_t, histogramBins>& getHistogram() const {
+            return histogram_;
+        }
+
+        /**
+         * Value ranges of the bricks of a level, including their borders.
+         */
+        [[nodiscard]] inline const MinMaxGrid& getMinMaxGrid(uint32_t level = 0) const {
+            return minMaxGrids_[level];
+        }
+
+        [[nodiscard]] inline std::size_t brickIndex(uint32_t x, uint32_t y, uint32_t z, uint32_t level = 0) const {
+            const auto& count = levelBrickCount_[level];
+            return levelFirstBrick_[level] + (static_cast<std::size_t>(z) * count[1] + y) * count[0] + x;
+        }
+
+        /**
+         * Voxels of a brick including the border, getStoredBrickSize()^3 values in x-fastest order. Read from disk on
+         * a cache miss. Thread-safe, the returned data stays valid when the brick is evicted.
+         */
+        [[nodiscard]] Brick getBrick(std::size_t index);
+
+        /**
+         * Get several bricks, cache misses are read in parallel.
+         */
+        [[nodiscard]] std::vector<Brick> getBricks(const std::vector<std::size_t>& indices, ThreadPool& pool);
+
+        void setCacheCapacity(std::size_t bytes);
+        [[nodiscard]] CacheStats getCacheStats() const;
+
+    private:
+        struct Header;
+        struct CacheEntry {
+            Brick brick;
+            std::list<std::size_t>::iterator lruPos;
+        };
+
+        void evict();
+
+        std::filesystem::path filename_;
+        std::unique_ptr<ReadOnlyFile> file_;
+        std::array<uint32_t, 3> resolution_;
+        std::array<float, 3> sliceThickness_;
+        std::array<uint64_t, histogramBins> histogram_;
+        uint32_t brickSize_;
+        std::size_t brickStride_;
+        std::size_t dataOffset_;
+        std::vector<std::array<uint32_t, 3>> levelResolution_;
+        std::vector<std::array<uint32_t, 3>> levelBrickCount_;
+        std::vector<std::size_t> levelFirstBrick_;
+        std::size_t numBricks_;
+        std::vector<MinMaxGrid> minMaxGrids_;
+
+        mutable std::mutex cacheMutex_;
+        std::unordered_map<std::size_t, CacheEntry> cache_;
+        std::list<std::size_t> lru_; // most recently used first
+        CacheStats cacheStats_;
+        TrackedMemory cacheMemory_;
+    };
+} // namespace OGL4Core2::Core
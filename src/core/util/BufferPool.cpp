@@ -0,0 +1,71 @@
+#include "BufferPool.h"
+
+#include <algorithm>
+#include <utility>
+
+using namespace OGL4Core2::Core;
+
+BufferPool::BufferPool(std::size_t maxBuffers)
+    : maxBuffers_(std::max<std::size_t>(maxBuffers, 1)),
+      acquired_(0),
+      reused_(0) {}
+
+std::vector<unsigned char> BufferPool::acquire(std::size_t size) {
+    std::vector<unsigned char> buffer;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        acquired_++;
+        // Best fit: the smallest buffer which is large enough.
+        auto best = buffers_.end();
+        for (auto it = buffers_.begin(); it != buffers_.end(); ++it) {
+            if (it->capacity() >= size && (best == buffers_.end() || it->capacity() < best->capacity())) {
+                best = it;
+            }
+        }
+        if (best != buffers_.end()) {
+            buffer = std::move(*best);
+            buffers_.erase(best);
+            reused_++;
+        }
+    }
+    buffer.resize(size);
+    return buffer;
+}
+
+void BufferPool::release(std::vector<unsigned char>&& buffer) {
+    if (buffer.capacity() == 0) {
+        return;
+    }
+    std::vector<unsigned char> dropped;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        buffers_.emplace_back(std::move(buffer));
+        if (buffers_.size() > maxBuffers_) {
+            auto smallest = std::min_element(buffers_.begin(), buffers_.end(),
+                [](const auto& a, const auto& b) { return a.capacity() < b.capacity(); });
+            dropped = std::move(*smallest);
+            buffers_.erase(smallest);
+        }
+    }
+    // dropped is freed outside of the lock.
+}
+
+void BufferPool::clear() {
+    std::vector<std::vector<unsigned char>> buffers;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        buffers.swap(buffers_);
+    }
+}
+
+BufferPool::Stats BufferPool::getStats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Stats stats;
+    stats.acquired = acquired_;
+    stats.reused = reused_;
+    stats.pooled = buffers_.size();
+    for (const auto& buffer : buffers_) {
+        stats.pooledBytes += buffer.capacity();
+    }
+    return stats;
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstddef>
+#include <mutex>
+#include <vector>
+
+namespace OGL4Core2::Core {
+    /**
+     * Thread-safe pool of byte buffers for data of recurring size, e.g. readback images. Released buffers keep their
+     * capacity and are handed out again by acquire(), so a steady stream of equally sized buffers does not touch the
+     * heap after the first few.
+     */
+    class BufferPool {
+    public:
+        struct Stats {
+            std::size_t acquired = 0; //!< total number of acquire() calls
+            std::size_t reused = 0;   //!< acquire() calls served from the pool
+            std::size_t pooled = 0;   //!< buffers currently in the pool
+            std::size_t pooledBytes = 0;
+        };
+
+        explicit BufferPool(std::size_t maxBuffers = 8);
+        ~BufferPool() = default;
+
+        BufferPool(const BufferPool&) = delete;
+        BufferPool(BufferPool&&) = delete;
+        BufferPool& operator=(const BufferPool&) = delete;
+        BufferPool& operator=(BufferPool&&) = delete;
+
+        /**
+         * Returns a buffer resized to size. The content is unspecified.
+         */
+        [[nodiscard]] std::vector<unsigned char> acquire(std::size_t size);
+
+        /**
+         * Return a buffer to the pool. If the pool is full, the buffer with the smallest capacity is freed.
+         */
+        void release(std::vector<unsigned char>&& buffer);
+
+        void clear();
+
+        [[nodiscard]] Stats getStats() const;
+
+    private:
+        std::size_t maxBuffers_;
+        std::vector<std::vector<unsigned char>> buffers_;
+        std::size_t acquired_;
+        std::size_t reused_;
+        mutable std::mutex mutex_;
+    };
+} // namespace OGL4Core2::Core
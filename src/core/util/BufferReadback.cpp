@@ -0,0 +1,106 @@
+#include "BufferReadback.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+using namespace OGL4Core2::Core;
+
+BufferReadback::BufferReadback(std::size_t numBuffers)
+    : slots_(std::max<std::size_t>(numBuffers, 1)),
+      nextSequence_(0) {}
+
+BufferReadback::~BufferReadback() {
+    for (auto& slot : slots_) {
+        release(slot);
+    }
+}
+
+bool BufferReadback::capture(GLuint buffer, std::size_t size) {
+    if (size == 0) {
+        return true;
+    }
+    auto slot = std::find_if(slots_.begin(), slots_.end(), [](const Slot& s) { return s.fence == nullptr; });
+    if (slot == slots_.end()) {
+        return false;
+    }
+    if (slot->capacity < size) {
+        allocate(*slot, size);
+    }
+
+    glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, slot->buffer);
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, static_cast<GLsizeiptr>(size));
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    slot->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    slot->size = size;
+    slot->sequence = nextSequence_++;
+    return true;
+}
+
+bool BufferReadback::read(void* dst, std::size_t size) {
+    Slot* oldest = nullptr;
+    for (auto& slot : slots_) {
+        if (slot.fence != nullptr && (oldest == nullptr || slot.sequence < oldest->sequence)) {
+            oldest = &slot;
+        }
+    }
+    if (oldest == nullptr) {
+        return false;
+    }
+    // A zero timeout only polls. The flush makes sure the fence is submitted, also without a buffer swap.
+    const GLenum status = glClientWaitSync(oldest->fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+    if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) {
+        return false;
+    }
+    glDeleteSync(oldest->fence);
+    oldest->fence = nullptr;
+    // The buffer is mapped coherent, after the fence is signaled the copied data is visible to the CPU.
+    std::memcpy(dst, oldest->mapping, std::min(size, oldest->size));
+    return true;
+}
+
+void BufferReadback::reset() {
+    for (auto& slot : slots_) {
+        if (slot.fence != nullptr) {
+            glDeleteSync(slot.fence);
+            slot.fence = nullptr;
+        }
+    }
+}
+
+std::size_t BufferReadback::getPending() const {
+    return static_cast<std::size_t>(
+        std::count_if(slots_.begin(), slots_.end(), [](const Slot& s) { return s.fence != nullptr; }));
+}
+
+void BufferReadback::allocate(Slot& slot, std::size_t size) {
+    release(slot);
+    const GLbitfield flags = GL_MAP_READ_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    glGenBuffers(1, &slot.buffer);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, slot.buffer);
+    glBufferStorage(GL_COPY_WRITE_BUFFER, static_cast<GLsizeiptr>(size), nullptr, flags);
+    slot.mapping = glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, static_cast<GLsizeiptr>(size), flags);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    if (slot.mapping == nullptr) {
+        release(slot);
+        throw std::runtime_error("Cannot map readback buffer!");
+    }
+    slot.capacity = size;
+}
+
+void BufferReadback::release(Slot& slot) {
+    if (slot.fence != nullptr) {
+        glDeleteSync(slot.fence);
+    }
+    if (slot.buffer != 0) {
+        if (slot.mapping != nullptr) {
+            glBindBuffer(GL_COPY_WRITE_BUFFER, slot.buffer);
+            glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+            glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        }
+        glDeleteBuffers(1, &slot.buffer);
+    }
+    slot = Slot();
+}
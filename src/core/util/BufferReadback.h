@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <glad/gl.h>
+
+namespace OGL4Core2::Core {
+    /**
+     * Asynchronous readback of buffer objects, e.g. feedback or counters written by shaders. The buffer is copied on
+     * the GPU into a ring of persistently mapped staging buffers guarded by fences. read() only returns copies whose
+     * fence is already signaled, so the CPU never waits for the GPU. The data arrives a few frames late, depending on
+     * how far the GPU is behind.
+     */
+    class BufferReadback {
+    public:
+        /**
+         * No OpenGL objects are created until the first capture.
+         */
+        explicit BufferReadback(std::size_t numBuffers);
+        ~BufferReadback();
+
+        BufferReadback(const BufferReadback&) = delete;
+        BufferReadback(BufferReadback&&) = delete;
+        BufferReadback& operator=(const BufferReadback&) = delete;
+        BufferReadback& operator=(BufferReadback&&) = delete;
+
+        /**
+         * Copy the first size bytes of buffer into a free staging buffer. Shader writes to buffer must be made
+         * visible before, with glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT). Returns false without copying, if all
+         * staging buffers are still in flight.
+         */
+        bool capture(GLuint buffer, std::size_t size);
+
+        /**
+         * Copy the oldest finished capture into dst, at most size bytes, and release its staging buffer. Returns
+         * false, if no capture has finished yet. Never blocks.
+         */
+        bool read(void* dst, std::size_t size);
+
+        /**
+         * Drop all captures, e.g. if the captured buffer was resized.
+         */
+        void reset();
+
+        [[nodiscard]] std::size_t getPending() const;
+
+    private:
+        struct Slot {
+            GLuint buffer = 0;
+            std::size_t capacity = 0;
+            void* mapping = nullptr;
+            GLsync fence = nullptr; //!< set while the capture is pending
+            std::size_t size = 0;
+            uint64_t sequence = 0;  //!< capture order, captures are read oldest first
+        };
+
+        static void allocate(Slot& slot, std::size_t size);
+        static void release(Slot& slot);
+
+        std::vector<Slot> slots_;
+        uint64_t nextSequence_;
+    };
+} // namespace OGL4Core2::Core
@@ -0,0 +1,340 @@
+#include "FileReader.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#define OGL4CORE2_IO_URING 1
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "MappedFile.h"
+#include "ReadOnlyFile.h"
+#include "ThreadPool.h"
+
+using namespace OGL4Core2::Core;
+
+namespace {
+    // Large chunks keep the number of requests low, while still spreading the reads over all workers.
+    constexpr std::size_t readChunkSize = 8 * 1024 * 1024;
+    constexpr std::size_t pageSize = 4096;
+    constexpr unsigned int ioUringQueueDepth = 32;
+    constexpr std::size_t ioUringChunkSize = 2 * 1024 * 1024;
+
+#ifdef OGL4CORE2_IO_URING
+    /**
+     * Minimal io_uring through the raw system calls, to avoid a dependency on liburing. Only used from one thread.
+     */
+    class IoUring {
+    public:
+        explicit IoUring(unsigned int entries) : pending_(0), inFlight_(0) {
+            io_uring_params params{};
+            fd_ = static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+            if (fd_ < 0) {
+                throw std::runtime_error(std::string("io_uring_setup failed: ") + std::strerror(errno) + "!");
+            }
+            sqRingSize_ = params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+            cqRingSize_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+            singleMmap_ = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+            if (singleMmap_) {
+                sqRingSize_ = cqRingSize_ = std::max(sqRingSize_, cqRingSize_);
+            }
+            sqesSize_ = params.sq_entries * sizeof(io_uring_sqe);
+
+            sqRing_ = mmap(nullptr, sqRingSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_,
+                IORING_OFF_SQ_RING);
+            cqRing_ = singleMmap_ ? sqRing_
+                                  : mmap(nullptr, cqRingSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                                        fd_, IORING_OFF_CQ_RING);
+            void* sqes = mmap(nullptr, sqesSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_,
+                IORING_OFF_SQES);
+            if (sqRing_ == MAP_FAILED || cqRing_ == MAP_FAILED || sqes == MAP_FAILED) {
+                const int error = errno;
+                unmap(sqes);
+                throw std::runtime_error(std::string("Cannot map io_uring: ") + std::strerror(error) + "!");
+            }
+            sqes_ = static_cast<io_uring_sqe*>(sqes);
+
+            auto* sq = static_cast<unsigned char*>(sqRing_);
+            sqTail_ = reinterpret_cast<unsigned int*>(sq + params.sq_off.tail);
+            sqMask_ = *reinterpret_cast<unsigned int*>(sq + params.sq_off.ring_mask);
+            sqArray_ = reinterpret_cast<unsigned int*>(sq + params.sq_off.array);
+            auto* cq = static_cast<unsigned char*>(cqRing_);
+            cqHead_ = reinterpret_cast<unsigned int*>(cq + params.cq_off.head);
+            cqTail_ = reinterpret_cast<unsigned int*>(cq + params.cq_off.tail);
+            cqMask_ = *reinterpret_cast<unsigned int*>(cq + params.cq_off.ring_mask);
+            cqes_ = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+        }
+
+        ~IoUring() {
+            // Closing the ring does not stop requests in flight, they would still write into the buffer of the
+            // caller, e.g. while it is read again with pread after an error.
+            drain();
+            unmap(sqes_);
+        }
+
+        IoUring(const IoUring&) = delete;
+        IoUring(IoUring&&) = delete;
+        IoUring& operator=(const IoUring&) = delete;
+        IoUring& operator=(IoUring&&) = delete;
+
+        void queueRead(int fd, unsigned char* dst, std::size_t size, std::size_t offset, uint64_t userData) {
+            // The tail is only written by us, the kernel reads it.
+            const unsigned int tail = *sqTail_;
+            const unsigned int index = tail & sqMask_;
+            io_uring_sqe& sqe = sqes_[index];
+            std::memset(&sqe, 0, sizeof(sqe));
+            sqe.opcode = IORING_OP_READ;
+            sqe.fd = fd;
+            sqe.addr = reinterpret_cast<uint64_t>(dst);
+            sqe.len = static_cast<uint32_t>(size);
+            sqe.off = static_cast<uint64_t>(offset);
+            sqe.user_data = userData;
+            sqArray_[index] = index;
+            __atomic_store_n(sqTail_, tail + 1, __ATOMIC_RELEASE);
+            pending_++;
+        }
+
+        /**
+         * Submit all queued requests and wait for at least one completion.
+         */
+        void submitAndWait() {
+            for (;;) {
+                const long result =
+                    syscall(__NR_io_uring_enter, fd_, pending_, 1u, IORING_ENTER_GETEVENTS, nullptr, 0);
+                if (result >= 0) {
+                    pending_ -= static_cast<unsigned int>(result);
+                    inFlight_ += static_cast<unsigned int>(result);
+                    return;
+                }
+                if (errno != EINTR) {
+                    throw std::runtime_error(std::string("io_uring_enter failed: ") + std::strerror(errno) + "!");
+                }
+            }
+        }
+
+        bool popCompletion(uint64_t& userData, int& result) {
+            const unsigned int head = *cqHead_;
+            if (head == __atomic_load_n(cqTail_, __ATOMIC_ACQUIRE)) {
+                return false;
+            }
+            const io_uring_cqe& cqe = cqes_[head & cqMask_];
+            userData = cqe.user_data;
+            result = cqe.res;
+            __atomic_store_n(cqHead_, head + 1, __ATOMIC_RELEASE);
+            inFlight_--;
+            return true;
+        }
+
+        /**
+         * Wait for all submitted requests and discard their completions. Queued requests, which were not submitted,
+         * never reach the kernel.
+         */
+        void drain() noexcept {
+            uint64_t userData = 0;
+            int result = 0;
+            while (inFlight_ > 0) {
+                if (popCompletion(userData, result)) {
+                    continue;
+                }
+                // The kernel posts the completions in any case, if waiting for them fails they are polled.
+                if (syscall(__NR_io_uring_enter, fd_, 0u, 1u, IORING_ENTER_GETEVENTS, nullptr, 0) < 0 &&
+                    errno != EINTR) {
+                    std::this_thread::yield();
+                }
+            }
+        }
+
+    private:
+        void unmap(void* sqes) {
+            if (sqes != MAP_FAILED && sqes != nullptr) {
+                munmap(sqes, sqesSize_);
+            }
+            if (!singleMmap_ && cqRing_ != MAP_FAILED) {
+                munmap(cqRing_, cqRingSize_);
+            }
+            if (sqRing_ != MAP_FAILED) {
+                munmap(sqRing_, sqRingSize_);
+            }
+            close(fd_);
+        }
+
+        int fd_;
+        bool singleMmap_;
+        std::size_t sqRingSize_;
+        std::size_t cqRingSize_;
+        std::size_t sqesSize_;
+        void* sqRing_;
+        void* cqRing_;
+        io_uring_sqe* sqes_;
+        unsigned int* sqTail_;
+        unsigned int sqMask_;
+        unsigned int* sqArray_;
+        unsigned int* cqHead_;
+        unsigned int* cqTail_;
+        unsigned int cqMask_;
+        io_uring_cqe* cqes_;
+        unsigned int pending_;
+        unsigned int inFlight_;
+    };
+
+    void readIoUring(const ReadOnlyFile& file, unsigned char* dst, std::size_t offset, std::size_t size) {
+        struct Request {
+            std::size_t pos;
+            std::size_t remaining;
+        };
+        IoUring ring(ioUringQueueDepth);
+        std::vector<Request> requests(ioUringQueueDepth);
+        std::vector<uint64_t> freeSlots;
+        for (uint64_t i = 0; i < ioUringQueueDepth; i++) {
+            freeSlots.push_back(i);
+        }
+        const auto queue = [&](uint64_t slot) {
+            const Request& r = requests[slot];
+            ring.queueRead(file.fd(), dst + r.pos, std::min(r.remaining, ioUringChunkSize), offset + r.pos, slot);
+        };
+
+        std::size_t next = 0;
+        while (next < size || freeSlots.size() < ioUringQueueDepth) {
+            while (next < size && !freeSlots.empty()) {
+                const uint64_t slot = freeSlots.back();
+                freeSlots.pop_back();
+                const std::size_t length = std::min(ioUringChunkSize, size - next);
+                requests[slot] = {next, length};
+                next += length;
+                queue(slot);
+            }
+            ring.submitAndWait();
+            uint64_t slot = 0;
+            int result = 0;
+            while (ring.popCompletion(slot, result)) {
+                if (result <= 0) {
+                    throw std::runtime_error(std::string("io_uring read failed: ") +
+                                             (result < 0 ? std::strerror(-result) : "unexpected end of file") + "!");
+                }
+                // Short reads are continued with the rest of the chunk.
+                Request& r = requests[slot];
+                r.pos += static_cast<std::size_t>(result);
+                r.remaining -= static_cast<std::size_t>(result);
+                if (r.remaining > 0) {
+                    queue(slot);
+                } else {
+                    freeSlots.push_back(slot);
+                }
+            }
+        }
+    }
+#endif
+
+    void readParallel(const ReadOnlyFile& file, unsigned char* dst, std::size_t offset, std::size_t size,
+        ThreadPool& pool) {
+        const std::size_t chunks = (size + readChunkSize - 1) / readChunkSize;
+        pool.parallelFor(0, chunks, [&](std::size_t begin, std::size_t end) {
+            for (std::size_t c = begin; c < end; c++) {
+                const std::size_t pos = c * readChunkSize;
+                file.readAt(dst + pos, offset + pos, std::min(readChunkSize, size - pos));
+            }
+        }, 1);
+    }
+} // namespace
+
+ResourceView FileReader::read(const std::filesystem::path& filename, std::size_t offset, std::size_t size,
+    Backend backend, ThreadPool& pool, Stats* stats) {
+    if (backend == Backend::External) {
+        throw std::runtime_error("Invalid I/O backend for reading \"" + filename.string() + "\"!");
+    }
+    const auto start = std::chrono::steady_clock::now();
+    ResourceView view;
+
+    if (backend == Backend::Mmap) {
+        auto file = std::make_shared<MappedFile>(filename);
+        if (offset > file->size() || size > file->size() - offset) {
+            throw std::runtime_error("File \"" + filename.string() + "\" is too short!");
+        }
+        // Touching one byte per page on all workers keeps many page faults and thereby reads in flight.
+        file->prefetch(offset, size);
+        const unsigned char* data = file->data() + offset;
+        const std::size_t chunks = (size + readChunkSize - 1) / readChunkSize;
+        pool.parallelFor(0, chunks, [data, size](std::size_t begin, std::size_t end) {
+            unsigned char sum = 0;
+            for (std::size_t pos = begin * readChunkSize; pos < std::min(size, end * readChunkSize); pos += pageSize) {
+                sum ^= *static_cast<const volatile unsigned char*>(data + pos);
+            }
+            [[maybe_unused]] volatile unsigned char sink = sum;
+        }, 1);
+        view.data = data;
+        view.size = size;
+        view.owner = std::move(file);
+    } else {
+        ReadOnlyFile file(filename);
+        if (offset > file.size() || size > file.size() - offset) {
+            throw std::runtime_error("File \"" + filename.string() + "\" is too short!");
+        }
+        // Not value initialized, the buffer is overwritten completely.
+        std::shared_ptr<unsigned char[]> buffer(new unsigned char[std::max<std::size_t>(size, 1)]);
+#ifdef OGL4CORE2_IO_URING
+        if (backend == Backend::IoUring) {
+            try {
+                readIoUring(file, buffer.get(), offset, size);
+            } catch (const std::exception& ex) {
+                // E.g. old kernels or io_uring disabled by a seccomp filter.
+                std::cerr << "io_uring not available, using pread: " << ex.what() << std::endl;
+                backend = Backend::Pread;
+            }
+        }
+#else
+        backend = Backend::Pread;
+#endif
+        if (backend == Backend::Pread) {
+            readParallel(file, buffer.get(), offset, size, pool);
+        }
+        view.data = buffer.get();
+        view.size = size;
+        view.owner = std::move(buffer);
+    }
+
+    if (stats != nullptr) {
+        stats->backend = backend;
+        stats->bytes = size;
+        stats->seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+    return view;
+}
+
+FileReader::Backend FileReader::parseBackend(const std::string& name) {
+    if (name == "mmap") {
+        return Backend::Mmap;
+    }
+    if (name == "pread") {
+        return Backend::Pread;
+    }
+    if (name == "io_uring") {
+        return Backend::IoUring;
+    }
+    throw std::runtime_error("Unknown I/O backend \"" + name + "\"!");
+}
+
+const char* FileReader::backendName(Backend backend) {
+    switch (backend) {
+        case Backend::Mmap:
+            return "mmap";
+        case Backend::Pread:
+            return "pread";
+        case Backend::IoUring:
+            return "io_uring";
+        case Backend::External:
+            return "external";
+    }
+    return "unknown";
+}
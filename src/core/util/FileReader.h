@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <string>
+
+#include "ResourceArchive.h"
+
+namespace OGL4Core2::Core {
+    class ThreadPool;
+
+    /**
+     * Reading large files, e.g. raw volumes, with a selectable I/O backend. The result is a view owning its data, so
+     * memory mapped files are used in place without a copy.
+     */
+    class FileReader {
+    public:
+        enum class Backend {
+            Mmap,     //!< zero-copy view into a memory mapping, pages are faulted in by parallel workers
+            Pread,    //!< positional reads of large chunks into a buffer, in parallel on the thread pool
+            IoUring,  //!< all chunks queued to an io_uring (Linux), falls back to Pread if not available
+            External, //!< not a backend of read(), stats of data read by other means, e.g. decoded by datraw
+        };
+
+        struct Stats {
+            Backend backend = Backend::Mmap; //!< backend actually used
+            std::size_t bytes = 0;
+            double seconds = 0.0;
+
+            [[nodiscard]] inline double throughputMiBs() const {
+                return seconds > 0.0 ? static_cast<double>(bytes) / (1024.0 * 1024.0) / seconds : 0.0;
+            }
+        };
+
+        /**
+         * Read size bytes starting at offset. Throws if the file cannot be read or is too short. The data is
+         * completely loaded when this returns, also for mapped files.
+         */
+        static ResourceView read(const std::filesystem::path& filename, std::size_t offset, std::size_t size,
+            Backend backend, ThreadPool& pool, Stats* stats = nullptr);
+
+        static Backend parseBackend(const std::string& name);
+        static const char* backendName(Backend backend);
+    };
+} // namespace OGL4Core2::Core
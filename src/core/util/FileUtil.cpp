@@ -2,6 +2,7 @@
 
 #include <algorithm>
 #include <cctype>
+#include <cstdlib>
 #include <fstream>
 #include <stdexcept>
 
@@ -17,6 +18,22 @@
 
 using namespace OGL4Core2::Core;
 
+static constexpr char resourceArchiveExtension[] = ".ogl4pak";
+
+namespace {
+    // Returns the path of the config file written to the cmake build directory, or an empty path when running from an
+    // installed directory.
+    std::filesystem::path findConfigFilePath(const std::filesystem::path& fullExeName) {
+        // Remove extension (on Windows).
+        std::filesystem::path configFilePath = (fullExeName.parent_path() / fullExeName.stem()).string() + ".config";
+        // Visual Studio creates "Release" or "Debug" directories for binary. Check parent directory for config.
+        if (!std::filesystem::exists(configFilePath)) {
+            configFilePath = (fullExeName.parent_path().parent_path() / fullExeName.stem()).string() + ".config";
+        }
+        return std::filesystem::exists(configFilePath) ? configFilePath : std::filesystem::path();
+    }
+} // namespace
+
 std::filesystem::path FileUtil::getFullExeName() {
 #ifdef WIN32
     std::vector<wchar_t> filename;
@@ -54,13 +71,8 @@ std::filesystem::path FileUtil::findPluginResourcesPath(const std::string& path)
     // Also, we can check for existence of this config file to distinguish between the two cases.
 
     std::filesystem::path fullExeName = FileUtil::getFullExeName();
-    // Remove extension (on Windows).
-    std::filesystem::path configFilePath = (fullExeName.parent_path() / fullExeName.stem()).string() + ".config";
-    // Visual Studio creates "Release" or "Debug" directories for binary. Check parent directory for config.
-    if (!std::filesystem::exists(configFilePath)) {
-        configFilePath = (fullExeName.parent_path().parent_path() / fullExeName.stem()).string() + ".config";
-    }
-    if (std::filesystem::exists(configFilePath)) {
+    std::filesystem::path configFilePath = findConfigFilePath(fullExeName);
+    if (!configFilePath.empty()) {
         if (!std::filesystem::is_regular_file(configFilePath)) {
             throw std::runtime_error("Cannot read config file!");
         }
@@ -96,9 +108,45 @@ std::filesystem::path FileUtil::findPluginResourcesPath(const std::string& path)
         // running from installed directory
         std::filesystem::path pluginResourcesDir =
             fullExeName.parent_path().parent_path() / "resources" / std::filesystem::path(path).make_preferred();
-        if (!std::filesystem::is_directory(pluginResourcesDir)) {
+        // Installations may contain only the resource archive.
+        if (!std::filesystem::is_directory(pluginResourcesDir) &&
+            !std::filesystem::is_regular_file(pluginResourcesDir.string() + resourceArchiveExtension)) {
             throw std::runtime_error("Resources dir not found!");
         }
         return pluginResourcesDir;
     }
 }
+
+std::filesystem::path FileUtil::findPluginResourceArchive(const std::string& path) {
+    // Archives are only used by installed builds. When running from the build directory, the resources in the source
+    // directory are used directly, so that they can be edited.
+    std::filesystem::path fullExeName = FileUtil::getFullExeName();
+    if (!findConfigFilePath(fullExeName).empty()) {
+        return {};
+    }
+    const std::string archiveName = std::filesystem::path(path).make_preferred().string() + resourceArchiveExtension;
+    std::filesystem::path archivePath = fullExeName.parent_path().parent_path() / "resources" / archiveName;
+    if (!std::filesystem::is_regular_file(archivePath)) {
+        return {};
+    }
+    return archivePath;
+}
+
+std::filesystem::path FileUtil::getUserCachePath() {
+#ifdef _WIN32
+    const char* localAppData = std::getenv("LOCALAPPDATA");
+    if (localAppData != nullptr && *localAppData != '\0') {
+        return std::filesystem::path(localAppData) / "OGL4Core2";
+    }
+#else
+    const char* xdgCacheHome = std::getenv("XDG_CACHE_HOME");
+    if (xdgCacheHome != nullptr && *xdgCacheHome != '\0') {
+        return std::filesystem::path(xdgCacheHome) / "OGL4Core2";
+    }
+    const char* home = std::getenv("HOME");
+    if (home != nullptr && *home != '\0') {
+        return std::filesystem::path(home) / ".cache" / "OGL4Core2";
+    }
+#endif
+    return std::filesystem::temp_directory_path() / "OGL4Core2";
+}
@@ -9,5 +9,15 @@ namespace OGL4Core2::Core {
         static std::filesystem::path getFullExeName();
 
         static std::filesystem::path findPluginResourcesPath(const std::string& path);
+
+        /**
+         * Path of the resource archive of an installed plugin, or an empty path if there is none.
+         */
+        static std::filesystem::path findPluginResourceArchive(const std::string& path);
+
+        /**
+         * Per-user cache directory of OGL4Core2, e.g. ~/.cache/OGL4Core2. It is not created here.
+         */
+        static std::filesystem::path getUserCachePath();
     };
 } // namespace OGL4Core2::Core
@@ -0,0 +1,136 @@
+#include "FileWatcher.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+using namespace OGL4Core2::Core;
+
+#ifdef __linux__
+
+FileWatcher::FileWatcher(std::filesystem::path dir) : dir_(std::move(dir)), fd_(-1) {
+    fd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (fd_ < 0) {
+        throw std::runtime_error("Cannot initialize inotify: " + std::string(std::strerror(errno)) + "!");
+    }
+    try {
+        addWatch(dir_);
+        for (const auto& entry : std::filesystem::recursive_directory_iterator(dir_)) {
+            if (entry.is_directory()) {
+                addWatch(entry.path());
+            }
+        }
+    } catch (...) {
+        close(fd_);
+        throw;
+    }
+}
+
+FileWatcher::~FileWatcher() {
+    // Closing the descriptor removes all watches.
+    close(fd_);
+}
+
+std::vector<std::filesystem::path> FileWatcher::poll() {
+    std::vector<std::filesystem::path> changed;
+    alignas(inotify_event) char buffer[4096];
+    while (true) {
+        const ssize_t length = read(fd_, buffer, sizeof(buffer));
+        if (length <= 0) {
+            // EAGAIN, no more events queued.
+            break;
+        }
+        for (ssize_t offset = 0; offset < length;) {
+            const auto* event = reinterpret_cast<const inotify_event*>(buffer + offset);
+            offset += static_cast<ssize_t>(sizeof(inotify_event) + event->len);
+
+            if (event->mask & IN_IGNORED) {
+                watches_.erase(event->wd);
+                continue;
+            }
+            auto it = watches_.find(event->wd);
+            if (it == watches_.end() || event->len == 0) {
+                continue;
+            }
+            const std::filesystem::path path = it->second / event->name;
+            if (event->mask & IN_ISDIR) {
+                if (event->mask & (IN_CREATE | IN_MOVED_TO)) {
+                    addWatch(path);
+                }
+            } else if (event->mask & (IN_CLOSE_WRITE | IN_MOVED_TO)) {
+                // New files are reported when closed after writing, not on creation. Editors replacing the file on
+                // save move it into place.
+                changed.push_back(path);
+            }
+        }
+    }
+    std::sort(changed.begin(), changed.end());
+    changed.erase(std::unique(changed.begin(), changed.end()), changed.end());
+    return changed;
+}
+
+void FileWatcher::addWatch(const std::filesystem::path& dir) {
+    const int wd = inotify_add_watch(fd_, dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE | IN_ONLYDIR);
+    if (wd < 0) {
+        throw std::runtime_error("Cannot watch directory \"" + dir.string() + "\": " + std::strerror(errno) + "!");
+    }
+    watches_[wd] = dir;
+}
+
+#else
+
+static constexpr auto scanInterval = std::chrono::milliseconds(500);
+
+FileWatcher::FileWatcher(std::filesystem::path dir) : dir_(std::move(dir)) {
+    if (!std::filesystem::is_directory(dir_)) {
+        throw std::runtime_error("Cannot watch directory \"" + dir_.string() + "\"!");
+    }
+    mtimes_ = scan();
+    lastScan_ = std::chrono::steady_clock::now();
+}
+
+FileWatcher::~FileWatcher() = default;
+
+std::vector<std::filesystem::path> FileWatcher::poll() {
+    std::vector<std::filesystem::path> changed;
+    const auto now = std::chrono::steady_clock::now();
+    if (now - lastScan_ < scanInterval) {
+        return changed;
+    }
+    lastScan_ = now;
+
+    auto mtimes = scan();
+    for (const auto& [path, mtime] : mtimes) {
+        auto it = mtimes_.find(path);
+        if (it == mtimes_.end() || it->second != mtime) {
+            changed.emplace_back(path);
+        }
+    }
+    mtimes_ = std::move(mtimes);
+    std::sort(changed.begin(), changed.end());
+    return changed;
+}
+
+std::unordered_map<std::string, std::filesystem::file_time_type> FileWatcher::scan() const {
+    std::unordered_map<std::string, std::filesystem::file_time_type> mtimes;
+    std::error_code ec;
+    for (auto it = std::filesystem::recursive_directory_iterator(dir_, ec);
+         it != std::filesystem::recursive_directory_iterator(); it.increment(ec)) {
+        if (ec) {
+            break;
+        }
+        if (it->is_regular_file(ec)) {
+            mtimes[it->path().string()] = it->last_write_time(ec);
+        }
+    }
+    return mtimes;
+}
+
+#endif
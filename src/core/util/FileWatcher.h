@@ -0,0 +1,49 @@
+#pragma once
+
+#include <chrono>
+#include <filesystem>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace OGL4Core2::Core {
+    /**
+     * Watches a directory tree for modified files. On Linux inotify is used, changes are collected by the kernel and
+     * poll() only reads the queued events without blocking. Elsewhere, the modification times of all files are
+     * compared, at most twice per second.
+     */
+    class FileWatcher {
+    public:
+        explicit FileWatcher(std::filesystem::path dir);
+        ~FileWatcher();
+
+        FileWatcher(const FileWatcher&) = delete;
+        FileWatcher(FileWatcher&&) = delete;
+        FileWatcher& operator=(const FileWatcher&) = delete;
+        FileWatcher& operator=(FileWatcher&&) = delete;
+
+        [[nodiscard]] inline const std::filesystem::path& getDir() const {
+            return dir_;
+        }
+
+        /**
+         * Files written or moved into the directory tree since the last call, each file is reported once.
+         */
+        [[nodiscard]] std::vector<std::filesystem::path> poll();
+
+    private:
+        std::filesystem::path dir_;
+
+#ifdef __linux__
+        void addWatch(const std::filesystem::path& dir);
+
+        int fd_;
+        std::unordered_map<int, std::filesystem::path> watches_;
+#else
+        std::unordered_map<std::string, std::filesystem::file_time_type> scan() const;
+
+        std::unordered_map<std::string, std::filesystem::file_time_type> mtimes_;
+        std::chrono::steady_clock::time_point lastScan_;
+#endif
+    };
+} // namespace OGL4Core2::Core
@@ -0,0 +1,76 @@
+#include "FrameArena.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+using namespace OGL4Core2::Core;
+
+FrameArena::FrameArena(std::size_t blockSize)
+    : blockSize_(std::max<std::size_t>(blockSize, 4096)),
+      currentBlock_(0),
+      offset_(0),
+      used_(0),
+      peak_(0),
+      allocations_(0) {
+    addBlock(blockSize_);
+}
+
+FrameArena::~FrameArena() = default;
+
+void* FrameArena::allocate(std::size_t size, std::size_t alignment) {
+    if (alignment == 0 || (alignment & (alignment - 1)) != 0) {
+        throw std::invalid_argument("Arena alignment must be a power of two!");
+    }
+    // Keep zero sized allocations distinct.
+    size = std::max<std::size_t>(size, 1);
+
+    while (true) {
+        auto& block = blocks_[currentBlock_];
+        const auto base = reinterpret_cast<std::uintptr_t>(block.data.get());
+        const std::size_t aligned = ((base + offset_ + alignment - 1) & ~(alignment - 1)) - base;
+        if (aligned + size <= block.size) {
+            offset_ = aligned + size;
+            used_ += size;
+            peak_ = std::max(peak_, used_);
+            allocations_++;
+            return block.data.get() + aligned;
+        }
+        if (currentBlock_ + 1 == blocks_.size()) {
+            addBlock(size + alignment);
+        }
+        currentBlock_++;
+        offset_ = 0;
+    }
+}
+
+void FrameArena::reset() {
+    if (blocks_.size() > 1) {
+        // The next frame likely needs as much memory as this one, allocate it as a single block.
+        std::size_t capacity = 0;
+        for (const auto& block : blocks_) {
+            capacity += block.size;
+        }
+        blocks_.clear();
+        addBlock(capacity);
+    }
+    currentBlock_ = 0;
+    offset_ = 0;
+    used_ = 0;
+    allocations_ = 0;
+}
+
+FrameArena::Stats FrameArena::getStats() const {
+    Stats stats;
+    stats.used = used_;
+    for (const auto& block : blocks_) {
+        stats.capacity += block.size;
+    }
+    stats.peak = peak_;
+    stats.allocations = allocations_;
+    return stats;
+}
+
+void FrameArena::addBlock(std::size_t minSize) {
+    const std::size_t size = std::max(minSize, blockSize_);
+    blocks_.push_back({std::make_unique<unsigned char[]>(size), size});
+}
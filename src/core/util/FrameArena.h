@@ -0,0 +1,102 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <vector>
+
+namespace OGL4Core2::Core {
+    /**
+     * Linear (bump) allocator for transient data living at most one frame. Allocating moves a pointer forward,
+     * deallocating does nothing, reset() releases everything at once. The core resets its arena at the end of every
+     * frame. If a frame needed more than one block, the blocks are merged on reset, so from then on a frame fits into
+     * a single block without any heap allocation.
+     *
+     * Not thread-safe, the arena of the core must only be used on the render thread.
+     */
+    class FrameArena {
+    public:
+        struct Stats {
+            std::size_t used = 0;        //!< bytes allocated since the last reset
+            std::size_t capacity = 0;    //!< bytes of all blocks
+            std::size_t peak = 0;        //!< maximum bytes used within a frame
+            std::size_t allocations = 0; //!< allocations since the last reset
+        };
+
+        explicit FrameArena(std::size_t blockSize = 1024 * 1024);
+        ~FrameArena();
+
+        FrameArena(const FrameArena&) = delete;
+        FrameArena(FrameArena&&) = delete;
+        FrameArena& operator=(const FrameArena&) = delete;
+        FrameArena& operator=(FrameArena&&) = delete;
+
+        /**
+         * Returns uninitialized memory valid until the next reset(). alignment must be a power of two.
+         */
+        [[nodiscard]] void* allocate(std::size_t size, std::size_t alignment = alignof(std::max_align_t));
+
+        void reset();
+
+        [[nodiscard]] Stats getStats() const;
+
+    private:
+        struct Block {
+            std::unique_ptr<unsigned char[]> data;
+            std::size_t size;
+        };
+
+        void addBlock(std::size_t minSize);
+
+        std::size_t blockSize_;
+        std::vector<Block> blocks_;
+        std::size_t currentBlock_;
+        std::size_t offset_;
+        std::size_t used_;
+        std::size_t peak_;
+        std::size_t allocations_;
+    };
+
+    /**
+     * Standard allocator adaptor for FrameArena, e.g. for FrameVector. Containers using it must not outlive the
+     * frame. Memory is only released by resetting the arena, so growing containers should reserve their size upfront.
+     */
+    template<typename T>
+    class ArenaAllocator {
+    public:
+        using value_type = T;
+
+        explicit ArenaAllocator(FrameArena& arena) noexcept : arena_(&arena) {}
+
+        template<typename U>
+        ArenaAllocator(const ArenaAllocator<U>& other) noexcept : arena_(other.arena_) {}
+
+        [[nodiscard]] T* allocate(std::size_t n) {
+            if (n > SIZE_MAX / sizeof(T)) {
+                throw std::bad_array_new_length();
+            }
+            return static_cast<T*>(arena_->allocate(n * sizeof(T), alignof(T)));
+        }
+
+        void deallocate([[maybe_unused]] T* p, [[maybe_unused]] std::size_t n) noexcept {}
+
+        template<typename U>
+        [[nodiscard]] bool operator==(const ArenaAllocator<U>& other) const noexcept {
+            return arena_ == other.arena_;
+        }
+        template<typename U>
+        [[nodiscard]] bool operator!=(const ArenaAllocator<U>& other) const noexcept {
+            return arena_ != other.arena_;
+        }
+
+    private:
+        template<typename U>
+        friend class ArenaAllocator;
+
+        FrameArena* arena_;
+    };
+
+    template<typename T>
+    using FrameVector = std::vector<T, ArenaAllocator<T>>;
+} // namespace OGL4Core2::Core
@@ -0,0 +1,187 @@
+#include "FrameReadback.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+
+#include "ThreadPool.h"
+
+using namespace OGL4Core2::Core;
+
+FrameReadback::FrameReadback(ThreadPool& pool, std::size_t numBuffers)
+    : pool_(pool),
+      imagePool_(std::max<std::size_t>(numBuffers, 1)),
+      nextSlot_(0),
+      nextSequence_(0),
+      runningConsumers_(0) {
+    numBuffers = std::max<std::size_t>(numBuffers, 1);
+    for (std::size_t i = 0; i < numBuffers; i++) {
+        slots_.emplace_back(std::make_unique<Slot>());
+    }
+}
+
+FrameReadback::~FrameReadback() {
+    finish();
+    for (auto& slot : slots_) {
+        release(*slot);
+    }
+}
+
+bool FrameReadback::capture(GLuint fbo, GLenum readBuffer, int width, int height, Consumer consumer) {
+    if (width <= 0 || height <= 0) {
+        return true;
+    }
+
+    Slot* slot = nullptr;
+    for (std::size_t i = 0; i < slots_.size(); i++) {
+        auto& s = slots_[(nextSlot_ + i) % slots_.size()];
+        if (s->state.load(std::memory_order_acquire) == SlotState::Free) {
+            slot = s.get();
+            nextSlot_ = (nextSlot_ + i + 1) % slots_.size();
+            break;
+        }
+    }
+    if (slot == nullptr) {
+        return false;
+    }
+
+    const std::size_t size = static_cast<std::size_t>(width) * static_cast<std::size_t>(height) * 4;
+    if (slot->capacity < size) {
+        allocate(*slot, size);
+    }
+
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, fbo);
+    glReadBuffer(readBuffer);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot->buffer);
+    // The pack state is shared with other readbacks, e.g. of plugins, and is restored afterwards.
+    GLint packAlignment = 4;
+    glGetIntegerv(GL_PACK_ALIGNMENT, &packAlignment);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glPixelStorei(GL_PACK_ALIGNMENT, packAlignment);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    slot->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    // Make sure the fence reaches the GPU, also when no buffer swap follows (e.g. headless mode).
+    glFlush();
+
+    slot->width = width;
+    slot->height = height;
+    slot->sequence = nextSequence_++;
+    slot->consumer = std::move(consumer);
+    slot->state.store(SlotState::Pending, std::memory_order_release);
+    return true;
+}
+
+void FrameReadback::captureBlocking(GLuint fbo, GLenum readBuffer, int width, int height, Consumer consumer) {
+    while (!capture(fbo, readBuffer, width, height, consumer)) {
+        // Wait for the oldest pending fence, then give the workers time to release their buffers.
+        Slot* oldest = nullptr;
+        for (auto& slot : slots_) {
+            if (slot->state.load(std::memory_order_acquire) == SlotState::Pending &&
+                (oldest == nullptr || slot->sequence < oldest->sequence)) {
+                oldest = slot.get();
+            }
+        }
+        if (oldest != nullptr) {
+            glClientWaitSync(oldest->fence, GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+        }
+        poll();
+        std::this_thread::yield();
+    }
+}
+
+void FrameReadback::poll() {
+    for (auto& slot : slots_) {
+        if (slot->state.load(std::memory_order_acquire) != SlotState::Pending) {
+            continue;
+        }
+        GLint status = GL_UNSIGNALED;
+        glGetSynciv(slot->fence, GL_SYNC_STATUS, 1, nullptr, &status);
+        if (status == GL_SIGNALED) {
+            dispatch(*slot);
+        }
+    }
+}
+
+void FrameReadback::finish() {
+    for (auto& slot : slots_) {
+        if (slot->state.load(std::memory_order_acquire) == SlotState::Pending) {
+            glClientWaitSync(slot->fence, GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+            dispatch(*slot);
+        }
+    }
+    // Only the own consumers, the pool is shared with the other readback and with plugins.
+    std::unique_lock<std::mutex> lock(consumerMutex_);
+    consumersDone_.wait(lock, [this]() { return runningConsumers_ == 0; });
+}
+
+void FrameReadback::dispatch(Slot& slot) {
+    glDeleteSync(slot.fence);
+    slot.fence = nullptr;
+    slot.state.store(SlotState::Processing, std::memory_order_release);
+    {
+        std::lock_guard<std::mutex> lock(consumerMutex_);
+        runningConsumers_++;
+    }
+
+    pool_.submit([this, &slot]() {
+        // The buffer is mapped coherent, after the fence is signaled the pixel data is visible to the CPU.
+        const std::size_t size = static_cast<std::size_t>(slot.width) * static_cast<std::size_t>(slot.height) * 4;
+        std::vector<unsigned char> image = imagePool_.acquire(size);
+        std::memcpy(image.data(), slot.mapping, size);
+        const int width = slot.width;
+        const int height = slot.height;
+        Consumer consumer = std::move(slot.consumer);
+        // Copy is done, the buffer can be reused while the consumer is still working on the image.
+        slot.state.store(SlotState::Free, std::memory_order_release);
+
+        try {
+            consumer(std::move(image), width, height);
+        } catch (...) {
+            consumerDone();
+            throw;
+        }
+        // Recycle the buffer, unless the consumer took it.
+        imagePool_.release(std::move(image));
+        consumerDone();
+    });
+}
+
+void FrameReadback::consumerDone() {
+    // Notified under the lock, finish() may return and this object be destroyed right after the lock is released.
+    std::lock_guard<std::mutex> lock(consumerMutex_);
+    runningConsumers_--;
+    consumersDone_.notify_all();
+}
+
+void FrameReadback::allocate(Slot& slot, std::size_t size) {
+    release(slot);
+    const GLbitfield flags = GL_MAP_READ_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    glGenBuffers(1, &slot.buffer);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+    glBufferStorage(GL_PIXEL_PACK_BUFFER, static_cast<GLsizeiptr>(size), nullptr, flags);
+    slot.mapping = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, static_cast<GLsizeiptr>(size), flags);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    if (slot.mapping == nullptr) {
+        release(slot);
+        throw std::runtime_error("Cannot map pixel pack buffer!");
+    }
+    slot.capacity = size;
+}
+
+void FrameReadback::release(Slot& slot) {
+    if (slot.buffer != 0) {
+        if (slot.mapping != nullptr) {
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+            glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        }
+        glDeleteBuffers(1, &slot.buffer);
+    }
+    slot.buffer = 0;
+    slot.mapping = nullptr;
+    slot.capacity = 0;
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <glad/gl.h>
+
+#include "BufferPool.h"
+
+namespace OGL4Core2::Core {
+    class ThreadPool;
+
+    /**
+     * Asynchronous framebuffer readback. Pixels are read into a ring of persistently mapped pixel pack buffers and
+     * guarded by fences. Finished buffers are handed to a worker pool, which copies the pixels out of the mapping and
+     * calls the consumer callback. This way neither the GPU-CPU transfer nor the processing of the image stalls the
+     * render thread. Image buffers come from a BufferPool, a consumer which does not take ownership of the image
+     * returns it to the pool for the next capture.
+     */
+    class FrameReadback {
+    public:
+        /**
+         * Called on a worker thread with the RGBA8 pixels in OpenGL row order (bottom row first).
+         */
+        using Consumer = std::function<void(std::vector<unsigned char>&& image, int width, int height)>;
+
+        FrameReadback(ThreadPool& pool, std::size_t numBuffers);
+        ~FrameReadback();
+
+        FrameReadback(const FrameReadback&) = delete;
+        FrameReadback(FrameReadback&&) = delete;
+        FrameReadback& operator=(const FrameReadback&) = delete;
+        FrameReadback& operator=(FrameReadback&&) = delete;
+
+        /**
+         * Start reading the given framebuffer. Returns false, if all buffers are still in flight.
+         */
+        bool capture(GLuint fbo, GLenum readBuffer, int width, int height, Consumer consumer);
+
+        /**
+         * Like capture(), but blocks until a buffer is available instead of failing.
+         */
+        void captureBlocking(GLuint fbo, GLenum readBuffer, int width, int height, Consumer consumer);
+
+        /**
+         * Dispatch all buffers whose fence is signaled to the worker pool. Must be called regularly on the render
+         * thread, e.g. once per frame.
+         */
+        void poll();
+
+        /**
+         * Block until all captured frames are processed by the consumers. Other tasks of the pool are not waited for.
+         */
+        void finish();
+
+        [[nodiscard]] inline BufferPool::Stats getBufferPoolStats() const {
+            return imagePool_.getStats();
+        }
+
+    private:
+        enum class SlotState { Free, Pending, Processing };
+
+        struct Slot {
+            GLuint buffer = 0;
+            std::size_t capacity = 0;
+            void* mapping = nullptr;
+            GLsync fence = nullptr;
+            int width = 0;
+            int height = 0;
+            uint64_t sequence = 0; //!< capture order, the oldest pending slot is waited for first
+            Consumer consumer;
+            std::atomic<SlotState> state{SlotState::Free};
+        };
+
+        void dispatch(Slot& slot);
+        void consumerDone();
+        static void allocate(Slot& slot, std::size_t size);
+        static void release(Slot& slot);
+
+        ThreadPool& pool_;
+        BufferPool imagePool_;
+        std::vector<std::unique_ptr<Slot>> slots_;
+        std::size_t nextSlot_;
+        uint64_t nextSequence_;
+        std::size_t runningConsumers_; //!< dispatched and not yet finished consumer tasks
+        std::mutex consumerMutex_;
+        std::condition_variable consumersDone_;
+    };
+} // namespace OGL4Core2::Core
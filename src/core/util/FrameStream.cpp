@@ -0,0 +1,280 @@
+#include "FrameStream.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <utility>
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#endif
+
+using namespace OGL4Core2::Core;
+
+namespace {
+    constexpr std::size_t pixelSize = 4;
+    constexpr char y4mFrameHeader[] = "FRAME\n";
+    constexpr std::size_t y4mFrameHeaderSize = sizeof(y4mFrameHeader) - 1;
+    constexpr std::size_t writeBufferSize = 1 << 20;
+
+    // BT.601 limited range, 8 bit fixed point.
+    inline unsigned char rgbToY(int r, int g, int b) {
+        return static_cast<unsigned char>(((66 * r + 129 * g + 25 * b + 128) >> 8) + 16);
+    }
+    inline unsigned char rgbToU(int r, int g, int b) {
+        return static_cast<unsigned char>(((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128);
+    }
+    inline unsigned char rgbToV(int r, int g, int b) {
+        return static_cast<unsigned char>(((112 * r - 94 * g - 18 * b + 128) >> 8) + 128);
+    }
+} // namespace
+
+FrameStream::FrameStream(const std::string& path, Format format, int fps, std::size_t maxQueuedFrames)
+    : path_(path),
+      format_(format),
+      fps_(std::max(fps, 1)),
+      maxQueuedFrames_(std::max<std::size_t>(maxQueuedFrames, 1)),
+      file_(nullptr),
+      coutBuffer_(nullptr),
+      width_(0),
+      height_(0),
+      nextSequence_(0),
+      nextWrite_(0),
+      queuedFrames_(0),
+      stop_(false),
+      writeError_(false),
+      buffers_(maxQueuedFrames_ + 2) {
+    if (path_ == "-") {
+#ifdef _WIN32
+        _setmode(_fileno(stdout), _O_BINARY);
+#endif
+        file_ = stdout;
+        coutBuffer_ = std::cout.rdbuf(std::cerr.rdbuf());
+    } else {
+        file_ = std::fopen(path_.c_str(), "wb");
+        if (file_ == nullptr) {
+            throw std::runtime_error("Cannot open capture stream \"" + path_ + "\"!");
+        }
+    }
+    std::setvbuf(file_, nullptr, _IOFBF, writeBufferSize);
+    writer_ = std::thread(&FrameStream::writerLoop, this);
+}
+
+FrameStream::~FrameStream() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    cv_.notify_all();
+    writer_.join();
+    if (file_ == stdout) {
+        std::fflush(stdout);
+        std::cout.rdbuf(coutBuffer_);
+    } else {
+        std::fclose(file_);
+    }
+}
+
+uint64_t FrameStream::beginFrame(int width, int height) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (width_ == 0) {
+        // The first frame defines the stream size, a Y4M stream cannot change it.
+        width_ = width;
+        height_ = height;
+    }
+    return nextSequence_++;
+}
+
+void FrameStream::skipFrame(uint64_t sequence) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stats_.droppedReadback++;
+        frames_.emplace(sequence, Frame{});
+    }
+    cv_.notify_all();
+}
+
+void FrameStream::submitFrame(uint64_t sequence, const std::vector<unsigned char>& image, int width, int height) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (queuedFrames_ >= maxQueuedFrames_ || writeError_) {
+            stats_.droppedQueue++;
+            frames_.emplace(sequence, Frame{});
+            cv_.notify_all();
+            return;
+        }
+        // Reserve the queue slot before converting, conversion runs in parallel for several frames.
+        queuedFrames_++;
+    }
+
+    const bool scaled = width != width_ || height != height_;
+    std::vector<unsigned char> data;
+    try {
+        const std::vector<unsigned char>* source = &image;
+        std::vector<unsigned char> scaledImage;
+        if (scaled) {
+            scaledImage = buffers_.acquire(static_cast<std::size_t>(width_) * height_ * pixelSize);
+            scale(image, width, height, scaledImage);
+            source = &scaledImage;
+        }
+        data = buffers_.acquire(frameSize());
+        if (format_ == Format::Raw) {
+            convertRaw(*source, data);
+        } else {
+            convertY4m(*source, data);
+        }
+        if (scaled) {
+            buffers_.release(std::move(scaledImage));
+        }
+    } catch (...) {
+        // The writer waits for every sequence number, it must be resolved in any case.
+        std::lock_guard<std::mutex> lock(mutex_);
+        queuedFrames_--;
+        stats_.droppedQueue++;
+        frames_.emplace(sequence, Frame{});
+        cv_.notify_all();
+        throw;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stats_.scaled += scaled ? 1 : 0;
+        frames_.emplace(sequence, Frame{std::move(data)});
+    }
+    cv_.notify_all();
+}
+
+FrameStream::Stats FrameStream::getStats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+}
+
+FrameStream::Format FrameStream::parseFormat(const std::string& name) {
+    if (name == "raw") {
+        return Format::Raw;
+    }
+    if (name == "y4m") {
+        return Format::Y4m;
+    }
+    throw std::runtime_error("Unknown capture format \"" + name + "\"!");
+}
+
+void FrameStream::writerLoop() {
+    bool headerWritten = false;
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        // Frames are written in sequence order, conversions may finish out of order.
+        cv_.wait(lock, [this]() { return stop_ || frames_.count(nextWrite_) > 0; });
+        auto it = frames_.find(nextWrite_);
+        if (it == frames_.end()) {
+            // Stopped and no more frames, all frames begun are resolved before the destructor runs.
+            break;
+        }
+        Frame frame = std::move(it->second);
+        frames_.erase(it);
+        nextWrite_++;
+        if (frame.data.empty()) {
+            continue;
+        }
+
+        lock.unlock();
+        if (!headerWritten) {
+            writeHeader();
+            headerWritten = true;
+        }
+        const bool ok = std::fwrite(frame.data.data(), 1, frame.data.size(), file_) == frame.data.size();
+        buffers_.release(std::move(frame.data));
+        lock.lock();
+
+        queuedFrames_--;
+        if (ok) {
+            stats_.written++;
+        } else if (!writeError_) {
+            // E.g. the reader closed the pipe. Later frames are dropped instead of written.
+            writeError_ = true;
+            std::cerr << "Cannot write capture stream \"" << path_ << "\", recording stopped!" << std::endl;
+        }
+    }
+    std::fflush(file_);
+}
+
+void FrameStream::writeHeader() {
+    if (format_ == Format::Y4m) {
+        std::fprintf(file_, "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C420jpeg\n", width_, height_, fps_);
+    }
+    std::cerr << "Capture stream: " << width_ << "x" << height_ << " "
+              << (format_ == Format::Y4m ? "y4m" : "rgba") << " at " << fps_ << " fps";
+    if (format_ == Format::Raw) {
+        std::cerr << ", e.g. ffmpeg -f rawvideo -pixel_format rgba -video_size " << width_ << "x" << height_
+                  << " -framerate " << fps_ << " -i <stream>";
+    }
+    std::cerr << std::endl;
+}
+
+void FrameStream::scale(const std::vector<unsigned char>& image, int width, int height,
+    std::vector<unsigned char>& out) const {
+    // Sampled at the pixel centers. Both images are in OpenGL row order, the rows map the same way.
+    for (int y = 0; y < height_; y++) {
+        const auto srcY = static_cast<std::size_t>((2 * static_cast<int64_t>(y) + 1) * height / (2 * height_));
+        const unsigned char* src = image.data() + srcY * width * pixelSize;
+        unsigned char* dst = out.data() + static_cast<std::size_t>(y) * width_ * pixelSize;
+        for (int x = 0; x < width_; x++) {
+            const auto srcX = static_cast<std::size_t>((2 * static_cast<int64_t>(x) + 1) * width / (2 * width_));
+            std::memcpy(dst + x * pixelSize, src + srcX * pixelSize, pixelSize);
+        }
+    }
+}
+
+void FrameStream::convertRaw(const std::vector<unsigned char>& image, std::vector<unsigned char>& out) const {
+    // Top row first.
+    const std::size_t rowSize = static_cast<std::size_t>(width_) * pixelSize;
+    for (int y = 0; y < height_; y++) {
+        std::memcpy(out.data() + y * rowSize, image.data() + (height_ - 1 - y) * rowSize, rowSize);
+    }
+}
+
+void FrameStream::convertY4m(const std::vector<unsigned char>& image, std::vector<unsigned char>& out) const {
+    const int chromaWidth = (width_ + 1) / 2;
+    const int chromaHeight = (height_ + 1) / 2;
+    const std::size_t rowSize = static_cast<std::size_t>(width_) * pixelSize;
+    unsigned char* yPlane = out.data() + y4mFrameHeaderSize;
+    unsigned char* uPlane = yPlane + static_cast<std::size_t>(width_) * height_;
+    unsigned char* vPlane = uPlane + static_cast<std::size_t>(chromaWidth) * chromaHeight;
+    std::memcpy(out.data(), y4mFrameHeader, y4mFrameHeaderSize);
+
+    for (int y = 0; y < height_; y++) {
+        const unsigned char* src = image.data() + (height_ - 1 - y) * rowSize;
+        unsigned char* dst = yPlane + static_cast<std::size_t>(y) * width_;
+        for (int x = 0; x < width_; x++) {
+            dst[x] = rgbToY(src[x * 4], src[x * 4 + 1], src[x * 4 + 2]);
+        }
+    }
+    // Chroma of the average color of each 2x2 block, odd edges use the existing pixels only.
+    for (int cy = 0; cy < chromaHeight; cy++) {
+        const int y0 = 2 * cy;
+        const int y1 = std::min(y0 + 1, height_ - 1);
+        const unsigned char* row0 = image.data() + (height_ - 1 - y0) * rowSize;
+        const unsigned char* row1 = image.data() + (height_ - 1 - y1) * rowSize;
+        for (int cx = 0; cx < chromaWidth; cx++) {
+            const int x0 = 2 * cx * 4;
+            const int x1 = std::min(2 * cx + 1, width_ - 1) * 4;
+            const int r = (row0[x0] + row0[x1] + row1[x0] + row1[x1] + 2) >> 2;
+            const int g = (row0[x0 + 1] + row0[x1 + 1] + row1[x0 + 1] + row1[x1 + 1] + 2) >> 2;
+            const int b = (row0[x0 + 2] + row0[x1 + 2] + row1[x0 + 2] + row1[x1 + 2] + 2) >> 2;
+            const std::size_t idx = static_cast<std::size_t>(cy) * chromaWidth + cx;
+            uPlane[idx] = rgbToU(r, g, b);
+            vPlane[idx] = rgbToV(r, g, b);
+        }
+    }
+}
+
+std::size_t FrameStream::frameSize() const {
+    const auto pixels = static_cast<std::size_t>(width_) * height_;
+    if (format_ == Format::Raw) {
+        return pixels * pixelSize;
+    }
+    const auto chroma = static_cast<std::size_t>((width_ + 1) / 2) * ((height_ + 1) / 2);
+    return y4mFrameHeaderSize + pixels + 2 * chroma;
+}
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <iosfwd>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "BufferPool.h"
+
+namespace OGL4Core2::Core {
+    /**
+     * Continuous recording of frames into a file or pipe, e.g. to feed ffmpeg. Frames are written as raw RGBA (top
+     * row first) or as Y4M video (YUV 4:2:0, BT.601 limited range). The render thread reserves a sequence number per
+     * frame, the pixels are converted by readback consumers on worker threads and written in order by a dedicated
+     * writer thread, so a slow reader never blocks the render loop. The queue between conversion and writer is
+     * bounded, frames which do not fit are dropped and counted. The first frame defines the size of the stream, later
+     * frames of a different size, e.g. after a window resize, are scaled to it.
+     */
+    class FrameStream {
+    public:
+        enum class Format { Raw, Y4m };
+
+        struct Stats {
+            uint64_t written = 0;
+            uint64_t droppedReadback = 0; //!< all readback buffers were in flight
+            uint64_t droppedQueue = 0;    //!< the writer could not keep up
+            uint64_t scaled = 0;          //!< frame size differed from the stream size
+        };
+
+        /**
+         * Opens the output, "-" writes to stdout. std::cout is redirected to std::cerr meanwhile, so log output does
+         * not mix with frame data. Opening a named pipe blocks until the reader has opened it.
+         */
+        FrameStream(const std::string& path, Format format, int fps, std::size_t maxQueuedFrames);
+
+        /**
+         * Writes all queued frames. All frames begun must be submitted or skipped before.
+         */
+        ~FrameStream();
+
+        FrameStream(const FrameStream&) = delete;
+        FrameStream(FrameStream&&) = delete;
+        FrameStream& operator=(const FrameStream&) = delete;
+        FrameStream& operator=(FrameStream&&) = delete;
+
+        /**
+         * Render thread: reserve the next frame and return its sequence number. The first frame defines the stream
+         * size.
+         */
+        [[nodiscard]] uint64_t beginFrame(int width, int height);
+
+        /**
+         * Render thread: the reserved frame could not be captured, all readback buffers were in flight.
+         */
+        void skipFrame(uint64_t sequence);
+
+        /**
+         * Any thread: convert and queue the pixels of a reserved frame, in OpenGL row order (bottom row first).
+         * Frames of a different size than the stream are scaled to it, nearest neighbor.
+         */
+        void submitFrame(uint64_t sequence, const std::vector<unsigned char>& image, int width, int height);
+
+        [[nodiscard]] Stats getStats() const;
+
+        [[nodiscard]] static Format parseFormat(const std::string& name);
+
+    private:
+        struct Frame {
+            std::vector<unsigned char> data; //!< empty for dropped frames
+        };
+
+        void writerLoop();
+        void writeHeader();
+        void scale(const std::vector<unsigned char>& image, int width, int height,
+            std::vector<unsigned char>& out) const;
+        void convertRaw(const std::vector<unsigned char>& image, std::vector<unsigned char>& out) const;
+        void convertY4m(const std::vector<unsigned char>& image, std::vector<unsigned char>& out) const;
+        [[nodiscard]] std::size_t frameSize() const;
+
+        std::string path_;
+        Format format_;
+        int fps_;
+        std::size_t maxQueuedFrames_;
+        std::FILE* file_;
+        std::streambuf* coutBuffer_;
+
+        int width_;
+        int height_;
+        uint64_t nextSequence_;
+        uint64_t nextWrite_;
+        std::size_t queuedFrames_;
+        std::map<uint64_t, Frame> frames_;
+        Stats stats_;
+        bool stop_;
+        bool writeError_;
+        mutable std::mutex mutex_;
+        std::condition_variable cv_;
+        BufferPool buffers_;
+        std::thread writer_;
+    };
+} // namespace OGL4Core2::Core
@@ -53,5 +53,14 @@ namespace OGL4Core2::Core {
                    glfwGetKey(window, GLFW_KEY_LEFT_SUPER) == GLFW_PRESS ||
                    glfwGetKey(window, GLFW_KEY_RIGHT_SUPER) == GLFW_PRESS;
         }
+
+        static bool anyMouseButtonPressed(GLFWwindow* window) {
+            for (int button = GLFW_MOUSE_BUTTON_1; button <= GLFW_MOUSE_BUTTON_LAST; button++) {
+                if (glfwGetMouseButton(window, button) == GLFW_PRESS) {
+                    return true;
+                }
+            }
+            return false;
+        }
     };
 } // namespace OGL4Core2::Core
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+namespace OGL4Core2::Core {
+    /**
+     * 64 bit FNV-1a hash. Unlike std::hash the value is stable across runs and platforms, so it can be used for data
+     * stored on disk.
+     */
+    class Fnv1aHash {
+    public:
+        inline void add(const void* data, std::size_t size) {
+            const auto* bytes = static_cast<const unsigned char*>(data);
+            for (std::size_t i = 0; i < size; i++) {
+                hash_ = (hash_ ^ bytes[i]) * 0x100000001b3ull;
+            }
+        }
+
+        /**
+         * Add a string prefixed by its length, so that concatenated strings cannot collide.
+         */
+        inline void addString(std::string_view str) {
+            const uint64_t size = str.size();
+            add(&size, sizeof(size));
+            add(str.data(), str.size());
+        }
+
+        [[nodiscard]] inline uint64_t value() const {
+            return hash_;
+        }
+
+        [[nodiscard]] static inline uint64_t hash(std::string_view str) {
+            Fnv1aHash h;
+            h.add(str.data(), str.size());
+            return h.value();
+        }
+
+    private:
+        uint64_t hash_ = 0xcbf29ce484222325ull;
+    };
+} // namespace OGL4Core2::Core
@@ -1,30 +1,179 @@
 #include "ImageUtil.h"
 
 #include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
 #include <stdexcept>
 #include <string>
 
 #include <lodepng.h>
 
+#include "ThreadPool.h"
+
 using namespace OGL4Core2::Core;
 
 namespace {
-    void flipImage(std::vector<unsigned char>& img, int width, int height, int pixelSize) {
-        if (static_cast<int>(img.size()) != width * height * pixelSize) {
-            throw std::runtime_error("Invalid image size!");
+    constexpr std::size_t pixelSize = 4;
+
+    // QOI format, see https://qoiformat.org/qoi-specification.pdf
+    constexpr unsigned char qoiOpIndex = 0x00;
+    constexpr unsigned char qoiOpDiff = 0x40;
+    constexpr unsigned char qoiOpLuma = 0x80;
+    constexpr unsigned char qoiOpRun = 0xc0;
+    constexpr unsigned char qoiOpRgb = 0xfe;
+    constexpr unsigned char qoiOpRgba = 0xff;
+    constexpr unsigned char qoiMask = 0xc0;
+    constexpr std::size_t qoiHeaderSize = 14;
+    constexpr std::array<unsigned char, 8> qoiEnd{0, 0, 0, 0, 0, 0, 0, 1};
+    // Limit of the format, rejects corrupt headers before allocating.
+    constexpr uint64_t qoiMaxPixels = 400000000;
+    // Rows per strip of the parallel encoder. Each strip starts with an empty index, which costs a few bytes only.
+    constexpr int qoiStripRows = 64;
+
+    struct QoiPixel {
+        unsigned char r = 0;
+        unsigned char g = 0;
+        unsigned char b = 0;
+        unsigned char a = 255;
+
+        [[nodiscard]] inline bool operator==(const QoiPixel& other) const {
+            return r == other.r && g == other.g && b == other.b && a == other.a;
+        }
+        [[nodiscard]] inline bool operator!=(const QoiPixel& other) const {
+            return !(*this == other);
+        }
+    };
+
+    inline std::size_t qoiHash(const QoiPixel& p) {
+        return (p.r * 3u + p.g * 5u + p.b * 7u + p.a * 11u) % 64u;
+    }
+
+    inline QoiPixel readPixel(const unsigned char* p) {
+        return {p[0], p[1], p[2], p[3]};
+    }
+
+    void writeBigEndian(unsigned char* out, uint32_t value) {
+        out[0] = static_cast<unsigned char>(value >> 24);
+        out[1] = static_cast<unsigned char>(value >> 16);
+        out[2] = static_cast<unsigned char>(value >> 8);
+        out[3] = static_cast<unsigned char>(value);
+    }
+
+    uint32_t readBigEndian(const unsigned char* in) {
+        return (static_cast<uint32_t>(in[0]) << 24) | (static_cast<uint32_t>(in[1]) << 16) |
+               (static_cast<uint32_t>(in[2]) << 8) | static_cast<uint32_t>(in[3]);
+    }
+
+    /**
+     * Encode the file rows [rowBegin, rowEnd) of a bottom-up image. The decoder state at the strip start is the
+     * previous pixel, which is known from the image, and an index filled by all previous pixels. Index entries are
+     * only used after this strip has written them itself, so strips can be encoded independently and concatenated.
+     */
+    void encodeQoiStrip(const unsigned char* image, int width, int height, int rowBegin, int rowEnd,
+        std::vector<unsigned char>& out) {
+        const std::size_t rowSize = static_cast<std::size_t>(width) * pixelSize;
+        std::array<QoiPixel, 64> index{};
+        std::array<bool, 64> known{};
+        QoiPixel prev;
+        if (rowBegin == 0) {
+            // Same state as the decoder at the file start.
+            index.fill(QoiPixel{0, 0, 0, 0});
+            known.fill(true);
+        } else {
+            prev = readPixel(image + (height - rowBegin) * rowSize + rowSize - pixelSize);
+        }
+
+        out.clear();
+        out.reserve(static_cast<std::size_t>(rowEnd - rowBegin) * rowSize / 2);
+        int run = 0;
+        for (int row = rowBegin; row < rowEnd; row++) {
+            const unsigned char* src = image + (height - 1 - row) * rowSize;
+            for (int x = 0; x < width; x++, src += pixelSize) {
+                const QoiPixel px = readPixel(src);
+                if (px == prev) {
+                    run++;
+                    if (run == 62) {
+                        out.push_back(static_cast<unsigned char>(qoiOpRun | (run - 1)));
+                        run = 0;
+                    }
+                    continue;
+                }
+                if (run > 0) {
+                    out.push_back(static_cast<unsigned char>(qoiOpRun | (run - 1)));
+                    run = 0;
+                }
+                const std::size_t hash = qoiHash(px);
+                if (known[hash] && index[hash] == px) {
+                    out.push_back(static_cast<unsigned char>(qoiOpIndex | hash));
+                } else {
+                    index[hash] = px;
+                    known[hash] = true;
+                    if (px.a == prev.a) {
+                        const int vr = static_cast<int8_t>(px.r - prev.r);
+                        const int vg = static_cast<int8_t>(px.g - prev.g);
+                        const int vb = static_cast<int8_t>(px.b - prev.b);
+                        const int vgr = vr - vg;
+                        const int vgb = vb - vg;
+                        if (vr > -3 && vr < 2 && vg > -3 && vg < 2 && vb > -3 && vb < 2) {
+                            out.push_back(static_cast<unsigned char>(qoiOpDiff | (vr + 2) << 4 | (vg + 2) << 2 |
+                                                                     (vb + 2)));
+                        } else if (vgr > -9 && vgr < 8 && vg > -33 && vg < 32 && vgb > -9 && vgb < 8) {
+                            out.push_back(static_cast<unsigned char>(qoiOpLuma | (vg + 32)));
+                            out.push_back(static_cast<unsigned char>((vgr + 8) << 4 | (vgb + 8)));
+                        } else {
+                            out.insert(out.end(), {qoiOpRgb, px.r, px.g, px.b});
+                        }
+                    } else {
+                        out.insert(out.end(), {qoiOpRgba, px.r, px.g, px.b, px.a});
+                    }
+                }
+                prev = px;
+            }
         }
-        int rowSize = width * pixelSize;
-        for (int i = 0; i < height / 2; i++) {
-            std::swap_ranges(img.begin() + i * rowSize, img.begin() + (i + 1) * rowSize,
-                img.begin() + (height - i - 1) * rowSize);
+        if (run > 0) {
+            out.push_back(static_cast<unsigned char>(qoiOpRun | (run - 1)));
         }
     }
+
+    std::vector<unsigned char> readFile(const std::filesystem::path& filename) {
+        std::ifstream file(filename, std::ios::binary | std::ios::ate);
+        if (!file.is_open()) {
+            throw std::runtime_error("Cannot open file \"" + filename.string() + "\"!");
+        }
+        const auto size = static_cast<std::size_t>(file.tellg());
+        std::vector<unsigned char> data(size);
+        file.seekg(0);
+        file.read(reinterpret_cast<char*>(data.data()), static_cast<std::streamsize>(size));
+        if (!file) {
+            throw std::runtime_error("Cannot read file \"" + filename.string() + "\"!");
+        }
+        return data;
+    }
 } // namespace
 
 std::vector<unsigned char> ImageUtil::loadPngImage(const std::filesystem::path& filename, int& width, int& height) {
+    std::vector<unsigned char> png;
+    unsigned int error = lodepng::load_file(png, filename.string());
+    if (error != 0) {
+        std::string errorText = lodepng_error_text(error);
+        throw std::runtime_error("Cannot load PNG image: " + errorText);
+    }
+    return loadPngImage(png.data(), png.size(), width, height);
+}
+
+std::vector<unsigned char> ImageUtil::loadPngImage(const unsigned char* png, std::size_t size, int& width,
+    int& height) {
+    // Checksums of local resources are not worth the time. Corruption may go undetected, e.g. damaged pixel data that
+    // still inflates to the expected size.
+    lodepng::State state;
+    state.decoder.ignore_crc = 1;
+    state.decoder.zlibsettings.ignore_adler32 = 1;
+
     std::vector<unsigned char> image;
     unsigned int w, h;
-    unsigned int error = lodepng::decode(image, w, h, filename.string());
+    unsigned int error = lodepng::decode(image, w, h, state, png, size);
     if (error != 0) {
         std::string errorText = lodepng_error_text(error);
         throw std::runtime_error("Cannot load PNG image: " + errorText);
@@ -32,21 +181,182 @@ std::vector<unsigned char> ImageUtil::loadPngImage(const std::filesystem::path&
     width = static_cast<int>(w);
     height = static_cast<int>(h);
 
-    flipImage(image, width, height, 4);
+    flipImage(image, width, height);
 
     return image;
 }
 
 void ImageUtil::savePngImage(const std::filesystem::path& filename, std::vector<unsigned char>&& image, int width,
-    int height) {
-    flipImage(image, width, height, 4);
+    int height, PngCompression compression) {
+    flipImage(image, width, height);
+
+    lodepng::State state;
+    if (compression != PngCompression::Default) {
+        // Skip the color analysis over the whole image, which picks a smaller color type if possible.
+        state.encoder.auto_convert = 0;
+        state.info_png.color.colortype = LCT_RGBA;
+        state.info_png.color.bitdepth = 8;
+    }
+    if (compression == PngCompression::Fast) {
+        // Paeth on every row instead of trying all five filters per row, and greedy matching in a small window.
+        state.encoder.filter_strategy = LFS_FOUR;
+        state.encoder.zlibsettings.windowsize = 1024;
+        state.encoder.zlibsettings.nicematch = 32;
+        state.encoder.zlibsettings.lazymatching = 0;
+    } else if (compression == PngCompression::None) {
+        state.encoder.filter_strategy = LFS_ZERO;
+        state.encoder.zlibsettings.btype = 0;
+    }
 
     std::vector<unsigned char> png;
-    auto error = lodepng::encode(png, image, static_cast<unsigned int>(width), static_cast<unsigned int>(height));
+    auto error = lodepng::encode(png, image.data(), static_cast<unsigned int>(width),
+        static_cast<unsigned int>(height), state);
     if (error == 0) {
-        lodepng::save_file(png, filename.string());
-    } else {
+        error = lodepng::save_file(png, filename.string());
+    }
+    if (error != 0) {
         std::string errorText = lodepng_error_text(error);
         throw std::runtime_error("Cannot write PNG image: " + errorText);
     }
 }
+
+std::vector<unsigned char> ImageUtil::loadQoiImage(const std::filesystem::path& filename, int& width, int& height) {
+    const auto qoi = readFile(filename);
+    return loadQoiImage(qoi.data(), qoi.size(), width, height);
+}
+
+std::vector<unsigned char> ImageUtil::loadQoiImage(const unsigned char* qoi, std::size_t size, int& width,
+    int& height) {
+    if (size < qoiHeaderSize + qoiEnd.size() || std::memcmp(qoi, "qoif", 4) != 0) {
+        throw std::runtime_error("Cannot load QOI image: invalid header!");
+    }
+    const uint32_t w = readBigEndian(qoi + 4);
+    const uint32_t h = readBigEndian(qoi + 8);
+    const unsigned char channels = qoi[12];
+    if (w == 0 || h == 0 || static_cast<uint64_t>(w) * h > qoiMaxPixels || (channels != 3 && channels != 4)) {
+        throw std::runtime_error("Cannot load QOI image: invalid header!");
+    }
+
+    // Pixels are always decoded to RGBA, rows are written bottom-up.
+    const std::size_t rowSize = static_cast<std::size_t>(w) * pixelSize;
+    std::vector<unsigned char> image(rowSize * h);
+    std::array<QoiPixel, 64> index{};
+    index.fill(QoiPixel{0, 0, 0, 0});
+    QoiPixel px;
+    std::size_t pos = qoiHeaderSize;
+    const std::size_t end = size - qoiEnd.size();
+    int run = 0;
+    for (uint32_t y = 0; y < h; y++) {
+        unsigned char* dst = image.data() + (h - 1 - y) * rowSize;
+        for (uint32_t x = 0; x < w; x++, dst += pixelSize) {
+            if (run > 0) {
+                run--;
+            } else if (pos < end) {
+                const unsigned char b1 = qoi[pos++];
+                if (b1 == qoiOpRgb) {
+                    if (pos + 3 > end) {
+                        throw std::runtime_error("Cannot load QOI image: unexpected end of data!");
+                    }
+                    px.r = qoi[pos];
+                    px.g = qoi[pos + 1];
+                    px.b = qoi[pos + 2];
+                    pos += 3;
+                } else if (b1 == qoiOpRgba) {
+                    if (pos + 4 > end) {
+                        throw std::runtime_error("Cannot load QOI image: unexpected end of data!");
+                    }
+                    px = readPixel(qoi + pos);
+                    pos += 4;
+                } else if ((b1 & qoiMask) == qoiOpIndex) {
+                    px = index[b1];
+                } else if ((b1 & qoiMask) == qoiOpDiff) {
+                    px.r = static_cast<unsigned char>(px.r + ((b1 >> 4) & 0x03) - 2);
+                    px.g = static_cast<unsigned char>(px.g + ((b1 >> 2) & 0x03) - 2);
+                    px.b = static_cast<unsigned char>(px.b + (b1 & 0x03) - 2);
+                } else if ((b1 & qoiMask) == qoiOpLuma) {
+                    if (pos + 1 > end) {
+                        throw std::runtime_error("Cannot load QOI image: unexpected end of data!");
+                    }
+                    const unsigned char b2 = qoi[pos++];
+                    const int vg = (b1 & 0x3f) - 32;
+                    px.r = static_cast<unsigned char>(px.r + vg - 8 + ((b2 >> 4) & 0x0f));
+                    px.g = static_cast<unsigned char>(px.g + vg);
+                    px.b = static_cast<unsigned char>(px.b + vg - 8 + (b2 & 0x0f));
+                } else {
+                    run = b1 & 0x3f;
+                }
+                index[qoiHash(px)] = px;
+            } else {
+                throw std::runtime_error("Cannot load QOI image: unexpected end of data!");
+            }
+            dst[0] = px.r;
+            dst[1] = px.g;
+            dst[2] = px.b;
+            dst[3] = px.a;
+        }
+    }
+
+    width = static_cast<int>(w);
+    height = static_cast<int>(h);
+    return image;
+}
+
+void ImageUtil::saveQoiImage(const std::filesystem::path& filename, const std::vector<unsigned char>& image,
+    int width, int height, ThreadPool* pool) {
+    if (width <= 0 || height <= 0 || image.size() != static_cast<std::size_t>(width) * height * pixelSize) {
+        throw std::runtime_error("Invalid image size!");
+    }
+
+    const std::size_t numStrips = (static_cast<std::size_t>(height) + qoiStripRows - 1) / qoiStripRows;
+    std::vector<std::vector<unsigned char>> strips(numStrips);
+    const auto encodeStrips = [&](std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; i++) {
+            const int rowBegin = static_cast<int>(i) * qoiStripRows;
+            const int rowEnd = std::min(rowBegin + qoiStripRows, height);
+            encodeQoiStrip(image.data(), width, height, rowBegin, rowEnd, strips[i]);
+        }
+    };
+    if (pool != nullptr) {
+        pool->parallelFor(0, numStrips, encodeStrips, 1);
+    } else {
+        encodeStrips(0, numStrips);
+    }
+
+    std::array<unsigned char, qoiHeaderSize> header{'q', 'o', 'i', 'f'};
+    writeBigEndian(header.data() + 4, static_cast<uint32_t>(width));
+    writeBigEndian(header.data() + 8, static_cast<uint32_t>(height));
+    header[12] = 4; // RGBA
+    header[13] = 0; // sRGB with linear alpha
+
+    std::ofstream file(filename, std::ios::binary);
+    if (!file.is_open()) {
+        throw std::runtime_error("Cannot write QOI image \"" + filename.string() + "\"!");
+    }
+    file.write(reinterpret_cast<const char*>(header.data()), header.size());
+    for (const auto& strip : strips) {
+        file.write(reinterpret_cast<const char*>(strip.data()), static_cast<std::streamsize>(strip.size()));
+    }
+    file.write(reinterpret_cast<const char*>(qoiEnd.data()), qoiEnd.size());
+    if (!file) {
+        throw std::runtime_error("Cannot write QOI image \"" + filename.string() + "\"!");
+    }
+}
+
+void ImageUtil::flipImage(std::vector<unsigned char>& image, int width, int height) {
+    if (width < 0 || height < 0 || image.size() != static_cast<std::size_t>(width) * height * pixelSize) {
+        throw std::runtime_error("Invalid image size!");
+    }
+    if (height < 2 || width == 0) {
+        return;
+    }
+    // Whole rows are swapped through a row buffer with memcpy, which is vectorized, unlike a byte-wise swap.
+    const std::size_t rowSize = static_cast<std::size_t>(width) * pixelSize;
+    std::vector<unsigned char> row(rowSize);
+    unsigned char* top = image.data();
+    unsigned char* bottom = image.data() + (static_cast<std::size_t>(height) - 1) * rowSize;
+    for (int i = 0; i < height / 2; i++, top += rowSize, bottom -= rowSize) {
+        std::memcpy(row.data(), top, rowSize);
+        std::memcpy(top, bottom, rowSize);
+        std::memcpy(bottom, row.data(), rowSize);
+    }
+}
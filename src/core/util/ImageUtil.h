@@ -1,14 +1,51 @@
 #pragma once
 
+#include <cstddef>
 #include <filesystem>
 #include <vector>
 
 namespace OGL4Core2::Core {
+    class ThreadPool;
+
+    /**
+     * Image loading and saving. Images are RGBA8 in OpenGL row order (bottom row first), the conversion to the top
+     * down order of the files is done here.
+     */
     class ImageUtil {
     public:
+        enum class PngCompression {
+            Default, //!< best compression of lodepng, slow
+            Fast,    //!< single filter, greedy matching, fixed RGBA output, larger files
+            None,    //!< stored deflate blocks, fastest but as large as the raw image
+        };
+
         static std::vector<unsigned char> loadPngImage(const std::filesystem::path& filename, int& width, int& height);
 
+        static std::vector<unsigned char> loadPngImage(const unsigned char* png, std::size_t size, int& width,
+            int& height);
+
         static void savePngImage(const std::filesystem::path& filename, std::vector<unsigned char>&& image, int width,
-            int height);
+            int height, PngCompression compression = PngCompression::Default);
+
+        /**
+         * QOI ("Quite OK Image") files, a simple lossless format, encoding and decoding are an order of magnitude
+         * faster than PNG at a similar size for rendered images. Meant for intermediate captures.
+         */
+        static std::vector<unsigned char> loadQoiImage(const std::filesystem::path& filename, int& width, int& height);
+
+        static std::vector<unsigned char> loadQoiImage(const unsigned char* qoi, std::size_t size, int& width,
+            int& height);
+
+        /**
+         * The image is encoded in row strips, in parallel if a thread pool is given. The result is a regular QOI
+         * file. The image is not modified.
+         */
+        static void saveQoiImage(const std::filesystem::path& filename, const std::vector<unsigned char>& image,
+            int width, int height, ThreadPool* pool = nullptr);
+
+        /**
+         * Flip the rows of an RGBA8 image in place.
+         */
+        static void flipImage(std::vector<unsigned char>& image, int width, int height);
     };
 } // namespace OGL4Core2::Core
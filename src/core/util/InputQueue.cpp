@@ -0,0 +1,28 @@
+#include "InputQueue.h"
+
+#include <utility>
+
+using namespace OGL4Core2::Core;
+
+void InputQueue::push(const InputEvent& event) {
+    events_.push_back(event);
+}
+
+void InputQueue::pushMouseMove(double time, double x, double y, bool coalesce) {
+    if (coalesce && !events_.empty() && events_.back().type == InputEvent::Type::MouseMove) {
+        auto& last = events_.back();
+        last.time = time;
+        last.x = x;
+        last.y = y;
+        return;
+    }
+    InputEvent event{InputEvent::Type::MouseMove, time};
+    event.x = x;
+    event.y = y;
+    events_.push_back(event);
+}
+
+void InputQueue::take(std::vector<InputEvent>& events) {
+    events.clear();
+    std::swap(events, events_);
+}
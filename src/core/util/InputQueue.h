@@ -0,0 +1,60 @@
+#pragma once
+
+#include <vector>
+
+namespace OGL4Core2::Core {
+    /**
+     * Timestamped raw GLFW input event. Fields not used by the event type are zero.
+     */
+    struct InputEvent {
+        enum class Type {
+            Key,
+            Char,
+            MouseButton,
+            MouseMove,
+            MouseScroll,
+        };
+
+        Type type;
+        double time;            //!< glfwGetTime() when the event was received, of the last move if coalesced
+        int code = 0;           //!< key or mouse button
+        int scancode = 0;       //!< key scancode
+        int action = 0;         //!< key or mouse button action
+        int mods = 0;           //!< key or mouse button modifiers
+        unsigned int codepoint = 0;
+        double x = 0.0;         //!< cursor position in window coordinates or scroll offset
+        double y = 0.0;
+    };
+
+    /**
+     * Collects the input events received while polling GLFW, so the core can dispatch them once per frame, in order.
+     * Consecutive mouse moves are coalesced into one event with the last cursor position, so a plugin computing the
+     * delta to the previous position gets the accumulated delta of all moves instead of many small ones. Any other
+     * event in between ends the coalescing, e.g. a drag stays split at a button press.
+     */
+    class InputQueue {
+    public:
+        InputQueue() = default;
+
+        InputQueue(const InputQueue&) = delete;
+        InputQueue(InputQueue&&) = delete;
+        InputQueue& operator=(const InputQueue&) = delete;
+        InputQueue& operator=(InputQueue&&) = delete;
+
+        void push(const InputEvent& event);
+
+        /**
+         * Mouse moves are queued separately if coalescing is disabled.
+         */
+        void pushMouseMove(double time, double x, double y, bool coalesce);
+
+        /**
+         * Move all queued events into events, replacing its content. The buffers are swapped, so no allocation happens
+         * once both have grown to the usual number of events per frame.
+         */
+        void take(std::vector<InputEvent>& events);
+
+    private:
+        std::vector<InputEvent> events_;
+    };
+} // namespace OGL4Core2::Core
@@ -0,0 +1,29 @@
+#include "Log.h"
+
+#include <atomic>
+#include <iostream>
+#include <mutex>
+
+using namespace OGL4Core2::Core;
+
+namespace {
+    std::atomic<bool> verboseOutput{false};
+    // Messages may come from worker threads, e.g. while a plugin is loaded.
+    std::mutex outputMutex;
+} // namespace
+
+void Log::setVerbose(bool verbose) {
+    verboseOutput.store(verbose, std::memory_order_relaxed);
+}
+
+bool Log::isVerbose() {
+    return verboseOutput.load(std::memory_order_relaxed);
+}
+
+void Log::info(const std::string& message) {
+    if (!isVerbose()) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(outputMutex);
+    std::cout << message << std::endl;
+}
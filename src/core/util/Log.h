@@ -0,0 +1,18 @@
+#pragma once
+
+#include <string>
+
+namespace OGL4Core2::Core {
+    /**
+     * Informational messages, e.g. reloads and load timings. They are printed to stdout only in verbose mode
+     * (--verbose), warnings and errors are always written to std::cerr directly.
+     */
+    class Log {
+    public:
+        static void setVerbose(bool verbose);
+
+        [[nodiscard]] static bool isVerbose();
+
+        static void info(const std::string& message);
+    };
+} // namespace OGL4Core2::Core
@@ -0,0 +1,117 @@
+#include "MappedFile.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN 1
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX 1
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace OGL4Core2::Core;
+
+#ifdef _WIN32
+
+MappedFile::MappedFile(const std::filesystem::path& filename)
+    : data_(nullptr),
+      size_(0),
+      file_(INVALID_HANDLE_VALUE),
+      mapping_(nullptr) {
+    file_ = CreateFileW(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file_ == INVALID_HANDLE_VALUE) {
+        throw std::runtime_error("Cannot open file \"" + filename.string() + "\"!");
+    }
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file_, &size)) {
+        CloseHandle(file_);
+        throw std::runtime_error("Cannot read size of file \"" + filename.string() + "\"!");
+    }
+    size_ = static_cast<std::size_t>(size.QuadPart);
+    if (size_ == 0) {
+        // Empty files cannot be mapped.
+        return;
+    }
+    mapping_ = CreateFileMappingW(file_, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mapping_ == nullptr) {
+        CloseHandle(file_);
+        throw std::runtime_error("Cannot map file \"" + filename.string() + "\"!");
+    }
+    data_ = static_cast<const unsigned char*>(MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0));
+    if (data_ == nullptr) {
+        CloseHandle(mapping_);
+        CloseHandle(file_);
+        throw std::runtime_error("Cannot map file \"" + filename.string() + "\"!");
+    }
+}
+
+MappedFile::~MappedFile() {
+    if (data_ != nullptr) {
+        UnmapViewOfFile(data_);
+    }
+    if (mapping_ != nullptr) {
+        CloseHandle(mapping_);
+    }
+    CloseHandle(file_);
+}
+
+void MappedFile::prefetch([[maybe_unused]] std::size_t offset, [[maybe_unused]] std::size_t size) const {
+    // PrefetchVirtualMemory() would require Windows 8, the pages are loaded on access.
+}
+
+#else
+
+MappedFile::MappedFile(const std::filesystem::path& filename) : data_(nullptr), size_(0) {
+    const int fd = open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        throw std::runtime_error("Cannot open file \"" + filename.string() + "\": " + std::strerror(errno) + "!");
+    }
+    struct stat st {};
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        throw std::runtime_error("Cannot read size of file \"" + filename.string() + "\"!");
+    }
+    size_ = static_cast<std::size_t>(st.st_size);
+    if (size_ > 0) {
+        void* ptr = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (ptr == MAP_FAILED) {
+            close(fd);
+            throw std::runtime_error("Cannot map file \"" + filename.string() + "\": " + std::strerror(errno) + "!");
+        }
+        data_ = static_cast<const unsigned char*>(ptr);
+    }
+    // The mapping stays valid after closing the descriptor.
+    close(fd);
+}
+
+MappedFile::~MappedFile() {
+    if (data_ != nullptr) {
+        munmap(const_cast<unsigned char*>(data_), size_);
+    }
+}
+
+void MappedFile::prefetch(std::size_t offset, std::size_t size) const {
+    if (data_ == nullptr || offset >= size_) {
+        return;
+    }
+    // madvise() requires a page aligned start.
+    const auto pageSize = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+    const std::size_t begin = offset / pageSize * pageSize;
+    const std::size_t end = std::min(size_, offset + size);
+    madvise(const_cast<unsigned char*>(data_) + begin, end - begin, MADV_WILLNEED);
+}
+
+#endif
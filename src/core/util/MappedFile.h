@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+
+namespace OGL4Core2::Core {
+    /**
+     * Read-only memory mapping of a whole file. Pages are loaded by the OS on first access, so opening is cheap even
+     * for large files and the data is shared with the page cache instead of being copied.
+     */
+    class MappedFile {
+    public:
+        explicit MappedFile(const std::filesystem::path& filename);
+        ~MappedFile();
+
+        MappedFile(const MappedFile&) = delete;
+        MappedFile(MappedFile&&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+        MappedFile& operator=(MappedFile&&) = delete;
+
+        [[nodiscard]] inline const unsigned char* data() const {
+            return data_;
+        }
+
+        [[nodiscard]] inline std::size_t size() const {
+            return size_;
+        }
+
+        /**
+         * Hint the OS to read the given range ahead of the first access. No-op where not supported.
+         */
+        void prefetch(std::size_t offset, std::size_t size) const;
+
+    private:
+        const unsigned char* data_;
+        std::size_t size_;
+#ifdef _WIN32
+        void* file_;
+        void* mapping_;
+#endif
+    };
+} // namespace OGL4Core2::Core
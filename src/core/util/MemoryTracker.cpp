@@ -0,0 +1,257 @@
+#include "MemoryTracker.h"
+
+#include <algorithm>
+#include <utility>
+
+#include <imgui.h>
+
+using namespace OGL4Core2::Core;
+
+std::mutex MemoryTracker::mutex_;
+std::unordered_map<uint64_t, MemoryTracker::Entry> MemoryTracker::entries_;
+uint64_t MemoryTracker::nextId_ = 1;
+std::string MemoryTracker::defaultOwner_ = "Core";
+
+namespace {
+    constexpr std::size_t numListedEntries = 20;
+
+    double toMiB(std::size_t bytes) {
+        return static_cast<double>(bytes) / (1024.0 * 1024.0);
+    }
+
+    std::size_t bytesPerTexel(GLenum internalFormat) {
+        switch (internalFormat) {
+            case GL_R8:
+            case GL_R8UI:
+            case GL_R8I:
+            case GL_STENCIL_INDEX8:
+                return 1;
+            case GL_R16:
+            case GL_R16F:
+            case GL_R16UI:
+            case GL_R16I:
+            case GL_RG8:
+            case GL_DEPTH_COMPONENT16:
+                return 2;
+            case GL_RGB8:
+            case GL_SRGB8:
+            case GL_DEPTH_COMPONENT24:
+                return 3;
+            case GL_RGBA8:
+            case GL_SRGB8_ALPHA8:
+            case GL_R32F:
+            case GL_R32UI:
+            case GL_R32I:
+            case GL_RG16:
+            case GL_RG16F:
+            case GL_RGB10_A2:
+            case GL_R11F_G11F_B10F:
+            case GL_DEPTH24_STENCIL8:
+            case GL_DEPTH_COMPONENT32F:
+                return 4;
+            case GL_RGB16F:
+                return 6;
+            case GL_RG32F:
+            case GL_RG32UI:
+            case GL_RGBA16:
+            case GL_RGBA16F:
+            case GL_DEPTH32F_STENCIL8:
+                return 8;
+            case GL_RGB32F:
+                return 12;
+            case GL_RGBA32F:
+            case GL_RGBA32UI:
+                return 16;
+            default:
+                return 4;
+        }
+    }
+} // namespace
+
+void MemoryTracker::setDefaultOwner(const std::string& owner) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    defaultOwner_ = owner;
+}
+
+MemoryTracker::Totals MemoryTracker::getTotals() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Totals totals;
+    for (const auto& [id, entry] : entries_) {
+        auto& sums = entry.location == MemoryLocation::Cpu ? totals.cpu : totals.gpu;
+        sums[static_cast<std::size_t>(entry.category)] += entry.bytes;
+    }
+    return totals;
+}
+
+MemoryTracker::Totals MemoryTracker::getTotals(const std::string& owner) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Totals totals;
+    for (const auto& [id, entry] : entries_) {
+        if (entry.owner == owner) {
+            auto& sums = entry.location == MemoryLocation::Cpu ? totals.cpu : totals.gpu;
+            sums[static_cast<std::size_t>(entry.category)] += entry.bytes;
+        }
+    }
+    return totals;
+}
+
+std::vector<MemoryTracker::Entry> MemoryTracker::getEntries() {
+    std::vector<Entry> entries;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        entries.reserve(entries_.size());
+        for (const auto& [id, entry] : entries_) {
+            entries.push_back(entry);
+        }
+    }
+    std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) { return a.bytes > b.bytes; });
+    return entries;
+}
+
+const char* MemoryTracker::categoryName(MemoryCategory category) {
+    switch (category) {
+        case MemoryCategory::Volume:
+            return "Volume";
+        case MemoryCategory::Mesh:
+            return "Mesh";
+        case MemoryCategory::Texture:
+            return "Texture";
+        case MemoryCategory::Framebuffer:
+            return "Framebuffer";
+        case MemoryCategory::ImGui:
+            return "ImGui";
+        case MemoryCategory::Other:
+            return "Other";
+    }
+    return "Unknown";
+}
+
+std::size_t MemoryTracker::textureBytes(GLenum internalFormat, int width, int height, int depth, int levels) {
+    std::size_t bytes = 0;
+    for (int level = 0; level < std::max(levels, 1); level++) {
+        bytes += static_cast<std::size_t>(std::max(width >> level, 1)) *
+                 static_cast<std::size_t>(std::max(height >> level, 1)) *
+                 static_cast<std::size_t>(std::max(depth >> level, 1));
+    }
+    return bytes * bytesPerTexel(internalFormat);
+}
+
+void MemoryTracker::drawGUI() {
+    const auto totals = getTotals();
+    std::size_t cpuTotal = 0;
+    std::size_t gpuTotal = 0;
+    for (std::size_t i = 0; i < numMemoryCategories; i++) {
+        cpuTotal += totals.cpu[i];
+        gpuTotal += totals.gpu[i];
+    }
+    if (ImGui::BeginTable("MemoryTotals", 3)) {
+        ImGui::TableSetupColumn("Category");
+        ImGui::TableSetupColumn("CPU [MiB]");
+        ImGui::TableSetupColumn("GPU [MiB]");
+        ImGui::TableHeadersRow();
+        for (std::size_t i = 0; i <= numMemoryCategories; i++) {
+            // The last row shows the totals.
+            const bool total = i == numMemoryCategories;
+            const std::size_t cpu = total ? cpuTotal : totals.cpu[i];
+            const std::size_t gpu = total ? gpuTotal : totals.gpu[i];
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            ImGui::Text("%s", total ? "Total" : categoryName(static_cast<MemoryCategory>(i)));
+            ImGui::TableNextColumn();
+            ImGui::Text("%.2f", toMiB(cpu));
+            ImGui::TableNextColumn();
+            ImGui::Text("%.2f", toMiB(gpu));
+        }
+        ImGui::EndTable();
+    }
+
+    const auto entries = getEntries();
+    if (ImGui::TreeNode("Owners")) {
+        std::vector<std::pair<std::string, std::array<std::size_t, 2>>> owners;
+        for (const auto& entry : entries) {
+            auto it = std::find_if(owners.begin(), owners.end(), [&](const auto& o) { return o.first == entry.owner; });
+            if (it == owners.end()) {
+                it = owners.insert(owners.end(), {entry.owner, {0, 0}});
+            }
+            it->second[entry.location == MemoryLocation::Cpu ? 0 : 1] += entry.bytes;
+        }
+        for (const auto& [owner, bytes] : owners) {
+            ImGui::Text("%s: %.2f MiB CPU, %.2f MiB GPU", owner.c_str(), toMiB(bytes[0]), toMiB(bytes[1]));
+        }
+        ImGui::TreePop();
+    }
+    if (ImGui::TreeNode("Largest resources")) {
+        for (std::size_t i = 0; i < std::min(entries.size(), numListedEntries); i++) {
+            const auto& entry = entries[i];
+            ImGui::Text("%.2f MiB %s %s: %s (%s)", toMiB(entry.bytes),
+                entry.location == MemoryLocation::Cpu ? "CPU" : "GPU", categoryName(entry.category),
+                entry.name.c_str(), entry.owner.c_str());
+        }
+        ImGui::TreePop();
+    }
+}
+
+uint64_t MemoryTracker::add(std::string name, std::string owner, MemoryCategory category, MemoryLocation location,
+    std::size_t bytes) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const uint64_t id = nextId_++;
+    if (owner.empty()) {
+        owner = defaultOwner_;
+    }
+    entries_.emplace(id, Entry{std::move(name), std::move(owner), category, location, bytes});
+    return id;
+}
+
+void MemoryTracker::update(uint64_t id, std::size_t bytes) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = entries_.find(id);
+    if (it != entries_.end()) {
+        it->second.bytes = bytes;
+    }
+}
+
+void MemoryTracker::remove(uint64_t id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    entries_.erase(id);
+}
+
+TrackedMemory::TrackedMemory(std::string name, MemoryCategory category, MemoryLocation location, std::size_t bytes,
+    std::string owner)
+    : id_(MemoryTracker::add(std::move(name), std::move(owner), category, location, bytes)),
+      bytes_(bytes) {}
+
+TrackedMemory::~TrackedMemory() {
+    reset();
+}
+
+TrackedMemory::TrackedMemory(TrackedMemory&& other) noexcept : id_(other.id_), bytes_(other.bytes_) {
+    other.id_ = 0;
+    other.bytes_ = 0;
+}
+
+TrackedMemory& TrackedMemory::operator=(TrackedMemory&& other) noexcept {
+    if (this != &other) {
+        reset();
+        id_ = other.id_;
+        bytes_ = other.bytes_;
+        other.id_ = 0;
+        other.bytes_ = 0;
+    }
+    return *this;
+}
+
+void TrackedMemory::resize(std::size_t bytes) {
+    if (id_ == 0 || bytes == bytes_) {
+        return;
+    }
+    bytes_ = bytes;
+    MemoryTracker::update(id_, bytes);
+}
+
+void TrackedMemory::reset() {
+    if (id_ != 0) {
+        MemoryTracker::remove(id_);
+        id_ = 0;
+        bytes_ = 0;
+    }
+}
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <glad/gl.h>
+
+namespace OGL4Core2::Core {
+    enum class MemoryCategory { Volume, Mesh, Texture, Framebuffer, ImGui, Other };
+    enum class MemoryLocation { Cpu, Gpu };
+
+    static constexpr std::size_t numMemoryCategories = 6;
+
+    /**
+     * Process-wide accounting of large CPU allocations and GPU resources. Memory is recorded by TrackedMemory handles,
+     * which belong to an owner (the core or a plugin), a category and a location. The GUI panel and benchmark reports
+     * show the totals, so the memory footprint of a dataset can be read off directly.
+     */
+    class MemoryTracker {
+    public:
+        struct Entry {
+            std::string name;
+            std::string owner;
+            MemoryCategory category;
+            MemoryLocation location;
+            std::size_t bytes;
+        };
+
+        struct Totals {
+            std::array<std::size_t, numMemoryCategories> cpu{};
+            std::array<std::size_t, numMemoryCategories> gpu{};
+        };
+
+        MemoryTracker() = delete;
+        ~MemoryTracker() = delete;
+        MemoryTracker(const MemoryTracker&) = delete;
+        MemoryTracker(MemoryTracker&&) = delete;
+        MemoryTracker& operator=(const MemoryTracker&) = delete;
+        MemoryTracker& operator=(MemoryTracker&&) = delete;
+
+        /**
+         * Owner of handles created without an explicit owner. Set by the core to the name of the active plugin.
+         */
+        static void setDefaultOwner(const std::string& owner);
+
+        [[nodiscard]] static Totals getTotals();
+
+        /**
+         * Totals of a single owner.
+         */
+        [[nodiscard]] static Totals getTotals(const std::string& owner);
+
+        /**
+         * All entries, largest first.
+         */
+        [[nodiscard]] static std::vector<Entry> getEntries();
+
+        [[nodiscard]] static const char* categoryName(MemoryCategory category);
+
+        /**
+         * Size of a texture with the given sized internal format, including all mipmap levels.
+         */
+        [[nodiscard]] static std::size_t textureBytes(GLenum internalFormat, int width, int height, int depth = 1,
+            int levels = 1);
+
+        static void drawGUI();
+
+    private:
+        friend class TrackedMemory;
+
+        static uint64_t add(std::string name, std::string owner, MemoryCategory category, MemoryLocation location,
+            std::size_t bytes);
+        static void update(uint64_t id, std::size_t bytes);
+        static void remove(uint64_t id);
+
+        static std::mutex mutex_;
+        static std::unordered_map<uint64_t, Entry> entries_;
+        static uint64_t nextId_;
+        static std::string defaultOwner_;
+    };
+
+    /**
+     * RAII record of tracked memory, e.g. as member next to a texture handle or a large vector. The entry is removed
+     * when the handle is destroyed or reset. Handles can be moved but not copied.
+     */
+    class TrackedMemory {
+    public:
+        TrackedMemory() : id_(0) {}
+
+        /**
+         * An empty owner uses the default owner, see MemoryTracker::setDefaultOwner().
+         */
+        TrackedMemory(std::string name, MemoryCategory category, MemoryLocation location, std::size_t bytes = 0,
+            std::string owner = std::string());
+        ~TrackedMemory();
+
+        TrackedMemory(const TrackedMemory&) = delete;
+        TrackedMemory(TrackedMemory&& other) noexcept;
+        TrackedMemory& operator=(const TrackedMemory&) = delete;
+        TrackedMemory& operator=(TrackedMemory&& other) noexcept;
+
+        /**
+         * Set the recorded size, e.g. after the resource was reallocated.
+         */
+        void resize(std::size_t bytes);
+
+        void reset();
+
+        [[nodiscard]] inline std::size_t bytes() const {
+            return bytes_;
+        }
+
+    private:
+        uint64_t id_;
+        std::size_t bytes_ = 0;
+    };
+} // namespace OGL4Core2::Core
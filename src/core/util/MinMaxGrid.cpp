@@ -0,0 +1,151 @@
+#include "MinMaxGrid.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <utility>
+
+#include "ThreadPool.h"
+
+using namespace OGL4Core2::Core;
+
+namespace {
+    // Level voxels by which sample positions are widened in addLevel(), covers rounding of the texture coordinates.
+    constexpr double positionSlack = 1.0e-3;
+} // namespace
+
+MinMaxGrid::MinMaxGrid(const std::array<uint32_t, 3>& cells, uint32_t cellSize, std::vector<uint8_t> minMax)
+    : cells_(cells),
+      cellSize_(cellSize),
+      levels_(1),
+      minMax_(std::move(minMax)) {
+    if (minMax_.size() != 2 * getNumCells()) {
+        throw std::runtime_error("Invalid min/max grid size!");
+    }
+}
+
+MinMaxGrid MinMaxGrid::build(const uint8_t* data, const std::array<uint32_t, 3>& resolution, uint32_t cellSize,
+    ThreadPool& pool) {
+    if (cellSize == 0) {
+        throw std::runtime_error("Invalid min/max grid cell size!");
+    }
+    const std::array<uint32_t, 3> cells = {(resolution[0] + cellSize - 1) / cellSize,
+        (resolution[1] + cellSize - 1) / cellSize, (resolution[2] + cellSize - 1) / cellSize};
+    const std::size_t rowSize = resolution[0];
+    const std::size_t sliceSize = rowSize * resolution[1];
+    std::vector<uint8_t> minMax(2 * static_cast<std::size_t>(cells[0]) * cells[1] * cells[2]);
+
+    // One layer of cells per task, the voxel slices of a layer are read once for all of its cells.
+    pool.parallelFor(0, cells[2], [&](std::size_t begin, std::size_t end) {
+        const std::size_t layerCells = static_cast<std::size_t>(cells[0]) * cells[1];
+        for (std::size_t cz = begin; cz < end; cz++) {
+            uint8_t* layer = minMax.data() + 2 * cz * layerCells;
+            for (std::size_t c = 0; c < layerCells; c++) {
+                layer[2 * c] = 255;
+                layer[2 * c + 1] = 0;
+            }
+            // Cells include one voxel of their neighbors on each side.
+            const std::size_t z0 = cz * cellSize > 0 ? cz * cellSize - 1 : 0;
+            const std::size_t z1 = std::min<std::size_t>((cz + 1) * cellSize + 1, resolution[2]);
+            for (std::size_t z = z0; z < z1; z++) {
+                for (std::size_t y = 0; y < resolution[1]; y++) {
+                    const uint8_t* row = data + z * sliceSize + y * rowSize;
+                    // A voxel on a cell border belongs to the ranges of both cells along each axis.
+                    const std::size_t cy0 = y > 0 ? (y - 1) / cellSize : 0;
+                    const std::size_t cy1 = std::min<std::size_t>((y + 1) / cellSize, cells[1] - 1);
+                    for (std::size_t cx = 0; cx < cells[0]; cx++) {
+                        const std::size_t x0 = cx * cellSize > 0 ? cx * cellSize - 1 : 0;
+                        const std::size_t x1 = std::min<std::size_t>((cx + 1) * cellSize + 1, rowSize);
+                        const auto [lo, hi] = std::minmax_element(row + x0, row + x1);
+                        for (std::size_t cy = cy0; cy <= cy1; cy++) {
+                            uint8_t* cell = layer + 2 * (cy * cells[0] + cx);
+                            cell[0] = std::min(cell[0], *lo);
+                            cell[1] = std::max(cell[1], *hi);
+                        }
+                    }
+                }
+            }
+        }
+    }, 1);
+    return MinMaxGrid(cells, cellSize, std::move(minMax));
+}
+
+void MinMaxGrid::addLevel(const MinMaxGrid& level, const std::array<uint32_t, 3>& levelResolution,
+    const std::array<uint32_t, 3>& resolution) {
+    if (empty() || level.empty() || level.cellSize_ != cellSize_) {
+        throw std::runtime_error("Invalid min/max grid level!");
+    }
+    // Per axis and cell the first and last level cell. Samples of a cell have the texture coordinates [c, c + 1) *
+    // cellSize / resolution, the level cell containing the sample holds its interpolated voxels including the border.
+    std::array<std::vector<std::pair<uint32_t, uint32_t>>, 3> spans;
+    for (int i = 0; i < 3; i++) {
+        if (resolution[i] == 0 || levelResolution[i] == 0 || cells_[i] != (resolution[i] + cellSize_ - 1) / cellSize_ ||
+            level.cells_[i] != (levelResolution[i] + cellSize_ - 1) / cellSize_) {
+            throw std::runtime_error("Invalid min/max grid level!");
+        }
+        const double scale = static_cast<double>(levelResolution[i]) / static_cast<double>(resolution[i]);
+        const auto levelCell = [&](double position) {
+            const double cell = std::floor(std::max(position, 0.0) / cellSize_);
+            return static_cast<uint32_t>(std::min(cell, static_cast<double>(level.cells_[i] - 1)));
+        };
+        for (uint32_t c = 0; c < cells_[i]; c++) {
+            const double begin = static_cast<double>(c) * cellSize_ * scale - positionSlack;
+            const double end =
+                std::min<double>(static_cast<double>(c + 1) * cellSize_, resolution[i]) * scale + positionSlack;
+            spans[i].emplace_back(levelCell(begin), levelCell(end));
+        }
+    }
+
+    const auto offset = [](const std::array<uint32_t, 3>& cells, uint32_t x, uint32_t y, uint32_t z) {
+        return 2 * ((static_cast<std::size_t>(z) * cells[1] + y) * cells[0] + x);
+    };
+    for (uint32_t z = 0; z < cells_[2]; z++) {
+        for (uint32_t y = 0; y < cells_[1]; y++) {
+            for (uint32_t x = 0; x < cells_[0]; x++) {
+                uint8_t* cell = minMax_.data() + offset(cells_, x, y, z);
+                for (uint32_t lz = spans[2][z].first; lz <= spans[2][z].second; lz++) {
+                    for (uint32_t ly = spans[1][y].first; ly <= spans[1][y].second; ly++) {
+                        for (uint32_t lx = spans[0][x].first; lx <= spans[0][x].second; lx++) {
+                            const uint8_t* l = level.minMax_.data() + offset(level.cells_, lx, ly, lz);
+                            cell[0] = std::min(cell[0], l[0]);
+                            cell[1] = std::max(cell[1], l[1]);
+                        }
+                    }
+                }
+            }
+        }
+    }
+    levels_++;
+}
+
+std::vector<uint8_t> MinMaxGrid::occupancy(const std::array<bool, 256>& visible, ThreadPool& pool) const {
+    std::array<uint32_t, 257> prefix{};
+    for (std::size_t v = 0; v < visible.size(); v++) {
+        prefix[v + 1] = prefix[v] + (visible[v] ? 1 : 0);
+    }
+    std::vector<uint8_t> result(getNumCells());
+    pool.parallelFor(0, result.size(), [&](std::size_t begin, std::size_t end) {
+        for (std::size_t c = begin; c < end; c++) {
+            const uint8_t lo = minMax_[2 * c];
+            const uint8_t hi = minMax_[2 * c + 1];
+            result[c] = lo <= hi && prefix[hi + 1] > prefix[lo] ? 255 : 0;
+        }
+    }, 1 << 14);
+    return result;
+}
+
+std::vector<uint8_t> MinMaxGrid::homogeneity(const std::array<bool, 255>& changes, ThreadPool& pool) const {
+    std::array<uint32_t, 256> prefix{};
+    for (std::size_t v = 0; v < changes.size(); v++) {
+        prefix[v + 1] = prefix[v] + (changes[v] ? 1 : 0);
+    }
+    std::vector<uint8_t> result(getNumCells());
+    pool.parallelFor(0, result.size(), [&](std::size_t begin, std::size_t end) {
+        for (std::size_t c = begin; c < end; c++) {
+            const uint8_t lo = minMax_[2 * c];
+            const uint8_t hi = minMax_[2 * c + 1];
+            result[c] = lo <= hi && prefix[hi] == prefix[lo] ? 255 : 0;
+        }
+    }, 1 << 14);
+    return result;
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace OGL4Core2::Core {
+    class ThreadPool;
+
+    /**
+     * Minimum and maximum value per cell of cellSize^3 voxels of an 8 bit volume, as acceleration structure for empty
+     * space skipping. Each cell includes a border of one voxel of its neighbors, so all values trilinearly interpolated
+     * within a cell are inside its range. Samples of downsampled levels reach further and have other values, their
+     * ranges are added with addLevel().
+     */
+    class MinMaxGrid {
+    public:
+        MinMaxGrid() : cells_{}, cellSize_(0), levels_(0) {}
+
+        /**
+         * Cells in x-fastest order, minMax holds a pair (min, max) per cell.
+         */
+        MinMaxGrid(const std::array<uint32_t, 3>& cells, uint32_t cellSize, std::vector<uint8_t> minMax);
+
+        /**
+         * Compute the grid of a volume (x fastest), the cells are computed in parallel.
+         */
+        [[nodiscard]] static MinMaxGrid build(const uint8_t* data, const std::array<uint32_t, 3>& resolution,
+            uint32_t cellSize, ThreadPool& pool);
+
+        [[nodiscard]] inline const std::array<uint32_t, 3>& getCells() const {
+            return cells_;
+        }
+
+        [[nodiscard]] inline std::size_t getNumCells() const {
+            return static_cast<std::size_t>(cells_[0]) * cells_[1] * cells_[2];
+        }
+
+        [[nodiscard]] inline uint32_t getCellSize() const {
+            return cellSize_;
+        }
+
+        [[nodiscard]] inline const std::vector<uint8_t>& getMinMax() const {
+            return minMax_;
+        }
+
+        [[nodiscard]] inline bool empty() const {
+            return minMax_.empty();
+        }
+
+        /**
+         * Number of levels whose values are within the ranges, 1 for the full resolution only. Samples of coarser
+         * levels must not be skipped.
+         */
+        [[nodiscard]] inline uint32_t getLevels() const {
+            return levels_;
+        }
+
+        /**
+         * Widen the ranges by the grid of the next downsampled level, with the same cell size in voxels of that level,
+         * e.g. built from a VolumePyramid level or the bricks of a level. A cell gets the ranges of all level cells
+         * sampled at its texture coordinates, resolution is the full resolution, levelResolution the one of the level.
+         */
+        void addLevel(const MinMaxGrid& level, const std::array<uint32_t, 3>& levelResolution,
+            const std::array<uint32_t, 3>& resolution);
+
+        /**
+         * Occupancy per cell, 255 if any value of its range is visible, otherwise 0. Uses a prefix sum over the
+         * visible values, so it is cheap enough to be recomputed whenever the visibility changes.
+         */
+        [[nodiscard]] std::vector<uint8_t> occupancy(const std::array<bool, 256>& visible, ThreadPool& pool) const;
+
+        /**
+         * Homogeneity per cell, 255 if all values of its range are mapped to the same result, otherwise 0. changes[v]
+         * is true if the values v and v + 1 are mapped differently.
+         */
+        [[nodiscard]] std::vector<uint8_t> homogeneity(const std::array<bool, 255>& changes, ThreadPool& pool) const;
+
+    private:
+        std::array<uint32_t, 3> cells_;
+        uint32_t cellSize_;
+        uint32_t levels_;
+        std::vector<uint8_t> minMax_;
+    };
+} // namespace OGL4Core2::Core
@@ -0,0 +1,303 @@
+#include "PngStreamWriter.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+
+using namespace OGL4Core2::Core;
+
+namespace {
+    constexpr std::size_t pixelSize = 4;
+    constexpr int windowSize = 32768;
+    constexpr int hashBits = 15;
+    constexpr int minMatch = 3;
+    constexpr int maxMatch = 258;
+    constexpr int maxChain = 16;
+    constexpr int niceMatch = 64;
+    constexpr std::size_t idatChunkSize = 1 << 20;
+
+    constexpr std::array<int, 29> lengthBase{3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59,
+        67, 83, 99, 115, 131, 163, 195, 227, 258};
+    constexpr std::array<int, 29> lengthExtra{0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4,
+        5, 5, 5, 5, 0};
+    constexpr std::array<int, 30> distanceBase{1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513,
+        769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+    constexpr std::array<int, 30> distanceExtra{0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10,
+        10, 11, 11, 12, 12, 13, 13};
+
+    uint32_t crcTable[256];
+    const bool crcTableInit = []() {
+        for (uint32_t n = 0; n < 256; n++) {
+            uint32_t c = n;
+            for (int k = 0; k < 8; k++) {
+                c = (c & 1u) != 0 ? 0xedb88320u ^ (c >> 1) : c >> 1;
+            }
+            crcTable[n] = c;
+        }
+        return true;
+    }();
+
+    uint32_t updateCrc(uint32_t crc, const unsigned char* data, std::size_t size) {
+        for (std::size_t i = 0; i < size; i++) {
+            crc = crcTable[(crc ^ data[i]) & 0xffu] ^ (crc >> 8);
+        }
+        return crc;
+    }
+
+    void putBigEndian(unsigned char* out, uint32_t value) {
+        out[0] = static_cast<unsigned char>(value >> 24);
+        out[1] = static_cast<unsigned char>(value >> 16);
+        out[2] = static_cast<unsigned char>(value >> 8);
+        out[3] = static_cast<unsigned char>(value);
+    }
+
+    // Huffman codes are sent most significant bit first, all other fields least significant bit first.
+    uint32_t reverseBits(uint32_t code, int length) {
+        uint32_t result = 0;
+        for (int i = 0; i < length; i++) {
+            result = (result << 1) | ((code >> i) & 1u);
+        }
+        return result;
+    }
+
+    inline unsigned char paeth(int a, int b, int c) {
+        const int p = a + b - c;
+        const int pa = std::abs(p - a);
+        const int pb = std::abs(p - b);
+        const int pc = std::abs(p - c);
+        if (pa <= pb && pa <= pc) {
+            return static_cast<unsigned char>(a);
+        }
+        return static_cast<unsigned char>(pb <= pc ? b : c);
+    }
+
+    inline uint32_t hash3(const unsigned char* p) {
+        return ((p[0] << 10) ^ (p[1] << 5) ^ p[2]) & ((1u << hashBits) - 1);
+    }
+} // namespace
+
+PngStreamWriter::PngStreamWriter(const std::filesystem::path& filename, int width, int height)
+    : filename_(filename),
+      file_(filename, std::ios::binary),
+      width_(width),
+      height_(height),
+      rowsWritten_(0),
+      head_(1u << hashBits),
+      prev_(windowSize),
+      bitBuffer_(0),
+      bitCount_(0),
+      adlerA_(1),
+      adlerB_(0) {
+    if (width <= 0 || height <= 0) {
+        throw std::runtime_error("Invalid PNG image size!");
+    }
+    if (!file_.is_open()) {
+        throw std::runtime_error("Cannot write PNG image \"" + filename_.string() + "\"!");
+    }
+    const std::size_t rowSize = static_cast<std::size_t>(width_) * pixelSize;
+    prevRow_.assign(rowSize, 0);
+    for (auto& candidate : candidates_) {
+        candidate.resize(rowSize);
+    }
+
+    static constexpr unsigned char signature[] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+    file_.write(reinterpret_cast<const char*>(signature), sizeof(signature));
+    unsigned char ihdr[13];
+    putBigEndian(ihdr, static_cast<uint32_t>(width_));
+    putBigEndian(ihdr + 4, static_cast<uint32_t>(height_));
+    ihdr[8] = 8;  // bit depth
+    ihdr[9] = 6;  // RGBA
+    ihdr[10] = 0; // deflate
+    ihdr[11] = 0; // adaptive filtering
+    ihdr[12] = 0; // no interlace
+    writeChunk("IHDR", ihdr, sizeof(ihdr));
+
+    // zlib header: deflate with 32K window, fastest compression level.
+    compressed_.push_back(0x78);
+    compressed_.push_back(0x01);
+}
+
+void PngStreamWriter::writeRows(const unsigned char* rows, int count, std::ptrdiff_t stride) {
+    if (count < 0 || rowsWritten_ + count > height_) {
+        throw std::runtime_error("Too many PNG rows!");
+    }
+    filtered_.clear();
+    for (int i = 0; i < count; i++) {
+        filterRow(rows + i * stride);
+    }
+    rowsWritten_ += count;
+    deflate(filtered_.data(), filtered_.size());
+    flushIdat(false);
+}
+
+void PngStreamWriter::finish() {
+    if (rowsWritten_ != height_) {
+        throw std::runtime_error("PNG image is incomplete!");
+    }
+    // Empty final block, then the Adler-32 checksum.
+    putBits(1, 1);
+    putBits(1, 2);
+    putLiteral(256);
+    if (bitCount_ > 0) {
+        putBits(0, 8 - bitCount_);
+    }
+    const uint32_t adler = (adlerB_ << 16) | adlerA_;
+    for (int shift = 24; shift >= 0; shift -= 8) {
+        compressed_.push_back(static_cast<unsigned char>(adler >> shift));
+    }
+    flushIdat(true);
+    writeChunk("IEND", nullptr, 0);
+    file_.flush();
+    if (!file_) {
+        throw std::runtime_error("Cannot write PNG image \"" + filename_.string() + "\"!");
+    }
+}
+
+void PngStreamWriter::filterRow(const unsigned char* row) {
+    // Per row, the filter with the smallest sum of absolute values is chosen, like lodepng's default strategy.
+    const std::size_t rowSize = prevRow_.size();
+    const unsigned char* up = prevRow_.data();
+    std::array<uint64_t, 4> sums{};
+    for (std::size_t x = 0; x < rowSize; x++) {
+        const int a = x >= pixelSize ? row[x - pixelSize] : 0;
+        const int b = up[x];
+        const int c = x >= pixelSize ? up[x - pixelSize] : 0;
+        const unsigned char values[4] = {row[x], static_cast<unsigned char>(row[x] - a),
+            static_cast<unsigned char>(row[x] - b), static_cast<unsigned char>(row[x] - paeth(a, b, c))};
+        for (std::size_t f = 0; f < 4; f++) {
+            candidates_[f][x] = values[f];
+            sums[f] += static_cast<uint64_t>(std::abs(static_cast<signed char>(values[f])));
+        }
+    }
+    // Candidates are None, Sub, Up and Paeth, the PNG filter types 0, 1, 2 and 4.
+    static constexpr unsigned char filterTypes[4] = {0, 1, 2, 4};
+    const std::size_t best = std::min_element(sums.begin(), sums.end()) - sums.begin();
+    filtered_.push_back(filterTypes[best]);
+    filtered_.insert(filtered_.end(), candidates_[best].begin(), candidates_[best].end());
+    std::memcpy(prevRow_.data(), row, rowSize);
+}
+
+void PngStreamWriter::deflate(const unsigned char* data, std::size_t size) {
+    // Adler-32 of the uncompressed data, reduced before the sums can overflow.
+    for (std::size_t i = 0; i < size;) {
+        const std::size_t end = std::min(size, i + 5552);
+        for (; i < end; i++) {
+            adlerA_ += data[i];
+            adlerB_ += adlerA_;
+        }
+        adlerA_ %= 65521u;
+        adlerB_ %= 65521u;
+    }
+
+    // One fixed Huffman block per strip, not final. Matches do not reach into previous strips.
+    putBits(0, 1);
+    putBits(1, 2);
+    std::fill(head_.begin(), head_.end(), -1);
+    const auto length = static_cast<int64_t>(size);
+    int64_t pos = 0;
+    while (pos < length) {
+        int bestLength = 0;
+        int bestDistance = 0;
+        if (pos + minMatch <= length) {
+            const uint32_t h = hash3(data + pos);
+            int64_t candidate = head_[h];
+            const int maxLength = static_cast<int>(std::min<int64_t>(maxMatch, length - pos));
+            for (int chain = 0; chain < maxChain && candidate >= 0 && pos - candidate <= windowSize; chain++) {
+                int l = 0;
+                while (l < maxLength && data[candidate + l] == data[pos + l]) {
+                    l++;
+                }
+                if (l > bestLength) {
+                    bestLength = l;
+                    bestDistance = static_cast<int>(pos - candidate);
+                    if (l >= niceMatch) {
+                        break;
+                    }
+                }
+                const int64_t next = prev_[candidate % windowSize];
+                if (next >= candidate) {
+                    break;
+                }
+                candidate = next;
+            }
+            prev_[pos % windowSize] = head_[h];
+            head_[h] = pos;
+        }
+        if (bestLength >= minMatch) {
+            putMatch(bestLength, bestDistance);
+            // Insert the skipped positions into the hash chains.
+            for (int64_t p = pos + 1; p < pos + bestLength && p + minMatch <= length; p++) {
+                const uint32_t h = hash3(data + p);
+                prev_[p % windowSize] = head_[h];
+                head_[h] = p;
+            }
+            pos += bestLength;
+        } else {
+            putLiteral(data[pos]);
+            pos++;
+        }
+    }
+    putLiteral(256);
+}
+
+void PngStreamWriter::putBits(uint32_t bits, int count) {
+    bitBuffer_ |= static_cast<uint64_t>(bits) << bitCount_;
+    bitCount_ += count;
+    while (bitCount_ >= 8) {
+        compressed_.push_back(static_cast<unsigned char>(bitBuffer_));
+        bitBuffer_ >>= 8;
+        bitCount_ -= 8;
+    }
+}
+
+void PngStreamWriter::putLiteral(unsigned int symbol) {
+    // Fixed Huffman code of the literal/length alphabet.
+    if (symbol < 144) {
+        putBits(reverseBits(0x30 + symbol, 8), 8);
+    } else if (symbol < 256) {
+        putBits(reverseBits(0x190 + symbol - 144, 9), 9);
+    } else if (symbol < 280) {
+        putBits(reverseBits(symbol - 256, 7), 7);
+    } else {
+        putBits(reverseBits(0xc0 + symbol - 280, 8), 8);
+    }
+}
+
+void PngStreamWriter::putMatch(int length, int distance) {
+    const auto lengthCode = static_cast<std::size_t>(
+        std::upper_bound(lengthBase.begin(), lengthBase.end(), length) - lengthBase.begin() - 1);
+    putLiteral(257 + static_cast<unsigned int>(lengthCode));
+    putBits(static_cast<uint32_t>(length - lengthBase[lengthCode]), lengthExtra[lengthCode]);
+    const auto distanceCode = static_cast<std::size_t>(
+        std::upper_bound(distanceBase.begin(), distanceBase.end(), distance) - distanceBase.begin() - 1);
+    putBits(reverseBits(static_cast<uint32_t>(distanceCode), 5), 5);
+    putBits(static_cast<uint32_t>(distance - distanceBase[distanceCode]), distanceExtra[distanceCode]);
+}
+
+void PngStreamWriter::writeChunk(const char* type, const unsigned char* data, std::size_t size) {
+    unsigned char header[8];
+    putBigEndian(header, static_cast<uint32_t>(size));
+    std::memcpy(header + 4, type, 4);
+    uint32_t crc = updateCrc(0xffffffffu, header + 4, 4);
+    if (size > 0) {
+        crc = updateCrc(crc, data, size);
+    }
+    unsigned char footer[4];
+    putBigEndian(footer, crc ^ 0xffffffffu);
+    file_.write(reinterpret_cast<const char*>(header), sizeof(header));
+    if (size > 0) {
+        file_.write(reinterpret_cast<const char*>(data), static_cast<std::streamsize>(size));
+    }
+    file_.write(reinterpret_cast<const char*>(footer), sizeof(footer));
+}
+
+void PngStreamWriter::flushIdat(bool all) {
+    std::size_t offset = 0;
+    while (compressed_.size() - offset >= idatChunkSize || (all && offset < compressed_.size())) {
+        const std::size_t size = std::min(idatChunkSize, compressed_.size() - offset);
+        writeChunk("IDAT", compressed_.data() + offset, size);
+        offset += size;
+    }
+    compressed_.erase(compressed_.begin(), compressed_.begin() + static_cast<std::ptrdiff_t>(offset));
+}
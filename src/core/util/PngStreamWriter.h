@@ -0,0 +1,67 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+namespace OGL4Core2::Core {
+    /**
+     * PNG writer for RGBA8 images which are too large to be held in memory. Rows are passed in strips from top to
+     * bottom, each strip is filtered, compressed and written as IDAT chunk right away, so memory use is bounded by
+     * the strip size. Compression is a simple LZ77 with fixed Huffman codes: files are larger than with lodepng, but
+     * much smaller than uncompressed.
+     */
+    class PngStreamWriter {
+    public:
+        PngStreamWriter(const std::filesystem::path& filename, int width, int height);
+        ~PngStreamWriter() = default;
+
+        PngStreamWriter(const PngStreamWriter&) = delete;
+        PngStreamWriter(PngStreamWriter&&) = delete;
+        PngStreamWriter& operator=(const PngStreamWriter&) = delete;
+        PngStreamWriter& operator=(PngStreamWriter&&) = delete;
+
+        /**
+         * Append rows in top-down order, stride is the distance between rows in bytes. A negative stride passes
+         * rows bottom-up in memory, e.g. OpenGL pixels starting at the last row.
+         */
+        void writeRows(const unsigned char* rows, int count, std::ptrdiff_t stride);
+
+        /**
+         * Write the end of the file. Throws if not all rows were written.
+         */
+        void finish();
+
+        [[nodiscard]] inline int getRowsWritten() const {
+            return rowsWritten_;
+        }
+
+    private:
+        void filterRow(const unsigned char* row);
+        void deflate(const unsigned char* data, std::size_t size);
+        void putBits(uint32_t bits, int count);
+        void putLiteral(unsigned int symbol);
+        void putMatch(int length, int distance);
+        void writeChunk(const char* type, const unsigned char* data, std::size_t size);
+        void flushIdat(bool all);
+
+        std::filesystem::path filename_;
+        std::ofstream file_;
+        int width_;
+        int height_;
+        int rowsWritten_;
+        std::vector<unsigned char> prevRow_;
+        std::vector<unsigned char> filtered_;   // filtered rows of the current strip
+        std::array<std::vector<unsigned char>, 4> candidates_;
+        std::vector<int64_t> head_;             // hash chains, positions within a strip may exceed 2 GiB
+        std::vector<int64_t> prev_;
+        std::vector<unsigned char> compressed_; // pending IDAT data
+        uint64_t bitBuffer_;
+        int bitCount_;
+        uint32_t adlerA_;
+        uint32_t adlerB_;
+    };
+} // namespace OGL4Core2::Core
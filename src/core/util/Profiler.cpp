@@ -0,0 +1,286 @@
+#include "Profiler.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#include <imgui.h>
+
+#include "Hash.h"
+
+using namespace OGL4Core2::Core;
+
+namespace {
+    constexpr std::size_t droppedScope = std::numeric_limits<std::size_t>::max();
+
+    std::string escapeJson(const char* str) {
+        std::string result;
+        for (const char* c = str; *c != '\0'; c++) {
+            if (*c == '"' || *c == '\\') {
+                result += '\\';
+            }
+            result += *c;
+        }
+        return result;
+    }
+
+    ImU32 scopeColor(const char* name) {
+        // A stable hash of the name gives a stable color per scope.
+        const uint64_t hash = Fnv1aHash::hash(name);
+        const auto r = 100 + (hash & 0x7Fu);
+        const auto g = 100 + ((hash >> 8) & 0x7Fu);
+        const auto b = 100 + ((hash >> 16) & 0x7Fu);
+        return IM_COL32(r, g, b, 255);
+    }
+} // namespace
+
+Profiler::Profiler(std::filesystem::path traceFilename)
+    : enabled_(false),
+      recording_(false),
+      startTime_(std::chrono::steady_clock::now()),
+      currentFrame_(0),
+      frameStart_(0.0),
+      showTimeline_(false),
+      traceFilename_(traceFilename.empty() ? std::filesystem::path("profile_trace.json") : std::move(traceFilename)) {}
+
+Profiler::~Profiler() {
+    for (auto& frame : frames_) {
+        if (!frame.queries.empty()) {
+            glDeleteQueries(static_cast<GLsizei>(frame.queries.size()), frame.queries.data());
+        }
+    }
+}
+
+void Profiler::beginFrame(uint64_t frameNumber) {
+    recording_ = false;
+    if (!enabled_) {
+        return;
+    }
+
+    currentFrame_ = (currentFrame_ + 1) % numFramesInFlight;
+    auto& frame = frames_[currentFrame_];
+    if (frame.active) {
+        // Queries of this slot are reused now, results not available yet are dropped instead of waiting for them.
+        resolve(frame, true);
+    }
+    if (frame.queries.empty()) {
+        frame.queries.resize(2 * maxScopesPerFrame + 2);
+        glGenQueries(static_cast<GLsizei>(frame.queries.size()), frame.queries.data());
+    }
+
+    frame.active = true;
+    frame.gpuValid = true;
+    frame.data = FrameData();
+    frame.data.frameNumber = frameNumber;
+    frame.data.cpuStart = now();
+    frameStart_ = frame.data.cpuStart;
+    scopeStack_.clear();
+    recording_ = true;
+
+    glQueryCounter(frame.queries[0], GL_TIMESTAMP);
+}
+
+void Profiler::endFrame() {
+    if (!recording_) {
+        return;
+    }
+    while (!scopeStack_.empty()) {
+        endScope();
+    }
+
+    auto& frame = frames_[currentFrame_];
+    frame.data.cpuDuration = now() - frameStart_;
+    glQueryCounter(frame.queries[1], GL_TIMESTAMP);
+    recording_ = false;
+
+    // Resolve older frames, oldest first, as long as their results are available.
+    for (std::size_t i = 1; i < numFramesInFlight; i++) {
+        auto& older = frames_[(currentFrame_ + i) % numFramesInFlight];
+        if (older.active) {
+            resolve(older, false);
+            if (older.active) {
+                break;
+            }
+        }
+    }
+}
+
+void Profiler::beginScope(const char* name) {
+    if (!recording_) {
+        return;
+    }
+    auto& frame = frames_[currentFrame_];
+    if (frame.data.records.size() >= maxScopesPerFrame) {
+        scopeStack_.push_back(droppedScope);
+        return;
+    }
+    const std::size_t idx = frame.data.records.size();
+    frame.data.records.push_back({name, static_cast<int>(scopeStack_.size()), now() - frameStart_, 0.0, -1.0, -1.0});
+    glQueryCounter(frame.queries[2 * idx + 2], GL_TIMESTAMP);
+    scopeStack_.push_back(idx);
+}
+
+void Profiler::endScope() {
+    if (!recording_ || scopeStack_.empty()) {
+        return;
+    }
+    const std::size_t idx = scopeStack_.back();
+    scopeStack_.pop_back();
+    if (idx == droppedScope) {
+        return;
+    }
+    auto& frame = frames_[currentFrame_];
+    frame.data.records[idx].cpuEnd = now() - frameStart_;
+    glQueryCounter(frame.queries[2 * idx + 3], GL_TIMESTAMP);
+}
+
+const Profiler::FrameData* Profiler::getLatestFrame() const {
+    return history_.empty() ? nullptr : &history_.back();
+}
+
+void Profiler::resolve(PendingFrame& frame, bool force) {
+    if (frame.gpuValid) {
+        // Queries finish in order, if the frame end timestamp is available, all others are, too.
+        GLint available = 0;
+        glGetQueryObjectiv(frame.queries[1], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (available == 0) {
+            if (!force) {
+                return;
+            }
+            frame.gpuValid = false;
+        }
+    }
+
+    if (frame.gpuValid) {
+        GLuint64 base = 0;
+        GLuint64 end = 0;
+        glGetQueryObjectui64v(frame.queries[0], GL_QUERY_RESULT, &base);
+        glGetQueryObjectui64v(frame.queries[1], GL_QUERY_RESULT, &end);
+        frame.data.gpuDuration = static_cast<double>(end - base) * 1.0e-6;
+        for (std::size_t i = 0; i < frame.data.records.size(); i++) {
+            GLuint64 b = 0;
+            GLuint64 e = 0;
+            glGetQueryObjectui64v(frame.queries[2 * i + 2], GL_QUERY_RESULT, &b);
+            glGetQueryObjectui64v(frame.queries[2 * i + 3], GL_QUERY_RESULT, &e);
+            frame.data.records[i].gpuBegin = static_cast<double>(b - base) * 1.0e-6;
+            frame.data.records[i].gpuEnd = static_cast<double>(e - base) * 1.0e-6;
+        }
+    }
+
+    frame.active = false;
+    history_.push_back(std::move(frame.data));
+    while (history_.size() > maxHistoryFrames) {
+        history_.pop_front();
+    }
+}
+
+double Profiler::now() const {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime_).count();
+}
+
+void Profiler::drawGUI() {
+    ImGui::Checkbox("Enable profiler", &enabled_);
+    ImGui::Checkbox("Show timeline", &showTimeline_);
+    if (ImGui::Button("Export Chrome trace")) {
+        try {
+            exportChromeTrace(traceFilename_);
+            std::cout << "Profiler trace written to " << traceFilename_.string() << std::endl;
+        } catch (const std::exception& ex) {
+            std::cerr << ex.what() << std::endl;
+        }
+    }
+
+    const FrameData* frame = getLatestFrame();
+    if (frame == nullptr) {
+        return;
+    }
+    ImGui::Text("Frame %llu: CPU %.3f ms, GPU %.3f ms", static_cast<unsigned long long>(frame->frameNumber),
+        frame->cpuDuration, frame->gpuDuration);
+
+    if (!showTimeline_) {
+        return;
+    }
+
+    ImGui::SetNextWindowSize(ImVec2(700.0f, 300.0f), ImGuiCond_Once);
+    if (ImGui::Begin("Profiler", &showTimeline_)) {
+        int maxDepth = 0;
+        for (const auto& r : frame->records) {
+            maxDepth = std::max(maxDepth, r.depth + 1);
+        }
+        const double span = std::max({frame->cpuDuration, frame->gpuDuration, 0.001});
+        const float rowHeight = ImGui::GetTextLineHeightWithSpacing();
+        const float labelWidth = 40.0f;
+        const ImVec2 origin = ImGui::GetCursorScreenPos();
+        const float width = std::max(ImGui::GetContentRegionAvail().x - labelWidth, 10.0f);
+        ImDrawList* drawList = ImGui::GetWindowDrawList();
+
+        // One lane for CPU and one for GPU, each with one row per nesting depth.
+        for (int lane = 0; lane < 2; lane++) {
+            const float laneY = origin.y + static_cast<float>(lane * (maxDepth + 1)) * rowHeight;
+            drawList->AddText(ImVec2(origin.x, laneY), IM_COL32(255, 255, 255, 255), lane == 0 ? "CPU" : "GPU");
+            for (const auto& r : frame->records) {
+                const double begin = lane == 0 ? r.cpuBegin : r.gpuBegin;
+                const double end = lane == 0 ? r.cpuEnd : r.gpuEnd;
+                if (begin < 0.0 || end < begin) {
+                    continue;
+                }
+                const ImVec2 p0(origin.x + labelWidth + static_cast<float>(begin / span) * width,
+                    laneY + static_cast<float>(r.depth) * rowHeight);
+                const ImVec2 p1(std::max(origin.x + labelWidth + static_cast<float>(end / span) * width, p0.x + 1.0f),
+                    p0.y + rowHeight - 1.0f);
+                drawList->AddRectFilled(p0, p1, scopeColor(r.name));
+                drawList->PushClipRect(p0, p1, true);
+                drawList->AddText(ImVec2(p0.x + 2.0f, p0.y), IM_COL32(0, 0, 0, 255), r.name);
+                drawList->PopClipRect();
+                if (ImGui::IsMouseHoveringRect(p0, p1)) {
+                    ImGui::SetTooltip("%s\nCPU: %.3f ms\nGPU: %.3f ms", r.name, r.cpuEnd - r.cpuBegin,
+                        r.gpuBegin >= 0.0 ? r.gpuEnd - r.gpuBegin : -1.0);
+                }
+            }
+        }
+        ImGui::Dummy(ImVec2(width + labelWidth, static_cast<float>(2 * (maxDepth + 1)) * rowHeight));
+
+        ImGui::Separator();
+        for (const auto& r : frame->records) {
+            ImGui::Text("%*s%-32s CPU %8.3f ms  GPU %8.3f ms", 2 * r.depth, "", r.name, r.cpuEnd - r.cpuBegin,
+                r.gpuBegin >= 0.0 ? r.gpuEnd - r.gpuBegin : -1.0);
+        }
+    }
+    ImGui::End();
+}
+
+void Profiler::exportChromeTrace(const std::filesystem::path& filename) const {
+    std::ofstream file(filename);
+    if (!file.is_open()) {
+        throw std::runtime_error("Cannot write trace file \"" + filename.string() + "\"!");
+    }
+
+    // Timestamps are in microseconds. GPU timestamps are aligned to the CPU begin of their frame.
+    file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":0,\"args\":{\"name\":\"CPU\"}},\n";
+    file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":1,\"args\":{\"name\":\"GPU\"}}";
+    for (const auto& frame : history_) {
+        file << ",\n{\"name\":\"Frame " << frame.frameNumber << "\",\"cat\":\"frame\",\"ph\":\"X\",\"pid\":0,\"tid\":0"
+             << ",\"ts\":" << frame.cpuStart * 1000.0 << ",\"dur\":" << frame.cpuDuration * 1000.0 << "}";
+        if (frame.gpuDuration >= 0.0) {
+            file << ",\n{\"name\":\"Frame " << frame.frameNumber << "\",\"cat\":\"frame\",\"ph\":\"X\",\"pid\":0"
+                 << ",\"tid\":1,\"ts\":" << frame.cpuStart * 1000.0 << ",\"dur\":" << frame.gpuDuration * 1000.0
+                 << "}";
+        }
+        for (const auto& r : frame.records) {
+            const std::string name = escapeJson(r.name);
+            file << ",\n{\"name\":\"" << name << "\",\"cat\":\"cpu\",\"ph\":\"X\",\"pid\":0,\"tid\":0,\"ts\":"
+                 << (frame.cpuStart + r.cpuBegin) * 1000.0 << ",\"dur\":" << (r.cpuEnd - r.cpuBegin) * 1000.0 << "}";
+            if (r.gpuBegin >= 0.0) {
+                file << ",\n{\"name\":\"" << name << "\",\"cat\":\"gpu\",\"ph\":\"X\",\"pid\":0,\"tid\":1,\"ts\":"
+                     << (frame.cpuStart + r.gpuBegin) * 1000.0 << ",\"dur\":" << (r.gpuEnd - r.gpuBegin) * 1000.0
+                     << "}";
+            }
+        }
+    }
+    file << "\n]}\n";
+}
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <vector>
+
+#include <glad/gl.h>
+
+namespace OGL4Core2::Core {
+    /**
+     * Hierarchical frame profiler. Named scopes record CPU time and GPU time. GPU time is measured with timestamp
+     * queries, which, in contrast to GL_TIME_ELAPSED queries, can be nested. Query results are read back a few frames
+     * later, only if they are already available, so the profiler never stalls the pipeline.
+     *
+     * Scopes must only be opened on the render thread and scope names must be string literals (or otherwise outlive
+     * the profiler), they are stored as plain pointers.
+     */
+    class Profiler {
+    public:
+        struct Record {
+            const char* name;
+            int depth;
+            double cpuBegin; //!< ms relative to frame begin
+            double cpuEnd;
+            double gpuBegin; //!< ms relative to GPU frame begin, negative if not available
+            double gpuEnd;
+        };
+
+        struct FrameData {
+            uint64_t frameNumber = 0;
+            double cpuStart = 0.0; //!< ms since profiler creation
+            double cpuDuration = 0.0;
+            double gpuDuration = -1.0;
+            std::vector<Record> records;
+        };
+
+        /**
+         * The trace file is written by the export button of the GUI, profile_trace.json if empty.
+         */
+        explicit Profiler(std::filesystem::path traceFilename = {});
+        ~Profiler();
+
+        Profiler(const Profiler&) = delete;
+        Profiler(Profiler&&) = delete;
+        Profiler& operator=(const Profiler&) = delete;
+        Profiler& operator=(Profiler&&) = delete;
+
+        inline void setEnabled(bool enabled) {
+            enabled_ = enabled;
+        }
+        [[nodiscard]] inline bool isEnabled() const {
+            return enabled_;
+        }
+
+        void beginFrame(uint64_t frameNumber);
+        void endFrame();
+
+        void beginScope(const char* name);
+        void endScope();
+
+        /**
+         * Latest frame with resolved GPU times, nullptr if there is none yet.
+         */
+        [[nodiscard]] const FrameData* getLatestFrame() const;
+
+        void drawGUI();
+
+        /**
+         * Write all frames in the history in Chrome trace event format (chrome://tracing, Perfetto).
+         */
+        void exportChromeTrace(const std::filesystem::path& filename) const;
+
+    private:
+        static constexpr std::size_t numFramesInFlight = 4;
+        static constexpr std::size_t maxScopesPerFrame = 256;
+        static constexpr std::size_t maxHistoryFrames = 600;
+
+        struct PendingFrame {
+            bool active = false;
+            bool gpuValid = true;
+            FrameData data;
+            std::vector<GLuint> queries; // 0: frame begin, 1: frame end, 2i+2 / 2i+3: scope i
+        };
+
+        void resolve(PendingFrame& frame, bool force);
+        [[nodiscard]] double now() const;
+
+        bool enabled_;
+        bool recording_;
+        std::chrono::steady_clock::time_point startTime_;
+        std::array<PendingFrame, numFramesInFlight> frames_;
+        std::size_t currentFrame_;
+        double frameStart_;
+        std::vector<std::size_t> scopeStack_;
+        std::deque<FrameData> history_;
+        bool showTimeline_;
+        std::filesystem::path traceFilename_;
+    };
+
+    /**
+     * RAII helper to profile the enclosing block.
+     */
+    class ProfileScope {
+    public:
+        ProfileScope(Profiler& profiler, const char* name) : profiler_(profiler) {
+            profiler_.beginScope(name);
+        }
+        ~ProfileScope() {
+            profiler_.endScope();
+        }
+
+        ProfileScope(const ProfileScope&) = delete;
+        ProfileScope(ProfileScope&&) = delete;
+        ProfileScope& operator=(const ProfileScope&) = delete;
+        ProfileScope& operator=(ProfileScope&&) = delete;
+
+    private:
+        Profiler& profiler_;
+    };
+} // namespace OGL4Core2::Core
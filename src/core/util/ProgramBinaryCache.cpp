@@ -0,0 +1,160 @@
+#include "ProgramBinaryCache.h"
+
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+
+#include "Hash.h"
+
+using namespace OGL4Core2::Core;
+
+static constexpr uint32_t fileMagic = 0x4250474F; // "OGPB"
+static constexpr uint64_t maxDriverLength = 4096;
+static constexpr uint64_t maxBinaryLength = uint64_t(256) * 1024 * 1024;
+
+std::filesystem::path ProgramBinaryCache::dir_;
+std::string ProgramBinaryCache::driver_;
+ProgramBinaryCache::Stats ProgramBinaryCache::stats_;
+
+namespace {
+    std::string glString(GLenum name) {
+        const auto* str = reinterpret_cast<const char*>(glGetString(name));
+        return str != nullptr ? str : "";
+    }
+} // namespace
+
+void ProgramBinaryCache::init(const std::filesystem::path& dir) {
+    dir_.clear();
+    if (dir.empty()) {
+        return;
+    }
+    GLint numFormats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &numFormats);
+    if (numFormats <= 0) {
+        std::cerr << "Program binary cache disabled, the driver does not support program binaries." << std::endl;
+        return;
+    }
+    std::error_code ec;
+    std::filesystem::create_directories(dir, ec);
+    if (ec) {
+        std::cerr << "Program binary cache disabled, cannot create \"" << dir.string() << "\": " << ec.message()
+                  << std::endl;
+        return;
+    }
+    dir_ = dir;
+    driver_ = glString(GL_VENDOR) + "\n" + glString(GL_RENDERER) + "\n" + glString(GL_VERSION);
+}
+
+bool ProgramBinaryCache::isEnabled() {
+    return !dir_.empty();
+}
+
+std::string ProgramBinaryCache::makeKey(const std::vector<std::pair<GLenum, const std::string*>>& shaders) {
+    Fnv1aHash hash;
+    hash.addString(driver_);
+    for (const auto& [type, source] : shaders) {
+        const uint32_t t = type;
+        hash.add(&t, sizeof(t));
+        hash.addString(*source);
+    }
+    char key[17];
+    std::snprintf(key, sizeof(key), "%016llx", static_cast<unsigned long long>(hash.value()));
+    return key;
+}
+
+bool ProgramBinaryCache::load(GLuint program, const std::string& key) {
+    if (!isEnabled()) {
+        return false;
+    }
+    const auto path = entryPath(key);
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        stats_.misses++;
+        return false;
+    }
+
+    uint32_t magic = 0;
+    uint32_t format = 0;
+    uint64_t driverLength = 0;
+    uint64_t length = 0;
+    file.read(reinterpret_cast<char*>(&magic), sizeof(magic));
+    file.read(reinterpret_cast<char*>(&format), sizeof(format));
+    file.read(reinterpret_cast<char*>(&driverLength), sizeof(driverLength));
+    std::string driver(file && driverLength <= maxDriverLength ? driverLength : 0, '\0');
+    file.read(driver.data(), static_cast<std::streamsize>(driver.size()));
+    file.read(reinterpret_cast<char*>(&length), sizeof(length));
+    std::vector<char> binary(file && length <= maxBinaryLength ? length : 0);
+    file.read(binary.data(), static_cast<std::streamsize>(binary.size()));
+
+    bool valid = file && magic == fileMagic && driver == driver_ && !binary.empty();
+    if (valid) {
+        glProgramBinary(program, format, binary.data(), static_cast<GLsizei>(binary.size()));
+        GLint status = GL_FALSE;
+        glGetProgramiv(program, GL_LINK_STATUS, &status);
+        valid = status == GL_TRUE;
+    }
+    if (!valid) {
+        // Stale or corrupt, it is replaced after building from source.
+        file.close();
+        std::error_code ec;
+        std::filesystem::remove(path, ec);
+        stats_.misses++;
+        return false;
+    }
+    stats_.hits++;
+    return true;
+}
+
+void ProgramBinaryCache::store(GLuint program, const std::string& key) {
+    if (!isEnabled()) {
+        return;
+    }
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0) {
+        return;
+    }
+    std::vector<char> binary(static_cast<std::size_t>(length));
+    GLenum format = 0;
+    glGetProgramBinary(program, length, &length, &format, binary.data());
+    binary.resize(static_cast<std::size_t>(length));
+
+    // Write to a temporary file first, so other instances never read partial files.
+    const auto path = entryPath(key);
+    auto tmpPath = path;
+    tmpPath += ".tmp";
+    {
+        std::ofstream file(tmpPath, std::ios::binary | std::ios::trunc);
+        if (!file.is_open()) {
+            return;
+        }
+        const uint32_t magic = fileMagic;
+        const uint32_t format32 = format;
+        const uint64_t driverLength = driver_.size();
+        const uint64_t binaryLength = binary.size();
+        file.write(reinterpret_cast<const char*>(&magic), sizeof(magic));
+        file.write(reinterpret_cast<const char*>(&format32), sizeof(format32));
+        file.write(reinterpret_cast<const char*>(&driverLength), sizeof(driverLength));
+        file.write(driver_.data(), static_cast<std::streamsize>(driver_.size()));
+        file.write(reinterpret_cast<const char*>(&binaryLength), sizeof(binaryLength));
+        file.write(binary.data(), static_cast<std::streamsize>(binary.size()));
+        if (!file) {
+            return;
+        }
+    }
+    std::error_code ec;
+    std::filesystem::rename(tmpPath, path, ec);
+    if (ec) {
+        std::filesystem::remove(tmpPath, ec);
+        return;
+    }
+    stats_.stores++;
+}
+
+ProgramBinaryCache::Stats ProgramBinaryCache::getStats() {
+    return stats_;
+}
+
+std::filesystem::path ProgramBinaryCache::entryPath(const std::string& key) {
+    return dir_ / (key + ".bin");
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <glad/gl.h>
+
+namespace OGL4Core2::Core {
+    /**
+     * On-disk cache of linked program binaries. Programs are keyed by a hash of their shader types and sources plus
+     * the driver vendor, renderer and version, so a driver update invalidates the cache. Loading a cached binary is
+     * much faster than compiling, which shortens the startup of plugins with many programs. Drivers may still reject
+     * a binary, callers must fall back to compiling from source if load() fails. Only used on the render thread.
+     */
+    class ProgramBinaryCache {
+    public:
+        struct Stats {
+            std::size_t hits = 0;
+            std::size_t misses = 0;
+            std::size_t stores = 0;
+        };
+
+        ProgramBinaryCache() = delete;
+        ~ProgramBinaryCache() = delete;
+        ProgramBinaryCache(const ProgramBinaryCache&) = delete;
+        ProgramBinaryCache(ProgramBinaryCache&&) = delete;
+        ProgramBinaryCache& operator=(const ProgramBinaryCache&) = delete;
+        ProgramBinaryCache& operator=(ProgramBinaryCache&&) = delete;
+
+        /**
+         * Enable the cache in the given directory, an empty path disables it. Requires a current OpenGL context, the
+         * cache stays disabled if the driver does not support any binary format.
+         */
+        static void init(const std::filesystem::path& dir);
+
+        [[nodiscard]] static bool isEnabled();
+
+        /**
+         * Key of a program built from the given shader types and sources.
+         */
+        [[nodiscard]] static std::string makeKey(const std::vector<std::pair<GLenum, const std::string*>>& shaders);
+
+        /**
+         * Load the cached binary into the program. Returns false, if there is no usable binary, the program then must
+         * be built from source.
+         */
+        static bool load(GLuint program, const std::string& key);
+
+        /**
+         * Store the binary of a linked program, which was created with the retrievable hint set.
+         */
+        static void store(GLuint program, const std::string& key);
+
+        [[nodiscard]] static Stats getStats();
+
+    private:
+        [[nodiscard]] static std::filesystem::path entryPath(const std::string& key);
+
+        static std::filesystem::path dir_;
+        static std::string driver_;
+        static Stats stats_;
+    };
+} // namespace OGL4Core2::Core
@@ -0,0 +1,111 @@
+#include "QualityController.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace OGL4Core2::Core;
+
+namespace {
+    // Weight of a new sample in the smoothed render time.
+    constexpr double smoothing = 0.25;
+    // Relative deviation from the target, which does not change the quality. Avoids flickering between levels.
+    constexpr double deadband = 0.05;
+    // Maximum relative quality change per frame.
+    constexpr float maxDecrease = 0.5f;
+    constexpr float maxIncrease = 1.25f;
+} // namespace
+
+QualityController::QualityController(double targetFrameTime, float minQuality)
+    : targetFrameTime_(targetFrameTime),
+      minQuality_(std::clamp(minQuality, lowestQuality, 1.0f)),
+      quality_(1.0f),
+      interactiveQuality_(1.0f),
+      costPerQuality_(-1.0),
+      currentMeasurement_(0) {}
+
+QualityController::~QualityController() {
+    for (auto& m : measurements_) {
+        if (m.queries[0] != 0) {
+            glDeleteQueries(static_cast<GLsizei>(m.queries.size()), m.queries.data());
+        }
+    }
+}
+
+void QualityController::interact() {
+    lastInteraction_ = std::chrono::steady_clock::now();
+}
+
+bool QualityController::isInteracting() const {
+    return std::chrono::steady_clock::now() - lastInteraction_ < idleDelay;
+}
+
+void QualityController::beginMeasure() {
+    currentMeasurement_ = (currentMeasurement_ + 1) % numFramesInFlight;
+    auto& m = measurements_[currentMeasurement_];
+    if (m.queries[0] == 0) {
+        glGenQueries(static_cast<GLsizei>(m.queries.size()), m.queries.data());
+    }
+    // A slot still in flight after numFramesInFlight frames is dropped, the queries are reused.
+    m.active = true;
+    m.quality = quality_;
+    measureStart_ = std::chrono::steady_clock::now();
+    glQueryCounter(m.queries[0], GL_TIMESTAMP);
+}
+
+void QualityController::endMeasure() {
+    auto& m = measurements_[currentMeasurement_];
+    glQueryCounter(m.queries[1], GL_TIMESTAMP);
+    m.cpuTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - measureStart_).count();
+}
+
+void QualityController::update() {
+    // Oldest first, so samples are added in frame order.
+    for (std::size_t i = 1; i <= numFramesInFlight; i++) {
+        auto& m = measurements_[(currentMeasurement_ + i) % numFramesInFlight];
+        if (!m.active) {
+            continue;
+        }
+        GLint available = 0;
+        glGetQueryObjectiv(m.queries[1], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (available == 0) {
+            continue;
+        }
+        GLuint64 begin = 0;
+        GLuint64 end = 0;
+        glGetQueryObjectui64v(m.queries[0], GL_QUERY_RESULT, &begin);
+        glGetQueryObjectui64v(m.queries[1], GL_QUERY_RESULT, &end);
+        m.active = false;
+        addSample(std::max(m.cpuTime, static_cast<double>(end - begin) * 1.0e-6), m.quality);
+    }
+
+    if (targetFrameTime_ <= 0.0) {
+        quality_ = 1.0f;
+        interactiveQuality_ = 1.0f;
+        return;
+    }
+    if (costPerQuality_ > 0.0) {
+        const double predicted = costPerQuality_ * interactiveQuality_;
+        if (std::abs(predicted - targetFrameTime_) > deadband * targetFrameTime_) {
+            const auto desired = static_cast<float>(targetFrameTime_ / costPerQuality_);
+            interactiveQuality_ = std::clamp(desired, interactiveQuality_ * maxDecrease,
+                interactiveQuality_ * maxIncrease);
+            interactiveQuality_ = std::clamp(interactiveQuality_, std::min(minQuality_, 1.0f), 1.0f);
+        }
+    }
+    // The interactive level is kept while idle, so the next interaction starts at the right level.
+    quality_ = isInteracting() ? interactiveQuality_ : 1.0f;
+}
+
+void QualityController::reset() {
+    for (auto& m : measurements_) {
+        m.active = false;
+    }
+    quality_ = 1.0f;
+    interactiveQuality_ = 1.0f;
+    costPerQuality_ = -1.0;
+}
+
+void QualityController::addSample(double frameTime, float quality) {
+    const double cost = frameTime / static_cast<double>(std::max(quality, 1.0e-3f));
+    costPerQuality_ = costPerQuality_ < 0.0 ? cost : costPerQuality_ + smoothing * (cost - costPerQuality_);
+}
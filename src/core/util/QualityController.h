@@ -0,0 +1,113 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+#include <glad/gl.h>
+
+namespace OGL4Core2::Core {
+    /**
+     * Adaptive quality controller. Measures the CPU and GPU time of the plugin rendering and, while the user is
+     * interacting, lowers the quality level passed to the plugin until the render time fits the target frame time.
+     * Once the input has been idle for a short time, the quality returns to 1 for a full quality frame.
+     *
+     * The plugin render time is assumed to scale linearly with the quality level (e.g. number of samples along a
+     * ray). Each measured frame gives an estimate of the render time per unit quality, smoothed over a few frames, so
+     * the controller converges in a few steps even though GPU times arrive a few frames late.
+     */
+    class QualityController {
+    public:
+        /**
+         * Lowest accepted minimum quality, shared by the command line and the GUI.
+         */
+        static constexpr float lowestQuality = 0.01f;
+
+        QualityController(double targetFrameTime, float minQuality);
+        ~QualityController();
+
+        QualityController(const QualityController&) = delete;
+        QualityController(QualityController&&) = delete;
+        QualityController& operator=(const QualityController&) = delete;
+        QualityController& operator=(QualityController&&) = delete;
+
+        /**
+         * Target plugin render time in ms, 0 disables the controller.
+         */
+        [[nodiscard]] inline double getTargetFrameTime() const {
+            return targetFrameTime_;
+        }
+        inline void setTargetFrameTime(double targetFrameTime) {
+            targetFrameTime_ = targetFrameTime;
+        }
+
+        [[nodiscard]] inline float getMinQuality() const {
+            return minQuality_;
+        }
+        inline void setMinQuality(float minQuality) {
+            minQuality_ = std::clamp(minQuality, lowestQuality, 1.0f);
+        }
+
+        /**
+         * Quality for the next frame in [minQuality, 1].
+         */
+        [[nodiscard]] inline float getQuality() const {
+            return quality_;
+        }
+
+        /**
+         * Smoothed plugin render time in ms, extrapolated to full quality. Negative until the first measurement.
+         */
+        [[nodiscard]] inline double getFullQualityFrameTime() const {
+            return costPerQuality_;
+        }
+
+        /**
+         * Report user input, which starts or extends the interaction.
+         */
+        void interact();
+
+        [[nodiscard]] bool isInteracting() const;
+
+        /**
+         * Enclose the plugin rendering of a frame.
+         */
+        void beginMeasure();
+        void endMeasure();
+
+        /**
+         * Read back available measurements and update the quality for the next frame. Never waits for the GPU.
+         */
+        void update();
+
+        /**
+         * Forget the render time estimate and measurements still in flight, e.g. when the plugin changes.
+         */
+        void reset();
+
+    private:
+        static constexpr std::size_t numFramesInFlight = 4;
+        static constexpr std::chrono::milliseconds idleDelay{300};
+
+        struct Measurement {
+            bool active = false;
+            std::array<GLuint, 2> queries{};
+            double cpuTime = 0.0;
+            float quality = 1.0f;
+        };
+
+        void addSample(double frameTime, float quality);
+
+        double targetFrameTime_;
+        float minQuality_;
+        float quality_;
+        float interactiveQuality_;
+        double costPerQuality_;
+        std::chrono::steady_clock::time_point lastInteraction_;
+        std::array<Measurement, numFramesInFlight> measurements_;
+        std::size_t currentMeasurement_;
+        std::chrono::steady_clock::time_point measureStart_;
+    };
+} // namespace OGL4Core2::Core
@@ -0,0 +1,113 @@
+#include "ReadOnlyFile.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN 1
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX 1
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace OGL4Core2::Core;
+
+#ifdef _WIN32
+
+ReadOnlyFile::ReadOnlyFile(const std::filesystem::path& filename) : filename_(filename), size_(0) {
+    handle_ = CreateFileW(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (handle_ == INVALID_HANDLE_VALUE) {
+        throw std::runtime_error("Cannot open file \"" + filename.string() + "\"!");
+    }
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(handle_, &size)) {
+        CloseHandle(handle_);
+        throw std::runtime_error("Cannot read size of file \"" + filename.string() + "\"!");
+    }
+    size_ = static_cast<std::size_t>(size.QuadPart);
+}
+
+ReadOnlyFile::~ReadOnlyFile() {
+    CloseHandle(handle_);
+}
+
+std::size_t ReadOnlyFile::readUpTo(unsigned char* dst, std::size_t offset, std::size_t size) const {
+    std::size_t total = 0;
+    while (total < size) {
+        // The offset of the OVERLAPPED struct makes this a positional read, also on a synchronous handle.
+        OVERLAPPED overlapped{};
+        overlapped.Offset = static_cast<DWORD>(offset + total);
+        overlapped.OffsetHigh = static_cast<DWORD>(static_cast<uint64_t>(offset + total) >> 32);
+        DWORD count = 0;
+        const auto request = static_cast<DWORD>(std::min<std::size_t>(size - total, 1u << 30));
+        if (!ReadFile(handle_, dst + total, request, &count, &overlapped)) {
+            // Positional reads at or beyond the end fail with ERROR_HANDLE_EOF instead of returning 0 bytes.
+            if (GetLastError() == ERROR_HANDLE_EOF) {
+                break;
+            }
+            throw std::runtime_error("Cannot read file \"" + filename_.string() + "\"!");
+        }
+        if (count == 0) {
+            break;
+        }
+        total += count;
+    }
+    return total;
+}
+
+#else
+
+ReadOnlyFile::ReadOnlyFile(const std::filesystem::path& filename) : filename_(filename), size_(0) {
+    fd_ = open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd_ < 0) {
+        throw std::runtime_error("Cannot open file \"" + filename.string() + "\": " + std::strerror(errno) + "!");
+    }
+    struct stat st {};
+    if (fstat(fd_, &st) != 0) {
+        close(fd_);
+        throw std::runtime_error("Cannot read size of file \"" + filename.string() + "\"!");
+    }
+    size_ = static_cast<std::size_t>(st.st_size);
+}
+
+ReadOnlyFile::~ReadOnlyFile() {
+    close(fd_);
+}
+
+std::size_t ReadOnlyFile::readUpTo(unsigned char* dst, std::size_t offset, std::size_t size) const {
+    std::size_t total = 0;
+    while (total < size) {
+        const ssize_t result = pread(fd_, dst + total, size - total, static_cast<off_t>(offset + total));
+        if (result < 0 && errno == EINTR) {
+            continue;
+        }
+        if (result < 0) {
+            throw std::runtime_error("Cannot read file \"" + filename_.string() + "\": " + std::strerror(errno) + "!");
+        }
+        if (result == 0) {
+            break;
+        }
+        total += static_cast<std::size_t>(result);
+    }
+    return total;
+}
+
+#endif
+
+void ReadOnlyFile::readAt(unsigned char* dst, std::size_t offset, std::size_t size) const {
+    if (readUpTo(dst, offset, size) != size) {
+        throw std::runtime_error("Cannot read file \"" + filename_.string() + "\": unexpected end of file!");
+    }
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+
+namespace OGL4Core2::Core {
+    /**
+     * Read-only file for positional reads, which may be issued from several threads at once. Unlike MappedFile, the
+     * data is copied into the caller's buffer, so only the buffers count towards the memory use of the process.
+     */
+    class ReadOnlyFile {
+    public:
+        explicit ReadOnlyFile(const std::filesystem::path& filename);
+        ~ReadOnlyFile();
+
+        ReadOnlyFile(const ReadOnlyFile&) = delete;
+        ReadOnlyFile(ReadOnlyFile&&) = delete;
+        ReadOnlyFile& operator=(const ReadOnlyFile&) = delete;
+        ReadOnlyFile& operator=(ReadOnlyFile&&) = delete;
+
+        /**
+         * Read exactly size bytes at offset, throws on errors and at the end of the file.
+         */
+        void readAt(unsigned char* dst, std::size_t offset, std::size_t size) const;
+
+        /**
+         * Read up to size bytes at offset and return the number of bytes read, which is only less than size at the
+         * end of the file, e.g. 0 at or beyond it. Throws on errors.
+         */
+        std::size_t readUpTo(unsigned char* dst, std::size_t offset, std::size_t size) const;
+
+        [[nodiscard]] inline std::size_t size() const {
+            return size_;
+        }
+
+#ifndef _WIN32
+        [[nodiscard]] inline int fd() const {
+            return fd_;
+        }
+#endif
+
+    private:
+        std::filesystem::path filename_;
+        std::size_t size_;
+#ifdef _WIN32
+        void* handle_;
+#else
+        int fd_;
+#endif
+    };
+} // namespace OGL4Core2::Core
@@ -0,0 +1,82 @@
+#include "RenderTarget.h"
+
+#include <stdexcept>
+
+using namespace OGL4Core2::Core;
+
+RenderTarget::RenderTarget(int width, int height)
+    : width_(width),
+      height_(height),
+      fbo_(0),
+      colorTex_(0),
+      depthTex_(0),
+      memory_("Render target", MemoryCategory::Framebuffer, MemoryLocation::Gpu, 0, "Core") {
+    create();
+}
+
+RenderTarget::~RenderTarget() {
+    destroy();
+}
+
+void RenderTarget::resize(int width, int height) {
+    if (width == width_ && height == height_) {
+        return;
+    }
+    destroy();
+    width_ = width;
+    height_ = height;
+    create();
+}
+
+void RenderTarget::bind() const {
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo_);
+}
+
+void RenderTarget::create() {
+    if (width_ <= 0 || height_ <= 0) {
+        throw std::runtime_error("Invalid render target size!");
+    }
+
+    glGenTextures(1, &colorTex_);
+    glBindTexture(GL_TEXTURE_2D, colorTex_);
+    glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA8, width_, height_);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+    glGenTextures(1, &depthTex_);
+    glBindTexture(GL_TEXTURE_2D, depthTex_);
+    glTexStorage2D(GL_TEXTURE_2D, 1, GL_DEPTH24_STENCIL8, width_, height_);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    glGenFramebuffers(1, &fbo_);
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo_);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, colorTex_, 0);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_TEXTURE_2D, depthTex_, 0);
+    const GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    if (status != GL_FRAMEBUFFER_COMPLETE) {
+        destroy();
+        throw std::runtime_error("Render target framebuffer is not complete!");
+    }
+    memory_.resize(MemoryTracker::textureBytes(GL_RGBA8, width_, height_) +
+                   MemoryTracker::textureBytes(GL_DEPTH24_STENCIL8, width_, height_));
+}
+
+void RenderTarget::destroy() {
+    if (fbo_ != 0) {
+        glDeleteFramebuffers(1, &fbo_);
+        fbo_ = 0;
+    }
+    if (colorTex_ != 0) {
+        glDeleteTextures(1, &colorTex_);
+        colorTex_ = 0;
+    }
+    if (depthTex_ != 0) {
+        glDeleteTextures(1, &depthTex_);
+        depthTex_ = 0;
+    }
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <glad/gl.h>
+
+#include "MemoryTracker.h"
+
+namespace OGL4Core2::Core {
+    /**
+     * Framebuffer object with a RGBA8 color and a depth/stencil texture attachment. Used by the core as offscreen
+     * replacement of the default framebuffer.
+     */
+    class RenderTarget {
+    public:
+        RenderTarget(int width, int height);
+        ~RenderTarget();
+
+        RenderTarget(const RenderTarget&) = delete;
+        RenderTarget(RenderTarget&&) = delete;
+        RenderTarget& operator=(const RenderTarget&) = delete;
+        RenderTarget& operator=(RenderTarget&&) = delete;
+
+        void resize(int width, int height);
+
+        void bind() const;
+
+        [[nodiscard]] inline GLuint fbo() const {
+            return fbo_;
+        }
+        [[nodiscard]] inline GLuint colorTex() const {
+            return colorTex_;
+        }
+        [[nodiscard]] inline int width() const {
+            return width_;
+        }
+        [[nodiscard]] inline int height() const {
+            return height_;
+        }
+
+    private:
+        void create();
+        void destroy();
+
+        int width_;
+        int height_;
+        GLuint fbo_;
+        GLuint colorTex_;
+        GLuint depthTex_;
+        TrackedMemory memory_;
+    };
+} // namespace OGL4Core2::Core
@@ -0,0 +1,336 @@
+#include "ResourceArchive.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <utility>
+
+#include <lodepng.h>
+
+#include "Hash.h"
+#include "MappedFile.h"
+
+using namespace OGL4Core2::Core;
+
+static constexpr char archiveMagic[8] = {'O', 'G', 'L', '4', 'P', 'A', 'K', '\0'};
+static constexpr uint32_t archiveVersion = 1;
+static constexpr uint64_t dataAlignment = 64;
+static constexpr uint32_t noEntry = 0xFFFFFFFFu;
+
+enum class Compression : uint32_t {
+    None = 0,
+    Zlib = 1,
+};
+
+// All platforms we build for are little endian, the structs are written and mapped as they are.
+struct ResourceArchive::Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t numEntries;
+    uint32_t numBuckets;
+    uint32_t reserved;
+    uint64_t entriesOffset;
+    uint64_t bucketsOffset;
+    uint64_t namesOffset;
+    uint64_t namesSize;
+};
+
+struct ResourceArchive::Entry {
+    uint64_t hash;
+    uint64_t offset;
+    uint64_t size;
+    uint64_t storedSize;
+    uint32_t nameOffset;
+    uint32_t nameLength;
+    uint32_t compression;
+    uint32_t next; // next entry within the same hash bucket
+};
+
+namespace {
+    uint64_t alignUp(uint64_t value, uint64_t alignment) {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+
+    bool isCompressedFormat(const std::filesystem::path& path) {
+        std::string ext = path.extension().string();
+        std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) { return std::tolower(c); });
+        return ext == ".png" || ext == ".jpg" || ext == ".jpeg" || ext == ".gz" || ext == ".zip";
+    }
+
+    std::vector<unsigned char> readFile(const std::filesystem::path& path) {
+        std::ifstream file(path, std::ios::binary | std::ios::ate);
+        if (!file.is_open()) {
+            throw std::runtime_error("Cannot read file \"" + path.string() + "\"!");
+        }
+        std::vector<unsigned char> data(static_cast<std::size_t>(file.tellg()));
+        file.seekg(0);
+        file.read(reinterpret_cast<char*>(data.data()), static_cast<std::streamsize>(data.size()));
+        if (!file) {
+            throw std::runtime_error("Cannot read file \"" + path.string() + "\"!");
+        }
+        return data;
+    }
+} // namespace
+
+ResourceArchive::ResourceArchive(std::filesystem::path filename)
+    : filename_(std::move(filename)),
+      mtime_(0),
+      header_(nullptr),
+      entries_(nullptr),
+      buckets_(nullptr),
+      names_(nullptr) {
+    static_assert(sizeof(Header) == 56 && sizeof(Entry) == 48, "Archive structs must not contain padding!");
+
+    file_ = std::make_shared<MappedFile>(filename_);
+    const auto invalid = [this]() {
+        return std::runtime_error("Invalid resource archive \"" + filename_.string() + "\"!");
+    };
+
+    const std::size_t fileSize = file_->size();
+    if (fileSize < sizeof(Header)) {
+        throw invalid();
+    }
+    header_ = reinterpret_cast<const Header*>(file_->data());
+    if (std::memcmp(header_->magic, archiveMagic, sizeof(archiveMagic)) != 0 || header_->version != archiveVersion) {
+        throw invalid();
+    }
+    const uint64_t entriesEnd = header_->entriesOffset + uint64_t(header_->numEntries) * sizeof(Entry);
+    const uint64_t bucketsEnd = header_->bucketsOffset + uint64_t(header_->numBuckets) * sizeof(uint32_t);
+    if (header_->entriesOffset % alignof(Entry) != 0 || header_->bucketsOffset % alignof(uint32_t) != 0 ||
+        entriesEnd > fileSize || bucketsEnd > fileSize || header_->namesOffset + header_->namesSize > fileSize ||
+        header_->numBuckets == 0 || (header_->numBuckets & (header_->numBuckets - 1)) != 0) {
+        throw invalid();
+    }
+    entries_ = reinterpret_cast<const Entry*>(file_->data() + header_->entriesOffset);
+    buckets_ = reinterpret_cast<const uint32_t*>(file_->data() + header_->bucketsOffset);
+    names_ = reinterpret_cast<const char*>(file_->data() + header_->namesOffset);
+
+    // Validate once, so lookups do not need any range checks.
+    for (uint32_t i = 0; i < header_->numEntries; i++) {
+        const Entry& entry = entries_[i];
+        if (entry.offset + entry.storedSize > fileSize ||
+            uint64_t(entry.nameOffset) + entry.nameLength > header_->namesSize ||
+            (entry.next != noEntry && entry.next >= header_->numEntries) ||
+            (entry.compression != static_cast<uint32_t>(Compression::None) &&
+                entry.compression != static_cast<uint32_t>(Compression::Zlib))) {
+            throw invalid();
+        }
+    }
+    // Each entry is in exactly one bucket chain, an entry reached twice means a chain loops or chains are merged.
+    std::vector<bool> visited(header_->numEntries, false);
+    for (uint32_t i = 0; i < header_->numBuckets; i++) {
+        for (uint32_t idx = buckets_[i]; idx != noEntry; idx = entries_[idx].next) {
+            if (idx >= header_->numEntries || visited[idx]) {
+                throw invalid();
+            }
+            visited[idx] = true;
+        }
+    }
+
+    std::error_code ec;
+    const auto mtime = std::filesystem::last_write_time(filename_, ec);
+    mtime_ = ec ? 0 : static_cast<int64_t>(mtime.time_since_epoch().count());
+}
+
+ResourceArchive::~ResourceArchive() = default;
+
+bool ResourceArchive::contains(std::string_view name) const {
+    return find(name) != nullptr;
+}
+
+bool ResourceArchive::containsDir(std::string_view name) const {
+    if (name.empty()) {
+        return true;
+    }
+    for (uint32_t i = 0; i < header_->numEntries; i++) {
+        const auto entry = entryName(entries_[i]);
+        if (entry.size() > name.size() && entry[name.size()] == '/' && entry.compare(0, name.size(), name) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+std::size_t ResourceArchive::getSize(std::string_view name) const {
+    const Entry* entry = find(name);
+    if (entry == nullptr) {
+        throw std::runtime_error("Resource \"" + std::string(name) + "\" not found in archive!");
+    }
+    return static_cast<std::size_t>(entry->size);
+}
+
+ResourceView ResourceArchive::get(std::string_view name) const {
+    const Entry* entry = find(name);
+    if (entry == nullptr) {
+        throw std::runtime_error("Resource \"" + std::string(name) + "\" not found in archive!");
+    }
+    const unsigned char* stored = file_->data() + entry->offset;
+    if (entry->compression == static_cast<uint32_t>(Compression::None)) {
+        return ResourceView{file_, stored, static_cast<std::size_t>(entry->size)};
+    }
+
+    unsigned char* out = nullptr;
+    std::size_t outSize = 0;
+    const unsigned error = lodepng_zlib_decompress(&out, &outSize, stored, static_cast<std::size_t>(entry->storedSize),
+        &lodepng_default_decompress_settings);
+    std::shared_ptr<unsigned char> buffer(out, std::free);
+    if (error != 0 || outSize != entry->size) {
+        throw std::runtime_error("Cannot decompress resource \"" + std::string(name) + "\"!");
+    }
+    return ResourceView{buffer, buffer.get(), outSize};
+}
+
+std::vector<std::string> ResourceArchive::list(std::string_view dir) const {
+    std::vector<std::string> files;
+    const std::size_t prefixLength = dir.empty() ? 0 : dir.size() + 1;
+    for (uint32_t i = 0; i < header_->numEntries; i++) {
+        const auto name = entryName(entries_[i]);
+        if (!dir.empty() &&
+            (name.size() <= prefixLength || name[dir.size()] != '/' || name.compare(0, dir.size(), dir) != 0)) {
+            continue;
+        }
+        const auto filename = name.substr(prefixLength);
+        if (filename.find('/') == std::string_view::npos) {
+            files.emplace_back(filename);
+        }
+    }
+    std::sort(files.begin(), files.end());
+    return files;
+}
+
+const ResourceArchive::Entry* ResourceArchive::find(std::string_view name) const {
+    const uint64_t hash = Fnv1aHash::hash(name);
+    uint32_t idx = buckets_[hash & (header_->numBuckets - 1)];
+    while (idx != noEntry) {
+        const Entry& entry = entries_[idx];
+        if (entry.hash == hash && entryName(entry) == name) {
+            return &entry;
+        }
+        idx = entry.next;
+    }
+    return nullptr;
+}
+
+std::string_view ResourceArchive::entryName(const Entry& entry) const {
+    return {names_ + entry.nameOffset, entry.nameLength};
+}
+
+void ResourceArchive::pack(const std::filesystem::path& dir, const std::filesystem::path& filename,
+    const PackOptions& options) {
+    struct PackEntry {
+        std::filesystem::path path;
+        std::string name;
+        Entry entry;
+        std::vector<unsigned char> compressed;
+    };
+
+    std::vector<PackEntry> files;
+    for (const auto& dirEntry : std::filesystem::recursive_directory_iterator(dir)) {
+        if (dirEntry.is_regular_file()) {
+            files.push_back({dirEntry.path(), dirEntry.path().lexically_relative(dir).generic_string(), {}, {}});
+        }
+    }
+    // Deterministic output, independent of directory iteration order.
+    std::sort(files.begin(), files.end(), [](const auto& a, const auto& b) { return a.name < b.name; });
+    if (files.size() >= noEntry) {
+        throw std::runtime_error("Too many files for a resource archive!");
+    }
+
+    uint32_t numBuckets = 1;
+    while (numBuckets < 2 * files.size()) {
+        numBuckets *= 2;
+    }
+    std::vector<uint32_t> buckets(numBuckets, noEntry);
+    std::string names;
+
+    Header header{};
+    std::memcpy(header.magic, archiveMagic, sizeof(archiveMagic));
+    header.version = archiveVersion;
+    header.numEntries = static_cast<uint32_t>(files.size());
+    header.numBuckets = numBuckets;
+    header.entriesOffset = sizeof(Header);
+    header.bucketsOffset = header.entriesOffset + files.size() * sizeof(Entry);
+    header.namesOffset = header.bucketsOffset + numBuckets * sizeof(uint32_t);
+    for (const auto& file : files) {
+        names += file.name;
+    }
+    header.namesSize = names.size();
+
+    uint64_t offset = alignUp(header.namesOffset + header.namesSize, dataAlignment);
+    uint32_t nameOffset = 0;
+    for (uint32_t i = 0; i < files.size(); i++) {
+        auto& file = files[i];
+        Entry& entry = file.entry;
+        entry.hash = Fnv1aHash::hash(file.name);
+        entry.size = std::filesystem::file_size(file.path);
+        entry.storedSize = entry.size;
+        entry.compression = static_cast<uint32_t>(Compression::None);
+        entry.nameOffset = nameOffset;
+        entry.nameLength = static_cast<uint32_t>(file.name.size());
+        nameOffset += entry.nameLength;
+
+        if (options.compress && entry.size >= options.compressMinSize && entry.size <= options.compressMaxSize &&
+            !isCompressedFormat(file.path)) {
+            const auto data = readFile(file.path);
+            unsigned char* compressed = nullptr;
+            std::size_t compressedSize = 0;
+            const unsigned error = lodepng_zlib_compress(&compressed, &compressedSize, data.data(), data.size(),
+                &lodepng_default_compress_settings);
+            std::unique_ptr<unsigned char, decltype(&std::free)> buffer(compressed, std::free);
+            // Only worth the decompression on access, if it saves a relevant amount of space.
+            if (error == 0 && compressedSize < data.size() - data.size() / 10) {
+                file.compressed.assign(compressed, compressed + compressedSize);
+                entry.storedSize = compressedSize;
+                entry.compression = static_cast<uint32_t>(Compression::Zlib);
+            }
+        }
+
+        entry.offset = offset;
+        offset = alignUp(offset + entry.storedSize, dataAlignment);
+
+        // Chain in front of the bucket.
+        const uint32_t bucket = static_cast<uint32_t>(entry.hash & (numBuckets - 1));
+        entry.next = buckets[bucket];
+        buckets[bucket] = i;
+    }
+
+    std::ofstream out(filename, std::ios::binary | std::ios::trunc);
+    if (!out.is_open()) {
+        throw std::runtime_error("Cannot write resource archive \"" + filename.string() + "\"!");
+    }
+    uint64_t written = 0;
+    const auto write = [&out, &written](const void* data, std::size_t size) {
+        out.write(static_cast<const char*>(data), static_cast<std::streamsize>(size));
+        written += size;
+    };
+    const auto pad = [&write, &written](uint64_t target) {
+        static constexpr char zeros[dataAlignment] = {};
+        while (written < target) {
+            write(zeros, static_cast<std::size_t>(std::min<uint64_t>(target - written, dataAlignment)));
+        }
+    };
+
+    write(&header, sizeof(header));
+    for (const auto& file : files) {
+        write(&file.entry, sizeof(Entry));
+    }
+    write(buckets.data(), buckets.size() * sizeof(uint32_t));
+    write(names.data(), names.size());
+    for (const auto& file : files) {
+        pad(file.entry.offset);
+        if (file.entry.compression == static_cast<uint32_t>(Compression::Zlib)) {
+            write(file.compressed.data(), file.compressed.size());
+        } else if (file.entry.size > 0) {
+            // Large files are streamed, not held in memory.
+            std::ifstream in(file.path, std::ios::binary);
+            out << in.rdbuf();
+            written += file.entry.size;
+        }
+    }
+    if (!out) {
+        throw std::runtime_error("Cannot write resource archive \"" + filename.string() + "\"!");
+    }
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace OGL4Core2::Core {
+    class MappedFile;
+
+    /**
+     * View of resource data. Data of uncompressed archive entries points directly into the memory mapped archive, the
+     * owner keeps the mapping alive as long as the view exists.
+     */
+    struct ResourceView {
+        std::shared_ptr<const void> owner;
+        const unsigned char* data = nullptr;
+        std::size_t size = 0;
+
+        [[nodiscard]] inline std::string_view str() const {
+            return {reinterpret_cast<const char*>(data), size};
+        }
+    };
+
+    /**
+     * Packed archive of all files within a plugin resources directory, created at build time with the
+     * OGL4Core2ResourcePacker tool. The archive is memory mapped, looking up a resource is a hash table lookup
+     * without any file system access. Entries are aligned to 64 bytes. Compressible entries of moderate size are
+     * stored zlib compressed, these are decompressed on access.
+     *
+     * Layout (little endian): header, entry table, hash buckets (first entry index per bucket, chained through the
+     * entries), names, entry data.
+     */
+    class ResourceArchive {
+    public:
+        struct PackOptions {
+            bool compress = true;
+            std::size_t compressMinSize = 1024;
+            std::size_t compressMaxSize = 16 * 1024 * 1024;
+        };
+
+        /**
+         * Open and validate an archive. Throws if the file is not a valid archive.
+         */
+        explicit ResourceArchive(std::filesystem::path filename);
+        ~ResourceArchive();
+
+        ResourceArchive(const ResourceArchive&) = delete;
+        ResourceArchive(ResourceArchive&&) = delete;
+        ResourceArchive& operator=(const ResourceArchive&) = delete;
+        ResourceArchive& operator=(ResourceArchive&&) = delete;
+
+        /**
+         * Pack all regular files below dir into a new archive.
+         */
+        static void pack(const std::filesystem::path& dir, const std::filesystem::path& filename,
+            const PackOptions& options);
+
+        [[nodiscard]] inline const std::filesystem::path& getFilename() const {
+            return filename_;
+        }
+
+        /**
+         * Modification time of the archive file, taken when it was opened.
+         */
+        [[nodiscard]] inline int64_t getModificationTime() const {
+            return mtime_;
+        }
+
+        /**
+         * Names are relative to the resources dir, using '/' as separator.
+         */
+        [[nodiscard]] bool contains(std::string_view name) const;
+        [[nodiscard]] bool containsDir(std::string_view name) const;
+
+        /**
+         * Uncompressed size of an entry, throws if the entry does not exist.
+         */
+        [[nodiscard]] std::size_t getSize(std::string_view name) const;
+
+        /**
+         * Entry data, throws if the entry does not exist.
+         */
+        [[nodiscard]] ResourceView get(std::string_view name) const;
+
+        /**
+         * Names of the files directly within the given dir, sorted.
+         */
+        [[nodiscard]] std::vector<std::string> list(std::string_view dir) const;
+
+    private:
+        struct Header;
+        struct Entry;
+
+        [[nodiscard]] const Entry* find(std::string_view name) const;
+        [[nodiscard]] std::string_view entryName(const Entry& entry) const;
+
+        std::filesystem::path filename_;
+        int64_t mtime_;
+        std::shared_ptr<MappedFile> file_;
+        const Header* header_;
+        const Entry* entries_;
+        const uint32_t* buckets_;
+        const char* names_;
+    };
+} // namespace OGL4Core2::Core
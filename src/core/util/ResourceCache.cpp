@@ -0,0 +1,174 @@
+#include "ResourceCache.h"
+
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <stdexcept>
+#include <utility>
+
+#include "ImageUtil.h"
+#include "ResourceArchive.h"
+
+using namespace OGL4Core2::Core;
+
+std::mutex ResourceCache::mutex_;
+ResourceCache::EntryList ResourceCache::entries_;
+std::unordered_map<std::string, ResourceCache::EntryList::iterator> ResourceCache::index_;
+ResourceCache::Stats ResourceCache::stats_{0, 0, 0, 0, 0, defaultCapacityMiB * 1024 * 1024};
+
+std::shared_ptr<const std::string> ResourceCache::getText(const std::filesystem::path& path) {
+    const Key key = makeKey(Kind::Text, path);
+    if (auto cached = find(key)) {
+        return std::static_pointer_cast<const std::string>(cached);
+    }
+
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        throw std::runtime_error("Cannot read resource file \"" + path.string() + "\"!");
+    }
+    std::stringstream buffer;
+    buffer << file.rdbuf();
+    auto text = std::make_shared<const std::string>(buffer.str());
+
+    insert(key, text, text->size());
+    return text;
+}
+
+std::shared_ptr<const std::vector<unsigned char>> ResourceCache::getBinary(const std::filesystem::path& path) {
+    const Key key = makeKey(Kind::Binary, path);
+    if (auto cached = find(key)) {
+        return std::static_pointer_cast<const std::vector<unsigned char>>(cached);
+    }
+
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        throw std::runtime_error("Cannot read resource file \"" + path.string() + "\"!");
+    }
+    auto data = std::make_shared<const std::vector<unsigned char>>(std::istreambuf_iterator<char>(file),
+        std::istreambuf_iterator<char>());
+
+    insert(key, data, data->size());
+    return data;
+}
+
+std::shared_ptr<const ResourceCache::Image> ResourceCache::getPng(const std::filesystem::path& path) {
+    const Key key = makeKey(Kind::Png, path);
+    if (auto cached = find(key)) {
+        return std::static_pointer_cast<const Image>(cached);
+    }
+
+    auto image = std::make_shared<Image>();
+    image->data = ImageUtil::loadPngImage(path, image->width, image->height);
+
+    insert(key, image, image->data.size());
+    return image;
+}
+
+std::shared_ptr<const ResourceCache::Image> ResourceCache::getPng(const ResourceArchive& archive,
+    const std::string& name) {
+    // No file system access, the archive is immutable while it is open.
+    const Key key{Kind::Png, archive.getFilename().string() + "|" + name, archive.getModificationTime()};
+    if (auto cached = find(key)) {
+        return std::static_pointer_cast<const Image>(cached);
+    }
+
+    const auto view = archive.get(name);
+    auto image = std::make_shared<Image>();
+    image->data = ImageUtil::loadPngImage(view.data, view.size, image->width, image->height);
+
+    insert(key, image, image->data.size());
+    return image;
+}
+
+void ResourceCache::setCapacity(std::size_t bytes) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stats_.capacity = bytes;
+    evict(bytes);
+}
+
+void ResourceCache::clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    evict(0);
+}
+
+ResourceCache::Stats ResourceCache::getStats() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+}
+
+ResourceCache::Key ResourceCache::makeKey(Kind kind, const std::filesystem::path& path) {
+    // Lookups happen for every resource load, so the key costs a single stat call. The path is normalized without
+    // file system access. Errors are handled by the loader, the key just will not match a cached entry.
+    std::error_code ec;
+    auto normalized = std::filesystem::absolute(path, ec).lexically_normal();
+    if (ec) {
+        normalized = path;
+    }
+    const auto mtime = std::filesystem::last_write_time(path, ec);
+    return Key{kind, normalized.string(), ec ? -1 : static_cast<int64_t>(mtime.time_since_epoch().count())};
+}
+
+std::string ResourceCache::lookupName(const Key& key) {
+    switch (key.kind) {
+        case Kind::Text:
+            return "text:" + key.path;
+        case Kind::Binary:
+            return "binary:" + key.path;
+        default:
+            return "png:" + key.path;
+    }
+}
+
+std::shared_ptr<const void> ResourceCache::find(const Key& key) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = index_.find(lookupName(key));
+    if (it == index_.end()) {
+        stats_.misses++;
+        return nullptr;
+    }
+    auto entry = it->second;
+    if (entry->key.mtime != key.mtime) {
+        // File has changed on disk.
+        stats_.bytes -= entry->bytes;
+        stats_.entries--;
+        entries_.erase(entry);
+        index_.erase(it);
+        stats_.misses++;
+        return nullptr;
+    }
+    entries_.splice(entries_.begin(), entries_, entry);
+    stats_.hits++;
+    return entry->data;
+}
+
+void ResourceCache::insert(const Key& key, std::shared_ptr<const void> data, std::size_t bytes) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (key.mtime < 0 || bytes > stats_.capacity) {
+        return;
+    }
+    const std::string name = lookupName(key);
+    auto it = index_.find(name);
+    if (it != index_.end()) {
+        // Loaded concurrently by another thread.
+        stats_.bytes -= it->second->bytes;
+        stats_.entries--;
+        entries_.erase(it->second);
+        index_.erase(it);
+    }
+    evict(stats_.capacity - bytes);
+    entries_.push_front(Entry{key, std::move(data), bytes});
+    index_[name] = entries_.begin();
+    stats_.bytes += bytes;
+    stats_.entries++;
+}
+
+void ResourceCache::evict(std::size_t capacity) {
+    while (!entries_.empty() && stats_.bytes > capacity) {
+        const Entry& entry = entries_.back();
+        stats_.bytes -= entry.bytes;
+        stats_.entries--;
+        stats_.evictions++;
+        index_.erase(lookupName(entry.key));
+        entries_.pop_back();
+    }
+}
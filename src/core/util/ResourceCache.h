@@ -0,0 +1,101 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace OGL4Core2::Core {
+    class ResourceArchive;
+
+    /**
+     * Process-wide cache for file contents and decoded images. Entries are keyed by path and modification time, so a
+     * changed file is loaded again, while unchanged files are served from memory, e.g. when switching between plugins
+     * or reloading shaders. The cache is bounded in memory, least recently used entries are evicted
+     * first. Returned data is shared, it stays valid after eviction as long as it is referenced.
+     */
+    class ResourceCache {
+    public:
+        struct Image {
+            std::vector<unsigned char> data; //!< RGBA8, bottom row first
+            int width = 0;
+            int height = 0;
+        };
+
+        // Memory bound until setCapacity() is called, also the default of the core configuration.
+        static constexpr std::size_t defaultCapacityMiB = 256;
+
+        struct Stats {
+            std::size_t hits = 0;
+            std::size_t misses = 0;
+            std::size_t evictions = 0;
+            std::size_t entries = 0;
+            std::size_t bytes = 0;
+            std::size_t capacity = 0;
+        };
+
+        ResourceCache() = delete;
+        ~ResourceCache() = delete;
+        ResourceCache(const ResourceCache&) = delete;
+        ResourceCache(ResourceCache&&) = delete;
+        ResourceCache& operator=(const ResourceCache&) = delete;
+        ResourceCache& operator=(ResourceCache&&) = delete;
+
+        [[nodiscard]] static std::shared_ptr<const std::string> getText(const std::filesystem::path& path);
+
+        /**
+         * File contents read in binary mode, unlike getText() without any line ending conversion.
+         */
+        [[nodiscard]] static std::shared_ptr<const std::vector<unsigned char>> getBinary(
+            const std::filesystem::path& path);
+        [[nodiscard]] static std::shared_ptr<const Image> getPng(const std::filesystem::path& path);
+
+        /**
+         * Decoded PNG from a resource archive, keyed by the archive file and the entry name.
+         */
+        [[nodiscard]] static std::shared_ptr<const Image> getPng(const ResourceArchive& archive,
+            const std::string& name);
+
+        /**
+         * Set the memory bound in bytes, 0 disables caching.
+         */
+        static void setCapacity(std::size_t bytes);
+
+        static void clear();
+
+        [[nodiscard]] static Stats getStats();
+
+    private:
+        enum class Kind { Text, Binary, Png };
+
+        struct Key {
+            Kind kind;
+            std::string path;
+            int64_t mtime;
+        };
+
+        struct Entry {
+            Key key;
+            std::shared_ptr<const void> data;
+            std::size_t bytes;
+        };
+
+        using EntryList = std::list<Entry>;
+
+        [[nodiscard]] static Key makeKey(Kind kind, const std::filesystem::path& path);
+        [[nodiscard]] static std::string lookupName(const Key& key);
+        static std::shared_ptr<const void> find(const Key& key);
+        static void insert(const Key& key, std::shared_ptr<const void> data, std::size_t bytes);
+        static void evict(std::size_t capacity);
+
+        static std::mutex mutex_;
+        static EntryList entries_; // front is most recently used
+        static std::unordered_map<std::string, EntryList::iterator> index_;
+        static Stats stats_;
+    };
+} // namespace OGL4Core2::Core
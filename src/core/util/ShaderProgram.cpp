@@ -0,0 +1,304 @@
+#include "ShaderProgram.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+
+#include <glm/gtc/type_ptr.hpp>
+
+#include "Log.h"
+#include "ProgramBinaryCache.h"
+#include "ResourceCache.h"
+
+using namespace OGL4Core2::Core;
+
+// GL_KHR_parallel_shader_compile and GL_ARB_parallel_shader_compile, not part of the generated core profile loader.
+static constexpr GLenum GL_COMPLETION_STATUS = 0x91B1;
+using MaxShaderCompilerThreadsProc = void(GLAPIENTRY*)(GLuint count);
+
+bool ShaderProgram::parallelCompile_ = false;
+
+ShaderProgram::ShaderProgram(ShaderFileList files, std::string label, SourceLoader loader)
+    : files_(std::move(files)),
+      label_(std::move(label)),
+      loader_(std::move(loader)),
+      program_(0) {
+    if (files_.empty()) {
+        throw std::runtime_error("Shader program \"" + label_ + "\" has no shaders!");
+    }
+    for (const auto& file : files_) {
+        std::error_code ec;
+        auto canonical = std::filesystem::weakly_canonical(file.path, ec);
+        canonicalPaths_.push_back(ec ? file.path : canonical);
+    }
+
+    Build build = startBuild();
+    std::string log;
+    if (!finishBuild(build, log)) {
+        throw std::runtime_error("Cannot build shader program \"" + label_ + "\"!\n" + log);
+    }
+    program_ = build.program;
+}
+
+ShaderProgram::~ShaderProgram() {
+    deleteBuild(pending_);
+    glDeleteProgram(program_);
+}
+
+void ShaderProgram::initParallelCompile(GLADloadfunc load) {
+    GLint numExtensions = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &numExtensions);
+    const char* function = nullptr;
+    for (GLint i = 0; i < numExtensions && function == nullptr; i++) {
+        const auto* name = reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, static_cast<GLuint>(i)));
+        if (std::strcmp(name, "GL_KHR_parallel_shader_compile") == 0) {
+            function = "glMaxShaderCompilerThreadsKHR";
+        } else if (std::strcmp(name, "GL_ARB_parallel_shader_compile") == 0) {
+            function = "glMaxShaderCompilerThreadsARB";
+        }
+    }
+    if (function == nullptr) {
+        return;
+    }
+    auto maxShaderCompilerThreads = reinterpret_cast<MaxShaderCompilerThreadsProc>(load(function));
+    if (maxShaderCompilerThreads == nullptr) {
+        return;
+    }
+    // Let the driver choose the number of threads.
+    maxShaderCompilerThreads(0xFFFFFFFFu);
+    parallelCompile_ = true;
+}
+
+bool ShaderProgram::dependsOn(const std::filesystem::path& file) const {
+    std::error_code ec;
+    auto canonical = std::filesystem::weakly_canonical(file, ec);
+    if (ec) {
+        canonical = file;
+    }
+    for (const auto& path : canonicalPaths_) {
+        if (path == canonical) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void ShaderProgram::reload() {
+    deleteBuild(pending_);
+    try {
+        pending_ = startBuild();
+    } catch (const std::exception& ex) {
+        // E.g., a file is replaced by an editor right now.
+        std::cerr << "Cannot reload shader program \"" << label_ << "\": " << ex.what() << std::endl;
+    }
+}
+
+bool ShaderProgram::update() {
+    if (pending_.program == 0) {
+        return false;
+    }
+    if (parallelCompile_) {
+        GLint completed = GL_FALSE;
+        glGetProgramiv(pending_.program, GL_COMPLETION_STATUS, &completed);
+        if (completed == GL_FALSE) {
+            return false;
+        }
+    }
+    Build build = std::exchange(pending_, Build());
+    std::string log;
+    if (!finishBuild(build, log)) {
+        std::cerr << "Cannot rebuild shader program \"" << label_ << "\", keeping the previous version!" << std::endl
+                  << log << std::endl;
+        return false;
+    }
+    glDeleteProgram(program_);
+    program_ = build.program;
+    // Locations may differ in the new program.
+    uniformLocations_.clear();
+    Log::info("Reloaded shader program \"" + label_ + "\".");
+    return true;
+}
+
+ShaderProgram::Build ShaderProgram::startBuild() const {
+    // Read all files first, so a missing file does not leave a partial build behind.
+    std::vector<std::shared_ptr<const std::string>> sources;
+    std::vector<std::pair<GLenum, const std::string*>> cacheSources;
+    for (const auto& file : files_) {
+        sources.push_back(loader_ ? loader_(file.path) : ResourceCache::getText(file.path));
+        cacheSources.emplace_back(static_cast<GLenum>(file.type), sources.back().get());
+    }
+
+    Build build;
+    if (ProgramBinaryCache::isEnabled()) {
+        build.cacheKey = ProgramBinaryCache::makeKey(cacheSources);
+        build.program = glCreateProgram();
+        if (ProgramBinaryCache::load(build.program, build.cacheKey)) {
+            build.cached = true;
+            return build;
+        }
+        // The program which rejected the binary is not reused for linking from source.
+        glDeleteProgram(build.program);
+    }
+
+    // No status is queried here, compiling and linking may continue in the background.
+    build.program = glCreateProgram();
+    if (!build.cacheKey.empty()) {
+        glProgramParameteri(build.program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
+    for (std::size_t i = 0; i < files_.size(); i++) {
+        const GLuint shader = glCreateShader(static_cast<GLenum>(files_[i].type));
+        const char* source = sources[i]->c_str();
+        glShaderSource(shader, 1, &source, nullptr);
+        glCompileShader(shader);
+        glAttachShader(build.program, shader);
+        build.shaders.push_back(shader);
+    }
+    glLinkProgram(build.program);
+    return build;
+}
+
+bool ShaderProgram::finishBuild(Build& build, std::string& log) const {
+    GLint status = GL_FALSE;
+    glGetProgramiv(build.program, GL_LINK_STATUS, &status);
+    if (status == GL_FALSE) {
+        for (std::size_t i = 0; i < build.shaders.size(); i++) {
+            GLint compiled = GL_FALSE;
+            glGetShaderiv(build.shaders[i], GL_COMPILE_STATUS, &compiled);
+            if (compiled == GL_FALSE) {
+                GLint length = 0;
+                glGetShaderiv(build.shaders[i], GL_INFO_LOG_LENGTH, &length);
+                std::string info(static_cast<std::size_t>(std::max(length, 1)), '\0');
+                glGetShaderInfoLog(build.shaders[i], length, nullptr, info.data());
+                log += files_[i].path.string() + ":\n" + info.c_str() + "\n";
+            }
+        }
+        GLint length = 0;
+        glGetProgramiv(build.program, GL_INFO_LOG_LENGTH, &length);
+        std::string info(static_cast<std::size_t>(std::max(length, 1)), '\0');
+        glGetProgramInfoLog(build.program, length, nullptr, info.data());
+        log += info.c_str();
+    }
+
+    for (const GLuint shader : build.shaders) {
+        glDetachShader(build.program, shader);
+        glDeleteShader(shader);
+    }
+    build.shaders.clear();
+    if (status == GL_FALSE) {
+        glDeleteProgram(build.program);
+        build.program = 0;
+        return false;
+    }
+    if (!build.cached && !build.cacheKey.empty()) {
+        ProgramBinaryCache::store(build.program, build.cacheKey);
+    }
+    return true;
+}
+
+void ShaderProgram::deleteBuild(Build& build) {
+    for (const GLuint shader : build.shaders) {
+        glDeleteShader(shader);
+    }
+    if (build.program != 0) {
+        glDeleteProgram(build.program);
+    }
+    build = Build();
+}
+
+void ShaderProgram::use() const {
+    glUseProgram(program_);
+}
+
+GLint ShaderProgram::getUniformLocation(const std::string& name) const {
+    const auto it = uniformLocations_.find(name);
+    if (it != uniformLocations_.end()) {
+        return it->second;
+    }
+    // Unknown names are cached as -1 as well, setting them stays a no-op.
+    const GLint location = glGetUniformLocation(program_, name.c_str());
+    uniformLocations_.emplace(name, location);
+    return location;
+}
+
+void ShaderProgram::setUniform(const std::string& name, bool value) const {
+    glProgramUniform1i(program_, getUniformLocation(name), static_cast<GLint>(value));
+}
+
+void ShaderProgram::setUniform(const std::string& name, int value) const {
+    glProgramUniform1i(program_, getUniformLocation(name), value);
+}
+
+void ShaderProgram::setUniform(const std::string& name, unsigned int value) const {
+    glProgramUniform1ui(program_, getUniformLocation(name), value);
+}
+
+void ShaderProgram::setUniform(const std::string& name, float value) const {
+    glProgramUniform1f(program_, getUniformLocation(name), value);
+}
+
+void ShaderProgram::setUniform(const std::string& name, const glm::vec2& value) const {
+    glProgramUniform2fv(program_, getUniformLocation(name), 1, glm::value_ptr(value));
+}
+
+void ShaderProgram::setUniform(const std::string& name, const glm::vec3& value) const {
+    glProgramUniform3fv(program_, getUniformLocation(name), 1, glm::value_ptr(value));
+}
+
+void ShaderProgram::setUniform(const std::string& name, const glm::vec4& value) const {
+    glProgramUniform4fv(program_, getUniformLocation(name), 1, glm::value_ptr(value));
+}
+
+void ShaderProgram::setUniform(const std::string& name, const glm::ivec2& value) const {
+    glProgramUniform2iv(program_, getUniformLocation(name), 1, glm::value_ptr(value));
+}
+
+void ShaderProgram::setUniform(const std::string& name, const glm::ivec3& value) const {
+    glProgramUniform3iv(program_, getUniformLocation(name), 1, glm::value_ptr(value));
+}
+
+void ShaderProgram::setUniform(const std::string& name, const glm::ivec4& value) const {
+    glProgramUniform4iv(program_, getUniformLocation(name), 1, glm::value_ptr(value));
+}
+
+void ShaderProgram::setUniform(const std::string& name, const glm::uvec2& value) const {
+    glProgramUniform2uiv(program_, getUniformLocation(name), 1, glm::value_ptr(value));
+}
+
+void ShaderProgram::setUniform(const std::string& name, const glm::uvec3& value) const {
+    glProgramUniform3uiv(program_, getUniformLocation(name), 1, glm::value_ptr(value));
+}
+
+void ShaderProgram::setUniform(const std::string& name, const glm::uvec4& value) const {
+    glProgramUniform4uiv(program_, getUniformLocation(name), 1, glm::value_ptr(value));
+}
+
+void ShaderProgram::setUniform(const std::string& name, const glm::mat3& value) const {
+    glProgramUniformMatrix3fv(program_, getUniformLocation(name), 1, GL_FALSE, glm::value_ptr(value));
+}
+
+void ShaderProgram::setUniform(const std::string& name, const glm::mat4& value) const {
+    glProgramUniformMatrix4fv(program_, getUniformLocation(name), 1, GL_FALSE, glm::value_ptr(value));
+}
+
+void ShaderProgram::setUniform(const std::string& name, const std::vector<unsigned int>& values) const {
+    glProgramUniform1uiv(program_, getUniformLocation(name), static_cast<GLsizei>(values.size()), values.data());
+}
+
+void ShaderProgram::setUniform(const std::string& name, const std::vector<glm::vec3>& values) const {
+    if (values.empty()) {
+        return;
+    }
+    glProgramUniform3fv(program_, getUniformLocation(name), static_cast<GLsizei>(values.size()),
+        glm::value_ptr(values.front()));
+}
+
+void ShaderProgram::setUniform(const std::string& name, const std::vector<glm::uvec3>& values) const {
+    if (values.empty()) {
+        return;
+    }
+    glProgramUniform3uiv(program_, getUniformLocation(name), static_cast<GLsizei>(values.size()),
+        glm::value_ptr(values.front()));
+}
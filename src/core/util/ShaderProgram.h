@@ -0,0 +1,145 @@
+#pragma once
+
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <glad/gl.h>
+#include <glm/glm.hpp>
+
+namespace OGL4Core2::Core {
+    /**
+     * GLSL program built from shader files, which can be rebuilt at runtime. A rebuild is only started by reload(),
+     * meanwhile the current program stays in use. With GL_KHR_parallel_shader_compile the driver compiles and links
+     * on its own threads and update() just checks for completion, otherwise the rebuild finishes within update(). The
+     * new program replaces the current one only if it linked successfully, errors are printed and the previous version
+     * is kept. Uniform locations are cached until the program is replaced. Linked programs are stored in the
+     * ProgramBinaryCache, a cached binary is used instead of compiling.
+     */
+    class ShaderProgram {
+    public:
+        enum class ShaderType : GLenum {
+            Vertex = GL_VERTEX_SHADER,
+            TessControl = GL_TESS_CONTROL_SHADER,
+            TessEvaluation = GL_TESS_EVALUATION_SHADER,
+            Geometry = GL_GEOMETRY_SHADER,
+            Fragment = GL_FRAGMENT_SHADER,
+            Compute = GL_COMPUTE_SHADER,
+        };
+
+        struct ShaderFile {
+            ShaderType type;
+            std::filesystem::path path;
+        };
+        using ShaderFileList = std::vector<ShaderFile>;
+
+        /**
+         * Reads the source of a shader file, by default through the ResourceCache.
+         */
+        using SourceLoader = std::function<std::shared_ptr<const std::string>(const std::filesystem::path&)>;
+
+        /**
+         * Build the program from the given files, blocking. Throws if the program cannot be built.
+         */
+        explicit ShaderProgram(ShaderFileList files, std::string label = std::string(),
+            SourceLoader loader = nullptr);
+        ~ShaderProgram();
+
+        ShaderProgram(const ShaderProgram&) = delete;
+        ShaderProgram(ShaderProgram&&) = delete;
+        ShaderProgram& operator=(const ShaderProgram&) = delete;
+        ShaderProgram& operator=(ShaderProgram&&) = delete;
+
+        /**
+         * Enable parallel shader compilation, if supported by the driver. Called once by the core after the OpenGL
+         * function pointers are loaded.
+         */
+        static void initParallelCompile(GLADloadfunc load);
+
+        [[nodiscard]] static inline bool hasParallelCompile() {
+            return parallelCompile_;
+        }
+
+        [[nodiscard]] inline GLuint getHandle() const {
+            return program_;
+        }
+
+        [[nodiscard]] inline const std::string& getLabel() const {
+            return label_;
+        }
+
+        [[nodiscard]] inline bool isReloading() const {
+            return pending_.program != 0;
+        }
+
+        /**
+         * Check if the given file is one of the shader sources of this program.
+         */
+        [[nodiscard]] bool dependsOn(const std::filesystem::path& file) const;
+
+        /**
+         * Start rebuilding the program from the current file contents. A pending rebuild is discarded.
+         */
+        void reload();
+
+        /**
+         * Finish a pending rebuild, if the driver is done with it. Returns true, if the program was replaced.
+         */
+        bool update();
+
+        void use() const;
+
+        void setUniform(const std::string& name, bool value) const;
+        void setUniform(const std::string& name, int value) const;
+        void setUniform(const std::string& name, unsigned int value) const;
+        void setUniform(const std::string& name, float value) const;
+        void setUniform(const std::string& name, const glm::vec2& value) const;
+        void setUniform(const std::string& name, const glm::vec3& value) const;
+        void setUniform(const std::string& name, const glm::vec4& value) const;
+        void setUniform(const std::string& name, const glm::ivec2& value) const;
+        void setUniform(const std::string& name, const glm::ivec3& value) const;
+        void setUniform(const std::string& name, const glm::ivec4& value) const;
+        void setUniform(const std::string& name, const glm::uvec2& value) const;
+        void setUniform(const std::string& name, const glm::uvec3& value) const;
+        void setUniform(const std::string& name, const glm::uvec4& value) const;
+        void setUniform(const std::string& name, const glm::mat3& value) const;
+        void setUniform(const std::string& name, const glm::mat4& value) const;
+
+        /**
+         * Set the elements of a uniform array with one call, starting at the element name refers to.
+         */
+        void setUniform(const std::string& name, const std::vector<unsigned int>& values) const;
+        void setUniform(const std::string& name, const std::vector<glm::vec3>& values) const;
+        void setUniform(const std::string& name, const std::vector<glm::uvec3>& values) const;
+
+    private:
+        struct Build {
+            GLuint program = 0;
+            std::vector<GLuint> shaders;
+            std::string cacheKey;
+            bool cached = false;
+        };
+
+        [[nodiscard]] Build startBuild() const;
+        [[nodiscard]] bool finishBuild(Build& build, std::string& log) const;
+        static void deleteBuild(Build& build);
+
+        /**
+         * Uniform location of the current program, looked up once per name and program.
+         */
+        [[nodiscard]] GLint getUniformLocation(const std::string& name) const;
+
+        ShaderFileList files_;
+        std::vector<std::filesystem::path> canonicalPaths_;
+        std::string label_;
+        SourceLoader loader_;
+        GLuint program_;
+        Build pending_;
+        mutable std::unordered_map<std::string, GLint> uniformLocations_;
+
+        static bool parallelCompile_;
+    };
+} // namespace OGL4Core2::Core
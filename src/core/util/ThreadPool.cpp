@@ -0,0 +1,297 @@
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <exception>
+#include <iostream>
+#include <stdexcept>
+#include <utility>
+
+using namespace OGL4Core2::Core;
+
+namespace {
+    // Pool and worker index of the current thread, used to push tasks submitted from a worker to its own deque.
+    thread_local const ThreadPool* currentPool = nullptr;
+    thread_local std::size_t currentWorker = 0;
+} // namespace
+
+ThreadPool::ThreadPool(std::size_t numThreads) : queuedTasks_(0), unfinishedTasks_(0), stop_(false) {
+    numThreads = std::max<std::size_t>(numThreads, 1);
+    for (std::size_t i = 0; i < numThreads; i++) {
+        workers_.push_back(std::make_unique<Worker>());
+    }
+    threads_.reserve(numThreads);
+    for (std::size_t i = 0; i < numThreads; i++) {
+        threads_.emplace_back(&ThreadPool::workerLoop, this, i);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex_);
+        stop_ = true;
+    }
+    taskAvailable_.notify_all();
+    for (auto& t : threads_) {
+        t.join();
+    }
+}
+
+void ThreadPool::submit(Task task) {
+    unfinishedTasks_++;
+    queuedTasks_++;
+    if (currentPool == this) {
+        auto& worker = *workers_[currentWorker];
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        worker.tasks.push_back(std::move(task));
+    } else {
+        std::lock_guard<std::mutex> lock(sharedMutex_);
+        sharedQueue_.push_back(std::move(task));
+    }
+    // Sleeping workers check the counter with the mutex held, taking it here avoids a lost wakeup.
+    { std::lock_guard<std::mutex> lock(sleepMutex_); }
+    taskAvailable_.notify_one();
+}
+
+void ThreadPool::wait() {
+    std::unique_lock<std::mutex> lock(sleepMutex_);
+    idle_.wait(lock, [this]() { return unfinishedTasks_ == 0; });
+}
+
+void ThreadPool::parallelFor(std::size_t begin, std::size_t end,
+    const std::function<void(std::size_t, std::size_t)>& body, std::size_t grainSize) {
+    if (end <= begin) {
+        return;
+    }
+    const std::size_t count = end - begin;
+    if (grainSize == 0) {
+        grainSize = std::max<std::size_t>(1, count / ((threads_.size() + 1) * 4));
+    }
+    const std::size_t numChunks = (count + grainSize - 1) / grainSize;
+    if (numChunks == 1) {
+        body(begin, end);
+        return;
+    }
+
+    struct State {
+        std::atomic<std::size_t> nextChunk{0};
+        std::atomic<std::size_t> doneChunks{0};
+        std::mutex exceptionMutex;
+        std::exception_ptr exception;
+    };
+    auto state = std::make_shared<State>();
+
+    // Helpers starting after all chunks are taken return without touching body, which may be gone by then.
+    auto runChunks = [state, &body, begin, end, grainSize, numChunks]() {
+        while (true) {
+            const std::size_t chunk = state->nextChunk++;
+            if (chunk >= numChunks) {
+                return;
+            }
+            const std::size_t chunkBegin = begin + chunk * grainSize;
+            try {
+                body(chunkBegin, std::min(chunkBegin + grainSize, end));
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(state->exceptionMutex);
+                if (state->exception == nullptr) {
+                    state->exception = std::current_exception();
+                }
+            }
+            state->doneChunks++;
+        }
+    };
+
+    const std::size_t numHelpers = std::min(threads_.size(), numChunks - 1);
+    for (std::size_t i = 0; i < numHelpers; i++) {
+        submit(runChunks);
+    }
+    runChunks();
+    // All chunks are taken, only wait for those still processed by other threads.
+    while (state->doneChunks < numChunks) {
+        std::this_thread::yield();
+    }
+    if (state->exception != nullptr) {
+        std::rethrow_exception(state->exception);
+    }
+}
+
+void ThreadPool::workerLoop(std::size_t index) {
+    currentPool = this;
+    currentWorker = index;
+    while (true) {
+        Task task;
+        if (popTask(task)) {
+            execute(task);
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(sleepMutex_);
+        // Remaining tasks are still processed on shutdown.
+        taskAvailable_.wait(lock, [this]() { return stop_ || queuedTasks_ > 0; });
+        if (stop_ && queuedTasks_ == 0) {
+            return;
+        }
+    }
+}
+
+bool ThreadPool::popTask(Task& task) {
+    const bool isWorker = currentPool == this;
+    if (isWorker) {
+        auto& worker = *workers_[currentWorker];
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        if (!worker.tasks.empty()) {
+            task = std::move(worker.tasks.back());
+            worker.tasks.pop_back();
+            queuedTasks_--;
+            return true;
+        }
+    }
+    {
+        std::lock_guard<std::mutex> lock(sharedMutex_);
+        if (!sharedQueue_.empty()) {
+            task = std::move(sharedQueue_.front());
+            sharedQueue_.pop_front();
+            queuedTasks_--;
+            return true;
+        }
+    }
+    const std::size_t start = isWorker ? currentWorker + 1 : 0;
+    for (std::size_t i = 0; i < workers_.size(); i++) {
+        auto& victim = *workers_[(start + i) % workers_.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.tasks.empty()) {
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            queuedTasks_--;
+            return true;
+        }
+    }
+    return false;
+}
+
+void ThreadPool::execute(Task& task) {
+    try {
+        task();
+    } catch (const std::exception& ex) {
+        std::cerr << "Worker task failed: " << ex.what() << std::endl;
+    } catch (...) {
+        std::cerr << "Worker task failed: Unknown error!" << std::endl;
+    }
+    task = nullptr;
+    if (--unfinishedTasks_ == 0) {
+        std::lock_guard<std::mutex> lock(sleepMutex_);
+        idle_.notify_all();
+    }
+}
+
+struct TaskGraph::State {
+    struct Node {
+        std::function<void()> task;
+        std::vector<TaskId> successors;
+        std::size_t numDependencies = 0;
+        std::atomic<std::size_t> pendingDependencies{0};
+        std::atomic<bool> skip{false};
+    };
+
+    explicit State(ThreadPool& p) : pool(p), remaining(0) {}
+
+    ThreadPool& pool;
+    std::vector<std::unique_ptr<Node>> nodes;
+    std::deque<TaskId> ready;
+    std::mutex readyMutex;
+    std::atomic<std::size_t> remaining;
+    std::mutex exceptionMutex;
+    std::exception_ptr exception;
+};
+
+TaskGraph::TaskGraph(ThreadPool& pool) : state_(std::make_shared<State>(pool)) {}
+
+TaskGraph::~TaskGraph() = default;
+
+TaskGraph::TaskId TaskGraph::add(std::function<void()> task, const std::vector<TaskId>& dependencies) {
+    const TaskId id = state_->nodes.size();
+    for (const TaskId dependency : dependencies) {
+        if (dependency >= id) {
+            throw std::runtime_error("Invalid task dependency!");
+        }
+    }
+    auto node = std::make_unique<State::Node>();
+    node->task = std::move(task);
+    node->numDependencies = dependencies.size();
+    for (const TaskId dependency : dependencies) {
+        state_->nodes[dependency]->successors.push_back(id);
+    }
+    state_->nodes.push_back(std::move(node));
+    return id;
+}
+
+void TaskGraph::run() {
+    auto& state = *state_;
+    if (state.nodes.empty()) {
+        return;
+    }
+    state.exception = nullptr;
+    state.remaining = state.nodes.size();
+    for (auto& node : state.nodes) {
+        node->pendingDependencies = node->numDependencies;
+        node->skip = false;
+    }
+    for (TaskId id = 0; id < state.nodes.size(); id++) {
+        if (state.nodes[id]->numDependencies == 0) {
+            schedule(state_, id);
+        }
+    }
+    // Only tasks of this graph are run here, a long unrelated task must not block the caller.
+    while (state.remaining > 0) {
+        if (!runReadyTask(state_)) {
+            std::this_thread::yield();
+        }
+    }
+    if (state.exception != nullptr) {
+        std::rethrow_exception(state.exception);
+    }
+}
+
+void TaskGraph::schedule(const std::shared_ptr<State>& state, TaskId id) {
+    {
+        std::lock_guard<std::mutex> lock(state->readyMutex);
+        state->ready.push_back(id);
+    }
+    // Either this pool task or the thread within run() takes the ready task, whoever comes first.
+    state->pool.submit([state]() { runReadyTask(state); });
+}
+
+bool TaskGraph::runReadyTask(const std::shared_ptr<State>& state) {
+    TaskId id = 0;
+    {
+        std::lock_guard<std::mutex> lock(state->readyMutex);
+        if (state->ready.empty()) {
+            return false;
+        }
+        id = state->ready.front();
+        state->ready.pop_front();
+    }
+
+    auto& node = *state->nodes[id];
+    if (!node.skip) {
+        try {
+            node.task();
+        } catch (...) {
+            node.skip = true;
+            std::lock_guard<std::mutex> lock(state->exceptionMutex);
+            if (state->exception == nullptr) {
+                state->exception = std::current_exception();
+            }
+        }
+    }
+    for (const TaskId successorId : node.successors) {
+        auto& successor = *state->nodes[successorId];
+        if (node.skip) {
+            successor.skip = true;
+        }
+        if (--successor.pendingDependencies == 0) {
+            schedule(state, successorId);
+        }
+    }
+    // Last access to the graph, run() may return afterwards.
+    state->remaining--;
+    return true;
+}
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace OGL4Core2::Core {
+    /**
+     * Work-stealing thread pool. Every worker has its own task deque. Tasks submitted from a worker are pushed to its
+     * own deque and taken LIFO, which keeps recursively spawned work cache local. Tasks submitted from other threads
+     * go to a shared FIFO queue. Idle workers take from the shared queue and steal the oldest tasks of other workers.
+     *
+     * Tasks passed to submit() must not throw, exceptions are caught and reported on stderr. Exceptions within
+     * parallelFor() and TaskGraph are rethrown to the caller.
+     */
+    class ThreadPool {
+    public:
+        using Task = std::function<void()>;
+
+        explicit ThreadPool(std::size_t numThreads);
+        ~ThreadPool();
+
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool(ThreadPool&&) = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+        ThreadPool& operator=(ThreadPool&&) = delete;
+
+        void submit(Task task);
+
+        /**
+         * Block until all tasks are finished. Must not be called from a task.
+         */
+        void wait();
+
+        /**
+         * Call body(chunkBegin, chunkEnd) for chunks of [begin, end) in parallel and block until all are done. The
+         * calling thread processes chunks, too, so this may be nested and called from tasks. grainSize is the minimum
+         * chunk size, 0 chooses about four chunks per thread.
+         */
+        void parallelFor(std::size_t begin, std::size_t end,
+            const std::function<void(std::size_t, std::size_t)>& body, std::size_t grainSize = 0);
+
+        [[nodiscard]] inline std::size_t size() const {
+            return threads_.size();
+        }
+
+    private:
+        struct Worker {
+            std::deque<Task> tasks;
+            std::mutex mutex;
+        };
+
+        void workerLoop(std::size_t index);
+        [[nodiscard]] bool popTask(Task& task);
+        void execute(Task& task);
+
+        std::vector<std::unique_ptr<Worker>> workers_;
+        std::vector<std::thread> threads_;
+        std::deque<Task> sharedQueue_;
+        std::mutex sharedMutex_;
+
+        std::atomic<std::size_t> queuedTasks_;     //!< tasks in any queue
+        std::atomic<std::size_t> unfinishedTasks_; //!< queued and running tasks
+        std::mutex sleepMutex_;
+        std::condition_variable taskAvailable_;
+        std::condition_variable idle_;
+        bool stop_;
+    };
+
+    /**
+     * Set of tasks with dependencies, executed on a thread pool. Tasks become ready once all their dependencies have
+     * finished. A graph can be run multiple times.
+     */
+    class TaskGraph {
+    public:
+        using TaskId = std::size_t;
+
+        explicit TaskGraph(ThreadPool& pool);
+        ~TaskGraph();
+
+        TaskGraph(const TaskGraph&) = delete;
+        TaskGraph(TaskGraph&&) = delete;
+        TaskGraph& operator=(const TaskGraph&) = delete;
+        TaskGraph& operator=(TaskGraph&&) = delete;
+
+        /**
+         * Add a task depending on previously added tasks, which rules out cycles. Throws on invalid dependencies.
+         */
+        TaskId add(std::function<void()> task, const std::vector<TaskId>& dependencies = {});
+
+        /**
+         * Run all tasks and block until they are done. The calling thread runs ready tasks of this graph meanwhile,
+         * so this may be called from a task. If a task throws, the tasks depending on it are skipped and the first
+         * exception is rethrown.
+         */
+        void run();
+
+    private:
+        struct State;
+
+        static void schedule(const std::shared_ptr<State>& state, TaskId id);
+        static bool runReadyTask(const std::shared_ptr<State>& state);
+
+        // Shared with the pool tasks, which may still be queued after run() has returned.
+        std::shared_ptr<State> state_;
+    };
+} // namespace OGL4Core2::Core
@@ -0,0 +1,109 @@
+#include "VolumePyramid.h"
+
+#include <algorithm>
+
+#include "ThreadPool.h"
+
+using namespace OGL4Core2::Core;
+
+namespace {
+    // Integer weights, applied per axis, output voxel i covers the input voxels 2i + offset.
+    struct Kernel {
+        std::array<int, 4> offsets;
+        std::array<uint32_t, 4> weights;
+        int taps;
+        uint32_t sum;
+    };
+
+    constexpr Kernel boxKernel{{0, 1, 0, 0}, {1, 1, 0, 0}, 2, 2};
+    constexpr Kernel gaussianKernel{{-1, 0, 1, 2}, {1, 3, 3, 1}, 4, 8};
+
+    inline std::size_t tap(uint32_t i, int offset, uint32_t size) {
+        return static_cast<std::size_t>(std::clamp<int64_t>(2 * static_cast<int64_t>(i) + offset, 0, size - 1));
+    }
+} // namespace
+
+std::array<uint32_t, 3> VolumePyramid::levelResolution(const std::array<uint32_t, 3>& resolution, uint32_t level) {
+    std::array<uint32_t, 3> result{};
+    for (int i = 0; i < 3; i++) {
+        result[i] = level < 32 ? std::max(1u, resolution[i] >> level) : 1u;
+    }
+    return result;
+}
+
+uint32_t VolumePyramid::numLevels(const std::array<uint32_t, 3>& resolution) {
+    uint32_t size = std::max({resolution[0], resolution[1], resolution[2]});
+    uint32_t levels = 1;
+    while (size > 1) {
+        size >>= 1;
+        levels++;
+    }
+    return levels;
+}
+
+void VolumePyramid::downsample(const uint8_t* src, const std::array<uint32_t, 3>& resolution, uint8_t* dst,
+    uint32_t zBegin, uint32_t zEnd, Filter filter, ThreadPool& pool) {
+    const Kernel& k = filter == Filter::Gaussian ? gaussianKernel : boxKernel;
+    const auto out = levelResolution(resolution, 1);
+    const std::size_t inRow = resolution[0];
+    const std::size_t inSlice = inRow * resolution[1];
+    const std::size_t outSlice = static_cast<std::size_t>(out[0]) * out[1];
+    const uint32_t norm = k.sum * k.sum * k.sum;
+
+    pool.parallelFor(zBegin, zEnd, [&](std::size_t begin, std::size_t end) {
+        // Separable: filter along z into a full slice, then along y into rows of the output, then along x.
+        std::vector<uint32_t> zPass(inSlice);
+        std::vector<uint32_t> yPass(inRow * out[1]);
+        for (std::size_t z = begin; z < end; z++) {
+            std::fill(zPass.begin(), zPass.end(), 0);
+            for (int t = 0; t < k.taps; t++) {
+                const uint8_t* s = src + tap(static_cast<uint32_t>(z), k.offsets[t], resolution[2]) * inSlice;
+                const uint32_t w = k.weights[t];
+                for (std::size_t i = 0; i < inSlice; i++) {
+                    zPass[i] += w * s[i];
+                }
+            }
+            std::fill(yPass.begin(), yPass.end(), 0);
+            for (uint32_t y = 0; y < out[1]; y++) {
+                uint32_t* d = yPass.data() + y * inRow;
+                for (int t = 0; t < k.taps; t++) {
+                    const uint32_t* s = zPass.data() + tap(y, k.offsets[t], resolution[1]) * inRow;
+                    const uint32_t w = k.weights[t];
+                    for (std::size_t x = 0; x < inRow; x++) {
+                        d[x] += w * s[x];
+                    }
+                }
+            }
+            uint8_t* d = dst + (z - zBegin) * outSlice;
+            for (uint32_t y = 0; y < out[1]; y++) {
+                const uint32_t* s = yPass.data() + y * inRow;
+                for (uint32_t x = 0; x < out[0]; x++) {
+                    uint32_t sum = 0;
+                    for (int t = 0; t < k.taps; t++) {
+                        sum += k.weights[t] * s[tap(x, k.offsets[t], resolution[0])];
+                    }
+                    *d++ = static_cast<uint8_t>((sum + norm / 2) / norm);
+                }
+            }
+        }
+    }, 1);
+}
+
+std::vector<VolumePyramid::Level> VolumePyramid::build(const uint8_t* data, const std::array<uint32_t, 3>& resolution,
+    Filter filter, ThreadPool& pool) {
+    const uint32_t levels = numLevels(resolution);
+    std::vector<Level> result;
+    result.reserve(levels - 1);
+    const uint8_t* src = data;
+    std::array<uint32_t, 3> res = resolution;
+    for (uint32_t l = 1; l < levels; l++) {
+        Level level;
+        level.resolution = levelResolution(resolution, l);
+        level.data.resize(static_cast<std::size_t>(level.resolution[0]) * level.resolution[1] * level.resolution[2]);
+        downsample(src, res, level.data.data(), 0, level.resolution[2], filter, pool);
+        result.push_back(std::move(level));
+        src = result.back().data.data();
+        res = result.back().resolution;
+    }
+    return result;
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace OGL4Core2::Core {
+    class ThreadPool;
+
+    /**
+     * Downsampled levels of 8 bit volumes (x fastest). Each level halves the resolution of the previous one, rounded
+     * down but at least 1, exactly like the mipmap levels of a 3D texture, so levels can be uploaded as such.
+     */
+    class VolumePyramid {
+    public:
+        enum class Filter {
+            Box,      //!< average of 2^3 voxels
+            Gaussian, //!< separable binomial filter (1 3 3 1) over 4^3 voxels, less aliasing than Box
+        };
+
+        struct Level {
+            std::array<uint32_t, 3> resolution;
+            std::vector<uint8_t> data;
+        };
+
+        [[nodiscard]] static std::array<uint32_t, 3> levelResolution(const std::array<uint32_t, 3>& resolution,
+            uint32_t level);
+
+        /**
+         * Number of levels down to a single voxel, including the full resolution.
+         */
+        [[nodiscard]] static uint32_t numLevels(const std::array<uint32_t, 3>& resolution);
+
+        /**
+         * Compute the slices [zBegin, zEnd) of the next level of src. dst holds only these slices. Slices are
+         * computed in parallel, so large volumes can be downsampled in parts with bounded memory.
+         */
+        static void downsample(const uint8_t* src, const std::array<uint32_t, 3>& resolution, uint8_t* dst,
+            uint32_t zBegin, uint32_t zEnd, Filter filter, ThreadPool& pool);
+
+        /**
+         * Build all levels below the full resolution, the first one has half the resolution.
+         */
+        [[nodiscard]] static std::vector<Level> build(const uint8_t* data, const std::array<uint32_t, 3>& resolution,
+            Filter filter, ThreadPool& pool);
+    };
+} // namespace OGL4Core2::Core
@@ -0,0 +1,619 @@
+#include "VolumeRaycaster.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#include <immintrin.h>
+#define OGL4CORE2_RAYCASTER_AVX2
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#define AVX2_FUNCTION
+#else
+// Compiled for AVX2 independent of the target architecture, only called if the CPU supports it. Without FMA, so
+// products and sums are rounded separately, exactly like the scalar path.
+#define AVX2_FUNCTION __attribute__((target("avx2")))
+#endif
+#endif
+
+#include "ThreadPool.h"
+
+using namespace OGL4Core2::Core;
+
+// Both paths compute the same operations in the same order without fused multiply-adds, so they produce identical
+// images. The build disables floating point contraction for this file.
+namespace {
+    constexpr int tileSize = 32;
+    constexpr int packetSize = 8;
+    constexpr float edgeThickness = 0.005f;
+
+    using Mode = VolumeRaycaster::Mode;
+    using Settings = VolumeRaycaster::Settings;
+
+    struct Volume {
+        const uint8_t* data;
+        std::size_t size;
+        std::array<int, 3> res;
+        std::ptrdiff_t row;
+        std::ptrdiff_t slice;
+    };
+
+    struct Frame {
+        glm::vec3 eye;
+        glm::mat4 invViewProj;
+        int width;
+        int height;
+        glm::vec3 boxMin;
+        glm::vec3 boxMax;
+        glm::vec3 voxelScale;  // world to voxel coordinates, texel centers are at integers
+        glm::vec3 voxelOffset;
+    };
+
+    // A ray in world space and in voxel coordinates, voxel(t) = voxelOrigin + t * voxelDir.
+    struct Ray {
+        glm::vec3 o = glm::vec3(0.0f);
+        glm::vec3 d = glm::vec3(0.0f);
+        glm::vec3 voxelOrigin = glm::vec3(0.0f);
+        glm::vec3 voxelDir = glm::vec3(0.0f);
+        float tnear = 0.0f;
+        float tfar = 0.0f;
+        bool hit = false;
+        int steps = 0; // samples at tnear + k * stepSize
+    };
+
+    // Result of marching a ray, the fields used depend on the mode.
+    struct March {
+        float value = 0.0f;              // sum (line of sight) or maximum (MIP)
+        int hitStep = -1;                // isosurface: sample after the first crossing
+        float v0 = 0.0f;                 // isosurface: value before the crossing
+        float v1 = 0.0f;                 // isosurface: value after the crossing
+        glm::vec4 acc = glm::vec4(0.0f); // volume: accumulated color, premultiplied alpha
+    };
+
+    /**
+     * Trilinear sample at voxel coordinates p, clamped to the texel centers at the border like CLAMP_TO_EDGE.
+     */
+    float sampleVolume(const Volume& v, const glm::vec3& p) {
+        std::array<int, 3> i0{};
+        std::array<float, 3> f{};
+        for (int a = 0; a < 3; a++) {
+            const float c = std::clamp(p[a], 0.0f, static_cast<float>(v.res[a] - 1));
+            i0[a] = std::max(0, std::min(static_cast<int>(c), v.res[a] - 2));
+            f[a] = c - static_cast<float>(i0[a]);
+        }
+        const std::ptrdiff_t dx = v.res[0] > 1 ? 1 : 0;
+        const std::ptrdiff_t dy = v.res[1] > 1 ? v.row : 0;
+        const std::ptrdiff_t dz = v.res[2] > 1 ? v.slice : 0;
+        const uint8_t* b = v.data + i0[0] + i0[1] * v.row + i0[2] * v.slice;
+        const auto lerp = [](float a, float b, float t) { return a + (b - a) * t; };
+        const float c00 = lerp(b[0], b[dx], f[0]);
+        const float c10 = lerp(b[dy], b[dy + dx], f[0]);
+        const float c01 = lerp(b[dz], b[dz + dx], f[0]);
+        const float c11 = lerp(b[dz + dy], b[dz + dy + dx], f[0]);
+        return lerp(lerp(c00, c10, f[1]), lerp(c01, c11, f[1]), f[2]) * (1.0f / 255.0f);
+    }
+
+    /**
+     * Transfer function value, linearly interpolated between the two nearest entries.
+     */
+    glm::vec4 classify(const std::vector<float>& tf, float value) {
+        const std::size_t entries = tf.size() / 4;
+        const float pos = std::clamp(value, 0.0f, 1.0f) * static_cast<float>(entries - 1);
+        const std::size_t i = std::min(static_cast<std::size_t>(pos), entries - 2);
+        const float f = pos - static_cast<float>(i);
+        const float* e = tf.data() + 4 * i;
+        return glm::vec4(e[0] + (e[4] - e[0]) * f, e[1] + (e[5] - e[1]) * f, e[2] + (e[6] - e[2]) * f,
+            e[3] + (e[7] - e[3]) * f);
+    }
+
+    /**
+     * Composite a sample behind acc, its opacity is corrected by exponent = stepSize / referenceStep.
+     */
+    void composite(glm::vec4& acc, const glm::vec4& s, float exponent) {
+        float alpha = std::clamp(s.a, 0.0f, 1.0f);
+        if (exponent != 1.0f) {
+            alpha = 1.0f - std::pow(1.0f - alpha, exponent);
+        }
+        const float w = (1.0f - acc.a) * alpha;
+        acc.r += w * s.r;
+        acc.g += w * s.g;
+        acc.b += w * s.b;
+        acc.a += w;
+    }
+
+    bool isBoxEdge(const glm::vec3& pos, const glm::vec3& dim) {
+        int close = 0;
+        for (int a = 0; a < 3; a++) {
+            if (std::abs(pos[a] - 0.5f * dim[a]) < edgeThickness || std::abs(pos[a] + 0.5f * dim[a]) < edgeThickness) {
+                close++;
+            }
+        }
+        return close >= 2;
+    }
+
+    Ray makeRay(const Frame& f, const Settings& s, int px, int py) {
+        Ray r;
+        r.o = f.eye;
+        // Pixel center on the far plane, like the texture coordinates of the full screen quad.
+        const float ndcX = (static_cast<float>(px) + 0.5f) / static_cast<float>(f.width) * 2.0f - 1.0f;
+        const float ndcY = (static_cast<float>(py) + 0.5f) / static_cast<float>(f.height) * 2.0f - 1.0f;
+        glm::vec4 world = f.invViewProj * glm::vec4(ndcX, ndcY, 1.0f, 1.0f);
+        world /= world.w;
+        r.d = glm::normalize(glm::vec3(world) - r.o);
+
+        const glm::vec3 t0 = (f.boxMin - r.o) / r.d;
+        const glm::vec3 t1 = (f.boxMax - r.o) / r.d;
+        const glm::vec3 tmin = glm::min(t0, t1);
+        const glm::vec3 tmax = glm::max(t0, t1);
+        r.tnear = std::max(std::max(tmin.x, tmin.y), tmin.z);
+        r.tfar = std::min(std::min(tmax.x, tmax.y), tmax.z);
+        r.hit = r.tnear <= r.tfar && r.tfar >= 0.0f;
+        if (r.hit) {
+            r.voxelOrigin = r.o * f.voxelScale + f.voxelOffset;
+            r.voxelDir = r.d * f.voxelScale;
+            const float steps = std::ceil((r.tfar - r.tnear) / s.stepSize);
+            r.steps = static_cast<int>(std::clamp(steps, 0.0f, static_cast<float>(s.maxSteps)));
+        }
+        return r;
+    }
+
+    March marchRay(const Volume& v, const Settings& s, const Ray& r, float exponent) {
+        March m;
+        const glm::vec3 start = r.voxelOrigin + r.tnear * r.voxelDir;
+        const glm::vec3 step = s.stepSize * r.voxelDir;
+        float prev = 0.0f;
+        for (int k = 0; k < r.steps; k++) {
+            const float value = sampleVolume(v, start + static_cast<float>(k) * step);
+            switch (s.mode) {
+                case Mode::LineOfSight:
+                    m.value += value;
+                    break;
+                case Mode::Mip:
+                    m.value = std::max(m.value, value);
+                    break;
+                case Mode::Isosurface:
+                    if (k > 0 && (prev - s.isoValue) * (value - s.isoValue) < 0.0f) {
+                        m.hitStep = k;
+                        m.v0 = prev;
+                        m.v1 = value;
+                        return m;
+                    }
+                    prev = value;
+                    break;
+                case Mode::Volume:
+                    composite(m.acc, classify(s.transferFunction, value), exponent);
+                    if (s.earlyTermination && m.acc.a >= s.opacityThreshold) {
+                        return m;
+                    }
+                    break;
+            }
+        }
+        return m;
+    }
+
+#ifdef OGL4CORE2_RAYCASTER_AVX2
+    // Rays of a packet, structure of arrays: first sample and step in voxel coordinates.
+    struct Packet {
+        alignas(32) float x[packetSize];
+        alignas(32) float y[packetSize];
+        alignas(32) float z[packetSize];
+        alignas(32) float dx[packetSize];
+        alignas(32) float dy[packetSize];
+        alignas(32) float dz[packetSize];
+        alignas(32) int steps[packetSize];
+    };
+
+    AVX2_FUNCTION inline __m256 lerp8(__m256 a, __m256 b, __m256 t) {
+        return _mm256_add_ps(_mm256_mul_ps(_mm256_sub_ps(b, a), t), a);
+    }
+
+    AVX2_FUNCTION inline __m256 lowByte(__m256i w) {
+        return _mm256_cvtepi32_ps(_mm256_and_si256(w, _mm256_set1_epi32(0xFF)));
+    }
+
+    AVX2_FUNCTION inline __m256 secondByte(__m256i w) {
+        return _mm256_cvtepi32_ps(_mm256_and_si256(_mm256_srli_epi32(w, 8), _mm256_set1_epi32(0xFF)));
+    }
+
+    AVX2_FUNCTION inline __m256 clampCoord(__m256 c, int res) {
+        return _mm256_min_ps(_mm256_max_ps(c, _mm256_setzero_ps()), _mm256_set1_ps(static_cast<float>(res - 1)));
+    }
+
+    /**
+     * Trilinear samples at 8 voxel coordinates, same as sampleVolume(). Requires a resolution of at least 2 per axis
+     * and fewer than 2^31 voxels.
+     */
+    AVX2_FUNCTION __m256 sample8(const Volume& v, __m256 x, __m256 y, __m256 z) {
+        x = clampCoord(x, v.res[0]);
+        y = clampCoord(y, v.res[1]);
+        z = clampCoord(z, v.res[2]);
+        const __m256i ix = _mm256_min_epi32(_mm256_cvttps_epi32(x), _mm256_set1_epi32(v.res[0] - 2));
+        const __m256i iy = _mm256_min_epi32(_mm256_cvttps_epi32(y), _mm256_set1_epi32(v.res[1] - 2));
+        const __m256i iz = _mm256_min_epi32(_mm256_cvttps_epi32(z), _mm256_set1_epi32(v.res[2] - 2));
+        const __m256 fx = _mm256_sub_ps(x, _mm256_cvtepi32_ps(ix));
+        const __m256 fy = _mm256_sub_ps(y, _mm256_cvtepi32_ps(iy));
+        const __m256 fz = _mm256_sub_ps(z, _mm256_cvtepi32_ps(iz));
+        const __m256i row = _mm256_set1_epi32(static_cast<int>(v.row));
+        const __m256i slice = _mm256_set1_epi32(static_cast<int>(v.slice));
+        const __m256i idx = _mm256_add_epi32(ix, _mm256_add_epi32(_mm256_mullo_epi32(iy, row),
+                                                     _mm256_mullo_epi32(iz, slice)));
+
+        // The corners x and x + 1 are the two low bytes of a 32 bit gather, which reads 2 bytes more. Samples at the
+        // very end of the data are taken one by one instead.
+        const auto lastSafe = static_cast<int>(static_cast<std::ptrdiff_t>(v.size) - 4 - v.row - v.slice);
+        if (_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(idx, _mm256_set1_epi32(lastSafe)))) != 0) {
+            alignas(32) float px[packetSize];
+            alignas(32) float py[packetSize];
+            alignas(32) float pz[packetSize];
+            alignas(32) float result[packetSize];
+            _mm256_store_ps(px, x);
+            _mm256_store_ps(py, y);
+            _mm256_store_ps(pz, z);
+            for (int i = 0; i < packetSize; i++) {
+                result[i] = sampleVolume(v, glm::vec3(px[i], py[i], pz[i]));
+            }
+            return _mm256_load_ps(result);
+        }
+
+        const auto* base = reinterpret_cast<const int*>(v.data);
+        const __m256i w00 = _mm256_i32gather_epi32(base, idx, 1);
+        const __m256i w10 = _mm256_i32gather_epi32(base, _mm256_add_epi32(idx, row), 1);
+        const __m256i w01 = _mm256_i32gather_epi32(base, _mm256_add_epi32(idx, slice), 1);
+        const __m256i w11 = _mm256_i32gather_epi32(base, _mm256_add_epi32(idx, _mm256_add_epi32(row, slice)), 1);
+        const __m256 c00 = lerp8(lowByte(w00), secondByte(w00), fx);
+        const __m256 c10 = lerp8(lowByte(w10), secondByte(w10), fx);
+        const __m256 c01 = lerp8(lowByte(w01), secondByte(w01), fx);
+        const __m256 c11 = lerp8(lowByte(w11), secondByte(w11), fx);
+        return _mm256_mul_ps(lerp8(lerp8(c00, c10, fy), lerp8(c01, c11, fy), fz), _mm256_set1_ps(1.0f / 255.0f));
+    }
+
+    /**
+     * Transfer function values of 8 samples, same as classify().
+     */
+    AVX2_FUNCTION void classify8(const std::vector<float>& tf, __m256 value, __m256* rgba) {
+        const int entries = static_cast<int>(tf.size() / 4);
+        const __m256 pos = _mm256_mul_ps(_mm256_min_ps(_mm256_max_ps(value, _mm256_setzero_ps()), _mm256_set1_ps(1.0f)),
+            _mm256_set1_ps(static_cast<float>(entries - 1)));
+        const __m256i i = _mm256_min_epi32(_mm256_cvttps_epi32(pos), _mm256_set1_epi32(entries - 2));
+        const __m256 f = _mm256_sub_ps(pos, _mm256_cvtepi32_ps(i));
+        const __m256i offset = _mm256_slli_epi32(i, 2);
+        for (int c = 0; c < 4; c++) {
+            const __m256 lo = _mm256_i32gather_ps(tf.data() + c, offset, 4);
+            const __m256 hi = _mm256_i32gather_ps(tf.data() + 4 + c, offset, 4);
+            rgba[c] = lerp8(lo, hi, f);
+        }
+    }
+
+    /**
+     * March 8 rays in lockstep, same results as marchRay(). Lanes are masked when they are out of steps, hit the iso
+     * value or are terminated, the packet ends when all lanes are done.
+     */
+    AVX2_FUNCTION void marchPacket(const Volume& v, const Settings& s, const Ray* rays, float exponent, March* out) {
+        Packet p;
+        int maxSteps = 0;
+        for (int i = 0; i < packetSize; i++) {
+            const glm::vec3 start = rays[i].voxelOrigin + rays[i].tnear * rays[i].voxelDir;
+            const glm::vec3 step = s.stepSize * rays[i].voxelDir;
+            p.x[i] = start.x;
+            p.y[i] = start.y;
+            p.z[i] = start.z;
+            p.dx[i] = step.x;
+            p.dy[i] = step.y;
+            p.dz[i] = step.z;
+            p.steps[i] = rays[i].hit ? rays[i].steps : 0;
+            maxSteps = std::max(maxSteps, p.steps[i]);
+        }
+        const __m256 x0 = _mm256_load_ps(p.x);
+        const __m256 y0 = _mm256_load_ps(p.y);
+        const __m256 z0 = _mm256_load_ps(p.z);
+        const __m256 dx = _mm256_load_ps(p.dx);
+        const __m256 dy = _mm256_load_ps(p.dy);
+        const __m256 dz = _mm256_load_ps(p.dz);
+        const __m256i steps = _mm256_load_si256(reinterpret_cast<const __m256i*>(p.steps));
+        const __m256 one = _mm256_set1_ps(1.0f);
+        const __m256 iso = _mm256_set1_ps(s.isoValue);
+        const __m256 threshold = _mm256_set1_ps(s.opacityThreshold);
+
+        __m256 value = _mm256_setzero_ps();
+        __m256 prev = _mm256_setzero_ps();
+        __m256i hitStep = _mm256_set1_epi32(-1);
+        __m256 v0 = _mm256_setzero_ps();
+        __m256 v1 = _mm256_setzero_ps();
+        __m256 acc[4] = {_mm256_setzero_ps(), _mm256_setzero_ps(), _mm256_setzero_ps(), _mm256_setzero_ps()};
+        __m256 done = _mm256_setzero_ps();
+        for (int k = 0; k < maxSteps; k++) {
+            const __m256 active = _mm256_andnot_ps(done,
+                _mm256_castsi256_ps(_mm256_cmpgt_epi32(steps, _mm256_set1_epi32(k))));
+            if (_mm256_movemask_ps(active) == 0) {
+                break;
+            }
+            const __m256 kf = _mm256_set1_ps(static_cast<float>(k));
+            const __m256 sample = sample8(v, _mm256_add_ps(x0, _mm256_mul_ps(kf, dx)),
+                _mm256_add_ps(y0, _mm256_mul_ps(kf, dy)), _mm256_add_ps(z0, _mm256_mul_ps(kf, dz)));
+            switch (s.mode) {
+                case Mode::LineOfSight:
+                    value = _mm256_add_ps(value, _mm256_and_ps(sample, active));
+                    break;
+                case Mode::Mip:
+                    value = _mm256_blendv_ps(value, _mm256_max_ps(value, sample), active);
+                    break;
+                case Mode::Isosurface: {
+                    if (k > 0) {
+                        const __m256 side = _mm256_mul_ps(_mm256_sub_ps(prev, iso), _mm256_sub_ps(sample, iso));
+                        const __m256 crossing = _mm256_and_ps(active,
+                            _mm256_cmp_ps(side, _mm256_setzero_ps(), _CMP_LT_OQ));
+                        hitStep = _mm256_castps_si256(_mm256_blendv_ps(_mm256_castsi256_ps(hitStep),
+                            _mm256_castsi256_ps(_mm256_set1_epi32(k)), crossing));
+                        v0 = _mm256_blendv_ps(v0, prev, crossing);
+                        v1 = _mm256_blendv_ps(v1, sample, crossing);
+                        done = _mm256_or_ps(done, crossing);
+                    }
+                    prev = sample;
+                    break;
+                }
+                case Mode::Volume: {
+                    __m256 rgba[4];
+                    classify8(s.transferFunction, sample, rgba);
+                    __m256 alpha = _mm256_min_ps(_mm256_max_ps(rgba[3], _mm256_setzero_ps()), one);
+                    if (exponent != 1.0f) {
+                        alignas(32) float a[packetSize];
+                        _mm256_store_ps(a, alpha);
+                        for (float& ai : a) {
+                            ai = 1.0f - std::pow(1.0f - ai, exponent);
+                        }
+                        alpha = _mm256_load_ps(a);
+                    }
+                    const __m256 w = _mm256_mul_ps(_mm256_sub_ps(one, acc[3]), _mm256_and_ps(alpha, active));
+                    for (int c = 0; c < 3; c++) {
+                        acc[c] = _mm256_add_ps(acc[c], _mm256_mul_ps(w, rgba[c]));
+                    }
+                    acc[3] = _mm256_add_ps(acc[3], w);
+                    if (s.earlyTermination) {
+                        done = _mm256_or_ps(done, _mm256_cmp_ps(acc[3], threshold, _CMP_GE_OQ));
+                    }
+                    break;
+                }
+            }
+        }
+
+        alignas(32) float values[packetSize];
+        alignas(32) int hits[packetSize];
+        alignas(32) float before[packetSize];
+        alignas(32) float after[packetSize];
+        alignas(32) float channels[4][packetSize];
+        _mm256_store_ps(values, value);
+        _mm256_store_si256(reinterpret_cast<__m256i*>(hits), hitStep);
+        _mm256_store_ps(before, v0);
+        _mm256_store_ps(after, v1);
+        for (int c = 0; c < 4; c++) {
+            _mm256_store_ps(channels[c], acc[c]);
+        }
+        for (int i = 0; i < packetSize; i++) {
+            out[i].value = values[i];
+            out[i].hitStep = hits[i];
+            out[i].v0 = before[i];
+            out[i].v1 = after[i];
+            out[i].acc = glm::vec4(channels[0][i], channels[1][i], channels[2][i], channels[3][i]);
+        }
+    }
+#endif
+
+    /**
+     * Blinn-Phong shaded isosurface hit of a marched ray. The step containing the crossing is narrowed by bisection,
+     * the hit is interpolated in the last interval.
+     */
+    glm::vec3 isosurfaceColor(const Volume& v, const Settings& s, const Ray& r, const March& m) {
+        float t0 = r.tnear + static_cast<float>(m.hitStep - 1) * s.stepSize;
+        float t1 = r.tnear + static_cast<float>(m.hitStep) * s.stepSize;
+        float v0 = m.v0;
+        float v1 = m.v1;
+        for (int i = 0; i < s.isoRefineSteps; i++) {
+            const float tm = 0.5f * (t0 + t1);
+            const float vm = sampleVolume(v, r.voxelOrigin + tm * r.voxelDir);
+            if ((v0 - s.isoValue) * (vm - s.isoValue) <= 0.0f) {
+                t1 = tm;
+                v1 = vm;
+            } else {
+                t0 = tm;
+                v0 = vm;
+            }
+        }
+        const float delta = v1 != v0 ? (v1 - s.isoValue) / (v1 - v0) : 0.0f;
+        const glm::vec3 p = r.voxelOrigin + (t1 - delta * (t1 - t0)) * r.voxelDir;
+
+        // Central differences over one voxel.
+        const glm::vec3 ex(1.0f, 0.0f, 0.0f);
+        const glm::vec3 ey(0.0f, 1.0f, 0.0f);
+        const glm::vec3 ez(0.0f, 0.0f, 1.0f);
+        const glm::vec3 gradient(sampleVolume(v, p + ex) - sampleVolume(v, p - ex),
+            sampleVolume(v, p + ey) - sampleVolume(v, p - ey), sampleVolume(v, p + ez) - sampleVolume(v, p - ez));
+        const float length = glm::length(gradient);
+        const glm::vec3 n = length > 0.0f ? -gradient / length : glm::vec3(0.0f);
+        const glm::vec3 l = glm::normalize(glm::vec3(1.0f, 1.0f, 1.0f));
+        const glm::vec3 h = glm::normalize(l - r.d);
+        const float diff = std::max(glm::dot(n, l), 0.0f);
+        const float spec = std::pow(std::max(glm::dot(n, h), 0.0f), s.kExp);
+        return s.kAmbient * s.ambient + s.kDiffuse * diff * s.diffuse + s.kSpecular * spec * s.specular;
+    }
+
+    /**
+     * Color of a marched ray before blending, including the box edges, like volume.frag.
+     */
+    glm::vec4 shade(const Volume& v, const Settings& s, const glm::vec3& dim, const Ray& r, const March& m) {
+        const glm::vec4 cyan(0.0f, 1.0f, 1.0f, 1.0f);
+        const bool backEdge = isBoxEdge(r.o + r.tfar * r.d, dim);
+        const bool frontEdge = isBoxEdge(r.o + r.tnear * r.d, dim);
+        glm::vec4 color = s.showBox && backEdge ? cyan : glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+        switch (s.mode) {
+            case Mode::LineOfSight: {
+                const float value = m.value * 0.1f * s.stepSize / s.referenceStep;
+                color = glm::vec4(color.r + value, color.g + value, color.b + value, 1.0f);
+                break;
+            }
+            case Mode::Mip:
+                color = glm::vec4(m.value, m.value, m.value, 1.0f);
+                break;
+            case Mode::Isosurface:
+                if (m.hitStep > 0) {
+                    color = glm::vec4(isosurfaceColor(v, s, r, m), 1.0f);
+                }
+                if (color.r < 0.2f && !(frontEdge || backEdge)) {
+                    color.a = 0.0f;
+                }
+                break;
+            case Mode::Volume: {
+                // The back edges of the box are seen through the volume.
+                glm::vec4 acc = m.acc;
+                if (s.showBox && backEdge) {
+                    acc += (1.0f - acc.a) * cyan;
+                }
+                color = acc.a > 0.0f ? glm::vec4(glm::vec3(acc) / acc.a, acc.a) : glm::vec4(0.0f);
+                break;
+            }
+        }
+        if (s.showBox && frontEdge) {
+            color = cyan;
+        }
+        return color;
+    }
+} // namespace
+
+VolumeRaycaster::VolumeRaycaster(ResourceView data, const std::array<uint32_t, 3>& resolution,
+    const glm::vec3& dimensions, bool allowAvx2)
+    : data_(std::move(data)),
+      resolution_(resolution),
+      dimensions_(dimensions),
+      avx2_(false) {
+    const std::size_t voxels = static_cast<std::size_t>(resolution[0]) * resolution[1] * resolution[2];
+    if (voxels == 0 || data_.data == nullptr || data_.size < voxels) {
+        throw std::runtime_error("Invalid volume data for ray casting!");
+    }
+    // Gathers use 32 bit offsets and read 2 bytes beyond a corner pair.
+    const std::size_t row = resolution[0];
+    const std::size_t slice = row * resolution[1];
+    avx2_ = allowAvx2 && cpuSupportsAvx2() && resolution[0] >= 2 && resolution[1] >= 2 && resolution[2] >= 2 &&
+            voxels <= static_cast<std::size_t>(std::numeric_limits<int>::max()) && voxels >= row + slice + 4;
+}
+
+bool VolumeRaycaster::cpuSupportsAvx2() {
+#if defined(OGL4CORE2_RAYCASTER_AVX2) && defined(_MSC_VER) && !defined(__clang__)
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7) {
+        return false;
+    }
+    __cpuid(info, 1);
+    const bool osxsave = (info[2] & (1 << 27)) != 0;
+    if (!osxsave || (_xgetbv(0) & 6) != 6) {
+        return false;
+    }
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#elif defined(OGL4CORE2_RAYCASTER_AVX2)
+    return __builtin_cpu_supports("avx2");
+#else
+    return false;
+#endif
+}
+
+void VolumeRaycaster::render(const Settings& settings, const glm::mat4& view, const glm::mat4& projection, int width,
+    int height, std::vector<unsigned char>& image, ThreadPool& pool) const {
+    if (width <= 0 || height <= 0) {
+        throw std::runtime_error("Invalid image size!");
+    }
+    if (settings.stepSize <= 0.0f || settings.referenceStep <= 0.0f) {
+        throw std::runtime_error("Invalid step size!");
+    }
+    image.resize(4 * static_cast<std::size_t>(width) * static_cast<std::size_t>(height));
+
+    const glm::vec3 res(resolution_[0], resolution_[1], resolution_[2]);
+    const Volume volume{data_.data, data_.size,
+        {static_cast<int>(resolution_[0]), static_cast<int>(resolution_[1]), static_cast<int>(resolution_[2])},
+        static_cast<std::ptrdiff_t>(resolution_[0]),
+        static_cast<std::ptrdiff_t>(resolution_[0]) * static_cast<std::ptrdiff_t>(resolution_[1])};
+    Frame frame;
+    frame.eye = glm::vec3(glm::inverse(view) * glm::vec4(0.0f, 0.0f, 0.0f, 1.0f));
+    frame.invViewProj = glm::inverse(projection * view);
+    frame.width = width;
+    frame.height = height;
+    frame.boxMin = -0.5f * dimensions_;
+    frame.boxMax = 0.5f * dimensions_;
+    // Texture coordinates pos / (dim * scale) / 2 + 1 / 2, times the resolution, minus the texel center offset.
+    frame.voxelScale = 0.5f * res / (dimensions_ * settings.scale);
+    frame.voxelOffset = 0.5f * res - glm::vec3(0.5f);
+
+    const float exponent = settings.stepSize / settings.referenceStep;
+    // Without a transfer function the volume mode shows nothing but the box.
+    const bool march = settings.mode != Mode::Volume || settings.transferFunction.size() >= 8;
+    const int tilesX = (width + tileSize - 1) / tileSize;
+    const int tilesY = (height + tileSize - 1) / tileSize;
+
+    pool.parallelFor(0, static_cast<std::size_t>(tilesX) * tilesY, [&](std::size_t begin, std::size_t end) {
+        std::array<Ray, packetSize> rays;
+        std::array<March, packetSize> results;
+        for (std::size_t tile = begin; tile < end; tile++) {
+            const int tx = static_cast<int>(tile % tilesX) * tileSize;
+            const int ty = static_cast<int>(tile / tilesX) * tileSize;
+            for (int y = ty; y < std::min(ty + tileSize, height); y++) {
+                for (int x = tx; x < std::min(tx + tileSize, width); x += packetSize) {
+                    const int lanes = std::min(packetSize, width - x);
+                    bool anyHit = false;
+                    for (int i = 0; i < packetSize; i++) {
+                        rays[i] = i < lanes ? makeRay(frame, settings, x + i, y) : Ray();
+                        results[i] = March();
+                        anyHit = anyHit || rays[i].hit;
+                    }
+                    if (march && anyHit) {
+#ifdef OGL4CORE2_RAYCASTER_AVX2
+                        if (avx2_) {
+                            marchPacket(volume, settings, rays.data(), exponent, results.data());
+                        } else
+#endif
+                        {
+                            for (int i = 0; i < lanes; i++) {
+                                if (rays[i].hit) {
+                                    results[i] = marchRay(volume, settings, rays[i], exponent);
+                                }
+                            }
+                        }
+                    }
+                    for (int i = 0; i < lanes; i++) {
+                        const glm::vec4 color = rays[i].hit ? shade(volume, settings, dimensions_, rays[i], results[i])
+                                                            : glm::vec4(0.0f);
+                        // Blended over the background like the shader output.
+                        const float a = std::clamp(color.a, 0.0f, 1.0f);
+                        unsigned char* pixel = image.data() + 4 * (static_cast<std::size_t>(y) * width + x + i);
+                        for (int c = 0; c < 3; c++) {
+                            const float value =
+                            std::clamp(color[c], 0.0f, 1.0f) * a + settings.background[c] * (1.0f - a);
+                            pixel[c] = static_cast<unsigned char>(std::clamp(value, 0.0f, 1.0f) * 255.0f + 0.5f);
+                        }
+                        pixel[3] = 255;
+                    }
+                }
+            }
+        }
+    }, 1);
+}
+
+std::vector<float> VolumeRaycaster::readTransferFunction(const std::filesystem::path& filename) {
+    std::ifstream file(filename);
+    std::size_t entries = 0;
+    if (!(file >> entries) || entries < 2) {
+        throw std::runtime_error("Invalid transfer function file \"" + filename.string() + "\"!");
+    }
+    std::vector<float> values(4 * entries);
+    for (auto& v : values) {
+        if (!(file >> v)) {
+            throw std::runtime_error("Invalid transfer function file \"" + filename.string() + "\"!");
+        }
+        v = std::clamp(v, 0.0f, 1.0f);
+    }
+    return values;
+}
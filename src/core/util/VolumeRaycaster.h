@@ -0,0 +1,93 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <filesystem>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "ResourceArchive.h"
+
+namespace OGL4Core2::Core {
+    class ThreadPool;
+
+    /**
+     * CPU ray caster for 8 bit volumes (x fastest), a reference for the ray marching of the VolumeVis shader and a
+     * renderer for nodes without a GPU. It uses the same conventions as the shader: the volume box spans
+     * +-dimensions / 2, texture coordinates are pos / (dimensions * scale) / 2 + 1 / 2 with clamp to edge, rays start
+     * at the box entry and take fixed steps. It always samples the full resolution with trilinear filtering, without
+     * level of detail, empty space skipping or adaptive steps.
+     *
+     * The image is rendered in tiles on the thread pool. Rays are marched in packets of 8 with AVX2 gathers if the CPU
+     * supports it, otherwise one by one. Both paths give identical images.
+     */
+    class VolumeRaycaster {
+    public:
+        enum class Mode {
+            LineOfSight = 0, //!< sum of the samples
+            Mip = 1,         //!< maximum intensity projection
+            Isosurface = 2,  //!< first crossing of the iso value, refined by bisection, Blinn-Phong shaded
+            Volume = 3,      //!< front-to-back compositing with a transfer function
+        };
+
+        struct Settings {
+            Mode mode = Mode::Volume;
+            int maxSteps = 174;
+            float stepSize = 0.01f;
+            float referenceStep = 0.01f; //!< step size of the transfer function opacities and line of sight weights
+            float scale = 0.5f;
+            bool showBox = true;
+            glm::vec3 background = glm::vec3(0.0f);
+
+            float isoValue = 0.5f;
+            int isoRefineSteps = 4;
+            glm::vec3 ambient = glm::vec3(1.0f);
+            glm::vec3 diffuse = glm::vec3(1.0f);
+            glm::vec3 specular = glm::vec3(1.0f);
+            float kAmbient = 0.2f;
+            float kDiffuse = 0.7f;
+            float kSpecular = 0.1f;
+            float kExp = 120.0f;
+
+            std::vector<float> transferFunction; //!< r, g, b, a per entry, entry i belongs to i / (entries - 1)
+            bool earlyTermination = true;
+            float opacityThreshold = 0.99f;
+        };
+
+        /**
+         * The volume data is shared, not copied, e.g. a file mapping stays mapped as long as the ray caster exists.
+         * allowAvx2 = false forces the scalar path, e.g. to compare both.
+         */
+        VolumeRaycaster(ResourceView data, const std::array<uint32_t, 3>& resolution, const glm::vec3& dimensions,
+            bool allowAvx2 = true);
+
+        /**
+         * Render an RGBA8 image in OpenGL row order (bottom row first), blended over the background like the shader
+         * output. view and projection are the matrices VolumeVis::render() passes to the shader.
+         */
+        void render(const Settings& settings, const glm::mat4& view, const glm::mat4& projection, int width,
+            int height, std::vector<unsigned char>& image, ThreadPool& pool) const;
+
+        /**
+         * Whether rays are marched in packets with AVX2, depends on the CPU and the volume size.
+         */
+        [[nodiscard]] inline bool usesAvx2() const {
+            return avx2_;
+        }
+
+        [[nodiscard]] static bool cpuSupportsAvx2();
+
+        /**
+         * Read a transfer function file of VolumeVis (.tf): the number of entries, at least 2, followed by r g b a per
+         * entry. Values are clamped to [0, 1], throws if the file is invalid.
+         */
+        [[nodiscard]] static std::vector<float> readTransferFunction(const std::filesystem::path& filename);
+
+    private:
+        ResourceView data_;
+        std::array<uint32_t, 3> resolution_;
+        glm::vec3 dimensions_;
+        bool avx2_;
+    };
+} // namespace OGL4Core2::Core
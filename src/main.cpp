@@ -1,6 +1,9 @@
+#include <algorithm>
+#include <cstddef>
 #include <cstdint>
 #include <exception>
 #include <iostream>
+#include <stdexcept>
 #include <string>
 #include <utility>
 #include <vector>
@@ -16,7 +19,36 @@ int main(int argc, char* argv[]) {
         ("p,plugin", "Default loaded plugin.", cxxopts::value<std::string>())
         ("s,screenshot", "List of frame numbers for screenshots.", cxxopts::value<std::vector<uint32_t>>())
         ("f,filename", "Base filename for screenshots.", cxxopts::value<std::string>())
+        ("screenshot-format", "Screenshot format: 'png', 'png-fast', 'png-raw', 'qoi'.", cxxopts::value<std::string>())
         ("q,quit", "Quit when screenshot list is empty.")
+        ("capture-stream", "Write every frame to this file or pipe, '-' for stdout.", cxxopts::value<std::string>())
+        ("capture-format", "Capture stream format: 'y4m' or 'raw' (RGBA).", cxxopts::value<std::string>())
+        ("capture-fps", "Frame rate written to the Y4M header.", cxxopts::value<int>())
+        ("poster", "Render a poster of 'width,height' in tiles into a PNG.", cxxopts::value<std::vector<int>>())
+        ("poster-frame", "Frame number at which the poster is rendered.", cxxopts::value<uint32_t>())
+        ("poster-tile", "Maximum poster tile size in pixels.", cxxopts::value<int>())
+        ("hide-gui", "Do not draw the GUI overlay.")
+        ("headless", "Render offscreen without a window, using an EGL or OSMesa context.")
+        ("headless-size", "Framebuffer size in headless mode as 'width,height'.", cxxopts::value<std::vector<int>>())
+        ("headless-api", "Headless context API: 'egl' or 'osmesa'.", cxxopts::value<std::string>())
+        ("profile-trace", "Write a Chrome trace of the profiler to this file on exit.", cxxopts::value<std::string>())
+        ("benchmark", "Benchmark this plugin along a scripted camera path and quit.", cxxopts::value<std::string>())
+        ("benchmark-frames", "Number of measured benchmark frames.", cxxopts::value<uint32_t>())
+        ("benchmark-warmup", "Number of benchmark warm-up frames.", cxxopts::value<uint32_t>())
+        ("benchmark-output", "Output JSON file of the benchmark.", cxxopts::value<std::string>())
+        ("resource-cache-mb", "Resource cache size in MiB, 0 disables it.", cxxopts::value<std::size_t>())
+        ("program-cache", "Directory of the shader program binary cache.", cxxopts::value<std::string>())
+        ("no-program-cache", "Always compile shader programs from source.")
+        ("no-resource-archive", "Read resources from files, even if a resource archive is installed.")
+        ("target-frame-ms", "Plugin render time held by lowering the quality while interacting, 0 disables it.",
+            cxxopts::value<double>())
+        ("min-quality", "Lowest quality level of the adaptive quality, in (0, 1].", cxxopts::value<float>())
+        ("threads", "Number of worker threads, 0 uses all but one hardware thread.", cxxopts::value<std::size_t>())
+        ("on-demand", "Draw frames only when something changed, instead of continuously.")
+        ("render-scale", "Plugin render resolution relative to the window, per axis.", cxxopts::value<float>())
+        ("min-render-scale", "Lowest render scale of the adaptive quality, 1 disables dynamic resolution.",
+            cxxopts::value<float>())
+        ("v,verbose", "Print informational messages, e.g. shader reloads and load timings.")
         ("h,help", "Show help.");
     // clang-format on
 
@@ -33,9 +65,102 @@ int main(int argc, char* argv[]) {
         if (result.count("filename")) {
             cfg.screenshotFilename = result["filename"].as<std::string>();
         }
+        if (result.count("screenshot-format")) {
+            cfg.screenshotFormat = result["screenshot-format"].as<std::string>();
+        }
+        if (result.count("capture-stream")) {
+            cfg.captureStream = result["capture-stream"].as<std::string>();
+        }
+        if (result.count("capture-format")) {
+            cfg.captureFormat = result["capture-format"].as<std::string>();
+        }
+        if (result.count("capture-fps")) {
+            cfg.captureFps = result["capture-fps"].as<int>();
+        }
+        if (result.count("poster")) {
+            const auto size = result["poster"].as<std::vector<int>>();
+            if (size.size() != 2) {
+                throw std::runtime_error("Poster size requires exactly two values!");
+            }
+            cfg.posterWidth = size[0];
+            cfg.posterHeight = size[1];
+        }
+        if (result.count("poster-frame")) {
+            cfg.posterFrame = result["poster-frame"].as<uint32_t>();
+        }
+        if (result.count("poster-tile")) {
+            cfg.posterTileSize = result["poster-tile"].as<int>();
+        }
         if (result.count("quit")) {
             cfg.autoQuit = result["quit"].as<bool>();
         }
+        if (result.count("hide-gui")) {
+            cfg.hideGui = result["hide-gui"].as<bool>();
+        }
+        if (result.count("headless")) {
+            cfg.headless = result["headless"].as<bool>();
+        }
+        if (result.count("headless-size")) {
+            const auto size = result["headless-size"].as<std::vector<int>>();
+            if (size.size() != 2) {
+                throw std::runtime_error("Headless size requires exactly two values!");
+            }
+            cfg.headlessWidth = size[0];
+            cfg.headlessHeight = size[1];
+        }
+        if (result.count("headless-api")) {
+            cfg.headlessContextApi = result["headless-api"].as<std::string>();
+        }
+        if (result.count("profile-trace")) {
+            cfg.profileTraceFilename = result["profile-trace"].as<std::string>();
+        }
+        if (result.count("benchmark")) {
+            cfg.benchmark = true;
+            cfg.defaultPluginName = result["benchmark"].as<std::string>();
+        }
+        if (result.count("benchmark-frames")) {
+            cfg.benchmarkFrames = result["benchmark-frames"].as<uint32_t>();
+        }
+        if (result.count("benchmark-warmup")) {
+            cfg.benchmarkWarmupFrames = result["benchmark-warmup"].as<uint32_t>();
+        }
+        if (result.count("benchmark-output")) {
+            cfg.benchmarkFilename = result["benchmark-output"].as<std::string>();
+        }
+        if (result.count("resource-cache-mb")) {
+            cfg.resourceCacheSizeMiB = result["resource-cache-mb"].as<std::size_t>();
+        }
+        if (result.count("program-cache")) {
+            cfg.programBinaryCacheDir = result["program-cache"].as<std::string>();
+        }
+        if (result.count("no-program-cache")) {
+            cfg.programBinaryCache = !result["no-program-cache"].as<bool>();
+        }
+        if (result.count("no-resource-archive")) {
+            cfg.resourceArchives = !result["no-resource-archive"].as<bool>();
+        }
+        if (result.count("target-frame-ms")) {
+            cfg.targetFrameTime = std::max(0.0, result["target-frame-ms"].as<double>());
+        }
+        if (result.count("min-quality")) {
+            // Clamped by the quality controller, like the GUI slider.
+            cfg.minQuality = result["min-quality"].as<float>();
+        }
+        if (result.count("threads")) {
+            cfg.workerThreads = result["threads"].as<std::size_t>();
+        }
+        if (result.count("on-demand")) {
+            cfg.onDemandRendering = result["on-demand"].as<bool>();
+        }
+        if (result.count("render-scale")) {
+            cfg.renderScale = result["render-scale"].as<float>();
+        }
+        if (result.count("min-render-scale")) {
+            cfg.minRenderScale = result["min-render-scale"].as<float>();
+        }
+        if (result.count("verbose")) {
+            cfg.verbose = result["verbose"].as<bool>();
+        }
     } catch (const std::exception& ex) {
         std::cerr << "Error parsing options: " << ex.what() << std::endl;
         std::cerr << options.help() << std::endl;
@@ -1,16 +1,20 @@
 #include "CrackVis.h"
 
 #include <cmath>
+#include <cstddef>
 #include <cstdint>
 #include <fstream>
 #include <iostream>
+#include <string>
 #include <utility>
+#include <vector>
 #include <fileSystem>
 #include <imgui.h>
 
 #include "Objects.h"
 #include "Mesh.h"
 #include "core/Core.h"
+#include "core/util/Profiler.h"
 
 using namespace OGL4Core2;
 using namespace OGL4Core2::Plugins::PCVC::CrackVis;
@@ -62,25 +66,73 @@ CrackVis::CrackVis(const Core::Core& c)
     initShaders();
     initVAs();
 
+    // Textures and models are loaded in prepare() and uploaded in finalize().
+
+    // Request some parameters
+    GLint maxColAtt;
+    glGetIntegerv(GL_MAX_COLOR_ATTACHMENTS, &maxColAtt);
+    std::cerr << "Maximum number of color attachments: " << maxColAtt << std::endl;
+
+    GLint maxGeomOuputVerts;
+    glGetIntegerv(GL_MAX_GEOMETRY_OUTPUT_VERTICES, &maxGeomOuputVerts);
+    std::cerr << "Maximum number of geometry output vertices: " << maxGeomOuputVerts << std::endl;
+
+    // Initialize clear color and enable depth testing
+    glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+    glEnable(GL_DEPTH_TEST);
+}
+
+/**
+ * @brief Decode textures and import models, called on a worker thread.
+ */
+void CrackVis::prepare() {
     // --------------------------------------------------------------------------------
     //  TODO: Load textures from the "resources/textures" folder.
     //        Use the "getTextureResource" helper function.
     // --------------------------------------------------------------------------------
-    texDice = getTextureResource("textures/dice.png");
-    texBoard = getTextureResource("textures/board.png");
-    texEarth = getTextureResource("textures/earth.png");
+    // Textures are decoded and the model is imported in parallel, each task writes only its own slot.
+    setLoadingProgress(0.0f, "Decoding textures and importing backpack model");
+    const std::vector<std::string> textureNames{"textures/dice.png", "textures/board.png", "textures/earth.png"};
+    textureData.resize(textureNames.size());
+    Core::TaskGraph tasks(getThreadPool());
+    for (std::size_t i = 0; i < textureNames.size(); i++) {
+        tasks.add([this, &textureNames, i]() {
+            auto& data = textureData[i];
+            data.name = textureNames[i];
+            data.image = getPngResource(textureNames[i], data.width, data.height);
+        });
+    }
 
     // --------------------------------------------------------------------------------
     //  TODO: Setup the 3D scene. Add a dice, a sphere, and a torus.
     // --------------------------------------------------------------------------------
-    std::string path = getResourceFilePath("models/backpack/backpack.obj").string();
-    std::shared_ptr<Model> backpack = std::make_shared<Model>(*this, path);
+    std::shared_ptr<Model> backpack;
+    tasks.add([this, &backpack]() {
+        std::string path = getResourceFilePath("models/backpack/backpack.obj").string();
+        backpack = std::make_shared<Model>(*this, path);
+    });
+    tasks.run();
     modelList.emplace_back(backpack);
 
-    
-    for (const auto& model : modelList) {
-        model->initShader("shaders/model.vert", "shaders/model.frag");
+    setLoadingProgress(1.0f, "Uploading models");
+}
+
+/**
+ * @brief Upload textures and models loaded in prepare().
+ */
+void CrackVis::finalize() {
+    for (const auto& data : textureData) {
+        auto tex = createTexture(data.name, data.image, data.width, data.height);
+        if (data.name == "textures/dice.png") {
+            texDice = tex;
+        } else if (data.name == "textures/board.png") {
+            texBoard = tex;
+        } else if (data.name == "textures/earth.png") {
+            texEarth = tex;
+        }
     }
+    textureData.clear();
+
     /*std::shared_ptr<Object> o1 = std::make_shared<Base>(*this, 1, texBoard);
     o1->modelMx = glm::translate(o1->modelMx, glm::vec3(0.0f, 0.0f, -0.6f));
     o1->modelMx = glm::scale(o1->modelMx, glm::vec3(5.0f, 5.0f, 0.01f));
@@ -100,18 +152,10 @@ CrackVis::CrackVis(const Core::Core& c)
     torus->modelMx = glm::scale(torus->modelMx, glm::vec3(1.5f));
     objectList.push_back(torus);*/
 
-    // Request some parameters
-    GLint maxColAtt;
-    glGetIntegerv(GL_MAX_COLOR_ATTACHMENTS, &maxColAtt);
-    std::cerr << "Maximum number of color attachments: " << maxColAtt << std::endl;
-
-    GLint maxGeomOuputVerts;
-    glGetIntegerv(GL_MAX_GEOMETRY_OUTPUT_VERTICES, &maxGeomOuputVerts);
-    std::cerr << "Maximum number of geometry output vertices: " << maxGeomOuputVerts << std::endl;
-
-    // Initialize clear color and enable depth testing
-    glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
-    glEnable(GL_DEPTH_TEST);
+    for (const auto& model : modelList) {
+        model->upload();
+        model->initShader("shaders/model.vert", "shaders/model.frag");
+    }
 }
 
 /**
@@ -139,7 +183,7 @@ CrackVis::~CrackVis() {
 
     objectList.clear();
 
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glBindFramebuffer(GL_FRAMEBUFFER, core_.getDefaultFramebuffer());
 }
 
 /**
@@ -172,7 +216,9 @@ void CrackVis::renderGUI() {
  * @brief CrackVis render callback.
  */
 void CrackVis::render() {
-    renderGUI();
+    if (!isRenderingPoster()) {
+        renderGUI();
+    }
 
     // Update the matrices for current frame.
     updateMatrices();
@@ -182,11 +228,13 @@ void CrackVis::render() {
     // --------------------------------------------------------------------------------
     drawToFBO();
 
+    Core::ProfileScope deferredScope(getProfiler(), "CrackVis::deferred");
+
     // --------------------------------------------------------------------------------
     //  TODO: In the second render pass, a window filling quad is drawn and the FBO
     //    textures are used for deferred shading.
     // --------------------------------------------------------------------------------
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glBindFramebuffer(GL_FRAMEBUFFER, core_.getDefaultFramebuffer());
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
     glViewport(0, 0, wWidth, wHeight);
@@ -275,10 +323,8 @@ void CrackVis::keyboard(Core::Key key, Core::KeyAction action, [[maybe_unused]]
 
     if (key == Core::Key::R) {
         std::cout << "Reload shaders!" << std::endl;
-        initShaders();
-        for (const auto& object : objectList) {
-            object->reloadShaders();
-        }
+        // Shader files are also reloaded automatically when changed, this forces a rebuild of all programs.
+        reloadShaderPrograms();
     } else if (key >= Core::Key::Key1 && key <= Core::Key::Key7) {
         showFBOAtt = static_cast<int>(key) - static_cast<int>(Core::Key::Key1);
     }
@@ -301,7 +347,7 @@ void CrackVis::mouseButton(Core::MouseButton button, Core::MouseButtonAction act
         glBindFramebuffer(GL_FRAMEBUFFER, fbo);
         glReadBuffer(GL_COLOR_ATTACHMENT1);
         glReadPixels(mouseX, wHeight - mouseY, 1, 1, GL_RED_INTEGER, GL_INT, &pickedObjNum);
-        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glBindFramebuffer(GL_FRAMEBUFFER, core_.getDefaultFramebuffer());
         std::cout << pickedObjNum << std::endl;
         if (pickedObjNum <= 0) {
             pickedObjNum = -1;
@@ -352,10 +398,10 @@ void CrackVis::mouseMove(double xpos, double ypos) {
  */
 void CrackVis::initShaders() {
     try {
-        shaderQuad = std::make_unique<glowl::GLSLProgram>(glowl::GLSLProgram::ShaderSourceList{
-            {glowl::GLSLProgram::ShaderType::Vertex, getStringResource("shaders/quad.vert")},
-            {glowl::GLSLProgram::ShaderType::Fragment, getStringResource("shaders/quad.frag")}});
-    } catch (glowl::GLSLProgramException& e) {
+        shaderQuad = createShaderProgram({
+            {Core::ShaderProgram::ShaderType::Vertex, "shaders/quad.vert"},
+            {Core::ShaderProgram::ShaderType::Fragment, "shaders/quad.frag"}});
+    } catch (const std::exception& e) {
         std::cerr << e.what() << std::endl;
     }
 
@@ -443,7 +489,7 @@ void CrackVis::initFBOs() {
         std::cerr << "Error: Framebuffer is not complete!" << std::endl;
     }
 
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glBindFramebuffer(GL_FRAMEBUFFER, core_.getDefaultFramebuffer());
     // --------------------------------------------------------------------------------
     //  TODO (BONUS TASK): Create a frame buffer object for the view from the spot light.
     // --------------------------------------------------------------------------------
@@ -567,7 +613,7 @@ void CrackVis::updateMatrices() {
     // --------------------------------------------------------------------------------
     //  TODO: Update the projection matrix (projMx).
     // --------------------------------------------------------------------------------
-    projMx = glm::perspective(glm::radians(fovY), aspect, zNear,zFar);
+    projMx = getProjectionTileMatrix() * glm::perspective(glm::radians(fovY), aspect, zNear,zFar);
     // --------------------------------------------------------------------------------
     //  TODO: Update the light matrices (for bonus task only).
     // --------------------------------------------------------------------------------
@@ -584,6 +630,7 @@ void CrackVis::drawToFBO() {
     // --------------------------------------------------------------------------------
     //  TODO: Render the scene to the FBO.
     // --------------------------------------------------------------------------------
+    Core::ProfileScope scope(getProfiler(), "CrackVis::drawToFBO");
     glBindFramebuffer(GL_FRAMEBUFFER, fbo);
 
     GLenum drawBuffers[] = {GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1, GL_COLOR_ATTACHMENT2};
@@ -620,7 +667,7 @@ void CrackVis::drawToFBO() {
     }
 
     // 解绑 FBO
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glBindFramebuffer(GL_FRAMEBUFFER, core_.getDefaultFramebuffer());
 }
 
 /**
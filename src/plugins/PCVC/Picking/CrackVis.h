@@ -28,6 +28,8 @@ namespace OGL4Core2::Plugins::PCVC::CrackVis {
         explicit CrackVis(const Core::Core& c);
         ~CrackVis() override;
 
+        void prepare() override;
+        void finalize() override;
         void render() override;
         void resize(int width, int height) override;
         void keyboard(Core::Key key, Core::KeyAction action, Core::Mods mods) override;
@@ -72,10 +74,10 @@ namespace OGL4Core2::Plugins::PCVC::CrackVis {
         std::shared_ptr<Core::OrbitCamera> camera; //!< Camera's view matrix
 
         // GL objects
-        std::unique_ptr<glowl::GLSLProgram> shaderBox;  //!< shader for box
-        std::unique_ptr<glowl::GLSLProgram> shaderQuad; //!< shader for quad
-        std::unique_ptr<glowl::Mesh> vaBox;             //!< box vertices
-        std::unique_ptr<glowl::Mesh> vaQuad;            //!< quad vertices
+        std::shared_ptr<Core::ShaderProgram> shaderBox;  //!< shader for box
+        std::shared_ptr<Core::ShaderProgram> shaderQuad; //!< shader for quad
+        std::unique_ptr<glowl::Mesh> vaBox;              //!< box vertices
+        std::unique_ptr<glowl::Mesh> vaQuad;             //!< quad vertices
 
         GLuint fbo;           //!< handle for FBO
         GLuint fboTexColor;   //!< handle for color attachments
@@ -87,6 +89,14 @@ namespace OGL4Core2::Plugins::PCVC::CrackVis {
         std::shared_ptr<glowl::Texture2D> texDice;  //!< dice texture
         std::shared_ptr<glowl::Texture2D> texBoard; //!< board texture
 
+        struct TextureData {
+            std::string name;
+            std::vector<unsigned char> image;
+            int width = 0;
+            int height = 0;
+        };
+        std::vector<TextureData> textureData; //!< decoded textures, until uploaded in finalize()
+
         // object state
         int pickedObjNum; //!< currently picked object, "< 0" = no object picked
         std::vector<std::shared_ptr<Object>> objectList;
@@ -6,14 +6,19 @@ using namespace OGL4Core2::Plugins::PCVC::CrackVis;
 Mesh::Mesh(CrackVis& basePlugin, std::vector<Vertex> vertices, std::vector<unsigned int> indices,
     std::vector<Texture> textures, uint16_t modelID, uint16_t meshNum)
     : basePlugin(basePlugin),
-      shaderProgram(nullptr)
+      shaderProgram(nullptr),
+      VAO(0),
+      VBO(0),
+      EBO(0)
     {
     //shaderPath should be "shaders/xxx.vert"
     this->vertices = vertices;
     this->indices = indices;
     this->textures = textures;
     globalID = ((uint32_t) modelID << 16) | (uint32_t) meshNum;
-    setupMesh();
+    const std::size_t bytes = this->vertices.size() * sizeof(Vertex) + this->indices.size() * sizeof(unsigned int);
+    cpuMemory = Core::TrackedMemory("Mesh " + std::to_string(globalID), Core::MemoryCategory::Mesh,
+        Core::MemoryLocation::Cpu, bytes);
 }
 
 void Mesh::Draw(const glm::mat4& projMx, const glm::mat4& viewMx) {
@@ -65,38 +70,52 @@ void Mesh::setupMesh(){
     glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*) offsetof(Vertex, TexCoords));
 
     glBindVertexArray(0);
+
+    gpuMemory = Core::TrackedMemory("Mesh " + std::to_string(globalID), Core::MemoryCategory::Mesh,
+        Core::MemoryLocation::Gpu, cpuMemory.bytes());
 }
 
 unsigned int OGL4Core2::Plugins::PCVC::CrackVis::TextureFromFile(std::string path, const std::string& directory, bool gamma) {
+    return TextureFromImage(TextureImageFromFile(path, directory));
+}
+
+TextureImage OGL4Core2::Plugins::PCVC::CrackVis::TextureImageFromFile(const std::string& path,
+    const std::string& directory) {
     std::string filename = directory + '/' + path;
 
+    TextureImage image;
+    unsigned char* data = stbi_load(filename.c_str(), &image.width, &image.height, &image.components, 0);
+    if (data) {
+        image.data.assign(data, data + static_cast<std::size_t>(image.width) * image.height * image.components);
+    } else {
+        std::cout << "Texture failed to load at path: " << path << std::endl;
+    }
+    stbi_image_free(data);
+    return image;
+}
+
+unsigned int OGL4Core2::Plugins::PCVC::CrackVis::TextureFromImage(const TextureImage& image) {
     unsigned int textureID;
     glGenTextures(1, &textureID);
 
-    int width, height, nrComponents;
-    unsigned char* data = stbi_load(filename.c_str(), &width, &height, &nrComponents, 0);
-    if (data) {
+    if (!image.data.empty()) {
         GLenum format = GL_RGB;
-        if (nrComponents == 1)
+        if (image.components == 1)
             format = GL_RED;
-        if (nrComponents == 3)
+        if (image.components == 3)
             format = GL_RGB;
-        if (nrComponents == 4)
+        if (image.components == 4)
             format = GL_RGBA;
 
         glBindTexture(GL_TEXTURE_2D, textureID);
-        glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
+        glTexImage2D(GL_TEXTURE_2D, 0, format, image.width, image.height, 0, format, GL_UNSIGNED_BYTE,
+            image.data.data());
         glGenerateMipmap(GL_TEXTURE_2D);
 
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-        stbi_image_free(data);
-    } else {
-        std::cout << "Texture failed to load at path: " << path << std::endl;
-        stbi_image_free(data);
     }
 
     return textureID;
@@ -105,10 +124,10 @@ unsigned int OGL4Core2::Plugins::PCVC::CrackVis::TextureFromFile(std::string pat
 
 void Model::initShader(std::string vsPath, std::string fspath) {
     try {
-        shaderProgram = std::make_unique<glowl::GLSLProgram>(glowl::GLSLProgram::ShaderSourceList{
-            {glowl::GLSLProgram::ShaderType::Vertex, basePlugin.getStringResource(vsPath)},
-            {glowl::GLSLProgram::ShaderType::Fragment, basePlugin.getStringResource(fspath)}});
-    } catch (glowl::GLSLProgramException& e) {
+        shaderProgram = basePlugin.createShaderProgram({
+            {Core::ShaderProgram::ShaderType::Vertex, vsPath},
+            {Core::ShaderProgram::ShaderType::Fragment, fspath}});
+    } catch (const std::exception& e) {
         std::cerr << e.what() << std::endl;
     }
     for (unsigned int i = 0; i < meshes.size(); i++)
@@ -120,6 +139,33 @@ void Model::Draw(const glm::mat4& projMx, const glm::mat4& viewMx) {
         meshes[i].Draw(projMx, viewMx);
 }
 
+void Model::upload() {
+    std::size_t textureBytes = 0;
+    for (unsigned int i = 0; i < textures_loaded.size(); i++) {
+        const auto& image = textureImages[i];
+        textures_loaded[i].id = TextureFromImage(image);
+        // Mipmaps add a third of the base level.
+        textureBytes += image.data.size() + image.data.size() / 3;
+    }
+    textureImages.clear();
+    textureImagesMemory.reset();
+    texturesMemory = Core::TrackedMemory("Model " + std::to_string(modelID) + " textures",
+        Core::MemoryCategory::Texture, Core::MemoryLocation::Gpu, textureBytes);
+
+    // Meshes hold copies of the texture entries, update their ids.
+    for (auto& mesh : meshes) {
+        for (auto& texture : mesh.textures) {
+            for (const auto& loaded : textures_loaded) {
+                if (std::strcmp(loaded.path.C_Str(), texture.path.C_Str()) == 0) {
+                    texture.id = loaded.id;
+                    break;
+                }
+            }
+        }
+        mesh.setupMesh();
+    }
+}
+
 void Model::loadModel(std::string path) {
     Assimp::Importer import;
     const aiScene* scene = import.ReadFile(path, aiProcess_Triangulate | aiProcess_FlipUVs);
@@ -131,6 +177,12 @@ void Model::loadModel(std::string path) {
     directory = path.substr(0, path.find_last_of('/'));
 
     processNode(scene->mRootNode, scene);
+
+    std::size_t imageBytes = 0;
+    for (const auto& image : textureImages)
+        imageBytes += image.data.size();
+    textureImagesMemory = Core::TrackedMemory("Model " + std::to_string(modelID) + " texture images",
+        Core::MemoryCategory::Texture, Core::MemoryLocation::Cpu, imageBytes);
 }
 
 void Model::processNode(aiNode* node, const aiScene* scene) {
@@ -209,11 +261,13 @@ std::vector<Texture> Model::loadMaterialTextures(aiMaterial* mat, aiTextureType
         }
         if (!skip) {
             Texture texture;
-            texture.id = TextureFromFile(str.C_Str(), directory);
+            // The image is uploaded in upload().
+            texture.id = 0;
             texture.type = typeName;
             texture.path = str.C_Str();
             textures.push_back(texture);
             textures_loaded.push_back(texture);
+            textureImages.push_back(TextureImageFromFile(str.C_Str(), directory));
         }
     }
     return textures;
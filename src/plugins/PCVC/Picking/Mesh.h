@@ -11,6 +11,9 @@
 #include <assimp/scene.h>
 #include <assimp/postprocess.h>
 
+#include "core/util/MemoryTracker.h"
+#include "core/util/ShaderProgram.h"
+
 struct Vertex {
     glm::vec3 Position;
     glm::vec3 Normal;
@@ -23,6 +26,13 @@ struct Texture {
     aiString path;
 };
 
+struct TextureImage {
+    int width = 0;
+    int height = 0;
+    int components = 0;
+    std::vector<unsigned char> data;
+};
+
 
 namespace OGL4Core2::Plugins::PCVC::CrackVis {
     class CrackVis;
@@ -34,19 +44,26 @@ namespace OGL4Core2::Plugins::PCVC::CrackVis {
         std::vector<Vertex> vertices;
         std::vector<unsigned int> indices;
         std::vector<Texture> textures;
-        std::shared_ptr<glowl::GLSLProgram> shaderProgram;
+        std::shared_ptr<Core::ShaderProgram> shaderProgram;
         uint32_t globalID;
         Mesh(CrackVis& basePlugin, std::vector<Vertex> vertices, std::vector<unsigned int> indices,
             std::vector<Texture> textures, uint16_t modelID, uint16_t meshNum);
 
         void Draw(const glm::mat4& projMx, const glm::mat4& viewMx);
+        // Upload vertex data to the GPU, must be called on the render thread before drawing.
+        void setupMesh();
 
     private:
         unsigned int VAO, VBO, EBO;
-        void setupMesh();
+        // vertices and indices are kept on the CPU after the upload.
+        Core::TrackedMemory cpuMemory;
+        Core::TrackedMemory gpuMemory;
     };
 
     unsigned int TextureFromFile(std::string path, const std::string& directory, bool gamma = false);
+    // Decoding only, without OpenGL, can be used on worker threads.
+    TextureImage TextureImageFromFile(const std::string& path, const std::string& directory);
+    unsigned int TextureFromImage(const TextureImage& image);
 
     class Model {
     public:
@@ -60,6 +77,8 @@ namespace OGL4Core2::Plugins::PCVC::CrackVis {
             loadModel(path);
         }
         void Draw(const glm::mat4& projMx, const glm::mat4& viewMx);
+        // Upload meshes and textures loaded by the constructor, must be called on the render thread.
+        void upload();
         CrackVis& basePlugin;
         std::vector<Texture> textures_loaded;
         uint16_t modelID;
@@ -69,10 +88,13 @@ namespace OGL4Core2::Plugins::PCVC::CrackVis {
         }
         void initShader(std::string vsPath, std::string fspath);
 
-        std::shared_ptr<glowl::GLSLProgram> shaderProgram;
+        std::shared_ptr<Core::ShaderProgram> shaderProgram;
 
     private:
         std::vector<Mesh> meshes;
+        std::vector<TextureImage> textureImages; // decoded images of textures_loaded, until uploaded
+        Core::TrackedMemory textureImagesMemory;
+        Core::TrackedMemory texturesMemory;
         std::string directory;
         void loadModel(std::string path);
         void processNode(aiNode* node, const aiScene* scene);
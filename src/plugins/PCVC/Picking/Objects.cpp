@@ -88,22 +88,15 @@ Base::Base(CrackVis& basePlugin, int id, std::shared_ptr<glowl::Texture2D> tex)
     va = std::make_unique<glowl::Mesh>(vertexDataBase, baseIndices, GL_UNSIGNED_INT, GL_TRIANGLE_STRIP);
 }
 
-/**
- * This function is caled from the plugin after pressing 'R' to reload/recompile shaders.
- */
-void Base::reloadShaders() {
-    initShaders();
-}
-
 /**
  * Creates the shader program for this object.
  */
 void Base::initShaders() {
     try {
-        shaderProgram = std::make_unique<glowl::GLSLProgram>(glowl::GLSLProgram::ShaderSourceList{
-            {glowl::GLSLProgram::ShaderType::Vertex, basePlugin.getStringResource("shaders/base.vert")},
-            {glowl::GLSLProgram::ShaderType::Fragment, basePlugin.getStringResource("shaders/base.frag")}});
-    } catch (glowl::GLSLProgramException& e) {
+        shaderProgram = basePlugin.createShaderProgram({
+            {Core::ShaderProgram::ShaderType::Vertex, "shaders/base.vert"},
+            {Core::ShaderProgram::ShaderType::Fragment, "shaders/base.frag"}});
+    } catch (const std::exception& e) {
         std::cerr << e.what() << std::endl;
     }
 }
@@ -129,19 +122,15 @@ Cube::Cube(CrackVis& basePlugin, int id, std::shared_ptr<glowl::Texture2D> tex)
     va = std::make_unique<glowl::Mesh>(vertexDataCube, cubeIndices, GL_UNSIGNED_INT, GL_POINTS);
 }
 
-void Cube::reloadShaders() {
-    initShaders();
-}
-
 void Cube::initShaders() {
     // --------------------------------------------------------------------------------
     //  TODO: Init cube shader program!
     // --------------------------------------------------------------------------------
     try {
-        shaderProgram = std::make_unique<glowl::GLSLProgram>(glowl::GLSLProgram::ShaderSourceList{
-            {glowl::GLSLProgram::ShaderType::Vertex, basePlugin.getStringResource("shaders/cube.vert")},
-            {glowl::GLSLProgram::ShaderType::Fragment, basePlugin.getStringResource("shaders/cube.frag")},
-            {glowl::GLSLProgram::ShaderType::Geometry, basePlugin.getStringResource("shaders/cube.geom")}});
+        shaderProgram = basePlugin.createShaderProgram({
+            {Core::ShaderProgram::ShaderType::Vertex, "shaders/cube.vert"},
+            {Core::ShaderProgram::ShaderType::Fragment, "shaders/cube.frag"},
+            {Core::ShaderProgram::ShaderType::Geometry, "shaders/cube.geom"}});
     } catch (const std::runtime_error& e) {
         std::cerr << "Error compiling shader: " << e.what() << std::endl;
     }
@@ -208,18 +197,14 @@ Sphere::Sphere(CrackVis& basePlugin, int id, std::shared_ptr<glowl::Texture2D> t
     va = std::make_unique<glowl::Mesh>(vertexData, indices);
 }
 
-void Sphere::reloadShaders() {
-    initShaders();
-}
-
 void Sphere::initShaders() {
     // --------------------------------------------------------------------------------
     //  TODO: Init sphere shader program!
     // --------------------------------------------------------------------------------
    try {
-        shaderProgram = std::make_unique<glowl::GLSLProgram>(glowl::GLSLProgram::ShaderSourceList{
-            {glowl::GLSLProgram::ShaderType::Vertex, basePlugin.getStringResource("shaders/sphere.vert")},
-            {glowl::GLSLProgram::ShaderType::Fragment, basePlugin.getStringResource("shaders/sphere.frag")}});
+        shaderProgram = basePlugin.createShaderProgram({
+            {Core::ShaderProgram::ShaderType::Vertex, "shaders/sphere.vert"},
+            {Core::ShaderProgram::ShaderType::Fragment, "shaders/sphere.frag"}});
    } catch (const std::runtime_error& e) {
         std::cerr << "Error compiling shader: " << e.what() << std::endl;
    }
@@ -293,18 +278,14 @@ Torus::Torus(CrackVis& basePlugin, int id, std::shared_ptr<glowl::Texture2D> tex
     va = std::make_unique<glowl::Mesh>(vertexData, indices);
 }
 
-void Torus::reloadShaders() {
-    initShaders();
-}
-
 void Torus::initShaders() {
     // --------------------------------------------------------------------------------
     //  TODO: Init torus shader program!
     // --------------------------------------------------------------------------------
     /*try {
-        shaderProgram = std::make_unique<glowl::GLSLProgram>(glowl::GLSLProgram::ShaderSourceList{
-            {glowl::GLSLProgram::ShaderType::Vertex, basePlugin.getStringResource("shaders/torus.vert")},
-            {glowl::GLSLProgram::ShaderType::Fragment, basePlugin.getStringResource("shaders/torus.frag")}});
+        shaderProgram = basePlugin.createShaderProgram({
+            {Core::ShaderProgram::ShaderType::Vertex, "shaders/torus.vert"},
+            {Core::ShaderProgram::ShaderType::Fragment, "shaders/torus.frag"}});
     } catch (const std::runtime_error& e) {
         std::cerr << "Error compiling shader: " << e.what() << std::endl;
     }*/
@@ -6,6 +6,8 @@
 #include <glm/glm.hpp>
 #include <glowl/glowl.h>
 
+#include "core/util/ShaderProgram.h"
+
 namespace OGL4Core2::Plugins::PCVC::CrackVis {
     class CrackVis;
 
@@ -20,14 +22,12 @@ namespace OGL4Core2::Plugins::PCVC::CrackVis {
 
         void draw(const glm::mat4& projMx, const glm::mat4& viewMx);
 
-        virtual void reloadShaders() = 0;
-
         glm::mat4 modelMx;
 
     protected:
         CrackVis& basePlugin;
         int id;
-        std::unique_ptr<glowl::GLSLProgram> shaderProgram;
+        std::shared_ptr<Core::ShaderProgram> shaderProgram;
         std::unique_ptr<glowl::Mesh> va;
         std::shared_ptr<glowl::Texture2D> tex;
     };
@@ -36,8 +36,6 @@ namespace OGL4Core2::Plugins::PCVC::CrackVis {
     public:
         Base(CrackVis& basePlugin, int id, std::shared_ptr<glowl::Texture2D> tex);
 
-        void reloadShaders() override;
-
     private:
         void initShaders();
     };
@@ -46,8 +44,6 @@ namespace OGL4Core2::Plugins::PCVC::CrackVis {
     public:
         Cube(CrackVis& basePlugin, int id, std::shared_ptr<glowl::Texture2D> tex);
 
-        void reloadShaders() override;
-
     private:
         void initShaders();
     };
@@ -56,8 +52,6 @@ namespace OGL4Core2::Plugins::PCVC::CrackVis {
     public:
         Sphere(CrackVis& basePlugin, int id, std::shared_ptr<glowl::Texture2D> tex);
 
-        void reloadShaders() override;
-
     private:
         void initShaders();
     };
@@ -66,8 +60,6 @@ namespace OGL4Core2::Plugins::PCVC::CrackVis {
     public:
         Torus(CrackVis& basePlugin, int id, std::shared_ptr<glowl::Texture2D> tex);
 
-        void reloadShaders() override;
-
     private:
         void initShaders();
     };
@@ -1,9 +1,16 @@
 #include "VolumeVis.h"
 
 #include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
 #include <fstream>
 #include <iostream>
 #include <iterator>
+#include <limits>
+#include <mutex>
+#include <sstream>
+#include <system_error>
 
 #include <datraw.h>
 #include <glm/gtc/matrix_transform.hpp>
@@ -12,10 +19,54 @@
 
 #include "core/Core.h"
 #include "core/util/ImGuiUtil.h"
+#include "core/util/Log.h"
+#include "core/util/Profiler.h"
 
 using namespace OGL4Core2;
 using namespace OGL4Core2::Plugins::PCVC::VolumeVis;
 
+namespace {
+    // Upload granularity of the volume texture.
+    constexpr std::size_t uploadSlabBytes = 64 * 1024 * 1024;
+
+    // Voxels per brick and axis of converted volumes, small enough for a fine grained residency. In-memory volumes
+    // select their level of detail for bricks of the same size.
+    constexpr uint32_t brickSize = 32;
+
+    // Size of the level arrays in volume.frag.
+    constexpr int maxShaderLevels = 32;
+
+    // Sample counters per pixel bin in volume.frag, spreads the atomics and keeps each counter below 2^32.
+    constexpr std::size_t sampleStatBins = 64;
+
+    // Levels of detail whose values are included in the empty space skipping ranges. Coarser levels are only
+    // selected for distant bricks, their wide filter footprints would leave few empty cells.
+    constexpr uint32_t skipLevels = 3;
+
+    // Staging buffers of the feedback and counter readbacks. The CPU reads the buffers of earlier frames, while the GPU
+    // may still render up to this many frames.
+    constexpr std::size_t readbackBuffers = 3;
+
+    /**
+     * Path of the raw file given by the ObjectFileName entry of a dat file, relative to the dat file.
+     */
+    std::filesystem::path rawFilePath(const std::filesystem::path& datFile) {
+        std::ifstream file(datFile);
+        std::string line;
+        const std::string key = "ObjectFileName:";
+        while (std::getline(file, line)) {
+            if (line.compare(0, key.size(), key) == 0) {
+                const auto begin = line.find_first_not_of(" \t", key.size());
+                const auto end = line.find_last_not_of(" \t\r");
+                if (begin != std::string::npos) {
+                    return datFile.parent_path() / line.substr(begin, end - begin + 1);
+                }
+            }
+        }
+        return {};
+    }
+} // namespace
+
 /**
  * @brief VolumeVis constructor.
  */
@@ -32,12 +83,36 @@ VolumeVis::VolumeVis(const Core::Core& c)
       useLinearFilter(true),
       showBox(true),
       viewMode(ViewMode::Volume),
+      useLod(true),
+      lodBias(0.0f),
+      pyramidFilter(Core::VolumePyramid::Filter::Box),
+      volumeLevels(1),
+      useSkipping(true),
+      occupiedCells(0),
+      occupancyValid(false),
+      occupancyMode(ViewMode::Volume),
+      occupancyIso(0.0f),
+      earlyTermination(true),
+      opacityThreshold(0.99f),
+      adaptiveSteps(true),
+      refineThreshold(0.1f),
+      refineSteps(4),
+      isoRefineSteps(4),
+      sampleStats(false),
+      showSampleCount(false),
+      statsReadback(readbackBuffers),
+      statRays(0),
+      statSamples(0),
+      statMaxSamples(0),
+      cpuRendering(false),
+      cpuRenderSeconds(0.0),
       // --------------------------------------------------------------------------------
       // TODO: Set maxSteps to reasonable default, explain here! Current value is just a placeholder.
       // --------------------------------------------------------------------------------
       maxSteps(174),//We must be able to completely cross the diagonal, which has a length root of 3, so N should be 1 more than square root of 3/stepsize, 174 
       stepSize(0.01f),
       scale(0.5f),
+      quality(1.0f),
       isoValue(0.5f),
       ambientColor(glm::vec3(1.0f, 1.0f, 1.0f)),
       diffuseColor(glm::vec3(1.0f, 1.0f, 1.0f)),
@@ -55,28 +130,56 @@ VolumeVis::VolumeVis(const Core::Core& c)
       tfFilename("test.tf"),
       histoNumBins(256),
       histoMaxBinValue(0),
+      ioBackend(Core::FileReader::Backend::Mmap),
+      brickCacheMiB(1024),
+      brickPoolMiB(512),
+      maxBrickUploads(256),
+      brickPoolSlots(0),
+      residentBricks(0),
+      pendingBricks(0),
+      brickFrame(0),
+      feedbackReadback(readbackBuffers),
+      feedbackViewProj(0.0f),
+      feedbackRedraws(0),
+      conversionProgress(0.0f),
       volumeTex(0),
-      tfTex(0) {
+      tfTex(0),
+      minMaxTex(0),
+      occupancyTex(0),
+      brickPoolTex(0),
+      pageTableBuffer(0),
+      brickFeedbackBuffer(0),
+      sampleStatsBuffer(0),
+      cpuImageTex(0),
+      cpuImageFbo(0) {
     // Init Camera
     camera = std::make_shared<Core::OrbitCamera>(2.0f);
     core_.registerCamera(camera);
 
     // Load list of data files.
-    datFiles = getResourceDirFilePaths("volumes", "^.*\\.dat$");
-    datFilesGuiString.clear();
-    for (const auto& file : datFiles) {
-        datFilesGuiString += file.stem().string() + '\0';
-    }
-    datFilesGuiString += '\0';
+    updateFileList();
+
+    // volume.frag always declares the page table and feedback buffers, small ones are bound when no bricked volume is
+    // loaded.
+    glGenBuffers(1, &pageTableBuffer);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, pageTableBuffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(uint32_t), nullptr, GL_DYNAMIC_DRAW);
+    glGenBuffers(1, &brickFeedbackBuffer);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, brickFeedbackBuffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, 2 * sizeof(uint32_t), nullptr, GL_DYNAMIC_COPY);
+    // Maximum samples of a ray, followed by the rays and the samples per bin.
+    const GLuint zero = 0;
+    glGenBuffers(1, &sampleStatsBuffer);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, sampleStatsBuffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, (1 + 2 * sampleStatBins) * sizeof(uint32_t), nullptr, GL_DYNAMIC_COPY);
+    glClearBufferData(GL_SHADER_STORAGE_BUFFER, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, &zero);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
 
     // Initialize shaders and vertex arrays
     initShaders();
     initVAs();
 
-
-    // Load the volume file and its transfer function
-    loadVolumeFile(0);
-    loadTransferFunc("engine.tf");
+    // The volume file is read in prepare() and uploaded in finalize().
 
     // Set OpenGL state.
     glEnable(GL_DEPTH_TEST);
@@ -93,6 +196,19 @@ VolumeVis::~VolumeVis() {
     // --------------------------------------------------------------------------------
     //  TODO: Do not forget to clear all allocated sources.
     // --------------------------------------------------------------------------------
+    // A running conversion uses this plugin's thread pool tasks and must finish first.
+    if (conversion.valid()) {
+        conversion.wait();
+    }
+    destroyBrickPool();
+    glDeleteTextures(1, &minMaxTex);
+    glDeleteTextures(1, &occupancyTex);
+    glDeleteTextures(1, &tfTex);
+    glDeleteBuffers(1, &pageTableBuffer);
+    glDeleteBuffers(1, &brickFeedbackBuffer);
+    glDeleteBuffers(1, &sampleStatsBuffer);
+    glDeleteFramebuffers(1, &cpuImageFbo);
+    glDeleteTextures(1, &cpuImageTex);
 
     // Reset OpenGL state.
     glDisable(GL_DEPTH_TEST);
@@ -101,6 +217,21 @@ VolumeVis::~VolumeVis() {
     glDisable(GL_BLEND);
 }
 
+/**
+ * @brief Read the initial volume, called on a worker thread.
+ */
+void VolumeVis::prepare() {
+    readVolumeFile(0);
+}
+
+/**
+ * @brief Upload the initial volume and load its transfer function.
+ */
+void VolumeVis::finalize() {
+    uploadVolume();
+    loadTransferFunc("engine.tf");
+}
+
 /**
  * @brief Render GUI.
  */
@@ -115,9 +246,77 @@ void VolumeVis::renderGUI() {
         ImGui::Text("ResX: %i", volumeRes.x);
         ImGui::Text("ResY: %i", volumeRes.y);
         ImGui::Text("ResZ: %i", volumeRes.z);
+        Core::ImGuiUtil::EnumCombo("I/O backend", ioBackend,
+            {
+                {Core::FileReader::Backend::Mmap, "mmap"},
+                {Core::FileReader::Backend::Pread, "pread"},
+                {Core::FileReader::Backend::IoUring, "io_uring"},
+            });
+        ImGui::Text("Read: %.1f MiB in %.3f s (%.0f MiB/s, %s)",
+            static_cast<double>(ioStats.bytes) / (1024.0 * 1024.0), ioStats.seconds, ioStats.throughputMiBs(),
+            Core::FileReader::backendName(ioStats.backend));
+        if (brickedVolume != nullptr) {
+            const auto stats = brickedVolume->getCacheStats();
+            ImGui::Text("Bricks: %zu resident of %zu, %zu pending", residentBricks, brickedVolume->getNumBricks(),
+                pendingBricks);
+            ImGui::Text("Brick cache: %.1f MiB, %zu hits, %zu misses, %zu evictions",
+                static_cast<double>(stats.bytes) / (1024.0 * 1024.0), stats.hits, stats.misses, stats.evictions);
+            if (ImGui::InputInt("Brick cache (MiB)", &brickCacheMiB, 64)) {
+                brickCacheMiB = std::clamp(brickCacheMiB, 16, 1 << 16);
+                brickedVolume->setCacheCapacity(static_cast<std::size_t>(brickCacheMiB) * 1024 * 1024);
+            }
+            // Changing the pool size drops all resident bricks, they are streamed in again.
+            if (ImGui::InputInt("Brick pool (MiB)", &brickPoolMiB, 64)) {
+                brickPoolMiB = std::clamp(brickPoolMiB, 16, 1 << 16);
+                createBrickPool();
+            }
+            ImGui::SliderInt("Brick uploads", &maxBrickUploads, 1, 4096);
+        } else if (conversion.valid()) {
+            ImGui::ProgressBar(conversionProgress.load(), ImVec2(-1.0f, 0.0f), "Converting to bricks");
+        } else if (ImGui::Button("Convert to bricks")) {
+            convertToBricks();
+        }
         // Whether to use linear filtering
         ImGui::Checkbox("Lin. Filter", &useLinearFilter);
         ImGui::Checkbox("ShowBox", &showBox);
+        ImGui::Checkbox("LOD", &useLod);
+        ImGui::SameLine();
+        ImGui::Text("(%d levels)", volumeLevels);
+        ImGui::SliderFloat("LOD bias", &lodBias, -2.0f, 2.0f);
+        ImGui::Checkbox("Empty space skipping", &useSkipping);
+        ImGui::SameLine();
+        ImGui::Text("(%zu of %zu cells occupied)", occupiedCells, minMaxGrid.getNumCells());
+        ImGui::Checkbox("Sample statistics", &sampleStats);
+        ImGui::SameLine();
+        ImGui::Checkbox("Heat map", &showSampleCount);
+        if (sampleStats) {
+            ImGui::Text("Samples per ray: %.1f avg, %u max (%llu rays)",
+                statRays > 0 ? static_cast<double>(statSamples) / static_cast<double>(statRays) : 0.0, statMaxSamples,
+                static_cast<unsigned long long>(statRays));
+        }
+        // The ray caster keeps the volume data in memory, which is released after the upload otherwise.
+        if (brickedVolume == nullptr && ImGui::Checkbox("CPU ray caster", &cpuRendering)) {
+            if (cpuRendering) {
+                loadVolumeFile(currentFileLoaded);
+            } else {
+                cpuRaycaster.reset();
+                volumeDataMemory.reset();
+            }
+        }
+        if (cpuRaycaster != nullptr) {
+            ImGui::SameLine();
+            ImGui::Text("(%.1f ms, %s, %zu threads)", cpuRenderSeconds * 1000.0,
+                cpuRaycaster->usesAvx2() ? "AVX2" : "scalar", getThreadPool().size());
+        }
+        // Bricked volumes get the filter when they are converted.
+        if (Core::ImGuiUtil::EnumCombo("Pyramid filter", pyramidFilter,
+                {
+                    {Core::VolumePyramid::Filter::Box, "Box"},
+                    {Core::VolumePyramid::Filter::Gaussian, "Gaussian"},
+                }) &&
+            brickedVolume == nullptr) {
+            loadVolumeFile(currentFileLoaded);
+        }
         Core::ImGuiUtil::EnumCombo("Mode", viewMode,
             {
                 {ViewMode::LineOfSight, "LineOfSight"},
@@ -134,6 +333,7 @@ void VolumeVis::renderGUI() {
         if (viewMode == ViewMode::Isosurface) {
             ImGui::InputFloat("IsoValue", &isoValue, 0.01f);
             isoValue = std::clamp(isoValue, 0.0f, 100.0f);
+            ImGui::SliderInt("Bisection steps", &isoRefineSteps, 0, 16);
             ImGui::ColorEdit3("Ambient", reinterpret_cast<float*>(&ambientColor), ImGuiColorEditFlags_Float);
             ImGui::ColorEdit3("Diffuse", reinterpret_cast<float*>(&diffuseColor), ImGuiColorEditFlags_Float);
             ImGui::ColorEdit3("Specular", reinterpret_cast<float*>(&specularColor), ImGuiColorEditFlags_Float);
@@ -143,6 +343,11 @@ void VolumeVis::renderGUI() {
             ImGui::SliderFloat("k_exp", &k_exp, 0.0f, 5000.0f);
         }
         if (viewMode == ViewMode::Volume) {
+            ImGui::Checkbox("Early ray termination", &earlyTermination);
+            ImGui::SliderFloat("Opacity threshold", &opacityThreshold, 0.5f, 1.0f);
+            ImGui::Checkbox("Adaptive steps", &adaptiveSteps);
+            ImGui::SliderFloat("Refine threshold", &refineThreshold, 0.01f, 1.0f);
+            ImGui::SliderInt("Refine steps", &refineSteps, 2, 16);
             ImGui::SliderInt("editor height", &editorHeight, 0, 500);
             ImGui::Checkbox("LogPlot", &histoLogplot);
             ImGui::Checkbox("random offset", &useRandom);
@@ -150,6 +355,14 @@ void VolumeVis::renderGUI() {
             ImGui::InputText("TF filename", &tfFilename);
         }
     }
+    if (conversion.valid() && conversion.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+        try {
+            conversion.get();
+            updateFileList();
+        } catch (const std::exception& ex) {
+            std::cerr << "Brick conversion failed: " << ex.what() << std::endl;
+        }
+    }
     // ImGui::Combo also returns true if the same entry is selected again.
     // Only load data if value really changed.
     if (currentFileSelection != currentFileLoaded) {
@@ -161,13 +374,17 @@ void VolumeVis::renderGUI() {
  * @brief VolumeVis render callback.
  */
 void VolumeVis::render() {
-    renderGUI();
+    // Poster tiles show only the volume, without GUI and editor.
+    const bool poster = isRenderingPoster();
+    if (!poster) {
+        renderGUI();
+    }
 
     glClearColor(backgroundColor.r, backgroundColor.g, backgroundColor.b, 1.0f);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
     float viewAspect = 1.0f;
-    if (viewMode == ViewMode::Volume) {
+    if (viewMode == ViewMode::Volume && !poster) {
         // --------------------------------------------------------------------------------
         //  TODO: Set the viewport and viewAspect.
         // --------------------------------------------------------------------------------
@@ -180,10 +397,11 @@ void VolumeVis::render() {
 
     glm::mat4 orthoProjMx = glm::ortho(0.0f, 1.0f, 0.0f, 1.0f);
 
-    if (viewMode == ViewMode::Volume) {
+    if (viewMode == ViewMode::Volume && !poster) {
         // --------------------------------------------------------------------------------
         //  TODO: Draw the transfer-function editor and histogram.
         // --------------------------------------------------------------------------------
+        Core::ProfileScope editorScope(getProfiler(), "VolumeVis::editor");
         glDisable(GL_DEPTH_TEST);
         glDisable(GL_CULL_FACE);
 
@@ -201,8 +419,11 @@ void VolumeVis::render() {
 
         shaderTfView->use();
         shaderTfView->setUniform("orthoProjMx", orthoProjMx);
-        shaderTfView->setUniform("tfTex", 1);
-        vaQuad->draw(); 
+        shaderTfView->setUniform("tex", 1);
+        glActiveTexture(GL_TEXTURE1);
+        glBindTexture(GL_TEXTURE_1D, tfTex);
+        glActiveTexture(GL_TEXTURE0);
+        vaQuad->draw();
 
         glEnable(GL_DEPTH_TEST);
         glEnable(GL_CULL_FACE);
@@ -212,14 +433,21 @@ void VolumeVis::render() {
     //  TODO: Draw (only) the volume.
     // --------------------------------------------------------------------------------
     
-    glViewport(0, editorHeight, wWidth, wHeight);
+    Core::ProfileScope volumeScope(getProfiler(), "VolumeVis::volume");
+    glViewport(0, poster ? 0 : editorHeight, wWidth, wHeight);
     viewAspect = static_cast<float>(wWidth) / static_cast<float>(wHeight);
     orthoProjMx = glm::ortho(0.0f, 1.0f, 0.0f, 1.0f);
 
-    glm::mat4 projection = glm::perspective(glm::radians(fovY), viewAspect, 0.1f, 10.0f);
+    const glm::mat4 perspective = glm::perspective(glm::radians(fovY), viewAspect, 0.1f, 10.0f);
+    glm::mat4 projection = getProjectionTileMatrix() * perspective;
     glm::mat4 view = camera->viewMx();
     glm::mat4 model = glm::scale(glm::mat4(1.0f), volumeDim);
 
+    if (cpuRaycaster != nullptr) {
+        renderCpu(view, projection);
+        return;
+    }
+
     shaderVolume->use();
     shaderVolume->setUniform("showBox", showBox);
     shaderVolume->setUniform("useRandom", useRandom);
@@ -233,14 +461,61 @@ void VolumeVis::render() {
     if (viewMode == ViewMode::Isosurface) {
         shaderVolume->setUniform("viewMode", 2);
     }
+    if (viewMode == ViewMode::Volume) {
+        shaderVolume->setUniform("viewMode", 3);
+    }
 
     shaderVolume->setUniform("orthoProjMx", orthoProjMx);
     shaderVolume->setUniform("invViewMx", glm::inverse(view));
     shaderVolume->setUniform("invViewProjMx", glm::inverse(projection * view));
     shaderVolume->setUniform("volumeDim", volumeDim);
     shaderVolume->setUniform("volumeRes", glm::vec3(volumeRes));
-    shaderVolume->setUniform("VolumeTex", 0);
+    shaderVolume->setUniform("volumeTex", 0);
     shaderVolume->setUniform("transferTex", 1);
+    shaderVolume->setUniform("brickPool", 2);
+    shaderVolume->setUniform("occupancyTex", 3);
+    shaderVolume->setUniform("minMaxTex", 4);
+
+    updateOccupancy();
+    const auto& cells = minMaxGrid.getCells();
+    shaderVolume->setUniform("useSkipping", useSkipping && !minMaxGrid.empty());
+    shaderVolume->setUniform("skipLevels", static_cast<int>(minMaxGrid.getLevels()));
+    shaderVolume->setUniform("skipCellSize", static_cast<float>(minMaxGrid.getCellSize()));
+    shaderVolume->setUniform("skipGridSize", glm::vec3(cells[0], cells[1], cells[2]));
+
+    shaderVolume->setUniform("tfSize", static_cast<float>(tfData.size() / 4));
+    shaderVolume->setUniform("earlyTermination", earlyTermination);
+    shaderVolume->setUniform("opacityThreshold", opacityThreshold);
+    shaderVolume->setUniform("adaptiveSteps", adaptiveSteps);
+    shaderVolume->setUniform("refineThreshold", refineThreshold);
+    shaderVolume->setUniform("refineSteps", refineSteps);
+    shaderVolume->setUniform("isoRefineSteps", isoRefineSteps);
+
+    readSampleStats();
+    shaderVolume->setUniform("sampleStats", sampleStats);
+    shaderVolume->setUniform("showSampleCount", showSampleCount);
+
+    // A voxel of level l covers one pixel at the distance where the pixel size is 2^l times the voxel size.
+    shaderVolume->setUniform("useLod", useLod);
+    shaderVolume->setUniform("lodBias", lodBias);
+    // Poster tiles are magnified by the tile matrix, their pixels have the size of the pixels of the whole poster.
+    const float lodViewHeight = static_cast<float>(wHeight) * getProjectionTileMatrix()[1][1];
+    shaderVolume->setUniform("lodPixelAngle", 2.0f / (perspective[1][1] * lodViewHeight));
+    shaderVolume->setUniform("lodBrickSize",
+        static_cast<float>(brickedVolume != nullptr ? brickedVolume->getBrickSize() : brickSize));
+    shaderVolume->setUniform("numLevels", volumeLevels);
+    shaderVolume->setUniform("bricked", brickedVolume != nullptr);
+    if (brickedVolume != nullptr) {
+        updateBricks(projection * view);
+        shaderVolume->setUniform("levelRes", levelRes);
+        shaderVolume->setUniform("levelBrickCount", levelBrickCount);
+        shaderVolume->setUniform("levelFirstBrick", levelFirstBrick);
+        const auto stored = static_cast<float>(brickedVolume->getStoredBrickSize());
+        shaderVolume->setUniform("brickSize", static_cast<float>(brickedVolume->getBrickSize()));
+        shaderVolume->setUniform("brickPoolSlots", brickPoolSlots);
+        shaderVolume->setUniform("brickPoolSize", glm::vec3(brickPoolSlots) * stored);
+        shaderVolume->setUniform("feedbackWords", static_cast<unsigned int>(brickFeedback.size() / 2));
+    }
 
     shaderVolume->setUniform("isovalue", isoValue);
     shaderVolume->setUniform("k_amb", k_ambient);
@@ -251,15 +526,108 @@ void VolumeVis::render() {
     shaderVolume->setUniform("diffuse", diffuseColor);
     shaderVolume->setUniform("specular", specularColor);
 
-    shaderVolume->setUniform("maxSteps", maxSteps);
-    shaderVolume->setUniform("stepSize", stepSize);
+    // Lower quality takes fewer, larger steps along the same distance. Accumulating modes weight samples accordingly.
+    const int qualitySteps = static_cast<int>(std::ceil(static_cast<float>(maxSteps) * quality));
+    shaderVolume->setUniform("maxSteps", std::max(1, qualitySteps));
+    shaderVolume->setUniform("stepSize", stepSize / quality);
+    shaderVolume->setUniform("sampleWeight", 1.0f / quality);
+    shaderVolume->setUniform("referenceStep", stepSize);
     shaderVolume->setUniform("scale", scale);
 
     glActiveTexture(GL_TEXTURE0);
     glBindTexture(GL_TEXTURE_3D, volumeTex);
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_1D, tfTex);
+    glActiveTexture(GL_TEXTURE2);
+    glBindTexture(GL_TEXTURE_3D, brickPoolTex);
+    glActiveTexture(GL_TEXTURE3);
+    glBindTexture(GL_TEXTURE_3D, occupancyTex);
+    glActiveTexture(GL_TEXTURE4);
+    glBindTexture(GL_TEXTURE_3D, minMaxTex);
+    glActiveTexture(GL_TEXTURE0);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, brickFeedbackBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, pageTableBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, sampleStatsBuffer);
 
     vaQuad->draw();
-    
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, 0);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, 0);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, 0);
+    if (brickedVolume != nullptr || sampleStats) {
+        // Makes the feedback and sample counters visible to the buffer copies and reads.
+        glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+    }
+    // The feedback is copied without waiting and read in a later frame. If all staging buffers are in flight, the
+    // feedback is kept and the next frame adds its bricks.
+    if (brickedVolume != nullptr &&
+        feedbackReadback.capture(brickFeedbackBuffer, brickFeedback.size() * sizeof(uint32_t))) {
+        const GLuint zero = 0;
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, brickFeedbackBuffer);
+        glClearBufferData(GL_SHADER_STORAGE_BUFFER, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, &zero);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    }
+    // The counters are cleared after each frame, if all staging buffers are in flight the frame is not counted.
+    if (sampleStats) {
+        statsReadback.capture(sampleStatsBuffer, (1 + 2 * sampleStatBins) * sizeof(uint32_t));
+        const GLuint zero = 0;
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, sampleStatsBuffer);
+        glClearBufferData(GL_SHADER_STORAGE_BUFFER, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, &zero);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    }
+}
+
+/**
+ * @brief Render the volume with the CPU ray caster into cpuImageTex and blit it into the viewport. Uses the settings
+ * of volume.frag, but always samples the full resolution with fixed steps.
+ * @param view        The view matrix
+ * @param projection  The projection matrix
+ */
+void VolumeVis::renderCpu(const glm::mat4& view, const glm::mat4& projection) {
+    Core::VolumeRaycaster::Settings settings;
+    settings.mode = static_cast<Core::VolumeRaycaster::Mode>(viewMode);
+    const int qualitySteps = static_cast<int>(std::ceil(static_cast<float>(maxSteps) * quality));
+    settings.maxSteps = std::max(1, qualitySteps);
+    settings.stepSize = stepSize / quality;
+    settings.referenceStep = stepSize;
+    settings.scale = scale;
+    settings.showBox = showBox;
+    settings.background = backgroundColor;
+    settings.isoValue = isoValue;
+    settings.isoRefineSteps = isoRefineSteps;
+    settings.ambient = ambientColor;
+    settings.diffuse = diffuseColor;
+    settings.specular = specularColor;
+    settings.kAmbient = k_ambient;
+    settings.kDiffuse = k_diffuse;
+    settings.kSpecular = k_specular;
+    settings.kExp = k_exp;
+    settings.transferFunction = tfData;
+    settings.earlyTermination = earlyTermination;
+    settings.opacityThreshold = opacityThreshold;
+
+    const auto start = std::chrono::steady_clock::now();
+    cpuRaycaster->render(settings, view, projection, wWidth, wHeight, cpuImage, getThreadPool());
+    cpuRenderSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    if (cpuImageTex == 0) {
+        glGenTextures(1, &cpuImageTex);
+        glGenFramebuffers(1, &cpuImageFbo);
+    }
+    glBindTexture(GL_TEXTURE_2D, cpuImageTex);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, wWidth, wHeight, 0, GL_RGBA, GL_UNSIGNED_BYTE, cpuImage.data());
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    // The image covers the same viewport as the volume quad, it is already blended over the background.
+    GLint readFbo = 0;
+    glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &readFbo);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, cpuImageFbo);
+    glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, cpuImageTex, 0);
+    const GLint y0 = isRenderingPoster() ? 0 : editorHeight;
+    glBlitFramebuffer(0, 0, wWidth, wHeight, 0, y0, wWidth, y0 + wHeight, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, static_cast<GLuint>(readFbo));
 }
 
 /**
@@ -287,8 +655,8 @@ void VolumeVis::keyboard(Core::Key key, Core::KeyAction action, [[maybe_unused]]
 
     switch (key) {
         case Core::Key::F5: {
-            // reload shaders
-            initShaders();
+            // reload shaders, changed shader files are also reloaded automatically
+            reloadShaderPrograms();
             break;
         }
         case Core::Key::Key1: {
@@ -348,6 +716,14 @@ void VolumeVis::keyboard(Core::Key key, Core::KeyAction action, [[maybe_unused]]
     // --------------------------------------------------------------------------------
 }
 
+/**
+ * @brief VolumeVis adaptive quality callback.
+ * @param quality  Quality level in (0, 1], used to scale the number of ray marching steps
+ */
+void VolumeVis::setQuality(float quality) {
+    this->quality = quality;
+}
+
 /**
  * @brief VolumeVis mouse move callback.
  * Called after the mouse was moved, coordinates are measured in screen coordinates but
@@ -367,47 +743,47 @@ void VolumeVis::mouseMove(double xpos, double ypos) {
 void VolumeVis::initShaders() {
     // Initialize shader for volume
     try {
-        shaderVolume = std::make_unique<glowl::GLSLProgram>(glowl::GLSLProgram::ShaderSourceList{
-            {glowl::GLSLProgram::ShaderType::Vertex, getStringResource("shaders/volume.vert")},
-            {glowl::GLSLProgram::ShaderType::Fragment, getStringResource("shaders/volume.frag")}});
-    } catch (glowl::GLSLProgramException& e) {
+        shaderVolume = createShaderProgram({
+            {Core::ShaderProgram::ShaderType::Vertex, "shaders/volume.vert"},
+            {Core::ShaderProgram::ShaderType::Fragment, "shaders/volume.frag"}});
+    } catch (const std::exception& e) {
         std::cerr << e.what() << std::endl;
     }
 
     // Initialize shader for background
     try {
-        shaderBackground = std::make_unique<glowl::GLSLProgram>(glowl::GLSLProgram::ShaderSourceList{
-            {glowl::GLSLProgram::ShaderType::Vertex, getStringResource("shaders/background.vert")},
-            {glowl::GLSLProgram::ShaderType::Fragment, getStringResource("shaders/background.frag")}});
-    } catch (glowl::GLSLProgramException& e) {
+        shaderBackground = createShaderProgram({
+            {Core::ShaderProgram::ShaderType::Vertex, "shaders/background.vert"},
+            {Core::ShaderProgram::ShaderType::Fragment, "shaders/background.frag"}});
+    } catch (const std::exception& e) {
         std::cerr << e.what() << std::endl;
     }
 
     // Initialize shader for histogram
     try {
-        shaderHisto = std::make_unique<glowl::GLSLProgram>(glowl::GLSLProgram::ShaderSourceList{
-            {glowl::GLSLProgram::ShaderType::Vertex, getStringResource("shaders/histo.vert")},
-            {glowl::GLSLProgram::ShaderType::Geometry, getStringResource("shaders/histo.geom")},
-            {glowl::GLSLProgram::ShaderType::Fragment, getStringResource("shaders/histo.frag")}});
-    } catch (glowl::GLSLProgramException& e) {
+        shaderHisto = createShaderProgram({
+            {Core::ShaderProgram::ShaderType::Vertex, "shaders/histo.vert"},
+            {Core::ShaderProgram::ShaderType::Geometry, "shaders/histo.geom"},
+            {Core::ShaderProgram::ShaderType::Fragment, "shaders/histo.frag"}});
+    } catch (const std::exception& e) {
         std::cerr << e.what() << std::endl;
     }
 
     // Initialize shader for transfer function lines
     try {
-        shaderTfLines = std::make_unique<glowl::GLSLProgram>(glowl::GLSLProgram::ShaderSourceList{
-            {glowl::GLSLProgram::ShaderType::Vertex, getStringResource("shaders/tf-lines.vert")},
-            {glowl::GLSLProgram::ShaderType::Fragment, getStringResource("shaders/tf-lines.frag")}});
-    } catch (glowl::GLSLProgramException& e) {
+        shaderTfLines = createShaderProgram({
+            {Core::ShaderProgram::ShaderType::Vertex, "shaders/tf-lines.vert"},
+            {Core::ShaderProgram::ShaderType::Fragment, "shaders/tf-lines.frag"}});
+    } catch (const std::exception& e) {
         std::cerr << e.what() << std::endl;
     }
 
     // Initialize shader for transfer function preview
     try {
-        shaderTfView = std::make_unique<glowl::GLSLProgram>(glowl::GLSLProgram::ShaderSourceList{
-            {glowl::GLSLProgram::ShaderType::Vertex, getStringResource("shaders/tf-view.vert")},
-            {glowl::GLSLProgram::ShaderType::Fragment, getStringResource("shaders/tf-view.frag")}});
-    } catch (glowl::GLSLProgramException& e) {
+        shaderTfView = createShaderProgram({
+            {Core::ShaderProgram::ShaderType::Vertex, "shaders/tf-view.vert"},
+            {Core::ShaderProgram::ShaderType::Fragment, "shaders/tf-view.frag"}});
+    } catch (const std::exception& e) {
         std::cerr << e.what() << std::endl;
     }
 }
@@ -431,17 +807,92 @@ void VolumeVis::initVAs() {
     vaQuad = std::make_unique<glowl::Mesh>(vertexDataQuad, quadIndices, GL_UNSIGNED_INT, GL_TRIANGLE_STRIP);
 }
 
+/**
+ * @brief Update the list of volume files, keeps the selection of the loaded file.
+ */
+void VolumeVis::updateFileList() {
+    const auto current = currentFileLoaded < static_cast<int>(datFiles.size()) ? datFiles[currentFileLoaded]
+                                                                                : std::filesystem::path();
+    // Bricked volumes are listed with their extension, they usually have the name of the dat file they are made of.
+    datFiles = getResourceDirFilePaths("volumes", "^.*\\.(dat|bvol)$");
+    datFilesGuiString.clear();
+    for (std::size_t i = 0; i < datFiles.size(); i++) {
+        const auto& file = datFiles[i];
+        datFilesGuiString += (file.extension() == ".bvol" ? file.filename() : file.stem()).string() + '\0';
+        if (file == current) {
+            currentFileLoaded = currentFileSelection = static_cast<int>(i);
+        }
+    }
+    datFilesGuiString += '\0';
+}
+
 /**
  * @brief Load volume file.
  * @param idx   The file index
  */
 void VolumeVis::loadVolumeFile(int idx) {
+    readVolumeFile(idx);
+    uploadVolume();
+}
+
+/**
+ * @brief Read volume file and calculate its histogram, does not use OpenGL.
+ * @param idx   The file index
+ */
+void VolumeVis::readVolumeFile(int idx) {
     if (idx < 0 || idx >= static_cast<int>(datFiles.size())) {
         throw std::runtime_error("Invalid file index!");
     }
     currentFileLoaded = idx;
 
     std::string volumeFile = datFiles[idx].string();
+    setLoadingProgress(0.0f, "Reading " + datFiles[idx].filename().string());
+
+    // Bricked volumes only read their header here, bricks are streamed in while rendering.
+    brickedVolume.reset();
+    if (datFiles[idx].extension() == ".bvol") {
+        brickedVolume = std::make_unique<Core::BrickedVolume>(datFiles[idx],
+            static_cast<std::size_t>(brickCacheMiB) * 1024 * 1024);
+        const auto& res = brickedVolume->getResolution();
+        const auto& thickness = brickedVolume->getSliceThickness();
+        volumeRes = glm::uvec3(res[0], res[1], res[2]);
+        volumeDim = glm::vec3(thickness[0], thickness[1], thickness[2]) * glm::vec3(volumeRes);
+        volumeDim /= std::max({volumeDim.x, volumeDim.y, volumeDim.z});
+        volumeLevels = std::min(static_cast<int>(brickedVolume->getNumLevels()), maxShaderLevels);
+        levelRes.clear();
+        levelBrickCount.clear();
+        levelFirstBrick.clear();
+        for (int l = 0; l < volumeLevels; l++) {
+            const auto level = static_cast<uint32_t>(l);
+            const auto& lres = brickedVolume->getLevelResolution(level);
+            const auto& count = brickedVolume->getBrickCount(level);
+            levelRes.emplace_back(lres[0], lres[1], lres[2]);
+            levelBrickCount.emplace_back(count[0], count[1], count[2]);
+            levelFirstBrick.push_back(static_cast<unsigned int>(brickedVolume->getLevelFirstBrick(level)));
+        }
+        ioStats = Core::FileReader::Stats();
+        volumeData = Core::ResourceView();
+        volumeDataMemory.reset();
+        volumePyramid.clear();
+        volumePyramidMemory.reset();
+
+        // The stored histogram has 256 bins, one per value.
+        const auto& stored = brickedVolume->getHistogram();
+        histogram.assign(histoNumBins, 0);
+        for (std::size_t v = 0; v < stored.size(); v++) {
+            auto& bin = histogram[std::min(v * histoNumBins / stored.size(), histoNumBins - 1)];
+            bin = static_cast<uint32_t>(
+                std::min<uint64_t>(uint64_t(bin) + stored[v], std::numeric_limits<uint32_t>::max()));
+        }
+        histoMaxBinValue = *std::max_element(histogram.begin(), histogram.end());
+        minMaxGrid = brickedVolume->getMinMaxGrid();
+        for (uint32_t l = 1; l < std::min(skipLevels, brickedVolume->getNumLevels()); l++) {
+            minMaxGrid.addLevel(brickedVolume->getMinMaxGrid(l), brickedVolume->getLevelResolution(l),
+                brickedVolume->getLevelResolution(0));
+        }
+        setLoadingProgress(1.0f, "Creating brick pool");
+        return;
+    }
 
     // --------------------------------------------------------------------------------
     //  TODO: Read data from 'volumeFile' using datraw::raw_reader<char>. Use slice
@@ -465,28 +916,496 @@ void VolumeVis::loadVolumeFile(int idx) {
     float maxDim = std::max({volumeDim.x, volumeDim.y, volumeDim.z});
     volumeDim /= maxDim;
 
-    std::vector<datraw::uint8> volumeData = reader.read_current();
+    // Uncompressed 8 bit raw files are read with the selected I/O backend, with mmap the data is not copied at all
+    // until the upload. Anything else, e.g. compressed raw files, is left to datraw.
+    const std::size_t volumeBytes =
+        static_cast<std::size_t>(volumeRes.x) * static_cast<std::size_t>(volumeRes.y) * volumeRes.z;
+    const auto rawFile = rawFilePath(datFiles[idx]);
+    std::error_code ec;
+    if (!rawFile.empty() && std::filesystem::file_size(rawFile, ec) == volumeBytes && !ec) {
+        setLoadingProgress(0.1f, "Reading " + rawFile.filename().string());
+        volumeData = Core::FileReader::read(rawFile, 0, volumeBytes, ioBackend, getThreadPool(), &ioStats);
+    } else {
+        const auto start = std::chrono::steady_clock::now();
+        auto data = std::make_shared<std::vector<std::uint8_t>>(reader.read_current());
+        ioStats.backend = Core::FileReader::Backend::External;
+        ioStats.bytes = data->size();
+        ioStats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        volumeData.data = data->data();
+        volumeData.size = data->size();
+        volumeData.owner = std::move(data);
+    }
+    // The GUI shows the same numbers.
+    if (Core::Log::isVerbose()) {
+        std::ostringstream message;
+        message << "Read " << datFiles[idx].filename().string() << ": " << ioStats.bytes / (1024 * 1024) << " MiB in "
+                << ioStats.seconds << " s (" << ioStats.throughputMiBs() << " MiB/s, "
+                << Core::FileReader::backendName(ioStats.backend) << ")";
+        Core::Log::info(message.str());
+    }
+    volumeDataMemory = Core::TrackedMemory(ioStats.backend == Core::FileReader::Backend::Mmap && volumeData.size > 0
+                                               ? "Volume data (mapped)"
+                                               : "Volume data",
+        Core::MemoryCategory::Volume, Core::MemoryLocation::Cpu, volumeData.size);
+
+    setLoadingProgress(0.8f, "Calculating histogram");
+    genHistogram(histoNumBins, volumeData.data, volumeData.size);
+
+    setLoadingProgress(0.85f, "Building pyramid");
+    volumePyramid.clear();
+    if (volumeData.size >= volumeBytes) {
+        volumePyramid = Core::VolumePyramid::build(volumeData.data, {volumeRes.x, volumeRes.y, volumeRes.z},
+            pyramidFilter, getThreadPool());
+    }
+    // The levels are uploaded as mipmaps, the shader can address at most maxShaderLevels of them.
+    volumePyramid.resize(std::min<std::size_t>(volumePyramid.size(), maxShaderLevels - 1));
+    volumeLevels = static_cast<int>(volumePyramid.size()) + 1;
+
+    setLoadingProgress(0.9f, "Building min/max grid");
+    minMaxGrid = Core::MinMaxGrid();
+    if (volumeData.size >= volumeBytes) {
+        const std::array<uint32_t, 3> resolution = {volumeRes.x, volumeRes.y, volumeRes.z};
+        minMaxGrid = Core::MinMaxGrid::build(volumeData.data, resolution, brickSize, getThreadPool());
+        for (std::size_t l = 0; l + 1 < skipLevels && l < volumePyramid.size(); l++) {
+            const auto& level = volumePyramid[l];
+            const auto levelGrid =
+                Core::MinMaxGrid::build(level.data.data(), level.resolution, brickSize, getThreadPool());
+            minMaxGrid.addLevel(levelGrid, level.resolution, resolution);
+        }
+    }
+    std::size_t pyramidBytes = 0;
+    for (const auto& level : volumePyramid) {
+        pyramidBytes += level.data.size();
+    }
+    volumePyramidMemory = Core::TrackedMemory("Volume pyramid", Core::MemoryCategory::Volume,
+        Core::MemoryLocation::Cpu, pyramidBytes);
+    setLoadingProgress(1.0f, "Uploading volume");
+}
+
+/**
+ * @brief Upload the volume read by readVolumeFile() as 3D texture.
+ */
+void VolumeVis::uploadVolume() {
+    cpuRaycaster.reset();
+    if (brickedVolume != nullptr) {
+        glDeleteTextures(1, &volumeTex);
+        volumeTex = 0;
+        volumeTexMemory.reset();
+        createBrickPool();
+        uploadMinMaxGrid();
+        initHistogramVA();
+        return;
+    }
+    destroyBrickPool();
     if (volumeTex == 0) {
         glGenTextures(1, &volumeTex);
     }
     glBindTexture(GL_TEXTURE_3D, volumeTex);
-    glTexImage3D(GL_TEXTURE_3D, 0, GL_R8, volumeRes.x, volumeRes.y, volumeRes.z, 0, GL_RED, GL_UNSIGNED_BYTE, volumeData.data());
+    // Uploaded in slabs of slices straight from the read data, e.g. the file mapping, so the driver never needs a
+    // staging copy of the whole volume.
+    glTexImage3D(GL_TEXTURE_3D, 0, GL_R8, volumeRes.x, volumeRes.y, volumeRes.z, 0, GL_RED, GL_UNSIGNED_BYTE, nullptr);
+    const std::size_t sliceBytes = static_cast<std::size_t>(volumeRes.x) * volumeRes.y;
+    if (volumeData.size >= sliceBytes * volumeRes.z && sliceBytes > 0) {
+        const auto slabSlices = static_cast<unsigned int>(std::max<std::size_t>(1, uploadSlabBytes / sliceBytes));
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        for (unsigned int z = 0; z < volumeRes.z; z += slabSlices) {
+            const unsigned int slices = std::min(slabSlices, volumeRes.z - z);
+            glTexSubImage3D(GL_TEXTURE_3D, 0, 0, 0, static_cast<GLint>(z), volumeRes.x, volumeRes.y, slices, GL_RED,
+                GL_UNSIGNED_BYTE, volumeData.data + z * sliceBytes);
+        }
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    }
+    // The pyramid has the mipmap sizes, the levels are small compared to the volume and uploaded at once.
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    for (std::size_t l = 0; l < volumePyramid.size(); l++) {
+        const auto& level = volumePyramid[l];
+        glTexImage3D(GL_TEXTURE_3D, static_cast<GLint>(l + 1), GL_R8, level.resolution[0], level.resolution[1],
+            level.resolution[2], 0, GL_RED, GL_UNSIGNED_BYTE, level.data.data());
+    }
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_BASE_LEVEL, 0);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAX_LEVEL, volumeLevels - 1);
+    volumeTexMemory = Core::TrackedMemory("Volume texture", Core::MemoryCategory::Volume, Core::MemoryLocation::Gpu,
+        Core::MemoryTracker::textureBytes(GL_R8, volumeRes.x, volumeRes.y, volumeRes.z, volumeLevels));
+    // The shader selects whole levels, filtering between levels is not needed.
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER,
+        useLinearFilter ? GL_LINEAR_MIPMAP_NEAREST : GL_NEAREST_MIPMAP_NEAREST);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, useLinearFilter ? GL_LINEAR : GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+
+    uploadMinMaxGrid();
+    initHistogramVA();
+
+    // The texture holds the volume now, this also releases the file mapping unless the CPU ray caster shares it.
+    if (cpuRendering && volumeData.size >= sliceBytes * volumeRes.z && sliceBytes > 0) {
+        cpuRaycaster = std::make_unique<Core::VolumeRaycaster>(volumeData,
+            std::array<uint32_t, 3>{volumeRes.x, volumeRes.y, volumeRes.z}, volumeDim);
+    } else {
+        volumeDataMemory.reset();
+    }
+    volumeData = Core::ResourceView();
+    volumePyramid.clear();
+    volumePyramidMemory.reset();
+}
+
+/**
+ * @brief Upload minMaxGrid and create the occupancy texture, which is filled by updateOccupancy().
+ */
+void VolumeVis::uploadMinMaxGrid() {
+    glDeleteTextures(1, &minMaxTex);
+    glDeleteTextures(1, &occupancyTex);
+    minMaxTex = 0;
+    occupancyTex = 0;
+    occupancyValid = false;
+    occupiedCells = 0;
+    skipGridMemory.reset();
+    if (minMaxGrid.empty()) {
+        return;
+    }
+    const auto& cells = minMaxGrid.getCells();
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glGenTextures(1, &minMaxTex);
+    glBindTexture(GL_TEXTURE_3D, minMaxTex);
+    glTexImage3D(GL_TEXTURE_3D, 0, GL_RG8, cells[0], cells[1], cells[2], 0, GL_RG, GL_UNSIGNED_BYTE,
+        minMaxGrid.getMinMax().data());
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glGenTextures(1, &occupancyTex);
+    glBindTexture(GL_TEXTURE_3D, occupancyTex);
+    glTexImage3D(GL_TEXTURE_3D, 0, GL_RG8, cells[0], cells[1], cells[2], 0, GL_RG, GL_UNSIGNED_BYTE, nullptr);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glBindTexture(GL_TEXTURE_3D, 0);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    skipGridMemory = Core::TrackedMemory("Empty space grid", Core::MemoryCategory::Volume, Core::MemoryLocation::Gpu,
+        Core::MemoryTracker::textureBytes(GL_RG8, cells[0], cells[1], cells[2]) +
+            Core::MemoryTracker::textureBytes(GL_RG8, cells[0], cells[1], cells[2]));
+}
+
+/**
+ * @brief Recompute the occupied cells if the view mode, iso value or transfer function changed. A value is visible
+ * if it is not 0 (line of sight, MIP), next to the iso value (isosurface) or has a transfer function opacity > 0.
+ * In volume mode, cells whose range is mapped to a single transfer function value are also marked as homogeneous.
+ */
+void VolumeVis::updateOccupancy() {
+    if (minMaxGrid.empty() ||
+        (occupancyValid && occupancyMode == viewMode && occupancyIso == isoValue && occupancyTf == tfData)) {
+        return;
+    }
+    std::array<bool, 256> visible{};
+    if (viewMode == ViewMode::Isosurface) {
+        // Sample values are the voxel values / 255, both neighbors of the iso value may be interpolated to it.
+        const float iso = isoValue * 255.0f;
+        if (iso >= 0.0f && iso <= 255.0f) {
+            visible[static_cast<std::size_t>(std::floor(iso))] = true;
+            visible[static_cast<std::size_t>(std::ceil(iso))] = true;
+        }
+    } else if (viewMode == ViewMode::Volume && tfData.size() >= 8) {
+        // Values between two transfer function entries are interpolated from both.
+        const std::size_t entries = tfData.size() / 4;
+        for (std::size_t v = 0; v < visible.size(); v++) {
+            const float pos = static_cast<float>(v) / 255.0f * static_cast<float>(entries - 1);
+            const auto i0 = static_cast<std::size_t>(std::floor(pos));
+            const auto i1 = std::min(i0 + 1, entries - 1);
+            visible[v] = tfData[4 * i0 + 3] > 0.0f || tfData[4 * i1 + 3] > 0.0f;
+        }
+    } else {
+        // Without a transfer function every value may be visible.
+        visible.fill(true);
+        visible[0] = viewMode == ViewMode::Volume;
+    }
+    // The mapping changes between v and v + 1 if any entry they are interpolated from differs.
+    std::array<bool, 255> changes{};
+    changes.fill(true);
+    if (viewMode == ViewMode::Volume && tfData.size() >= 8) {
+        const std::size_t entries = tfData.size() / 4;
+        const auto last = static_cast<float>(entries - 1);
+        for (std::size_t v = 0; v < changes.size(); v++) {
+            const auto i0 = static_cast<std::size_t>(std::floor(static_cast<float>(v) / 255.0f * last));
+            const auto i1 = std::min(entries - 1,
+                static_cast<std::size_t>(std::ceil(static_cast<float>(v + 1) / 255.0f * last)));
+            // All entries in [i0, i1] are equal if each one equals its predecessor.
+            changes[v] = !std::equal(tfData.begin() + 4 * (i0 + 1), tfData.begin() + 4 * (i1 + 1),
+                tfData.begin() + 4 * i0);
+        }
+    }
+    const auto occupancy = minMaxGrid.occupancy(visible, getThreadPool());
+    const auto homogeneity = minMaxGrid.homogeneity(changes, getThreadPool());
+    occupiedCells = static_cast<std::size_t>(std::count(occupancy.begin(), occupancy.end(), uint8_t(255)));
+    std::vector<uint8_t> cellFlags(2 * occupancy.size());
+    for (std::size_t c = 0; c < occupancy.size(); c++) {
+        cellFlags[2 * c] = occupancy[c];
+        cellFlags[2 * c + 1] = homogeneity[c];
+    }
+
+    const auto& cells = minMaxGrid.getCells();
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glBindTexture(GL_TEXTURE_3D, occupancyTex);
+    glTexSubImage3D(GL_TEXTURE_3D, 0, 0, 0, 0, cells[0], cells[1], cells[2], GL_RG, GL_UNSIGNED_BYTE,
+        cellFlags.data());
+    glBindTexture(GL_TEXTURE_3D, 0);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+    occupancyValid = true;
+    occupancyMode = viewMode;
+    occupancyIso = isoValue;
+    occupancyTf = tfData;
+}
+
+/**
+ * @brief Read the sample counters of the latest finished frame, without waiting for the GPU.
+ */
+void VolumeVis::readSampleStats() {
+    if (!sampleStats) {
+        statsReadback.reset();
+        return;
+    }
+    std::array<uint32_t, 1 + 2 * sampleStatBins> counters{};
+    bool arrived = false;
+    while (statsReadback.read(counters.data(), sizeof(counters))) {
+        arrived = true;
+    }
+    if (!arrived) {
+        return;
+    }
+
+    statMaxSamples = counters[0];
+    statRays = 0;
+    statSamples = 0;
+    for (std::size_t b = 0; b < sampleStatBins; b++) {
+        statRays += counters[1 + b];
+        statSamples += counters[1 + sampleStatBins + b];
+    }
+}
+
+/**
+ * @brief Create the GPU brick pool and page table for the bricked volume, all bricks are non-resident.
+ */
+void VolumeVis::createBrickPool() {
+    destroyBrickPool();
+    const std::size_t numBricks = brickedVolume->getNumBricks();
+    const uint32_t stored = brickedVolume->getStoredBrickSize();
+    const std::size_t brickBytes = static_cast<std::size_t>(stored) * stored * stored;
+    GLint maxTextureSize = 0;
+    glGetIntegerv(GL_MAX_3D_TEXTURE_SIZE, &maxTextureSize);
+    const auto maxSlots = static_cast<std::size_t>(std::max<GLint>(1, maxTextureSize / static_cast<GLint>(stored)));
+
+    // The pool is a roughly cubic grid of slots within the budget. A pool larger than the volume gets a slot per brick.
+    std::size_t slots = std::max<std::size_t>(1, static_cast<std::size_t>(brickPoolMiB) * 1024 * 1024 / brickBytes);
+    const bool fitsVolume = slots >= numBricks;
+    slots = std::min(slots, numBricks);
+    const auto x = std::clamp<std::size_t>(static_cast<std::size_t>(std::ceil(std::cbrt(slots))), 1, maxSlots);
+    const auto y = std::clamp<std::size_t>(static_cast<std::size_t>(std::ceil(std::sqrt(slots / x))), 1, maxSlots);
+    const auto z = std::clamp<std::size_t>(fitsVolume ? (slots + x * y - 1) / (x * y) : slots / (x * y), 1, maxSlots);
+    brickPoolSlots = glm::uvec3(x, y, z);
+    const glm::uvec3 poolSize = brickPoolSlots * stored;
+
+    glGenTextures(1, &brickPoolTex);
+    glBindTexture(GL_TEXTURE_3D, brickPoolTex);
+    glTexImage3D(GL_TEXTURE_3D, 0, GL_R8, poolSize.x, poolSize.y, poolSize.z, 0, GL_RED, GL_UNSIGNED_BYTE, nullptr);
     glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, useLinearFilter ? GL_LINEAR : GL_NEAREST);
     glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, useLinearFilter ? GL_LINEAR : GL_NEAREST);
     glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
     glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
     glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
 
-    genHistogram(histoNumBins, volumeData);
+    glBindTexture(GL_TEXTURE_3D, 0);
+
+    // The page table covers the bricks of all levels.
+    pageTable.assign(numBricks, 0);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, pageTableBuffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, static_cast<GLsizeiptr>(pageTable.size() * sizeof(uint32_t)),
+        pageTable.data(), GL_DYNAMIC_DRAW);
+
+    // One bit per brick for requested bricks, followed by one bit per brick for used bricks.
+    brickFeedback.assign(2 * ((numBricks + 31) / 32), 0);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, brickFeedbackBuffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, static_cast<GLsizeiptr>(brickFeedback.size() * sizeof(uint32_t)),
+        brickFeedback.data(), GL_DYNAMIC_COPY);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    const std::size_t numSlots = static_cast<std::size_t>(x) * y * z;
+    slotBricks.assign(numSlots, -1);
+    slotLastUsed.assign(numSlots, 0);
+    residentBricks = 0;
+    pendingBricks = 0;
+    brickPoolMemory = Core::TrackedMemory("Brick pool", Core::MemoryCategory::Volume, Core::MemoryLocation::Gpu,
+        Core::MemoryTracker::textureBytes(GL_R8, poolSize.x, poolSize.y, poolSize.z) +
+            (pageTable.size() + (1 + readbackBuffers) * brickFeedback.size()) * sizeof(uint32_t));
+}
+
+/**
+ * @brief Delete the brick pool and page table.
+ */
+void VolumeVis::destroyBrickPool() {
+    glDeleteTextures(1, &brickPoolTex);
+    brickPoolTex = 0;
+    brickPoolSlots = glm::uvec3(0);
+    pageTable.clear();
+    slotBricks.clear();
+    slotLastUsed.clear();
+    brickFeedback.clear();
+    feedbackReadback.reset();
+    feedbackRedraws = 0;
+    residentBricks = 0;
+    pendingBricks = 0;
+    brickPoolMemory.reset();
+}
+
+/**
+ * @brief Stream in the bricks requested by earlier frames. The feedback is read back without waiting for the GPU and
+ * arrives one or more frames late. Bricks used by these frames stay resident, the least recently used other bricks are
+ * replaced.
+ * @param viewProjection  The view projection matrix of the current frame
+ */
+void VolumeVis::updateBricks(const glm::mat4& viewProjection) {
+    brickFrame++;
+    // In on-demand mode, frames are rendered until the feedback of the last view has arrived. Frames that were not
+    // requested here, e.g. after input, and view changes restart the count.
+    if (feedbackRedraws == 0 || viewProjection != feedbackViewProj) {
+        feedbackRedraws = static_cast<int>(readbackBuffers) + 1;
+    }
+    feedbackViewProj = viewProjection;
+
+    // The feedback of all finished frames is merged. Scratch data of this function lives in the frame arena, it runs
+    // every frame.
+    const std::size_t words = brickFeedback.size() / 2;
+    Core::FrameVector<uint32_t> frameFeedback(brickFeedback.size(), 0, Core::ArenaAllocator<uint32_t>(getFrameArena()));
+    std::fill(brickFeedback.begin(), brickFeedback.end(), 0);
+    bool feedbackArrived = false;
+    while (feedbackReadback.read(frameFeedback.data(), frameFeedback.size() * sizeof(uint32_t))) {
+        std::transform(brickFeedback.begin(), brickFeedback.end(), frameFeedback.begin(), brickFeedback.begin(),
+            [](uint32_t a, uint32_t b) { return a | b; });
+        feedbackArrived = true;
+    }
+
+    std::vector<std::size_t> requested;
+    for (std::size_t w = 0; w < words; w++) {
+        for (uint32_t bit = 0; bit < 32; bit++) {
+            const std::size_t brick = w * 32 + bit;
+            if ((brickFeedback[words + w] & (1u << bit)) != 0 && pageTable[brick] != 0) {
+                slotLastUsed[pageTable[brick] - 1] = brickFrame;
+            }
+            if ((brickFeedback[w] & (1u << bit)) != 0 && pageTable[brick] == 0) {
+                requested.push_back(brick);
+            }
+        }
+    }
+    if (!requested.empty()) {
+        // The bricks of the requests are sampled by later frames, which report the bricks still missing.
+        feedbackRedraws = static_cast<int>(readbackBuffers) + 1;
+    }
+    feedbackRedraws--;
+    if (feedbackRedraws > 0) {
+        core_.requestRedraw();
+    }
+
+    // Free slots first, then the least recently used slots not needed by the read back frames.
+    Core::FrameVector<std::size_t> candidates{Core::ArenaAllocator<std::size_t>(getFrameArena())};
+    if (!requested.empty()) {
+        candidates.reserve(slotBricks.size());
+        for (std::size_t s = 0; s < slotBricks.size(); s++) {
+            if (slotBricks[s] < 0 || slotLastUsed[s] < brickFrame) {
+                candidates.push_back(s);
+            }
+        }
+        std::sort(candidates.begin(), candidates.end(), [this](std::size_t a, std::size_t b) {
+            return std::make_pair(slotBricks[a] >= 0, slotLastUsed[a]) < std::make_pair(slotBricks[b] >= 0,
+                                                                             slotLastUsed[b]);
+        });
+    }
+    const std::size_t uploads =
+        std::min({requested.size(), candidates.size(), static_cast<std::size_t>(maxBrickUploads)});
+    if (feedbackArrived) {
+        pendingBricks = requested.size() - uploads;
+    }
+    if (uploads == 0) {
+        return;
+    }
+    requested.resize(uploads);
+
+    // Cache misses are read from disk in parallel.
+    const auto bricks = brickedVolume->getBricks(requested, getThreadPool());
+    const uint32_t stored = brickedVolume->getStoredBrickSize();
+    std::size_t changedBegin = pageTable.size();
+    std::size_t changedEnd = 0;
+    const auto changed = [&](std::size_t brick) {
+        changedBegin = std::min(changedBegin, brick);
+        changedEnd = std::max(changedEnd, brick + 1);
+    };
+    glBindTexture(GL_TEXTURE_3D, brickPoolTex);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    for (std::size_t i = 0; i < uploads; i++) {
+        const std::size_t slot = candidates[i];
+        if (slotBricks[slot] >= 0) {
+            pageTable[static_cast<std::size_t>(slotBricks[slot])] = 0;
+            changed(static_cast<std::size_t>(slotBricks[slot]));
+        } else {
+            residentBricks++;
+        }
+        slotBricks[slot] = static_cast<int64_t>(requested[i]);
+        slotLastUsed[slot] = brickFrame;
+        pageTable[requested[i]] = static_cast<uint32_t>(slot + 1);
+        changed(requested[i]);
+        const auto sx = static_cast<GLint>(slot % brickPoolSlots.x * stored);
+        const auto sy = static_cast<GLint>(slot / brickPoolSlots.x % brickPoolSlots.y * stored);
+        const auto sz = static_cast<GLint>(slot / (brickPoolSlots.x * brickPoolSlots.y) * stored);
+        glTexSubImage3D(GL_TEXTURE_3D, 0, sx, sy, sz, stored, stored, stored, GL_RED, GL_UNSIGNED_BYTE,
+            bricks[i]->data());
+    }
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glBindTexture(GL_TEXTURE_3D, 0);
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, pageTableBuffer);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, static_cast<GLintptr>(changedBegin * sizeof(uint32_t)),
+        static_cast<GLsizeiptr>((changedEnd - changedBegin) * sizeof(uint32_t)), pageTable.data() + changedBegin);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+/**
+ * @brief Convert the loaded raw volume into a bricked volume next to its dat file, in the background.
+ */
+void VolumeVis::convertToBricks() {
+    const auto datFile = datFiles[currentFileLoaded];
+    auto bvolFile = datFile;
+    bvolFile.replace_extension(".bvol");
+    conversionProgress = 0.0f;
+    auto task = std::make_shared<std::packaged_task<void()>>([this, datFile, bvolFile, filter = pyramidFilter]() {
+        auto reader = datraw::raw_reader<char>::open(datFile.string());
+        if (!reader) {
+            throw std::runtime_error("Failed to open volume file!");
+        }
+        const auto info = reader.info();
+        const auto rawFile = rawFilePath(datFile);
+        const std::array<uint32_t, 3> res = {static_cast<uint32_t>(info.resolution()[0]),
+            static_cast<uint32_t>(info.resolution()[1]), static_cast<uint32_t>(info.resolution()[2])};
+        std::error_code ec;
+        if (rawFile.empty() || std::filesystem::file_size(rawFile, ec) != std::size_t(res[0]) * res[1] * res[2]) {
+            throw std::runtime_error("Only uncompressed 8 bit raw volumes can be converted!");
+        }
+        const auto thickness = info.slice_thickness();
+        Core::BrickedVolume::convert(rawFile, res, {thickness[0], thickness[1], thickness[2]}, bvolFile, brickSize,
+            filter, getThreadPool(), [this](float progress) {
+                conversionProgress = progress;
+                core_.requestRedraw();
+            });
+        std::cout << "Converted " << datFile.filename().string() << " to " << bvolFile.filename().string()
+                  << std::endl;
+    });
+    conversion = task->get_future();
+    getThreadPool().submit([task]() { (*task)(); });
 }
 
 /**
  * @brief Create the histogram.
  * @param bins     The number of bins
- * @param values   The vector with the histogram values
+ * @param values   The volume values
+ * @param count    The number of values
  */
-void VolumeVis::genHistogram(std::size_t bins, const std::vector<std::uint8_t>& values) {
-    if (bins == 0 || values.empty()) {
+void VolumeVis::genHistogram(std::size_t bins, const std::uint8_t* values, std::size_t count) {
+    if (bins == 0 || count == 0) {
         return;
     }
     // --------------------------------------------------------------------------------
@@ -494,19 +1413,38 @@ void VolumeVis::genHistogram(std::size_t bins, const std::vector<std::uint8_t>&
     //        therefore the value range is [0, 255].
     //        Divide this value range into "bins" number of bins.
     // --------------------------------------------------------------------------------
-    std::vector<uint32_t> histogram(bins, 0);
+    histogram.assign(bins, 0);
 
     float minValue = 0.0f;
     float maxValue = 255.0f;
     float binSize = (maxValue - minValue) / bins;
 
-    for (auto value : values) {
-        size_t binIndex = static_cast<size_t>((value - minValue) / binSize);
-        binIndex = std::clamp(binIndex, size_t(0), bins - 1);
-        histogram[binIndex]++;
-    }
+    // Each chunk counts into its own histogram, which is added to the result at the end.
+    std::mutex histogramMutex;
+    getThreadPool().parallelFor(0, count, [&](std::size_t begin, std::size_t end) {
+        std::vector<uint32_t> localHistogram(bins, 0);
+        for (std::size_t i = begin; i < end; i++) {
+            size_t binIndex = static_cast<size_t>((values[i] - minValue) / binSize);
+            binIndex = std::clamp(binIndex, size_t(0), bins - 1);
+            localHistogram[binIndex]++;
+        }
+        std::lock_guard<std::mutex> lock(histogramMutex);
+        for (std::size_t b = 0; b < bins; b++) {
+            histogram[b] += localHistogram[b];
+        }
+    }, 1 << 20);
 
     histoMaxBinValue = *std::max_element(histogram.begin(), histogram.end());
+}
+
+/**
+ * @brief Init the histogram vertex array from the histogram calculated by genHistogram().
+ */
+void VolumeVis::initHistogramVA() {
+    if (histogram.empty()) {
+        return;
+    }
+    const std::size_t bins = histogram.size();
 
     std::vector<float> histoVertices;
     for (std::size_t i = 0; i < bins; ++i) {
@@ -556,6 +1494,8 @@ void VolumeVis::initTransferFunc() {
 
     glBindTexture(GL_TEXTURE_1D, tfTex);
     glTexImage1D(GL_TEXTURE_1D, 0, GL_RGBA32F, tfNumPoints, 0, GL_RGBA, GL_FLOAT, transferVertices.data() + 2);
+    tfTexMemory = Core::TrackedMemory("Transfer function", Core::MemoryCategory::Texture, Core::MemoryLocation::Gpu,
+        Core::MemoryTracker::textureBytes(GL_RGBA32F, static_cast<int>(tfNumPoints), 1));
     glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
     glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
     glBindTexture(GL_TEXTURE_1D, 0);
@@ -605,6 +1545,35 @@ void VolumeVis::loadTransferFunc(const std::string& filename) {
     // --------------------------------------------------------------------------------
     //  TODO: Load the transfer function from file "path".
     // --------------------------------------------------------------------------------
+    // Same format as saveTransferFunc(), shared with the CPU ray caster tool.
+    std::vector<float> values;
+    try {
+        values = Core::VolumeRaycaster::readTransferFunction(path);
+    } catch (const std::exception& ex) {
+        std::cerr << ex.what() << std::endl;
+        return;
+    }
+    tfNumPoints = values.size() / 4;
+    tfData = std::move(values);
+    uploadTransferFunc();
+}
+
+/**
+ * @brief Upload tfData into the transfer function texture, entries are sampled with linear interpolation.
+ */
+void VolumeVis::uploadTransferFunc() {
+    if (tfTex == 0) {
+        glGenTextures(1, &tfTex);
+    }
+    const auto entries = static_cast<GLsizei>(tfData.size() / 4);
+    glBindTexture(GL_TEXTURE_1D, tfTex);
+    glTexImage1D(GL_TEXTURE_1D, 0, GL_RGBA32F, entries, 0, GL_RGBA, GL_FLOAT, tfData.data());
+    glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_1D, 0);
+    tfTexMemory = Core::TrackedMemory("Transfer function", Core::MemoryCategory::Texture, Core::MemoryLocation::Gpu,
+        Core::MemoryTracker::textureBytes(GL_RGBA32F, entries, 1));
 }
 
 /**
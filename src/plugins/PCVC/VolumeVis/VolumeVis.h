@@ -1,6 +1,8 @@
 #pragma once
 
+#include <atomic>
 #include <filesystem>
+#include <future>
 #include <memory>
 #include <string>
 #include <vector>
@@ -12,6 +14,13 @@
 #include "core/PluginRegister.h"
 #include "core/RenderPlugin.h"
 #include "core/camera/OrbitCamera.h"
+#include "core/util/BrickedVolume.h"
+#include "core/util/BufferReadback.h"
+#include "core/util/FileReader.h"
+#include "core/util/MemoryTracker.h"
+#include "core/util/MinMaxGrid.h"
+#include "core/util/VolumeRaycaster.h"
+#include "core/util/VolumePyramid.h"
 
 namespace OGL4Core2::Plugins::PCVC::VolumeVis {
 
@@ -26,10 +35,13 @@ namespace OGL4Core2::Plugins::PCVC::VolumeVis {
         explicit VolumeVis(const Core::Core& c);
         ~VolumeVis() override;
 
+        void prepare() override;
+        void finalize() override;
         void render() override;
         void resize(int width, int height) override;
         void keyboard(Core::Key key, Core::KeyAction action, Core::Mods mods) override;
         void mouseMove(double xpos, double ypos) override;
+        void setQuality(float quality) override;
 
     private:
         enum class ViewMode { LineOfSight = 0, Mip = 1, Isosurface = 2, Volume = 3 };
@@ -40,10 +52,27 @@ namespace OGL4Core2::Plugins::PCVC::VolumeVis {
 
         void initVAs();
 
+        void updateFileList();
         void loadVolumeFile(int idx);
-        void genHistogram(std::size_t bins, const std::vector<std::uint8_t>& values);
+        void readVolumeFile(int idx);
+        void uploadVolume();
+        void genHistogram(std::size_t bins, const std::uint8_t* values, std::size_t count);
+        void initHistogramVA();
+
+        void uploadMinMaxGrid();
+        void updateOccupancy();
+
+        void readSampleStats();
+
+        void renderCpu(const glm::mat4& view, const glm::mat4& projection);
+
+        void createBrickPool();
+        void destroyBrickPool();
+        void updateBricks(const glm::mat4& viewProjection);
+        void convertToBricks();
 
         void initTransferFunc();
+        void uploadTransferFunc();
         void updateTransferFunc(int channel, float value);
         void updateTransferFunc(int idx, int channel, float value);
         void loadTransferFunc(const std::string& filename);
@@ -68,9 +97,50 @@ namespace OGL4Core2::Plugins::PCVC::VolumeVis {
         bool showBox;         //!< toggle box drawing
         ViewMode viewMode;
 
+        bool useLod;                               //!< select a coarser level per brick from its projected voxel size
+        float lodBias;                             //!< added to the selected level
+        Core::VolumePyramid::Filter pyramidFilter; //!< filter of the downsampled levels
+        int volumeLevels;                          //!< number of levels of the current volume
+        std::vector<glm::vec3> levelRes;           //!< voxel resolution per level of the bricked volume
+        std::vector<glm::uvec3> levelBrickCount;   //!< bricks per axis per level of the bricked volume
+        std::vector<unsigned int> levelFirstBrick; //!< index of the first brick per level of the bricked volume
+
+        // Empty space skipping: rays skip cells of minMaxGrid without any visible value in the current mode.
+        bool useSkipping;                //!< toggle empty space skipping
+        Core::MinMaxGrid minMaxGrid;     //!< value ranges of the volume per cell of brickSize^3 voxels
+        std::size_t occupiedCells;       //!< cells with visible values
+        bool occupancyValid;             //!< occupancyTex matches the state below
+        ViewMode occupancyMode;          //!< view mode occupancyTex was computed for
+        float occupancyIso;              //!< iso value occupancyTex was computed for
+        std::vector<float> occupancyTf;  //!< transfer function occupancyTex was computed for
+
+        // Ray marching: front-to-back compositing stops at an opacity threshold. Adaptive steps cross cells with a
+        // constant transfer function in one step and refine steps across large opacity changes.
+        bool earlyTermination;   //!< toggle early ray termination
+        float opacityThreshold;  //!< accumulated opacity at which rays terminate
+        bool adaptiveSteps;      //!< toggle adaptive step sizes
+        float refineThreshold;   //!< opacity change between samples that is refined
+        int refineSteps;         //!< substeps of a refined step
+        int isoRefineSteps;      //!< bisection steps of isosurface hits
+
+        // Sample statistics: volume.frag counts the volume samples per pixel, read back a few frames later.
+        bool sampleStats;                   //!< toggle counting samples
+        bool showSampleCount;               //!< show the samples per pixel as heat map
+        Core::BufferReadback statsReadback; //!< delayed readback of sampleStatsBuffer
+        uint64_t statRays;                  //!< rays of the last read back frame
+        uint64_t statSamples;               //!< samples of the last read back frame
+        uint32_t statMaxSamples;            //!< maximum samples of a ray in the last read back frame
+
+        // CPU ray casting: the volume is rendered by cpuRaycaster on the thread pool and blitted into the viewport.
+        bool cpuRendering;                                   //!< toggle the CPU ray caster for in-memory volumes
+        std::unique_ptr<Core::VolumeRaycaster> cpuRaycaster; //!< ray caster of the current volume
+        std::vector<unsigned char> cpuImage;                 //!< image of the last CPU frame
+        double cpuRenderSeconds;                             //!< render time of the last CPU frame
+
         int maxSteps;   //!< Maximum number of integration steps
         float stepSize; //!< Step size
         float scale;    //!< Global scaling factor
+        float quality;  //!< Adaptive quality level, scales the number of samples along a ray
 
         float isoValue;
         glm::vec3 ambientColor;
@@ -94,17 +164,58 @@ namespace OGL4Core2::Plugins::PCVC::VolumeVis {
         std::size_t histoNumBins;  //!< number of bins for histogram
         uint32_t histoMaxBinValue; //!< maximum bin value
 
-        std::unique_ptr<glowl::GLSLProgram> shaderVolume;     //!< shader program for volume rendering
-        std::unique_ptr<glowl::GLSLProgram> shaderBackground; //!< shader program for box rendering
-        std::unique_ptr<glowl::GLSLProgram> shaderHisto;      //!< shader program for histogram rendering
-        std::unique_ptr<glowl::GLSLProgram> shaderTfLines;    //!< shader program for histogram background
-        std::unique_ptr<glowl::GLSLProgram> shaderTfView;     //!< shader program for transfer functions
+        Core::ResourceView volumeData;                         //!< volume read from file, kept until uploaded
+        std::vector<Core::VolumePyramid::Level> volumePyramid; //!< downsampled levels of volumeData
+        Core::FileReader::Backend ioBackend;                   //!< I/O backend for reading raw files
+        Core::FileReader::Stats ioStats;                       //!< throughput of the last volume read
+        std::vector<uint32_t> histogram;                       //!< histogram of the current volume
+
+        // Out-of-core rendering of bricked volumes (.bvol). Bricks touched by rays are reported by volume.frag in a
+        // feedback buffer, read from disk through the LRU cache of brickedVolume and uploaded into a pool texture.
+        std::unique_ptr<Core::BrickedVolume> brickedVolume;
+        int brickCacheMiB;                      //!< CPU brick cache size
+        int brickPoolMiB;                       //!< GPU brick pool size
+        int maxBrickUploads;                    //!< bricks uploaded per frame at most
+        glm::uvec3 brickPoolSlots;              //!< pool size in bricks per axis
+        std::vector<uint32_t> pageTable;        //!< per brick of all levels pool slot + 1, 0 if not resident
+        std::vector<int64_t> slotBricks;        //!< brick per pool slot, -1 if free
+        std::vector<uint64_t> slotLastUsed;     //!< frame in which a slot was last sampled
+        std::vector<uint32_t> brickFeedback;    //!< requested and used brick bitmasks of the last read back frames
+        std::size_t residentBricks;             //!< number of bricks in the pool
+        std::size_t pendingBricks;              //!< bricks requested but not uploaded in the last frame
+        uint64_t brickFrame;                    //!< frame counter for the slot LRU
+        Core::BufferReadback feedbackReadback;  //!< delayed readback of brickFeedbackBuffer
+        glm::mat4 feedbackViewProj;             //!< view projection matrix of the last bricked frame
+        int feedbackRedraws;                    //!< frames to render until the feedback of the last change arrived
+        std::future<void> conversion;           //!< running conversion of a raw volume into bricks
+        std::atomic<float> conversionProgress;  //!< progress of the conversion in [0, 1]
+
+        std::shared_ptr<Core::ShaderProgram> shaderVolume;     //!< shader program for volume rendering
+        std::shared_ptr<Core::ShaderProgram> shaderBackground; //!< shader program for box rendering
+        std::shared_ptr<Core::ShaderProgram> shaderHisto;      //!< shader program for histogram rendering
+        std::shared_ptr<Core::ShaderProgram> shaderTfLines;    //!< shader program for histogram background
+        std::shared_ptr<Core::ShaderProgram> shaderTfView;     //!< shader program for transfer functions
 
         std::unique_ptr<glowl::Mesh> vaQuad;         //!< vertex array for histogram data
         std::unique_ptr<glowl::Mesh> vaHisto;        //!< vertex array for histogram data
         std::unique_ptr<glowl::Mesh> vaTransferFunc; //!< vertex array for transfer functions
 
-        GLuint volumeTex; //!< texture handle for volume data
-        GLuint tfTex;     //!< transfer function texture handle
+        GLuint volumeTex;           //!< texture handle for volume data
+        GLuint tfTex;               //!< transfer function texture handle
+        GLuint minMaxTex;           //!< texture of minMaxGrid
+        GLuint occupancyTex;        //!< texture of the occupied and homogeneous cells of minMaxGrid
+        GLuint brickPoolTex;        //!< texture atlas of resident bricks
+        GLuint pageTableBuffer;     //!< storage buffer of pageTable
+        GLuint brickFeedbackBuffer; //!< storage buffer of brickFeedback, written by volume.frag
+        GLuint sampleStatsBuffer;   //!< storage buffer of the sample counters, written by volume.frag
+        GLuint cpuImageTex;         //!< texture of cpuImage
+        GLuint cpuImageFbo;         //!< framebuffer of cpuImageTex, blitted into the viewport
+
+        Core::TrackedMemory volumeDataMemory;    //!< memory record of volumeData
+        Core::TrackedMemory volumePyramidMemory; //!< memory record of volumePyramid
+        Core::TrackedMemory volumeTexMemory;     //!< memory record of volumeTex
+        Core::TrackedMemory tfTexMemory;         //!< memory record of tfTex
+        Core::TrackedMemory skipGridMemory;      //!< memory record of minMaxTex and occupancyTex
+        Core::TrackedMemory brickPoolMemory;     //!< memory record of the brick pool, page table and feedback
     };
 } // namespace OGL4Core2::Plugins::PCVC::VolumeVis
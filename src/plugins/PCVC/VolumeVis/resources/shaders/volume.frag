@@ -5,9 +5,69 @@
 #define FLT_MAX 3.402823466e+38
 #define FLT_MIN 1.175494351e-38
 
+#define MAX_LEVELS 32
+
 uniform sampler3D volumeTex; //!< 3D texture handle
 uniform sampler1D transferTex;
 
+// Level of detail: level l has 2^l times larger voxels, it is selected per brick of lodBrickSize^3 voxels.
+uniform bool useLod;          //!< select coarser levels for distant bricks
+uniform float lodBias;        //!< added to the selected level
+uniform float lodPixelAngle;  //!< size of a pixel at distance 1
+uniform float lodBrickSize;   //!< voxels per brick and axis for the level selection
+uniform int numLevels;        //!< levels of the volume, mipmap levels of volumeTex or levels of the bricked volume
+
+// Bricked volumes: bricks of brickSize^3 voxels plus a border of one voxel are stored in slots of the brickPool atlas.
+uniform bool bricked;                          //!< sample the brick pool instead of volumeTex
+uniform sampler3D brickPool;                   //!< atlas of resident bricks
+uniform float brickSize;                       //!< voxels per brick and axis, without border
+uniform vec3 levelRes[MAX_LEVELS];             //!< resolution per level
+uniform uvec3 levelBrickCount[MAX_LEVELS];     //!< bricks per axis and level
+uniform uint levelFirstBrick[MAX_LEVELS];      //!< index of the first brick per level
+uniform uvec3 brickPoolSlots;                  //!< slots per axis of the brick pool
+uniform vec3 brickPoolSize;                    //!< size of the brick pool in voxels
+uniform uint feedbackWords;                    //!< size of each bitmask in brickFeedback
+
+// Empty space skipping: cells of skipCellSize^3 voxels, including a border of one voxel, without visible values.
+// The ranges include the values of the first skipLevels levels, samples of coarser levels are never skipped.
+uniform bool useSkipping;       //!< skip empty cells
+uniform int skipLevels;         //!< levels of detail included in the cell ranges
+uniform sampler3D occupancyTex; //!< per cell: r > 0 if any value is visible, g > 0 if all values look the same
+uniform sampler3D minMaxTex;    //!< per cell: minimum and maximum value
+uniform float skipCellSize;     //!< voxels per cell and axis
+uniform vec3 skipGridSize;      //!< cells per axis
+
+// Front-to-back compositing of the volume mode. Transfer function opacities are defined for steps of referenceStep.
+uniform float tfSize;           //!< number of transfer function entries
+uniform float referenceStep;    //!< step size of the transfer function opacities
+uniform bool earlyTermination;  //!< stop rays at opacityThreshold
+uniform float opacityThreshold; //!< accumulated opacity at which rays stop
+uniform bool adaptiveSteps;     //!< cross homogeneous cells in one step, refine steps across opacity changes
+uniform float refineThreshold;  //!< opacity change between two samples that is refined
+uniform int refineSteps;        //!< substeps of a refined step
+uniform int isoRefineSteps;     //!< bisection steps of isosurface hits
+
+uniform bool sampleStats;     //!< count the samples per ray in SampleStats
+uniform bool showSampleCount; //!< show the samples per ray as heat map
+
+// Bitmasks of requested (non-resident) bricks, followed by the bricks sampled by this frame.
+layout(std430, binding = 0) buffer BrickFeedback {
+    uint brickFeedback[];
+};
+
+// Per brick of all levels: slot in the brick pool + 1, 0 if not resident.
+layout(std430, binding = 1) readonly buffer PageTable {
+    uint pageTable[];
+};
+
+// Maximum samples of a ray, rays and samples per bin of pixels. Bins spread the atomics and keep counters small.
+#define STAT_BINS 64u
+layout(std430, binding = 2) buffer SampleStats {
+    uint statMaxSamples;
+    uint statRays[STAT_BINS];
+    uint statSamples[STAT_BINS];
+};
+
 uniform mat4 invViewMx;     //!< inverse view matrix
 uniform mat4 invViewProjMx; //!< inverse view-projection matrix
 
@@ -18,9 +78,10 @@ uniform int viewMode; //<! rendering method: 0: line-of-sight, 1: mip, 2: isosur
 uniform bool showBox;
 uniform bool useRandom;
 
-uniform int maxSteps;   //!< maximum number of steps
-uniform float stepSize; //!< step size
-uniform float scale;    //!< scaling factor
+uniform int maxSteps;       //!< maximum number of steps
+uniform float stepSize;     //!< step size
+uniform float sampleWeight; //!< weight of accumulated samples, compensates larger steps at lower quality
+uniform float scale;        //!< scaling factor
 
 uniform float isovalue; //!< value for iso surface
 
@@ -93,6 +154,162 @@ vec3 mapTexCoords(vec3 pos) {
     return (pos / (volumeDim * scale)) * 0.5 + 0.5;
 }
 
+vec3 eyePos;              // camera position, set in main()
+ivec3 lodBrick = ivec3(-1); // brick of the current level selection
+int lodLevel = 0;           // current level
+int lastBrick = -1;         // last brick reported as used by this ray, the feedback is written when it changes
+int sampleCount = 0;        // volume samples of this ray
+
+/**
+ * Select the level for the brick containing tc: the coarsest level whose voxels still project to at most one pixel
+ * at the brick center. Only computed when the ray enters another brick.
+ * @param tc            The texture coordinates
+ */
+int selectLevel(vec3 tc) {
+    if (!useLod || numLevels <= 1) {
+        return 0;
+    }
+    ivec3 b = ivec3(clamp(tc * volumeRes, vec3(0.5), volumeRes - 0.5) / lodBrickSize);
+    if (b != lodBrick) {
+        lodBrick = b;
+        vec3 center = ((vec3(b) + 0.5) * lodBrickSize / volumeRes - 0.5) * 2.0 * volumeDim * scale;
+        // The largest voxel extent, anisotropic voxels are not made coarser than needed along any axis.
+        vec3 voxel = 2.0 * scale * volumeDim / volumeRes;
+        float pixel = distance(center, eyePos) * lodPixelAngle;
+        lodLevel = clamp(int(floor(log2(pixel / max(max(voxel.x, voxel.y), voxel.z)) + lodBias)), 0, numLevels - 1);
+    }
+    return lodLevel;
+}
+
+/**
+ * Set the bit of a brick in a bitmask of brickFeedback.
+ * @param index         The brick index
+ * @param offset        Offset of the bitmask, 0 for requests, feedbackWords for used bricks
+ */
+void reportBrick(uint index, uint offset) {
+    uint word = (index >> 5u) + offset;
+    uint bit = 1u << (index & 31u);
+    // Most rays hit already reported bricks, the read avoids most atomics.
+    if ((brickFeedback[word] & bit) == 0u) {
+        atomicOr(brickFeedback[word], bit);
+    }
+}
+
+/**
+ * Sample the volume at the level selected for tc, from the brick pool for bricked volumes. Bricks that are not
+ * resident are requested, coarser resident levels are sampled instead. Without any resident level the value is 0.
+ * @param tc            The texture coordinates
+ */
+float sampleVolume(vec3 tc) {
+    sampleCount++;
+    int level = selectLevel(tc);
+    if (!bricked) {
+        return textureLod(volumeTex, tc, float(level)).r;
+    }
+    for (int l = level; l < numLevels; l++) {
+        // Voxel coordinates, clamped to voxel centers like CLAMP_TO_EDGE.
+        vec3 res = levelRes[l];
+        vec3 p = clamp(tc * res, vec3(0.5), res - 0.5);
+        uvec3 count = levelBrickCount[l];
+        uvec3 b = min(uvec3(p / brickSize), count - 1u);
+        uint index = levelFirstBrick[l] + (b.z * count.y + b.y) * count.x + b.x;
+        uint entry = pageTable[index];
+        if (entry == 0u) {
+            reportBrick(index, 0u);
+            continue;
+        }
+        if (int(index) != lastBrick) {
+            lastBrick = int(index);
+            reportBrick(index, feedbackWords);
+        }
+
+        uint slot = entry - 1u;
+        uvec3 s = uvec3(slot % brickPoolSlots.x, (slot / brickPoolSlots.x) % brickPoolSlots.y,
+            slot / (brickPoolSlots.x * brickPoolSlots.y));
+        // Voxel centers of the brick payload start after the border.
+        vec3 local = p - vec3(b) * brickSize + 1.0;
+        return texture(brickPool, (vec3(s) * (brickSize + 2.0) + local) / brickPoolSize).r;
+    }
+    return 0.0;
+}
+
+/**
+ * Cell of the empty space skipping grid containing tc.
+ * @param tc            The texture coordinates
+ */
+ivec3 skipCell(vec3 tc) {
+    return ivec3(min(clamp(tc, 0.0, 1.0) * volumeRes / skipCellSize, skipGridSize - 1.0));
+}
+
+/**
+ * Test if the range of the cell containing tc holds the value sampled at tc, i.e. the level selected for tc is
+ * included in the ranges.
+ * @param tc            The texture coordinates
+ */
+bool rangeHolds(vec3 tc) {
+    return selectLevel(tc) < skipLevels;
+}
+
+/**
+ * Test if the cell containing tc has no visible values in the current mode.
+ * @param tc            The texture coordinates
+ */
+bool cellEmpty(vec3 tc) {
+    return useSkipping && rangeHolds(tc) && texelFetch(occupancyTex, skipCell(tc), 0).r == 0.0;
+}
+
+/**
+ * Ray parameter of the sample after t. In an empty cell, this is the last step inside the cell, so the following
+ * sample is the first one of the next cell. Samples stay on the step grid starting at tnear.
+ * @param r             The ray
+ * @param tnear         The ray parameter of the first sample
+ * @param t             The ray parameter of the current sample
+ * @param tc            The texture coordinates of the current sample
+ * @param empty         Whether the current sample is in an empty cell
+ */
+float nextSample(Ray r, float tnear, float t, vec3 tc, bool empty) {
+    if (!empty) {
+        return t + stepSize;
+    }
+    ivec3 c = skipCell(tc);
+    vec3 lo = (vec3(c) * skipCellSize / volumeRes - 0.5) * 2.0 * volumeDim * scale;
+    vec3 hi = (min(vec3(c + 1) * skipCellSize, volumeRes) / volumeRes - 0.5) * 2.0 * volumeDim * scale;
+    // Axes the ray is parallel to are never crossed, a division by 0 could give NaN.
+    bvec3 zeroDir = equal(r.d, vec3(0.0));
+    vec3 d = mix(r.d, vec3(1.0), zeroDir);
+    vec3 tmax = mix(max((lo - r.o) / d, (hi - r.o) / d), vec3(FLT_MAX), zeroDir);
+    float exit = min(min(tmax.x, tmax.y), tmax.z);
+    return max(t + stepSize, tnear + floor((exit - tnear) / stepSize) * stepSize);
+}
+
+/**
+ * Map a sample value to color and opacity, entry i of the transfer function belongs to the value i / (tfSize - 1).
+ * @param value         The sample value
+ */
+vec4 classify(float value) {
+    return texture(transferTex, (value * (tfSize - 1.0) + 0.5) / tfSize);
+}
+
+/**
+ * Composite a sample behind the accumulated color (premultiplied alpha), its opacity is corrected for a step of
+ * length dt.
+ * @param acc           The accumulated color
+ * @param s             The classified sample
+ * @param dt            The length of the step the sample stands for
+ */
+vec4 composite(vec4 acc, vec4 s, float dt) {
+    float alpha = 1.0 - pow(1.0 - clamp(s.a, 0.0, 1.0), dt / referenceStep);
+    return acc + (1.0 - acc.a) * vec4(alpha * s.rgb, alpha);
+}
+
+/**
+ * Blue to red heat map of the samples of this ray, relative to the step limit.
+ */
+vec3 heatMap() {
+    float x = clamp(float(sampleCount) / float(maxSteps), 0.0, 1.0);
+    return clamp(vec3(2.0 * x - 0.5, 1.0 - abs(2.0 * x - 1.0), 1.5 - 2.0 * x), 0.0, 1.0);
+}
+
 /**
  * Calculate normals based on the volume gradient.
  */
@@ -100,12 +317,11 @@ vec3 calcNormal(vec3 pos) {
     // --------------------------------------------------------------------------------
     //  TODO: Calculate normals based on volume gradient.
     // --------------------------------------------------------------------------------
-    float dx = textureOffset(volumeTex, pos, ivec3(1, 0, 0)).r - 
-               textureOffset(volumeTex, pos, ivec3(-1, 0, 0)).r;
-    float dy = textureOffset(volumeTex, pos, ivec3(0, 1, 0)).r - 
-               textureOffset(volumeTex, pos, ivec3(0, -1, 0)).r;
-    float dz = textureOffset(volumeTex, pos, ivec3(0, 0, 1)).r - 
-               textureOffset(volumeTex, pos, ivec3(0, 0, -1)).r;
+    // Central differences over one voxel of the current level.
+    vec3 texel = exp2(float(lodLevel)) / volumeRes;
+    float dx = sampleVolume(pos + vec3(texel.x, 0.0, 0.0)) - sampleVolume(pos - vec3(texel.x, 0.0, 0.0));
+    float dy = sampleVolume(pos + vec3(0.0, texel.y, 0.0)) - sampleVolume(pos - vec3(0.0, texel.y, 0.0));
+    float dz = sampleVolume(pos + vec3(0.0, 0.0, texel.z)) - sampleVolume(pos - vec3(0.0, 0.0, texel.z));
 
     return normalize(vec3(dx, dy, dz)); 
 }
@@ -153,6 +369,7 @@ void main() {
     // --------------------------------------------------------------------------------
     Ray ray;
     ray.o = (invViewMx * vec4(0.0, 0.0, 0.0, 1.0)).xyz;
+    eyePos = ray.o;
     vec4 worldPoint = invViewProjMx * vec4(texCoords * 2.0 - 1.0, 1.0, 1.0);
     worldPoint /= worldPoint.w;
     ray.d = normalize(worldPoint.xyz - ray.o);
@@ -161,7 +378,8 @@ void main() {
     if (!intersectBox(ray, -0.5 * volumeDim, 0.5 * volumeDim, tnear, tfar)) {
         discard;
     }
-    if (showBox == true && isBoxEdge(ray.o + tfar * ray.d, 0.005)) {
+    bool backEdge = showBox && isBoxEdge(ray.o + tfar * ray.d, 0.005);
+    if (backEdge) {
         color = vec4(0.0, 1.0, 1.0, 1.0);
     }
     // --------------------------------------------------------------------------------
@@ -172,17 +390,16 @@ void main() {
             // --------------------------------------------------------------------------------
             //  TODO: Implement line of sight (LoS) rendering.
             // --------------------------------------------------------------------------------
-            vec3 currentPoint = ray.o + tnear * ray.d;
-            vec3 step = ray.d * stepSize;
-
-            for (float t = tnear; t < tfar && t < tnear + maxSteps * stepSize; t += stepSize) {
-                vec3 texCoord = mapTexCoords(currentPoint);
-                float value = texture(volumeTex, texCoord).r * 0.1;
-
-                color.rgb += vec3(value);
+            // Empty cells only have zeros, they add nothing.
+            for (float t = tnear; t < tfar && t < tnear + maxSteps * stepSize;) {
+                vec3 texCoord = mapTexCoords(ray.o + t * ray.d);
+                bool empty = cellEmpty(texCoord);
+                if (!empty) {
+                    float value = sampleVolume(texCoord) * 0.1 * sampleWeight;
+                    color.rgb += vec3(value);
+                }
                 color.a = 1.0;
-
-                currentPoint += step;
+                t = nextSample(ray, tnear, t, texCoord, empty);
             }
             break;
         }
@@ -190,16 +407,17 @@ void main() {
             // --------------------------------------------------------------------------------
             //  TODO: Implement maximum intensity projection (MIP) rendering.
             // --------------------------------------------------------------------------------
-            vec3 currentPoint = ray.o + tnear * ray.d;
-            vec3 step = ray.d * stepSize;
             float maxValue = 0.0;
 
-            for (float t = tnear; t < tfar && t < tnear + maxSteps * stepSize; t += stepSize) {
-                vec3 texCoord = mapTexCoords(currentPoint);
-                float value = texture(volumeTex, texCoord).r;
-
-                maxValue = max(maxValue, value);
-                currentPoint += step;
+            // Cells whose maximum is not above the current maximum cannot change it.
+            for (float t = tnear; t < tfar && t < tnear + maxSteps * stepSize;) {
+                vec3 texCoord = mapTexCoords(ray.o + t * ray.d);
+                bool empty = useSkipping && rangeHolds(texCoord) &&
+                             texelFetch(minMaxTex, skipCell(texCoord), 0).g <= maxValue;
+                if (!empty) {
+                    maxValue = max(maxValue, sampleVolume(texCoord));
+                }
+                t = nextSample(ray, tnear, t, texCoord, empty);
             }
 
             color = vec4(maxValue,maxValue,maxValue, 1.0);
@@ -209,19 +427,44 @@ void main() {
             // --------------------------------------------------------------------------------
             //  TODO: Implement isosurface rendering.
             // --------------------------------------------------------------------------------
-            vec3 currentPoint = ray.o + tnear * ray.d;
-            vec3 step = ray.d * stepSize;
-
-            float prevValue = texture(volumeTex, mapTexCoords(currentPoint)).r;
-            currentPoint += step;
-
-            for (float t = tnear; t < tfar; t += stepSize) {
+            // Empty cells are completely above or below the iso value, the bound of their range closest to the iso
+            // value stands in for their samples. It has the same side of the iso value, so crossings are found at the
+            // same steps. Stand-in values of a crossing are replaced by samples before the hit is interpolated.
+            float prevValue = 0.0;
+            float prevT = tnear;
+            bool prevEmpty = false;
+            for (float t = tnear; t < tfar && t < tnear + maxSteps * stepSize;) {
+                vec3 currentPoint = ray.o + t * ray.d;
                 vec3 texCoord = mapTexCoords(currentPoint);
-                float currentValue = texture(volumeTex, texCoord).r;
+                bool empty = cellEmpty(texCoord);
+                float currentValue;
+                if (empty) {
+                    vec2 range = texelFetch(minMaxTex, skipCell(texCoord), 0).rg;
+                    currentValue = range.r > isovalue ? range.r : range.g;
+                } else {
+                    currentValue = sampleVolume(texCoord);
+                }
 
-                if ((prevValue - isovalue) * (currentValue - isovalue) < 0.0) {
-                    float delta = (currentValue - isovalue) / (currentValue - prevValue);
-                    vec3 isoPoint = currentPoint - delta * step;
+                if (t > tnear && (prevValue - isovalue) * (currentValue - isovalue) < 0.0) {
+                    // Bisection narrows the step containing the crossing, the hit is interpolated in the last
+                    // interval. Samples in empty cells are on the same side as their stand-in value.
+                    float t0 = prevT;
+                    float t1 = t;
+                    float v0 = prevEmpty ? sampleVolume(mapTexCoords(ray.o + t0 * ray.d)) : prevValue;
+                    float v1 = empty ? sampleVolume(texCoord) : currentValue;
+                    for (int i = 0; i < isoRefineSteps; i++) {
+                        float tm = 0.5 * (t0 + t1);
+                        float vm = sampleVolume(mapTexCoords(ray.o + tm * ray.d));
+                        if ((v0 - isovalue) * (vm - isovalue) <= 0.0) {
+                            t1 = tm;
+                            v1 = vm;
+                        } else {
+                            t0 = tm;
+                            v0 = vm;
+                        }
+                    }
+                    float delta = v1 != v0 ? (v1 - isovalue) / (v1 - v0) : 0.0;
+                    vec3 isoPoint = ray.o + (t1 - delta * (t1 - t0)) * ray.d;
 
                     vec3 normal = calcNormal(mapTexCoords(isoPoint));
 
@@ -234,7 +477,9 @@ void main() {
                     break;
                 }
                 prevValue = currentValue;
-                currentPoint += step;
+                prevT = t;
+                prevEmpty = empty;
+                t = nextSample(ray, tnear, t, texCoord, empty);
             }
             
             if(color.r <0.2 && !(isBoxEdge(ray.o + tnear * ray.d, 0.005) || isBoxEdge(ray.o + tfar * ray.d, 0.005))){
@@ -246,6 +491,46 @@ void main() {
             // --------------------------------------------------------------------------------
             //  TODO: Implement volume rendering.
             // --------------------------------------------------------------------------------
+            // Front-to-back compositing, each sample stands for the step since the previous sample. Empty cells add
+            // nothing. Homogeneous cells are crossed in one step, the last sample in the cell stands for the whole
+            // step. Steps across a large opacity change are split into refineSteps substeps.
+            vec4 acc = vec4(0.0);
+            vec4 prev = vec4(0.0);
+            float prevT = tnear - stepSize;
+            for (float t = tnear; t < tfar && t < tnear + maxSteps * stepSize;) {
+                vec3 texCoord = mapTexCoords(ray.o + t * ray.d);
+                // Without a skipping grid (skipCellSize 0) no cell is empty or homogeneous.
+                vec2 cell = skipCellSize > 0.0 ? texelFetch(occupancyTex, skipCell(texCoord), 0).rg : vec2(1.0, 0.0);
+                bool ranged = rangeHolds(texCoord);
+                bool empty = useSkipping && ranged && cell.r == 0.0;
+                bool homogeneous = adaptiveSteps && ranged && cell.g > 0.0;
+                if (!empty) {
+                    vec4 s = classify(sampleVolume(texCoord));
+                    float dt = t - prevT;
+                    if (adaptiveSteps && t > tnear && abs(s.a - prev.a) > refineThreshold) {
+                        float sub = dt / float(refineSteps);
+                        for (int k = 1; k < refineSteps; k++) {
+                            float tk = prevT + float(k) * sub;
+                            acc = composite(acc, classify(sampleVolume(mapTexCoords(ray.o + tk * ray.d))), sub);
+                        }
+                        acc = composite(acc, s, sub);
+                    } else {
+                        acc = composite(acc, s, dt);
+                    }
+                    prev = s;
+                    if (earlyTermination && acc.a >= opacityThreshold) {
+                        break;
+                    }
+                } else {
+                    prev = vec4(0.0);
+                }
+                prevT = t;
+                t = nextSample(ray, tnear, t, texCoord, empty || homogeneous);
+            }
+            // The back edges of the box are seen through the volume.
+            vec4 behind = backEdge ? vec4(0.0, 1.0, 1.0, 1.0) : vec4(0.0);
+            acc += (1.0 - acc.a) * behind;
+            color = acc.a > 0.0 ? vec4(acc.rgb / acc.a, acc.a) : vec4(0.0);
             break;
         }
         default: {
@@ -257,6 +542,15 @@ void main() {
     if (showBox == true && isBoxEdge(ray.o + tnear * ray.d, 0.005)) {
         color = vec4(0.0, 1.0, 1.0, 1.0);
     }
+    if (showSampleCount) {
+        color = vec4(heatMap(), 1.0);
+    }
+    if (sampleStats) {
+        uint bin = (uint(gl_FragCoord.x) + 7u * uint(gl_FragCoord.y)) % STAT_BINS;
+        atomicAdd(statRays[bin], 1u);
+        atomicAdd(statSamples[bin], uint(sampleCount));
+        atomicMax(statMaxSamples, uint(sampleCount));
+    }
     // --------------------------------------------------------------------------------
     //  TODO: Draw the box lines behind the volume, if the volume is transparent.
     // --------------------------------------------------------------------------------
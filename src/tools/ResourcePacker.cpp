@@ -0,0 +1,56 @@
+#include <cstddef>
+#include <exception>
+#include <filesystem>
+#include <iostream>
+#include <string>
+
+#include <cxxopts.hpp>
+
+#include "core/util/ResourceArchive.h"
+
+// Packs a plugin resources directory into a resource archive, used by the build.
+int main(int argc, char* argv[]) {
+    cxxopts::Options options("OGL4Core2ResourcePacker", "Pack a plugin resources directory into an archive.");
+    // clang-format off
+    options.add_options()
+        ("no-compress", "Store all files uncompressed.")
+        ("compress-max-mb", "Files larger than this are stored uncompressed.", cxxopts::value<std::size_t>())
+        ("dir", "Resources directory.", cxxopts::value<std::string>())
+        ("output", "Archive file.", cxxopts::value<std::string>())
+        ("h,help", "Show help.");
+    // clang-format on
+    options.parse_positional({"dir", "output"});
+    options.positional_help("<dir> <output>");
+
+    OGL4Core2::Core::ResourceArchive::PackOptions packOptions;
+    cxxopts::ParseResult result;
+    try {
+        result = options.parse(argc, argv);
+        if (result.count("no-compress")) {
+            packOptions.compress = !result["no-compress"].as<bool>();
+        }
+        if (result.count("compress-max-mb")) {
+            packOptions.compressMaxSize = result["compress-max-mb"].as<std::size_t>() * 1024 * 1024;
+        }
+    } catch (const std::exception& ex) {
+        std::cerr << "Error parsing options: " << ex.what() << std::endl;
+        std::cerr << options.help() << std::endl;
+        return -1;
+    }
+
+    if (result.count("help") || !result.count("dir") || !result.count("output")) {
+        std::cout << options.help() << std::endl;
+        return result.count("help") ? 0 : -1;
+    }
+
+    const std::filesystem::path output = result["output"].as<std::string>();
+    try {
+        OGL4Core2::Core::ResourceArchive::pack(result["dir"].as<std::string>(), output, packOptions);
+    } catch (const std::exception& ex) {
+        std::cerr << "ResourcePacker Exception: " << ex.what() << std::endl;
+        std::error_code ec;
+        std::filesystem::remove(output, ec);
+        return -1;
+    }
+    return 0;
+}
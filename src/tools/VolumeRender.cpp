@@ -0,0 +1,144 @@
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <exception>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <cxxopts.hpp>
+#include <datraw.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "core/util/ImageUtil.h"
+#include "core/util/ThreadPool.h"
+#include "core/util/VolumeRaycaster.h"
+
+using namespace OGL4Core2::Core;
+
+// Renders a volume with the CPU ray caster of VolumeVis into a PNG image, without OpenGL.
+int main(int argc, char* argv[]) {
+    cxxopts::Options options("OGL4Core2VolumeRender", "Render a volume with the CPU ray caster.");
+    // clang-format off
+    options.add_options()
+        ("dat", "Volume dat file.", cxxopts::value<std::string>())
+        ("output", "PNG file.", cxxopts::value<std::string>())
+        ("m,mode", "Render mode: los, mip, iso or volume.", cxxopts::value<std::string>()->default_value("volume"))
+        ("width", "Image width.", cxxopts::value<int>()->default_value("1024"))
+        ("height", "Image height.", cxxopts::value<int>()->default_value("1024"))
+        ("yaw", "Camera rotation around the y axis in degrees.", cxxopts::value<float>()->default_value("0"))
+        ("pitch", "Camera rotation around the x axis in degrees.", cxxopts::value<float>()->default_value("0"))
+        ("distance", "Camera distance to the volume center.", cxxopts::value<float>()->default_value("2"))
+        ("fovy", "Vertical field of view in degrees.", cxxopts::value<float>()->default_value("45"))
+        ("step", "Step size.", cxxopts::value<float>()->default_value("0.01"))
+        ("max-steps", "Maximum number of steps per ray.", cxxopts::value<int>()->default_value("174"))
+        ("scale", "Global scaling factor.", cxxopts::value<float>()->default_value("0.5"))
+        ("iso", "Iso value.", cxxopts::value<float>()->default_value("0.5"))
+        ("tf", "Transfer function file, required for the volume mode.", cxxopts::value<std::string>())
+        ("threads", "Number of threads, 0 for all cores.", cxxopts::value<std::size_t>()->default_value("0"))
+        ("frames", "Render the image this many times and report the average time.",
+            cxxopts::value<int>()->default_value("1"))
+        ("scalar", "Do not use AVX2.")
+        ("h,help", "Show help.");
+    // clang-format on
+    options.parse_positional({"dat", "output"});
+    options.positional_help("<dat> <output>");
+
+    cxxopts::ParseResult result;
+    try {
+        result = options.parse(argc, argv);
+    } catch (const std::exception& ex) {
+        std::cerr << "Error parsing options: " << ex.what() << std::endl;
+        std::cerr << options.help() << std::endl;
+        return -1;
+    }
+
+    if (result.count("help") || !result.count("dat") || !result.count("output")) {
+        std::cout << options.help() << std::endl;
+        return result.count("help") ? 0 : -1;
+    }
+
+    try {
+        VolumeRaycaster::Settings settings;
+        const auto mode = result["mode"].as<std::string>();
+        if (mode == "los") {
+            settings.mode = VolumeRaycaster::Mode::LineOfSight;
+        } else if (mode == "mip") {
+            settings.mode = VolumeRaycaster::Mode::Mip;
+        } else if (mode == "iso") {
+            settings.mode = VolumeRaycaster::Mode::Isosurface;
+        } else if (mode == "volume") {
+            settings.mode = VolumeRaycaster::Mode::Volume;
+            if (!result.count("tf")) {
+                throw std::runtime_error("The volume mode requires a transfer function!");
+            }
+            settings.transferFunction = VolumeRaycaster::readTransferFunction(result["tf"].as<std::string>());
+        } else {
+            throw std::runtime_error("Unknown mode " + mode + "!");
+        }
+        settings.stepSize = result["step"].as<float>();
+        settings.referenceStep = settings.stepSize;
+        settings.maxSteps = result["max-steps"].as<int>();
+        settings.scale = result["scale"].as<float>();
+        settings.isoValue = result["iso"].as<float>();
+        const int width = result["width"].as<int>();
+        const int height = result["height"].as<int>();
+        if (width <= 0 || height <= 0 || settings.stepSize <= 0.0f || settings.maxSteps <= 0) {
+            throw std::runtime_error("Invalid image size or step size!");
+        }
+
+        // Same dimensions as VolumeVis: slice thickness times resolution, normalized to a maximum of 1.
+        auto reader = datraw::raw_reader<char>::open(result["dat"].as<std::string>());
+        if (!reader) {
+            throw std::runtime_error("Failed to open volume file!");
+        }
+        const auto& info = reader.info();
+        const std::array<uint32_t, 3> resolution = {static_cast<uint32_t>(info.resolution()[0]),
+            static_cast<uint32_t>(info.resolution()[1]), static_cast<uint32_t>(info.resolution()[2])};
+        const auto sliceThickness = info.slice_thickness();
+        glm::vec3 dimensions = glm::vec3(sliceThickness[0] * resolution[0], sliceThickness[1] * resolution[1],
+            sliceThickness[2] * resolution[2]);
+        dimensions /= std::max({dimensions.x, dimensions.y, dimensions.z});
+        auto data = std::make_shared<std::vector<std::uint8_t>>(reader.read_current());
+        ResourceView volume{data, data->data(), data->size()};
+
+        // The orbit camera of VolumeVis looks at the volume center from the given distance.
+        const float distance = result["distance"].as<float>();
+        const float pitch = glm::radians(result["pitch"].as<float>());
+        const float yaw = glm::radians(result["yaw"].as<float>());
+        const glm::mat4 viewMx = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, -distance)) *
+                                 glm::rotate(glm::mat4(1.0f), pitch, glm::vec3(1.0f, 0.0f, 0.0f)) *
+                                 glm::rotate(glm::mat4(1.0f), yaw, glm::vec3(0.0f, 1.0f, 0.0f));
+        const glm::mat4 projectionMx = glm::perspective(glm::radians(result["fovy"].as<float>()),
+            static_cast<float>(width) / static_cast<float>(height), 0.1f, 10.0f);
+
+        VolumeRaycaster raycaster(volume, resolution, dimensions, !result.count("scalar"));
+        std::size_t threads = result["threads"].as<std::size_t>();
+        if (threads == 0) {
+            threads = std::max(1u, std::thread::hardware_concurrency());
+        }
+        ThreadPool pool(threads);
+
+        const int frames = std::max(1, result["frames"].as<int>());
+        std::vector<unsigned char> image;
+        const auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < frames; i++) {
+            raycaster.render(settings, viewMx, projectionMx, width, height, image, pool);
+        }
+        const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::cout << "Rendered " << width << "x" << height << " in " << seconds * 1000.0 / frames << " ms ("
+                  << (raycaster.usesAvx2() ? "AVX2" : "scalar") << ", " << threads << " threads)" << std::endl;
+
+        ImageUtil::savePngImage(result["output"].as<std::string>(), std::move(image), width, height);
+    } catch (const std::exception& ex) {
+        std::cerr << "VolumeRender Exception: " << ex.what() << std::endl;
+        return -1;
+    }
+    return 0;
+}
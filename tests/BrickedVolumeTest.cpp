@@ -0,0 +1,191 @@
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+#include "TestUtil.h"
+#include "core/util/BrickedVolume.h"
+#include "core/util/MinMaxGrid.h"
+#include "core/util/ThreadPool.h"
+#include "core/util/VolumePyramid.h"
+
+using namespace OGL4Core2::Core;
+using namespace OGL4Core2::Test;
+
+namespace {
+    // Not a multiple of the brick size, so the last bricks per axis are padded. Levels: 21x13x9, 10x6x4, 5x3x2.
+    constexpr std::array<uint32_t, 3> resolution = {21, 13, 9};
+    constexpr uint32_t brickSize = 8;
+    constexpr uint32_t numLevels = 3;
+    constexpr std::size_t numBricks = 3 * 2 * 2 + 2 * 1 * 1 + 1;
+    // Offset of the version in the file header, after the magic. There is a single version, 1.
+    constexpr std::streamoff versionOffset = 8;
+
+    void writeRaw(const std::filesystem::path& path, const std::vector<uint8_t>& data) {
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        out.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+    }
+
+    void writeVersion(const std::filesystem::path& path, uint32_t version) {
+        std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+        file.seekp(versionOffset);
+        file.write(reinterpret_cast<const char*>(&version), sizeof(version));
+    }
+
+    /**
+     * Volume converted with the default settings of this test, removed again when it goes out of scope.
+     */
+    struct ConvertedVolume {
+        TempFile raw{"bricked.raw"};
+        TempFile bvol{"bricked.bvol"};
+        std::vector<uint8_t> data = randomVolume(resolution, 42);
+
+        explicit ConvertedVolume(ThreadPool& pool) {
+            writeRaw(raw.path(), data);
+            BrickedVolume::convert(raw.path(), resolution, {1.0f, 1.0f, 2.0f}, bvol.path(), brickSize,
+                VolumePyramid::Filter::Box, pool);
+        }
+    };
+
+    /**
+     * Stored voxels of a brick as expected from the volume: the payload, its border of one voxel and the padding
+     * beyond the volume are all clamped to the volume.
+     */
+    std::vector<uint8_t> expectedBrick(const std::vector<uint8_t>& data, const std::array<uint32_t, 3>& res,
+        uint32_t bx, uint32_t by, uint32_t bz) {
+        const uint32_t stored = brickSize + 2 * BrickedVolume::border;
+        const auto voxel = [&](uint32_t b, uint32_t s, uint32_t size) {
+            const int64_t v = static_cast<int64_t>(b) * brickSize + s - BrickedVolume::border;
+            return static_cast<std::size_t>(std::clamp<int64_t>(v, 0, size - 1));
+        };
+        std::vector<uint8_t> brick;
+        for (uint32_t sz = 0; sz < stored; sz++) {
+            for (uint32_t sy = 0; sy < stored; sy++) {
+                for (uint32_t sx = 0; sx < stored; sx++) {
+                    const std::size_t x = voxel(bx, sx, res[0]);
+                    const std::size_t y = voxel(by, sy, res[1]);
+                    const std::size_t z = voxel(bz, sz, res[2]);
+                    brick.push_back(data[(z * res[1] + y) * res[0] + x]);
+                }
+            }
+        }
+        return brick;
+    }
+
+    void testRoundTrip() {
+        ThreadPool pool(4);
+        ConvertedVolume volume(pool);
+        BrickedVolume bricked(volume.bvol.path(), 1024 * 1024);
+
+        OGL4CORE2_CHECK(bricked.getResolution() == resolution);
+        OGL4CORE2_CHECK((bricked.getSliceThickness() == std::array<float, 3>{1.0f, 1.0f, 2.0f}));
+        OGL4CORE2_CHECK(bricked.getBrickSize() == brickSize);
+        OGL4CORE2_CHECK(bricked.getStoredBrickSize() == brickSize + 2);
+        OGL4CORE2_CHECK(bricked.getNumLevels() == numLevels);
+        OGL4CORE2_CHECK(bricked.getNumBricks() == numBricks);
+
+        // Each level is downsampled from the previous one, exactly like the pyramid of the in-memory path.
+        const auto pyramid = VolumePyramid::build(volume.data.data(), resolution, VolumePyramid::Filter::Box, pool);
+        std::size_t firstBrick = 0;
+        for (uint32_t l = 0; l < numLevels; l++) {
+            const auto& data = l == 0 ? volume.data : pyramid[l - 1].data;
+            const auto res = VolumePyramid::levelResolution(resolution, l);
+            const auto& count = bricked.getBrickCount(l);
+            OGL4CORE2_CHECK(bricked.getLevelResolution(l) == res);
+            OGL4CORE2_CHECK(bricked.getLevelFirstBrick(l) == firstBrick);
+            for (int i = 0; i < 3; i++) {
+                OGL4CORE2_CHECK(count[i] == (res[i] + brickSize - 1) / brickSize);
+            }
+            firstBrick += static_cast<std::size_t>(count[0]) * count[1] * count[2];
+
+            // The stored ranges include the border, so they match a grid built from the voxels.
+            const auto expectedGrid = MinMaxGrid::build(data.data(), res, brickSize, pool);
+            const auto& grid = bricked.getMinMaxGrid(l);
+            OGL4CORE2_CHECK(grid.getCells() == count);
+            OGL4CORE2_CHECK(grid.getMinMax() == expectedGrid.getMinMax());
+
+            for (uint32_t bz = 0; bz < count[2]; bz++) {
+                for (uint32_t by = 0; by < count[1]; by++) {
+                    for (uint32_t bx = 0; bx < count[0]; bx++) {
+                        const std::size_t index = bricked.brickIndex(bx, by, bz, l);
+                        const auto brick = bricked.getBrick(index);
+                        OGL4CORE2_CHECK(*brick == expectedBrick(data, res, bx, by, bz));
+                        const auto [lo, hi] = std::minmax_element(brick->begin(), brick->end());
+                        const std::size_t cell = index - bricked.getLevelFirstBrick(l);
+                        OGL4CORE2_CHECK(grid.getMinMax()[2 * cell] == *lo);
+                        OGL4CORE2_CHECK(grid.getMinMax()[2 * cell + 1] == *hi);
+                    }
+                }
+            }
+        }
+        OGL4CORE2_CHECK(firstBrick == numBricks);
+
+        // Each voxel is counted once, padding and borders are not.
+        std::array<uint64_t, BrickedVolume::histogramBins> histogram{};
+        for (const auto v : volume.data) {
+            histogram[v]++;
+        }
+        OGL4CORE2_CHECK(bricked.getHistogram() == histogram);
+        OGL4CORE2_CHECK_THROWS(static_cast<void>(bricked.getBrick(numBricks)));
+    }
+
+    void testInvalidFiles() {
+        ThreadPool pool(2);
+        ConvertedVolume volume(pool);
+
+        for (const uint32_t version : {0u, 2u, 3u}) {
+            writeVersion(volume.bvol.path(), version);
+            OGL4CORE2_CHECK_THROWS(BrickedVolume(volume.bvol.path(), 0));
+        }
+        writeVersion(volume.bvol.path(), 1);
+        OGL4CORE2_CHECK(BrickedVolume(volume.bvol.path(), 0).getNumBricks() == numBricks);
+
+        // Bricks of the last level missing.
+        std::filesystem::resize_file(volume.bvol.path(), std::filesystem::file_size(volume.bvol.path()) / 2);
+        OGL4CORE2_CHECK_THROWS(BrickedVolume(volume.bvol.path(), 0));
+        std::filesystem::resize_file(volume.bvol.path(), 16);
+        OGL4CORE2_CHECK_THROWS(BrickedVolume(volume.bvol.path(), 0));
+
+        OGL4CORE2_CHECK_THROWS(BrickedVolume::convert(volume.raw.path(), resolution, {1.0f, 1.0f, 1.0f},
+            volume.bvol.path(), 0, VolumePyramid::Filter::Box, pool));
+        OGL4CORE2_CHECK_THROWS(BrickedVolume::convert(volume.raw.path(), {21, 13, 10}, {1.0f, 1.0f, 1.0f},
+            volume.bvol.path(), brickSize, VolumePyramid::Filter::Box, pool));
+    }
+
+    void testCache() {
+        ThreadPool pool(2);
+        ConvertedVolume volume(pool);
+        const std::size_t brickBytes = 10 * 10 * 10;
+        BrickedVolume bricked(volume.bvol.path(), 2 * brickBytes);
+
+        static_cast<void>(bricked.getBrick(0));
+        static_cast<void>(bricked.getBrick(1));
+        static_cast<void>(bricked.getBrick(0));
+        static_cast<void>(bricked.getBrick(2));
+        auto stats = bricked.getCacheStats();
+        OGL4CORE2_CHECK(stats.hits == 1 && stats.misses == 3);
+        OGL4CORE2_CHECK(stats.evictions == 1 && stats.bricks == 2 && stats.bytes == 2 * brickBytes);
+
+        // Brick 1 was the least recently used one.
+        static_cast<void>(bricked.getBrick(0));
+        static_cast<void>(bricked.getBrick(1));
+        stats = bricked.getCacheStats();
+        OGL4CORE2_CHECK(stats.hits == 2 && stats.misses == 4);
+
+        const auto bricks = bricked.getBricks({3, 4, 5, 3}, pool);
+        OGL4CORE2_CHECK(bricks.size() == 4 && *bricks[0] == *bricks[3]);
+        bricked.setCacheCapacity(0);
+        stats = bricked.getCacheStats();
+        OGL4CORE2_CHECK(stats.bricks == 1 && stats.capacity == 0);
+    }
+} // namespace
+
+int main() {
+    return runTests({
+        {"BrickedVolume round trip", testRoundTrip},
+        {"BrickedVolume invalid files", testInvalidFiles},
+        {"BrickedVolume cache", testCache},
+    });
+}
@@ -0,0 +1,225 @@
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include "TestUtil.h"
+#include "core/util/MinMaxGrid.h"
+#include "core/util/ThreadPool.h"
+#include "core/util/VolumePyramid.h"
+
+using namespace OGL4Core2::Core;
+using namespace OGL4Core2::Test;
+
+namespace {
+    using Resolution = std::array<uint32_t, 3>;
+
+    // Not a multiple of the cell size, so the last cells per axis are partial.
+    constexpr Resolution resolution = {93, 77, 61};
+    constexpr uint32_t cellSize = 8;
+    // Tolerance of the interpolated values, the ranges themselves are exact.
+    constexpr float epsilon = 1.0e-3f;
+
+    /**
+     * A ramp along x in the lower half, so the ranges are narrow and samples attributed to the wrong cell are out of
+     * range. The upper half is empty except for a small dense block, so there is something to skip.
+     */
+    std::vector<uint8_t> makeVolume() {
+        std::vector<uint8_t> data(static_cast<std::size_t>(resolution[0]) * resolution[1] * resolution[2], 0);
+        for (uint32_t z = 0; z < resolution[2]; z++) {
+            for (uint32_t y = 0; y < resolution[1]; y++) {
+                for (uint32_t x = 0; x < resolution[0]; x++) {
+                    uint8_t v = 0;
+                    if (z < 20) {
+                        v = static_cast<uint8_t>(x * x * 200 / ((resolution[0] - 1) * (resolution[0] - 1)) + 2 * z);
+                    } else if (x >= 60 && x < 64 && y >= 50 && y < 54 && z >= 44 && z < 48) {
+                        v = 255;
+                    }
+                    data[(static_cast<std::size_t>(z) * resolution[1] + y) * resolution[0] + x] = v;
+                }
+            }
+        }
+        return data;
+    }
+
+    std::size_t countEmpty(const MinMaxGrid& grid) {
+        std::size_t empty = 0;
+        for (std::size_t c = 0; c < grid.getNumCells(); c++) {
+            empty += grid.getMinMax()[2 * c + 1] == 0 ? 1 : 0;
+        }
+        return empty;
+    }
+
+    /**
+     * Trilinear texture lookup with clamp to edge, as the ray caster samples the volume.
+     */
+    float sample(const std::vector<uint8_t>& data, const Resolution& res, const std::array<float, 3>& tc) {
+        std::array<int64_t, 3> i0{};
+        std::array<float, 3> f{};
+        for (int a = 0; a < 3; a++) {
+            const float p = tc[a] * static_cast<float>(res[a]) - 0.5f;
+            const float fl = std::floor(p);
+            i0[a] = static_cast<int64_t>(fl);
+            f[a] = p - fl;
+        }
+        float value = 0.0f;
+        for (int c = 0; c < 8; c++) {
+            float w = 1.0f;
+            std::array<std::size_t, 3> v{};
+            for (int a = 0; a < 3; a++) {
+                const int b = (c >> a) & 1;
+                v[a] = static_cast<std::size_t>(std::clamp<int64_t>(i0[a] + b, 0, res[a] - 1));
+                w *= b ? f[a] : 1.0f - f[a];
+            }
+            value += w * static_cast<float>(data[(v[2] * res[1] + v[1]) * res[0] + v[0]]);
+        }
+        return value;
+    }
+
+    /**
+     * Count samples of the given levels outside the range of their cell. Samples are taken at random texture
+     * coordinates and on the cell borders, where neighboring cells meet.
+     */
+    std::size_t countOutOfRange(const MinMaxGrid& grid, const std::vector<uint8_t>& data,
+        const std::vector<VolumePyramid::Level>& pyramid, uint32_t levels) {
+        std::mt19937 rng(11);
+        std::uniform_real_distribution<float> dist(0.0f, 1.0f);
+        std::uniform_int_distribution<uint32_t> borderDist(0, 12);
+        const auto& cells = grid.getCells();
+        std::size_t outOfRange = 0;
+        for (int n = 0; n < 100000; n++) {
+            std::array<float, 3> tc = {dist(rng), dist(rng), dist(rng)};
+            if (n % 2 == 0) {
+                const int a = n / 2 % 3;
+                tc[a] = std::min(1.0f, static_cast<float>(borderDist(rng) * cellSize) / resolution[a]);
+            }
+            std::array<std::size_t, 3> c{};
+            for (int a = 0; a < 3; a++) {
+                c[a] = std::min<std::size_t>(static_cast<std::size_t>(tc[a] * resolution[a] / cellSize), cells[a] - 1);
+            }
+            const uint8_t* range = grid.getMinMax().data() + 2 * ((c[2] * cells[1] + c[1]) * cells[0] + c[0]);
+            for (uint32_t l = 0; l < levels; l++) {
+                const float v = l == 0 ? sample(data, resolution, tc)
+                                       : sample(pyramid[l - 1].data, pyramid[l - 1].resolution, tc);
+                if (v < range[0] - epsilon || v > range[1] + epsilon) {
+                    outOfRange++;
+                }
+            }
+        }
+        return outOfRange;
+    }
+
+    void testBuild() {
+        ThreadPool pool(4);
+        const auto data = makeVolume();
+        const auto grid = MinMaxGrid::build(data.data(), resolution, cellSize, pool);
+        OGL4CORE2_CHECK((grid.getCells() == Resolution{12, 10, 8}));
+        OGL4CORE2_CHECK(grid.getNumCells() == 12 * 10 * 8);
+        OGL4CORE2_CHECK(grid.getCellSize() == cellSize);
+        OGL4CORE2_CHECK(grid.getLevels() == 1);
+        OGL4CORE2_CHECK(!grid.empty());
+
+        // Ranges are exactly those of the voxels of the cell and the one voxel border around it.
+        const auto& cells = grid.getCells();
+        for (uint32_t cz = 0; cz < cells[2]; cz++) {
+            for (uint32_t cy = 0; cy < cells[1]; cy++) {
+                for (uint32_t cx = 0; cx < cells[0]; cx++) {
+                    const std::array<uint32_t, 3> c = {cx, cy, cz};
+                    std::array<uint32_t, 3> begin{};
+                    std::array<uint32_t, 3> end{};
+                    for (int a = 0; a < 3; a++) {
+                        begin[a] = c[a] * cellSize > 0 ? c[a] * cellSize - 1 : 0;
+                        end[a] = std::min((c[a] + 1) * cellSize + 1, resolution[a]);
+                    }
+                    uint8_t lo = 255;
+                    uint8_t hi = 0;
+                    for (uint32_t z = begin[2]; z < end[2]; z++) {
+                        for (uint32_t y = begin[1]; y < end[1]; y++) {
+                            for (uint32_t x = begin[0]; x < end[0]; x++) {
+                                const uint8_t v = data[(static_cast<std::size_t>(z) * resolution[1] + y) *
+                                                           resolution[0] + x];
+                                lo = std::min(lo, v);
+                                hi = std::max(hi, v);
+                            }
+                        }
+                    }
+                    const std::size_t index = (static_cast<std::size_t>(cz) * cells[1] + cy) * cells[0] + cx;
+                    OGL4CORE2_CHECK(grid.getMinMax()[2 * index] == lo);
+                    OGL4CORE2_CHECK(grid.getMinMax()[2 * index + 1] == hi);
+                }
+            }
+        }
+        // Otherwise the test would not cover skipping.
+        OGL4CORE2_CHECK(countEmpty(grid) > grid.getNumCells() / 3);
+
+        // No sample of the full resolution is outside the range of its cell.
+        OGL4CORE2_CHECK(countOutOfRange(grid, data, {}, 1) == 0);
+    }
+
+    void testLevels() {
+        ThreadPool pool(4);
+        const auto data = makeVolume();
+        const auto pyramid = VolumePyramid::build(data.data(), resolution, VolumePyramid::Filter::Gaussian, pool);
+        auto grid = MinMaxGrid::build(data.data(), resolution, cellSize, pool);
+        const std::size_t emptyBefore = countEmpty(grid);
+
+        // Samples of coarser levels reach beyond the cell, the ranges of the full resolution do not hold for them.
+        OGL4CORE2_CHECK(countOutOfRange(grid, data, pyramid, 3) > 0);
+
+        for (uint32_t l = 0; l < 2; l++) {
+            const auto& level = pyramid[l];
+            grid.addLevel(MinMaxGrid::build(level.data.data(), level.resolution, cellSize, pool), level.resolution,
+                resolution);
+        }
+        OGL4CORE2_CHECK(grid.getLevels() == 3);
+        OGL4CORE2_CHECK(countOutOfRange(grid, data, pyramid, 3) == 0);
+
+        // Widened, but not to everything, otherwise skipping would be pointless.
+        const std::size_t emptyCells = countEmpty(grid);
+        OGL4CORE2_CHECK(emptyCells > 0 && emptyCells < emptyBefore);
+
+        // The cell size is in voxels of each level, the level grid must match the level resolution.
+        const auto& level = pyramid[2];
+        const auto levelGrid = MinMaxGrid::build(level.data.data(), level.resolution, cellSize, pool);
+        OGL4CORE2_CHECK_THROWS(grid.addLevel(levelGrid, pyramid[1].resolution, resolution));
+        OGL4CORE2_CHECK_THROWS(grid.addLevel(MinMaxGrid::build(level.data.data(), level.resolution, 4, pool),
+            level.resolution, resolution));
+        OGL4CORE2_CHECK_THROWS(MinMaxGrid().addLevel(levelGrid, level.resolution, resolution));
+        OGL4CORE2_CHECK(grid.getLevels() == 3);
+    }
+
+    void testOccupancy() {
+        ThreadPool pool(2);
+        // One cell per kind of range: empty, dense and partial.
+        const MinMaxGrid grid({3, 1, 1}, cellSize, {0, 0, 255, 255, 0, 200});
+        std::array<bool, 256> visible{};
+        visible[255] = true;
+        OGL4CORE2_CHECK((grid.occupancy(visible, pool) == std::vector<uint8_t>{0, 255, 0}));
+        visible[100] = true;
+        OGL4CORE2_CHECK((grid.occupancy(visible, pool) == std::vector<uint8_t>{0, 255, 255}));
+
+        OGL4CORE2_CHECK_THROWS(MinMaxGrid({2, 1, 1}, cellSize, {0, 0}));
+        OGL4CORE2_CHECK_THROWS(static_cast<void>(MinMaxGrid::build(nullptr, resolution, 0, pool)));
+    }
+
+    void testHomogeneity() {
+        ThreadPool pool(2);
+        const MinMaxGrid grid({3, 1, 1}, cellSize, {0, 0, 255, 255, 0, 200});
+        std::array<bool, 255> changes{};
+        OGL4CORE2_CHECK((grid.homogeneity(changes, pool) == std::vector<uint8_t>{255, 255, 255}));
+        // Only the partial cell contains both values around the change.
+        changes[150] = true;
+        OGL4CORE2_CHECK((grid.homogeneity(changes, pool) == std::vector<uint8_t>{255, 255, 0}));
+    }
+} // namespace
+
+int main() {
+    return runTests({
+        {"MinMaxGrid build", testBuild},
+        {"MinMaxGrid levels", testLevels},
+        {"MinMaxGrid occupancy", testOccupancy},
+        {"MinMaxGrid homogeneity", testHomogeneity},
+    });
+}
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <exception>
+#include <filesystem>
+#include <functional>
+#include <initializer_list>
+#include <iostream>
+#include <random>
+#include <string>
+#include <system_error>
+#include <vector>
+
+namespace OGL4Core2::Test {
+    /**
+     * Minimal test harness without dependencies. Each test executable runs its test functions through runTests(),
+     * failed checks are reported and make the executable return a non-zero exit code for CTest.
+     */
+    inline int& failures() {
+        static int count = 0;
+        return count;
+    }
+
+    inline void check(bool condition, const std::string& message, const char* file, int line) {
+        if (!condition) {
+            std::cerr << file << ":" << line << ": check failed: " << message << std::endl;
+            failures()++;
+        }
+    }
+
+    /**
+     * Temporary file, removed again when it goes out of scope.
+     */
+    class TempFile {
+    public:
+        explicit TempFile(const std::string& name)
+            : path_(std::filesystem::temp_directory_path() / ("ogl4core2_test_" + name)) {}
+
+        ~TempFile() {
+            std::error_code ec;
+            std::filesystem::remove(path_, ec);
+        }
+
+        TempFile(const TempFile&) = delete;
+        TempFile& operator=(const TempFile&) = delete;
+
+        [[nodiscard]] inline const std::filesystem::path& path() const {
+            return path_;
+        }
+
+    private:
+        std::filesystem::path path_;
+    };
+
+    /**
+     * Volume of random 8 bit values, x fastest. The same seed gives the same volume.
+     */
+    inline std::vector<uint8_t> randomVolume(const std::array<uint32_t, 3>& resolution, uint32_t seed) {
+        std::vector<uint8_t> data(static_cast<std::size_t>(resolution[0]) * resolution[1] * resolution[2]);
+        std::mt19937 rng(seed);
+        std::uniform_int_distribution<int> dist(0, 255);
+        for (auto& v : data) {
+            v = static_cast<uint8_t>(dist(rng));
+        }
+        return data;
+    }
+
+    struct TestCase {
+        const char* name;
+        std::function<void()> run;
+    };
+
+    /**
+     * Run all tests, exceptions count as failures. Returns the exit code of the test executable.
+     */
+    inline int runTests(std::initializer_list<TestCase> tests) {
+        for (const auto& test : tests) {
+            const int before = failures();
+            try {
+                test.run();
+            } catch (const std::exception& ex) {
+                std::cerr << test.name << ": unexpected exception: " << ex.what() << std::endl;
+                failures()++;
+            }
+            std::cout << (failures() == before ? "[pass] " : "[FAIL] ") << test.name << std::endl;
+        }
+        return failures() == 0 ? 0 : 1;
+    }
+} // namespace OGL4Core2::Test
+
+#define OGL4CORE2_CHECK(condition) OGL4Core2::Test::check((condition), #condition, __FILE__, __LINE__)
+
+/**
+ * Check that statement throws std::exception.
+ */
+#define OGL4CORE2_CHECK_THROWS(statement) \
+    do { \
+        bool thrown = false; \
+        try { \
+            statement; \
+        } catch (const std::exception&) { \
+            thrown = true; \
+        } \
+        OGL4Core2::Test::check(thrown, #statement " throws", __FILE__, __LINE__); \
+    } while (false)
@@ -0,0 +1,106 @@
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include "TestUtil.h"
+#include "core/util/ThreadPool.h"
+#include "core/util/VolumePyramid.h"
+
+using namespace OGL4Core2::Core;
+using namespace OGL4Core2::Test;
+
+namespace {
+    using Resolution = std::array<uint32_t, 3>;
+
+    void testLevelResolution() {
+        // Like the mipmap levels of a 3D texture: halved and rounded down, at least 1.
+        const Resolution res = {21, 13, 9};
+        OGL4CORE2_CHECK(VolumePyramid::levelResolution(res, 0) == res);
+        OGL4CORE2_CHECK((VolumePyramid::levelResolution(res, 1) == Resolution{10, 6, 4}));
+        OGL4CORE2_CHECK((VolumePyramid::levelResolution(res, 2) == Resolution{5, 3, 2}));
+        OGL4CORE2_CHECK((VolumePyramid::levelResolution(res, 3) == Resolution{2, 1, 1}));
+        OGL4CORE2_CHECK((VolumePyramid::levelResolution(res, 4) == Resolution{1, 1, 1}));
+        OGL4CORE2_CHECK((VolumePyramid::levelResolution(res, 40) == Resolution{1, 1, 1}));
+        OGL4CORE2_CHECK(VolumePyramid::numLevels(res) == 5);
+
+        OGL4CORE2_CHECK(VolumePyramid::numLevels({1, 1, 1}) == 1);
+        OGL4CORE2_CHECK(VolumePyramid::numLevels({2, 1, 1}) == 2);
+        OGL4CORE2_CHECK(VolumePyramid::numLevels({1, 1, 256}) == 9);
+        OGL4CORE2_CHECK(VolumePyramid::numLevels({255, 3, 1}) == 8);
+        OGL4CORE2_CHECK((VolumePyramid::levelResolution({1, 1, 256}, 8) == Resolution{1, 1, 1}));
+        OGL4CORE2_CHECK((VolumePyramid::levelResolution({0xffffffffu, 1, 1}, 31) == Resolution{1, 1, 1}));
+    }
+
+    void testBuild() {
+        ThreadPool pool(4);
+        const Resolution res = {21, 13, 9};
+        const auto data = randomVolume(res, 7);
+        for (const auto filter : {VolumePyramid::Filter::Box, VolumePyramid::Filter::Gaussian}) {
+            const auto levels = VolumePyramid::build(data.data(), res, filter, pool);
+            OGL4CORE2_CHECK(levels.size() + 1 == VolumePyramid::numLevels(res));
+            for (std::size_t l = 0; l < levels.size(); l++) {
+                const auto& level = levels[l];
+                OGL4CORE2_CHECK(level.resolution == VolumePyramid::levelResolution(res, static_cast<uint32_t>(l + 1)));
+                OGL4CORE2_CHECK(level.data.size() ==
+                                static_cast<std::size_t>(level.resolution[0]) * level.resolution[1] *
+                                    level.resolution[2]);
+            }
+        }
+
+        // Constant volumes stay constant with both filters, also at the clamped boundary.
+        const std::vector<uint8_t> constant(static_cast<std::size_t>(res[0]) * res[1] * res[2], 77);
+        for (const auto filter : {VolumePyramid::Filter::Box, VolumePyramid::Filter::Gaussian}) {
+            for (const auto& level : VolumePyramid::build(constant.data(), res, filter, pool)) {
+                for (const auto v : level.data) {
+                    OGL4CORE2_CHECK(v == 77);
+                }
+            }
+        }
+    }
+
+    void testBoxFilter() {
+        ThreadPool pool(2);
+        // Each output voxel is the rounded average of its 2^3 input voxels, an odd last voxel is dropped.
+        const Resolution res = {5, 2, 2};
+        std::vector<uint8_t> data(5 * 2 * 2);
+        for (std::size_t i = 0; i < data.size(); i++) {
+            data[i] = static_cast<uint8_t>(10 * i);
+        }
+        const auto levels = VolumePyramid::build(data.data(), res, VolumePyramid::Filter::Box, pool);
+        OGL4CORE2_CHECK(levels.size() == 2);
+        OGL4CORE2_CHECK((levels[0].resolution == Resolution{2, 1, 1}));
+        // (0 + 10 + 50 + 60 + 100 + 110 + 150 + 160) / 8 = 80, then 20 more for the next pair along x.
+        OGL4CORE2_CHECK(levels[0].data[0] == 80);
+        OGL4CORE2_CHECK(levels[0].data[1] == 100);
+        // The last level of a 2x1x1 volume averages both voxels, rounded half up.
+        OGL4CORE2_CHECK(levels[1].data[0] == 90);
+    }
+
+    void testDownsampleSlabs() {
+        ThreadPool pool(3);
+        // Slabs of slices computed separately match the whole level, the bricked conversion relies on it.
+        const Resolution res = {17, 11, 23};
+        const auto data = randomVolume(res, 7);
+        const auto out = VolumePyramid::levelResolution(res, 1);
+        const std::size_t slice = static_cast<std::size_t>(out[0]) * out[1];
+        for (const auto filter : {VolumePyramid::Filter::Box, VolumePyramid::Filter::Gaussian}) {
+            const auto whole = VolumePyramid::build(data.data(), res, filter, pool).front().data;
+            std::vector<uint8_t> slabs(whole.size());
+            for (uint32_t z = 0; z < out[2]; z += 3) {
+                const uint32_t zEnd = std::min(z + 3, out[2]);
+                VolumePyramid::downsample(data.data(), res, slabs.data() + z * slice, z, zEnd, filter, pool);
+            }
+            OGL4CORE2_CHECK(slabs == whole);
+        }
+    }
+} // namespace
+
+int main() {
+    return runTests({
+        {"VolumePyramid level resolution", testLevelResolution},
+        {"VolumePyramid build", testBuild},
+        {"VolumePyramid box filter", testBoxFilter},
+        {"VolumePyramid downsample slabs", testDownsampleSlabs},
+    });
+}
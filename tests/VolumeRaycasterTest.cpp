@@ -0,0 +1,101 @@
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "TestUtil.h"
+#include "core/util/ThreadPool.h"
+#include "core/util/VolumeRaycaster.h"
+
+using namespace OGL4Core2::Core;
+using namespace OGL4Core2::Test;
+
+namespace {
+    using Mode = VolumeRaycaster::Mode;
+
+    // Neither a multiple of the tile size nor of the packet size, so tiles and packets are partial at the edges.
+    constexpr int width = 67;
+    constexpr int height = 45;
+
+    VolumeRaycaster::Settings makeSettings(Mode mode) {
+        VolumeRaycaster::Settings settings;
+        settings.mode = mode;
+        settings.maxSteps = 400;
+        settings.scale = 0.8f;
+        settings.isoValue = 0.6f;
+        settings.transferFunction = {
+            0.0f, 0.0f, 0.0f, 0.0f,
+            0.2f, 0.4f, 1.0f, 0.02f,
+            1.0f, 0.6f, 0.1f, 0.3f,
+            1.0f, 1.0f, 1.0f, 0.8f,
+        };
+        return settings;
+    }
+
+    /**
+     * Render all modes with the scalar and the AVX2 path and compare the images byte by byte.
+     */
+    void compareModes(const std::array<uint32_t, 3>& resolution, uint32_t seed) {
+        ThreadPool pool(3);
+        auto data = std::make_shared<std::vector<uint8_t>>(randomVolume(resolution, seed));
+        // The exact size, reads beyond the data are caught by address sanitizer builds.
+        const ResourceView volume{data, data->data(), data->size()};
+        const glm::vec3 dimensions = glm::vec3(resolution[0], resolution[1], resolution[2]) /
+                                     static_cast<float>(std::max({resolution[0], resolution[1], resolution[2]}));
+        const VolumeRaycaster scalar(volume, resolution, dimensions, false);
+        const VolumeRaycaster avx2(volume, resolution, dimensions, true);
+        OGL4CORE2_CHECK(!scalar.usesAvx2());
+        OGL4CORE2_CHECK(avx2.usesAvx2() == VolumeRaycaster::cpuSupportsAvx2());
+
+        const glm::mat4 view = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, -2.0f)) *
+                               glm::rotate(glm::mat4(1.0f), glm::radians(-25.0f), glm::vec3(1.0f, 0.0f, 0.0f)) *
+                               glm::rotate(glm::mat4(1.0f), glm::radians(35.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+        const glm::mat4 projection =
+            glm::perspective(glm::radians(45.0f), static_cast<float>(width) / static_cast<float>(height), 0.1f, 10.0f);
+
+        for (const auto mode : {Mode::LineOfSight, Mode::Mip, Mode::Isosurface, Mode::Volume}) {
+            const auto settings = makeSettings(mode);
+            std::vector<unsigned char> expected;
+            std::vector<unsigned char> image;
+            scalar.render(settings, view, projection, width, height, expected, pool);
+            avx2.render(settings, view, projection, width, height, image, pool);
+            OGL4CORE2_CHECK(expected.size() == static_cast<std::size_t>(width) * height * 4);
+            OGL4CORE2_CHECK(image == expected);
+
+            // Otherwise the comparison would be trivial.
+            std::size_t covered = 0;
+            for (std::size_t i = 0; i < expected.size(); i += 4) {
+                covered += expected[i] != 0 || expected[i + 1] != 0 || expected[i + 2] != 0 ? 1 : 0;
+            }
+            OGL4CORE2_CHECK(covered > expected.size() / 4 / 50);
+        }
+    }
+
+    void testOddResolution() {
+        compareModes({23, 17, 11}, 5);
+    }
+
+    void testSmallVolume() {
+        // Just large enough for gathers. Corner pairs in the last two voxels of the data are sampled one by one, in a
+        // volume this small many rays pass through them.
+        compareModes({5, 3, 2}, 6);
+    }
+
+    void testInvalidVolume() {
+        auto data = std::make_shared<std::vector<uint8_t>>(10);
+        OGL4CORE2_CHECK_THROWS(VolumeRaycaster({data, data->data(), data->size()}, {3, 2, 2}, glm::vec3(1.0f)));
+        OGL4CORE2_CHECK_THROWS(VolumeRaycaster({}, {1, 1, 1}, glm::vec3(1.0f)));
+    }
+} // namespace
+
+int main() {
+    return runTests({
+        {"VolumeRaycaster odd resolution", testOddResolution},
+        {"VolumeRaycaster small volume", testSmallVolume},
+        {"VolumeRaycaster invalid volume", testInvalidVolume},
+    });
+}